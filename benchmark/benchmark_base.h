@@ -15,6 +15,7 @@
 #include <sys/time.h>
 
 #include <string>
+#include <unordered_set>
 
 #define CALC_TIME_SPAN(X)       \
     double t_start = elapsed(); \
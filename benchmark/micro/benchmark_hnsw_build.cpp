@@ -0,0 +1,109 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+#include <omp.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark_base.h"
+#include "knowhere/comp/brute_force.h"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/comp/knowhere_config.h"
+#include "knowhere/dataset.h"
+#include "knowhere/factory.h"
+
+// HNSW build time against the number of build threads, one point at a time (build_batch_size = 0) and in rounds
+// searched against a frozen graph. The one by one build takes a lock per visited node and the global lock for every
+// new top level, so it stops scaling well before the core count; the rounds take no lock at all. Recall@10 is
+// printed next to every build to show what the rounds cost in graph quality.
+class Benchmark_hnsw_build : public Benchmark_base, public ::testing::Test {
+ public:
+    void
+    SetUp() override {
+        T0_ = elapsed();
+        dim_ = 128;
+        nb_ = 200000;
+        nq_ = 1000;
+        knowhere::KnowhereConfig::SetSimdType(knowhere::KnowhereConfig::SimdType::AUTO);
+    }
+
+    std::vector<float>
+    gen_data(int32_t rows, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> distrib(-1.0f, 1.0f);
+        std::vector<float> data((size_t)rows * dim_);
+        std::generate(data.begin(), data.end(), [&]() { return distrib(rng); });
+        return data;
+    }
+
+    std::vector<int32_t>
+    thread_counts() {
+        std::vector<int32_t> counts;
+        int32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (int32_t t = 1; t < max_threads; t *= 2) {
+            counts.push_back(t);
+        }
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+ protected:
+    const int32_t topk_ = 10;
+    const std::vector<int32_t> BATCH_SIZEs_ = {0, 1000, 4000};
+};
+
+TEST_F(Benchmark_hnsw_build, TEST_HNSW_BUILD_SCALING) {
+    auto xb = gen_data(nb_, 42);
+    auto xq = gen_data(nq_, 1);
+    auto base = knowhere::GenDataSet(nb_, dim_, xb.data());
+    auto query = knowhere::GenDataSet(nq_, dim_, xq.data());
+
+    knowhere::Json conf;
+    conf[knowhere::meta::DIM] = dim_;
+    conf[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    conf[knowhere::meta::TOPK] = topk_;
+    conf[knowhere::indexparam::HNSW_M] = 16;
+    conf[knowhere::indexparam::EFCONSTRUCTION] = 200;
+    conf[knowhere::indexparam::EF] = 64;
+    auto gt = knowhere::BruteForce::Search(base, query, conf, nullptr);
+    ASSERT_TRUE(gt.has_value());
+    auto gt_ids = gt.value()->GetIds();
+
+    printf("\n[%0.3f s] HNSW build, nb = %d, dim = %d, M = 16, efConstruction = 200\n", get_time_diff(), nb_, dim_);
+    printf("================================================================================\n");
+    for (auto batch_size : BATCH_SIZEs_) {
+        conf[knowhere::indexparam::BUILD_BATCH_SIZE] = batch_size;
+        double t_single = 0.0;
+        for (auto threads : thread_counts()) {
+            omp_set_num_threads(threads);
+            auto index = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+            double t_begin = elapsed();
+            ASSERT_EQ(index.Build(*base, conf), knowhere::Status::success);
+            auto t_build = elapsed() - t_begin;
+            if (threads == 1) {
+                t_single = t_build;
+            }
+
+            auto res = index.Search(*query, conf, nullptr);
+            ASSERT_TRUE(res.has_value());
+            auto recall = CalcRecall(gt_ids, res.value()->GetIds(), nq_, topk_);
+            printf("  batch = %5d, threads = %3d, build = %8.3fs, speedup = %6.2f, R@%d = %.4f\n", batch_size,
+                   threads, t_build, t_single / t_build, topk_, recall);
+            std::fflush(stdout);
+        }
+    }
+    omp_set_num_threads(std::max(1u, std::thread::hardware_concurrency()));
+    printf("================================================================================\n");
+}
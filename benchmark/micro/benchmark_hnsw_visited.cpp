@@ -0,0 +1,115 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark_base.h"
+#include "hnswlib/visited_list_pool.h"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/comp/knowhere_config.h"
+#include "knowhere/dataset.h"
+#include "knowhere/factory.h"
+
+// Per-query latency of HNSW search against index size. With a visited table that is
+// cleared on every query the latency grows linearly with nb even though the number of
+// visited nodes stays roughly constant; the epoch-stamped table keeps it flat.
+class Benchmark_hnsw_visited : public Benchmark_base, public ::testing::Test {
+ public:
+    void
+    SetUp() override {
+        T0_ = elapsed();
+        dim_ = 32;
+        nq_ = 2000;
+        knowhere::KnowhereConfig::SetSimdType(knowhere::KnowhereConfig::SimdType::AUTO);
+    }
+
+    std::vector<float>
+    gen_data(int32_t rows, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> distrib(-1.0f, 1.0f);
+        std::vector<float> data((size_t)rows * dim_);
+        std::generate(data.begin(), data.end(), [&]() { return distrib(rng); });
+        return data;
+    }
+
+ protected:
+    const int32_t topk_ = 10;
+    const std::vector<int32_t> NBs_ = {10000, 100000, 1000000};
+    const std::vector<int32_t> EFs_ = {16, 64};
+    const int32_t kVisitedRounds = 10000;
+};
+
+TEST_F(Benchmark_hnsw_visited, TEST_VISITED_LIST_RESET) {
+    printf("\n[%0.3f s] visited list acquire + reset, %d rounds\n", get_time_diff(), kVisitedRounds);
+    printf("================================================================================\n");
+    for (auto nb : NBs_) {
+        std::vector<bool> bits(nb, false);
+        CALC_TIME_SPAN(for (int32_t i = 0; i < kVisitedRounds; i++) {
+            std::fill(bits.begin(), bits.end(), false);
+            bits[i % nb] = true;
+        });
+        auto t_fill = t_diff;
+
+        hnswlib::VisitedListPool pool(nb);
+        double t_begin = elapsed();
+        for (int32_t i = 0; i < kVisitedRounds; i++) {
+            auto visited = pool.getFreeVisitedList();
+            visited.set(i % nb);
+        }
+        auto t_tag = elapsed() - t_begin;
+
+        printf("  nb = %8d, fill = %8.3fus/query, tagged = %8.3fus/query\n", nb, t_fill * 1e6 / kVisitedRounds,
+               t_tag * 1e6 / kVisitedRounds);
+        std::fflush(stdout);
+    }
+    printf("================================================================================\n");
+}
+
+TEST_F(Benchmark_hnsw_visited, TEST_HNSW_LATENCY_VS_NB) {
+    auto xq = gen_data(nq_, 1);
+
+    knowhere::Json conf;
+    conf[knowhere::meta::DIM] = dim_;
+    conf[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    conf[knowhere::meta::TOPK] = topk_;
+    conf[knowhere::indexparam::HNSW_M] = 16;
+    conf[knowhere::indexparam::EFCONSTRUCTION] = 100;
+
+    printf("\n[%0.3f s] HNSW single-thread per-query latency, dim = %d, nq = %d, k = %d\n", get_time_diff(), dim_,
+           nq_, topk_);
+    printf("================================================================================\n");
+    for (auto nb : NBs_) {
+        auto xb = gen_data(nb, 42);
+        auto base = knowhere::GenDataSet(nb, dim_, xb.data());
+        auto index = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        ASSERT_EQ(index.Build(*base, conf), knowhere::Status::success);
+        printf("[%0.3f s] built index on %d vectors\n", get_time_diff(), nb);
+
+        for (auto ef : EFs_) {
+            conf[knowhere::indexparam::EF] = ef;
+            double t_total = 0.0;
+            for (int32_t i = 0; i < nq_; i++) {
+                auto one = knowhere::GenDataSet(1, dim_, xq.data() + (size_t)i * dim_);
+                double t_begin = elapsed();
+                auto res = index.Search(*one, conf, nullptr);
+                t_total += elapsed() - t_begin;
+                ASSERT_TRUE(res.has_value());
+            }
+            printf("  nb = %8d, ef = %4d, latency = %8.3fus/query\n", nb, ef, t_total * 1e6 / nq_);
+            std::fflush(stdout);
+        }
+    }
+    printf("================================================================================\n");
+}
@@ -0,0 +1,133 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark_base.h"
+#include "common/kmeans.h"
+#include "faiss/Clustering.h"
+#include "faiss/IndexFlat.h"
+#include "knowhere/comp/knowhere_config.h"
+#include "knowhere/comp/thread_pool.h"
+
+// Wall time and quality of the coarse quantizer training of IVF: faiss::Clustering, which IVF Train uses by default,
+// against the k-means of common/kmeans.h in full batch mode and in mini-batch mode (kmeans_batch_size). The objective
+// is the mean squared distance of all the points to their closest centroid, the convergence column lists the
+// objectives the training measured along the way.
+class Benchmark_kmeans : public Benchmark_base, public ::testing::Test {
+ public:
+    void
+    SetUp() override {
+        T0_ = elapsed();
+        dim_ = 128;
+        nb_ = 1000000;
+        knowhere::KnowhereConfig::SetSimdType(knowhere::KnowhereConfig::SimdType::AUTO);
+    }
+
+    // points around nb / 1000 random means, so that the data has a real cluster structure
+    std::vector<float>
+    gen_data(int32_t rows, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        const int32_t n_means = std::max(1, rows / 1000);
+        std::vector<float> means((size_t)n_means * dim_);
+        for (auto& v : means) {
+            v = normal(rng) * 4;
+        }
+        std::vector<float> data((size_t)rows * dim_);
+        for (int32_t i = 0; i < rows; ++i) {
+            const float* mean = means.data() + (size_t)(rng() % n_means) * dim_;
+            for (int32_t j = 0; j < dim_; ++j) {
+                data[(size_t)i * dim_ + j] = mean[j] + normal(rng);
+            }
+        }
+        return data;
+    }
+
+    double
+    objective(const std::vector<float>& xb, const std::vector<float>& centroids, int32_t k) {
+        std::vector<int64_t> assign(nb_);
+        std::vector<float> dis(nb_);
+        knowhere::KMeansAssign(knowhere::ThreadPool::GetGlobalThreadPool(), xb.data(), nb_, dim_, centroids.data(), k,
+                               false, assign.data(), dis.data());
+        double sum = 0;
+        for (auto v : dis) {
+            sum += v;
+        }
+        return sum / nb_;
+    }
+
+    void
+    print_row(const char* name, double t, double t_base, double obj, const std::vector<double>& trace, size_t rows) {
+        printf("  %-22s time = %8.3fs, speedup = %6.2f, objective = %10.4f, convergence:", name, t, t_base / t, obj);
+        for (auto v : trace) {
+            printf(" %.4g", v / rows);
+        }
+        printf("\n");
+        std::fflush(stdout);
+    }
+
+ protected:
+    const std::vector<int32_t> NLISTs_ = {1024, 4096};
+    const std::vector<int32_t> BATCH_SIZEs_ = {4096, 16384, 65536};
+};
+
+TEST_F(Benchmark_kmeans, TEST_KMEANS_CONVERGENCE) {
+    auto xb = gen_data(nb_, 42);
+    auto pool = knowhere::ThreadPool::GetGlobalThreadPool();
+
+    printf("\n[%0.3f s] k-means, nb = %d, dim = %d, threads = %d\n", get_time_diff(), nb_, dim_, pool->size());
+    printf("================================================================================\n");
+    for (auto nlist : NLISTs_) {
+        printf("nlist = %d\n", nlist);
+
+        faiss::ClusteringParameters cp;
+        faiss::Clustering clus(dim_, nlist, cp);
+        faiss::IndexFlatL2 assigner(dim_);
+        double t_begin = elapsed();
+        clus.train(nb_, xb.data(), assigner);
+        double t_faiss = elapsed() - t_begin;
+        std::vector<double> trace;
+        for (auto& st : clus.iteration_stats) {
+            trace.push_back(st.obj);
+        }
+        const size_t sample_rows = std::min<size_t>(nb_, (size_t)nlist * cp.max_points_per_centroid);
+        print_row("faiss::Clustering", t_faiss, t_faiss, objective(xb, clus.centroids, nlist), trace, sample_rows);
+
+        knowhere::KMeansConfig cfg;
+        cfg.niter = cp.niter;
+        std::vector<float> centroids((size_t)nlist * dim_);
+        knowhere::KMeansStats stats;
+        t_begin = elapsed();
+        ASSERT_EQ(knowhere::KMeansTrain(pool, xb.data(), nb_, dim_, nlist, cfg, centroids.data(), &stats),
+                  knowhere::Status::success);
+        print_row("full batch", elapsed() - t_begin, t_faiss, objective(xb, centroids, nlist), stats.objectives,
+                  sample_rows);
+
+        for (auto batch_size : BATCH_SIZEs_) {
+            cfg.batch_size = batch_size;
+            t_begin = elapsed();
+            ASSERT_EQ(knowhere::KMeansTrain(pool, xb.data(), nb_, dim_, nlist, cfg, centroids.data(), &stats),
+                      knowhere::Status::success);
+            auto t = elapsed() - t_begin;
+            char name[64];
+            snprintf(name, sizeof(name), "mini-batch %d", batch_size);
+            print_row(name, t, t_faiss, objective(xb, centroids, nlist), stats.objectives,
+                      std::min<size_t>(nb_, cfg.eval_size));
+            printf("  %-22s %ld steps, converged: %d\n", "", stats.iterations, stats.converged);
+        }
+    }
+    printf("================================================================================\n");
+}
@@ -3,6 +3,11 @@ find_package(Boost REQUIRED COMPONENTS program_options)
 include_directories(${Boost_INCLUDE_DIR})
 find_package(aio REQUIRED)
 include_directories(${AIO_INCLUDE})
+if(WITH_IO_URING)
+  find_package(uring REQUIRED)
+  include_directories(${URING_INCLUDE_DIR})
+  add_definitions(-DKNOWHERE_WITH_IO_URING)
+endif()
 include_directories(thirdparty/DiskANN/include)
 
 find_package(double-conversion REQUIRED)
@@ -20,9 +25,14 @@ set(DISKANN_SOURCES
     thirdparty/DiskANN/src/pq_flash_index.cpp
     thirdparty/DiskANN/src/logger.cpp
     thirdparty/DiskANN/src/utils.cpp)
+if(WITH_IO_URING)
+  list(APPEND DISKANN_SOURCES
+       thirdparty/DiskANN/src/io_uring_aligned_file_reader.cpp)
+endif()
 
 add_library(diskann STATIC ${DISKANN_SOURCES})
 target_link_libraries(diskann PUBLIC ${AIO_LIBRARIES}
+                                     ${URING_LIBRARIES}
                                      ${DISKANN_BOOST_PROGRAM_OPTIONS_LIB}
                                      nlohmann_json::nlohmann_json
                                      glog::glog)
@@ -28,6 +28,7 @@ class KnowhereConan(ConanFile):
         "with_raft": [True, False],
         "with_asan": [True, False],
         "with_diskann": [True, False],
+        "with_io_uring": [True, False],
         "with_profiler": [True, False],
         "with_ut": [True, False],
         "with_benchmark": [True, False],
@@ -39,6 +40,7 @@ class KnowhereConan(ConanFile):
         "with_raft": False,
         "with_asan": False,
         "with_diskann": False,
+        "with_io_uring": False,
         "with_profiler": False,
         "with_ut": False,
         "glog:with_gflags": True,
@@ -152,6 +154,7 @@ class KnowhereConan(ConanFile):
                 self)
         tc.variables["WITH_ASAN"] = self.options.with_asan
         tc.variables["WITH_DISKANN"] = self.options.with_diskann
+        tc.variables["WITH_IO_URING"] = self.options.with_io_uring
         tc.variables["WITH_RAFT"] = self.options.with_raft
         tc.variables["WITH_PROFILER"] = self.options.with_profiler
         tc.variables["WITH_UT"] = self.options.with_ut
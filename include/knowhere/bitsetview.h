@@ -12,11 +12,62 @@
 #ifndef BITSET_H
 #define BITSET_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace knowhere {
+class BitsetView;
+
+// Facts about a filter bitset that the indexes need to pick how to filter. It is computed once per request by
+// Index<T>, so that no index has to scan the bitset again. A set bit filters its id out, ids are grouped in blocks of
+// kBlockBits bits.
+struct BitsetSummary {
+    static constexpr size_t kBlockBits = 4096;
+
+    BitsetSummary() = default;
+
+    explicit BitsetSummary(const BitsetView& bitset);
+
+    // filtered / num_bits, 0 for an empty bitset
+    float
+    filter_ratio() const {
+        return num_bits == 0 ? 0.0f : (float)filtered / num_bits;
+    }
+
+    size_t
+    block_num() const {
+        return block_filtered.size();
+    }
+
+    size_t
+    block_bits(size_t block) const {
+        return std::min(kBlockBits, num_bits - block * kBlockBits);
+    }
+
+    bool
+    block_all_filtered(size_t block) const {
+        return block_filtered[block] == block_bits(block);
+    }
+
+    bool
+    block_none_filtered(size_t block) const {
+        return block_filtered[block] == 0;
+    }
+
+    size_t num_bits = 0;
+    size_t filtered = 0;
+    // -1 when every id is filtered out
+    int64_t first_valid = -1;
+    int64_t last_valid = -1;
+    // number of filtered ids of every block
+    std::vector<uint16_t> block_filtered;
+};
+
 class BitsetView {
  public:
     BitsetView() = default;
@@ -53,8 +104,12 @@ class BitsetView {
         return bits_[index >> 3] & (0x1 << (index & 0x7));
     }
 
+    // O(1) when a summary is attached
     size_t
     count() const {
+        if (summary_ != nullptr) {
+            return summary_->filtered;
+        }
         size_t ret = 0;
         auto len_uint8 = byte_size();
         auto len_uint64 = len_uint8 >> 3;
@@ -95,10 +150,94 @@ class BitsetView {
         return buf.str();
     }
 
+    // the summary of this bitset, nullptr when the view was not made by WithSummary
+    const BitsetSummary*
+    summary() const {
+        return summary_;
+    }
+
+    // a view of the same bits carrying summary, which must have been computed from them and outlive the view
+    BitsetView
+    WithSummary(const BitsetSummary* summary) const {
+        BitsetView view(*this);
+        view.summary_ = summary;
+        return view;
+    }
+
  private:
     const uint8_t* bits_ = nullptr;
     size_t num_bits_ = 0;
+    const BitsetSummary* summary_ = nullptr;
+};
+
+inline BitsetSummary::BitsetSummary(const BitsetView& bitset) : num_bits(bitset.size()) {
+    if (num_bits == 0) {
+        return;
+    }
+    const uint8_t* bits = bitset.data();
+    block_filtered.resize((num_bits + kBlockBits - 1) / kBlockBits);
+    // kBlockBits is a multiple of 64, so a word never spans two blocks
+    constexpr size_t kWordsPerBlock = kBlockBits / 64;
+    const size_t full_words = num_bits / 64;
+    for (size_t w = 0; w < full_words; w++) {
+        uint64_t word;
+        memcpy(&word, bits + w * 8, sizeof(word));
+        const auto cnt = __builtin_popcountll(word);
+        block_filtered[w / kWordsPerBlock] += cnt;
+        if (cnt == 64) {
+            continue;
+        }
+        if (first_valid < 0) {
+            first_valid = w * 64 + __builtin_ctzll(~word);
+        }
+        last_valid = w * 64 + 63 - __builtin_clzll(~word);
+    }
+    for (size_t i = full_words * 64; i < num_bits; i++) {
+        if (bitset.test(i)) {
+            block_filtered[i / kBlockBits]++;
+        } else {
+            if (first_valid < 0) {
+                first_valid = i;
+            }
+            last_valid = i;
+        }
+    }
+    for (auto cnt : block_filtered) {
+        filtered += cnt;
+    }
+}
+
+// How an index applies a filter bitset to one request.
+enum class FilterStrategy {
+    NONE,          // no id is filtered out
+    POST_FILTER,   // search ignoring the bitset, then drop the filtered ids of the result
+    PRE_FILTER,    // keep the filtered ids out of the result while searching
+    BRUTE_FORCE,   // scan only the ids the bitset lets through
+    ALL_FILTERED,  // every id is filtered out, the result is empty
 };
+
+// Picks the strategy from the share of filtered ids among num_ids: post filtering below post_filter_ratio, brute force
+// from brute_force_ratio on, pre filtering in between. An index that never post filters passes 0.
+inline FilterStrategy
+ChooseFilterStrategy(const BitsetView& bitset, size_t num_ids, float post_filter_ratio, float brute_force_ratio) {
+    if (bitset.empty()) {
+        return FilterStrategy::NONE;
+    }
+    const size_t filtered = bitset.count();
+    if (filtered == 0) {
+        return FilterStrategy::NONE;
+    }
+    if (filtered == num_ids) {
+        return FilterStrategy::ALL_FILTERED;
+    }
+    if (filtered >= num_ids * brute_force_ratio) {
+        return FilterStrategy::BRUTE_FORCE;
+    }
+    if (filtered < num_ids * post_filter_ratio) {
+        return FilterStrategy::POST_FILTER;
+    }
+    return FilterStrategy::PRE_FILTER;
+}
 }  // namespace knowhere
 
 #endif /* BITSET_H */
@@ -28,7 +28,12 @@ constexpr const char* INDEX_FAISS_IDMAP = "FLAT";
 constexpr const char* INDEX_FAISS_IVFFLAT = "IVF_FLAT";
 constexpr const char* INDEX_FAISS_IVFFLAT_CC = "IVF_FLAT_CC";
 constexpr const char* INDEX_FAISS_IVFPQ = "IVF_PQ";
+constexpr const char* INDEX_FAISS_IVFPQ_FASTSCAN = "IVF_PQ_FASTSCAN";
 constexpr const char* INDEX_FAISS_IVFSQ8 = "IVF_SQ8";
+constexpr const char* INDEX_FAISS_IVFSQ4 = "IVF_SQ4";
+constexpr const char* INDEX_FAISS_IVFSQ6 = "IVF_SQ6";
+constexpr const char* INDEX_FAISS_IVFFP16 = "IVF_FP16";
+constexpr const char* INDEX_FAISS_IVFBF16 = "IVF_BF16";
 
 constexpr const char* INDEX_FAISS_GPU_IDMAP = "GPU_FAISS_FLAT";
 constexpr const char* INDEX_FAISS_GPU_IVFFLAT = "GPU_FAISS_IVF_FLAT";
@@ -40,6 +45,8 @@ constexpr const char* INDEX_RAFT_IVFPQ = "GPU_RAFT_IVF_PQ";
 constexpr const char* INDEX_RAFT_CAGRA = "GPU_RAFT_CAGRA";
 
 constexpr const char* INDEX_HNSW = "HNSW";
+constexpr const char* INDEX_HNSW_SQ8 = "HNSW_SQ8";
+constexpr const char* INDEX_HNSW_FP16 = "HNSW_FP16";
 constexpr const char* INDEX_DISKANN = "DISKANN";
 
 }  // namespace IndexEnum
@@ -61,6 +68,9 @@ constexpr const char* OUTPUT_TENSOR = "output_tensor";
 constexpr const char* DEVICE_ID = "gpu_id";
 constexpr const char* NUM_BUILD_THREAD = "num_build_thread";
 constexpr const char* TRACE_VISIT = "trace_visit";
+constexpr const char* THREAD_POOL = "thread_pool";
+constexpr const char* TASK_PRIORITY = "task_priority";
+constexpr const char* MAX_CONCURRENCY = "max_concurrency";
 constexpr const char* JSON_INFO = "json_info";
 constexpr const char* JSON_ID_SET = "json_id_set";
 };  // namespace meta
@@ -72,11 +82,18 @@ constexpr const char* NLIST = "nlist";
 constexpr const char* NBITS = "nbits";  // PQ/SQ
 constexpr const char* M = "m";          // PQ param for IVFPQ
 constexpr const char* SSIZE = "ssize";
+constexpr const char* REFINE_K = "refine_k";  // IVF_PQ_FASTSCAN
+constexpr const char* KMEANS_BATCH_SIZE = "kmeans_batch_size";
 // HNSW Params
 constexpr const char* EFCONSTRUCTION = "efConstruction";
 constexpr const char* HNSW_M = "M";
 constexpr const char* EF = "ef";
 constexpr const char* OVERVIEW_LEVELS = "overview_levels";
+constexpr const char* GRAPH_REORDER = "graph_reorder";
+constexpr const char* BUILD_BATCH_SIZE = "build_batch_size";
+constexpr const char* REFINE = "refine";  // HNSW_SQ8/HNSW_FP16/IVF_PQ_FASTSCAN
+// HNSW/DiskANN Params
+constexpr const char* ENTRY_CACHE_SIZE = "entry_cache_size";
 }  // namespace indexparam
 
 using MetricType = std::string;
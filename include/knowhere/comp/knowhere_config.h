@@ -81,6 +81,26 @@ class KnowhereConfig {
     static void
     SetAioContextPool(size_t num_ctx, size_t max_events);
 
+    /**
+     * Select how DiskANN reads from disk, it applies to indexes loaded afterwards.
+     *   LIBAIO (default) shares the global aio context pool above.
+     *   IO_URING gives every search thread its own ring of `queue_depth` entries with the sector buffers registered
+     *   up front, so it is not bound by `aio-max-nr`. With `sqpoll` a kernel thread polls the submission queues and
+     *   reads need no syscall, at the cost of a busy core while searches are running.
+     * IO_URING needs a build with WITH_IO_URING and a kernel that allows io_uring, otherwise LIBAIO is kept and
+     * false is returned.
+     */
+    enum DiskIOBackend {
+        LIBAIO = 0,
+        IO_URING,
+    };
+
+    static bool
+    SetDiskIOBackend(const DiskIOBackend backend, bool sqpoll = false, size_t queue_depth = 256);
+
+    static DiskIOBackend
+    GetDiskIOBackend();
+
     /**
      * init GPU Resource
      */
@@ -0,0 +1,82 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace knowhere {
+
+// Phases of a search, each one is a histogram of knowhere_search_phase_latency.
+enum class SearchPhase {
+    COARSE_QUANTIZATION = 0,  // IVF, picking the lists to probe
+    LIST_SCAN = 1,            // IVF, scanning the probed lists
+    GRAPH_HOPS = 2,           // HNSW, walking the graph
+    IO_WAIT = 3,              // DiskANN, waiting for sector reads
+    RESULT_ASSEMBLY = 4,      // gathering the hits of all queries into the result of a range search
+};
+
+// graph indexes that start their searches from a cached entry point
+enum class EntryCacheIndex {
+    HNSW = 0,
+    DISKANN = 1,
+};
+
+// The functions below feed the prometheus metrics of prometheus_client.h. They are declared apart so that faiss,
+// hnswlib and DiskANN can report without the prometheus headers.
+
+// one sample of phase, in milliseconds
+void
+ObserveSearchPhase(SearchPhase phase, double ms);
+
+// moves knowhere_thread_pool_queue_depth, the number of tasks pushed to a thread pool that have not started yet
+void
+AddThreadPoolQueueDepth(int64_t delta);
+
+// node visits of a DiskANN search that the node cache served and that went to the disk
+void
+CountNodeCacheAccesses(uint64_t hits, uint64_t misses);
+
+// one rebuild of an adaptive DiskANN node cache
+void
+CountNodeCacheRefresh();
+
+// one lookup of the entry point cache of a search, hit when it found an entry point for the query
+void
+CountEntryCacheLookup(EntryCacheIndex index, bool hit);
+
+// Observes the time from its construction to its destruction as one sample of a phase.
+class ScopedPhaseTimer {
+ public:
+    explicit ScopedPhaseTimer(SearchPhase phase) : phase_(phase), start_(std::chrono::steady_clock::now()) {
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+
+    ScopedPhaseTimer&
+    operator=(const ScopedPhaseTimer&) = delete;
+
+    ~ScopedPhaseTimer() {
+        ObserveSearchPhase(phase_, ElapsedMs(start_));
+    }
+
+    static double
+    ElapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+ private:
+    SearchPhase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace knowhere
@@ -13,23 +13,152 @@
 
 #include <omp.h>
 
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
 #include <utility>
 
+#include "folly/ScopeGuard.h"
 #include "folly/executors/CPUThreadPoolExecutor.h"
+#include "folly/executors/ExecutorWithPriority.h"
 #include "folly/futures/Future.h"
+#include "knowhere/comp/metrics.h"
 #include "knowhere/log.h"
 
 namespace knowhere {
 
+// Lanes of a ThreadPool. An idle thread always takes the oldest task of the highest non-empty lane, so a lower lane
+// runs on whatever the higher ones leave idle and never holds threads back from them.
+enum class TaskPriority {
+    // latency sensitive searches
+    INTERACTIVE = 0,
+    // large-nq searches and other throughput work
+    BATCH = 1,
+    // build, load and warm up
+    BUILD = 2,
+};
+
+// Caps how many tasks of one request run at the same time. Tasks beyond the cap are queued here and only reach
+// the pool once an earlier task of the request finishes, so they do not fill the lanes ahead of other requests.
+class TaskConcurrencyLimiter {
+ public:
+    explicit TaskConcurrencyLimiter(size_t limit) : limit_(limit) {
+    }
+
+    // the promise is fulfilled once the task may run
+    void
+    Acquire(folly::Promise<folly::Unit> gate) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (running_ >= limit_) {
+                pending_.push_back(std::move(gate));
+                return;
+            }
+            ++running_;
+        }
+        gate.setValue();
+    }
+
+    void
+    Release() {
+        folly::Promise<folly::Unit> next;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.empty()) {
+                --running_;
+                return;
+            }
+            next = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        next.setValue();
+    }
+
+ private:
+    const size_t limit_;
+    std::mutex mutex_;
+    size_t running_ = 0;
+    std::deque<folly::Promise<folly::Unit>> pending_;
+};
+
+class ThreadPool;
+
+// Scheduling hints of the current thread. ThreadPool::push() submits into the lane of the pushing thread and the
+// task runs with the same context, so everything a request fans out to inherits its lane and its pool.
+struct TaskContext {
+    TaskPriority priority = TaskPriority::INTERACTIVE;
+    std::shared_ptr<TaskConcurrencyLimiter> limiter = nullptr;
+    // the pool the request fans out to, nullptr for the pool of the index
+    std::shared_ptr<ThreadPool> pool = nullptr;
+};
+
 class ThreadPool {
  public:
+    class ScopedTaskContext {
+        TaskContext ctx_before;
+
+     public:
+        explicit ScopedTaskContext(TaskContext ctx) : ctx_before(std::move(current_task_context_)) {
+            current_task_context_ = std::move(ctx);
+        }
+        // a new request: tasks it pushes go to `priority` and at most `max_concurrency` of them run at once, 0 for
+        // no cap
+        explicit ScopedTaskContext(TaskPriority priority, size_t max_concurrency = 0)
+            : ScopedTaskContext(
+                  TaskContext{priority, max_concurrency > 0
+                                            ? std::make_shared<TaskConcurrencyLimiter>(max_concurrency)
+                                            : nullptr}) {
+        }
+        ~ScopedTaskContext() {
+            current_task_context_ = std::move(ctx_before);
+        }
+        ScopedTaskContext(const ScopedTaskContext&) = delete;
+        ScopedTaskContext&
+        operator=(const ScopedTaskContext&) = delete;
+    };
+
+    static const TaskContext&
+    CurrentTaskContext() {
+        return current_task_context_;
+    }
+
+    // The pool the current request fans its tasks out to: the one it picked through the `thread_pool` param, or
+    // `fallback` if it picked none.
+    static std::shared_ptr<ThreadPool>
+    CurrentThreadPool(const std::shared_ptr<ThreadPool>& fallback) {
+        const auto& pool = current_task_context_.pool;
+        return pool != nullptr ? pool : fallback;
+    }
+
+    static std::shared_ptr<ThreadPool>
+    CurrentThreadPool() {
+        const auto& pool = current_task_context_.pool;
+        return pool != nullptr ? pool : GetGlobalThreadPool();
+    }
+
+    static std::optional<TaskPriority>
+    ParseTaskPriority(const std::string& name) {
+        if (name == "interactive") {
+            return TaskPriority::INTERACTIVE;
+        }
+        if (name == "batch") {
+            return TaskPriority::BATCH;
+        }
+        if (name == "build") {
+            return TaskPriority::BUILD;
+        }
+        return std::nullopt;
+    }
+
     explicit ThreadPool(uint32_t num_threads)
         : pool_(folly::CPUThreadPoolExecutor(
               num_threads,
-              std::make_unique<
-                  folly::LifoSemMPMCQueue<folly::CPUThreadPoolExecutor::CPUTask, folly::QueueBehaviorIfFull::BLOCK>>(
-                  num_threads * kTaskQueueFactor))) {
+              std::make_unique<folly::PriorityLifoSemMPMCQueue<folly::CPUThreadPoolExecutor::CPUTask,
+                                                               folly::QueueBehaviorIfFull::BLOCK>>(
+                  kNumPriorities, num_threads * kTaskQueueFactor))) {
     }
 
     ThreadPool(const ThreadPool&) = delete;
@@ -42,11 +171,35 @@ class ThreadPool {
     ThreadPool&
     operator=(ThreadPool&&) noexcept = delete;
 
+    // Run func on the pool in the lane of the calling thread. When the caller is inside a request with a
+    // concurrency cap the task waits for a slot first; it then runs without the cap, so a capped task that pushes
+    // and waits for more tasks can not deadlock on its own slot.
     template <typename Func, typename... Args>
     auto
     push(Func&& func, Args&&... args) {
-        return folly::makeSemiFuture().via(&pool_).then(
-            [func = std::forward<Func>(func), &args...](auto&&) mutable { return func(std::forward<Args>(args)...); });
+        TaskContext ctx = current_task_context_;
+        auto executor = folly::ExecutorWithPriority::create(folly::getKeepAliveToken(&pool_),
+                                                            FollyPriority(ctx.priority));
+        auto limiter = std::move(ctx.limiter);
+        AddThreadPoolQueueDepth(1);
+        // a task that is dropped without running, e.g. when its gate is broken, still leaves the queue
+        auto queued = folly::makeGuard([]() { AddThreadPoolQueueDepth(-1); });
+        auto task = [ctx = std::move(ctx), queued = std::move(queued), func = std::forward<Func>(func),
+                     &args...](auto&&) mutable {
+            queued.dismiss();
+            AddThreadPoolQueueDepth(-1);
+            ScopedTaskContext scope(ctx);
+            return func(std::forward<Args>(args)...);
+        };
+        if (limiter == nullptr) {
+            return folly::makeSemiFuture().via(std::move(executor)).then(std::move(task));
+        }
+        folly::Promise<folly::Unit> gate;
+        auto fut = gate.getSemiFuture().via(std::move(executor)).then(std::move(task)).ensure([limiter]() {
+            limiter->Release();
+        });
+        limiter->Acquire(std::move(gate));
+        return fut;
     }
 
     [[nodiscard]] int32_t
@@ -96,6 +249,44 @@ class ThreadPool {
         return pool;
     }
 
+    /**
+     * @brief Create a named thread pool, e.g. a dedicated pool for one collection. Requests pick it through the
+     * `thread_pool` search param. Creating a name twice keeps the first pool.
+     *
+     * @param name
+     * @param num_threads
+     * @return std::shared_ptr<ThreadPool>
+     */
+    static std::shared_ptr<ThreadPool>
+    CreateThreadPool(const std::string& name, uint32_t num_threads) {
+        if (num_threads <= 0) {
+            LOG_KNOWHERE_ERROR_ << "num_threads should be bigger than 0";
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(named_pools_mutex_);
+        auto& pool = named_pools_[name];
+        if (pool != nullptr) {
+            LOG_KNOWHERE_WARNING_ << "ThreadPool " << name
+                                  << " has already been created with threads num: " << pool->size();
+            return pool;
+        }
+        pool = std::make_shared<ThreadPool>(num_threads);
+        return pool;
+    }
+
+    /**
+     * @brief Get a pool created by CreateThreadPool().
+     *
+     * @param name
+     * @return std::shared_ptr<ThreadPool>, nullptr if there is no pool with this name
+     */
+    static std::shared_ptr<ThreadPool>
+    GetThreadPool(const std::string& name) {
+        std::lock_guard<std::mutex> lock(named_pools_mutex_);
+        auto it = named_pools_.find(name);
+        return it == named_pools_.end() ? nullptr : it->second;
+    }
+
     class ScopedOmpSetter {
         int omp_before;
 
@@ -109,9 +300,25 @@ class ThreadPool {
     };
 
  private:
+    static int8_t
+    FollyPriority(TaskPriority priority) {
+        switch (priority) {
+            case TaskPriority::INTERACTIVE:
+                return folly::Executor::HI_PRI;
+            case TaskPriority::BATCH:
+                return folly::Executor::MID_PRI;
+            default:
+                return folly::Executor::LO_PRI;
+        }
+    }
+
     folly::CPUThreadPoolExecutor pool_;
     inline static uint32_t global_thread_pool_size_ = 0;
     inline static std::mutex global_thread_pool_mutex_;
+    inline static std::unordered_map<std::string, std::shared_ptr<ThreadPool>> named_pools_;
+    inline static std::mutex named_pools_mutex_;
+    inline static thread_local TaskContext current_task_context_;
     constexpr static size_t kTaskQueueFactor = 16;
+    constexpr static int8_t kNumPriorities = 3;
 };
 }  // namespace knowhere
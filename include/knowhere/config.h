@@ -499,6 +499,9 @@ class BaseConfig : public Config {
     CFG_BOOL trace_visit;
     CFG_BOOL enable_mmap;
     CFG_BOOL for_tuning;
+    CFG_STRING thread_pool;
+    CFG_STRING task_priority;
+    CFG_INT max_concurrency;
     KNOHWERE_DECLARE_CONFIG(BaseConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(metric_type).set_default("L2").description("metric type").for_train_and_search();
         KNOWHERE_CONFIG_DECLARE_FIELD(k)
@@ -529,6 +532,22 @@ class BaseConfig : public Config {
             .description("enable mmap for load index")
             .for_deserialize_from_file();
         KNOWHERE_CONFIG_DECLARE_FIELD(for_tuning).set_default(false).description("for tuning").for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(thread_pool)
+            .description("name of the thread pool to search on, empty for the pool of the index.")
+            .allow_empty_without_default()
+            .for_search()
+            .for_range_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(task_priority)
+            .set_default("interactive")
+            .description("scheduling lane of the search, one of interactive, batch and build.")
+            .for_search()
+            .for_range_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(max_concurrency)
+            .set_default(0)
+            .description("max number of tasks of one search running at the same time, 0 for no limit.")
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .for_search()
+            .for_range_search();
     }
 
     virtual Status
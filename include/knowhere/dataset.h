@@ -17,189 +17,116 @@
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <string>
 #include <utility>
-#include <variant>
+#include <vector>
 
 #include "comp/index_param.h"
 
 namespace knowhere {
 
+// The fields used on the search path are plain members, so reading them takes neither a lock nor a map lookup.
+// They are meant to be set while the DataSet is built and not touched once it is shared between threads; only the
+// deprecated Set/Get key-value API keeps a map and a lock.
 class DataSet {
  public:
-    typedef std::variant<const float*, const size_t*, const int64_t*, const void*, int64_t, std::string, std::any> Var;
     DataSet() = default;
+    DataSet(const DataSet&) = delete;
+    DataSet&
+    operator=(const DataSet&) = delete;
     ~DataSet() {
-        if (!is_owner) {
+        if (!is_owner_) {
             return;
         }
-        for (auto&& x : this->data_) {
-            {
-                auto ptr = std::get_if<0>(&x.second);
-                if (ptr != nullptr) {
-                    delete[] * ptr;
-                }
-            }
-            {
-                auto ptr = std::get_if<1>(&x.second);
-                if (ptr != nullptr) {
-                    delete[] * ptr;
-                }
-            }
-            {
-                auto ptr = std::get_if<2>(&x.second);
-                if (ptr != nullptr) {
-                    delete[] * ptr;
-                }
-            }
-            {
-                auto ptr = std::get_if<3>(&x.second);
-                if (ptr != nullptr) {
-                    delete[](char*)(*ptr);
-                }
-            }
-        }
+        delete[] distance_;
+        delete[] lims_;
+        delete[] ids_;
+        delete[](char*) tensor_;
     }
 
     void
     SetDistance(const float* dis) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::DISTANCE] = Var(std::in_place_index<0>, dis);
+        distance_ = dis;
     }
 
     void
     SetLims(const size_t* lims) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::LIMS] = Var(std::in_place_index<1>, lims);
+        lims_ = lims;
     }
 
     void
     SetIds(const int64_t* ids) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::IDS] = Var(std::in_place_index<2>, ids);
+        ids_ = ids;
     }
 
     void
     SetTensor(const void* tensor) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::TENSOR] = Var(std::in_place_index<3>, tensor);
+        tensor_ = tensor;
     }
 
     void
     SetRows(const int64_t rows) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::ROWS] = Var(std::in_place_index<4>, rows);
+        rows_ = rows;
     }
 
     void
     SetDim(const int64_t dim) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::DIM] = Var(std::in_place_index<4>, dim);
+        dim_ = dim;
     }
 
     void
     SetJsonInfo(const std::string& info) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::JSON_INFO] = Var(std::in_place_index<5>, info);
+        json_info_ = info;
     }
 
     void
     SetJsonIdSet(const std::string& idset) {
-        std::unique_lock lock(mutex_);
-        this->data_[meta::JSON_ID_SET] = Var(std::in_place_index<5>, idset);
+        json_id_set_ = idset;
     }
 
     const float*
     GetDistance() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::DISTANCE);
-        if (it != this->data_.end()) {
-            const float* res = *std::get_if<0>(&it->second);
-            return res;
-        }
-        return nullptr;
+        return distance_;
     }
 
     const size_t*
     GetLims() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::LIMS);
-        if (it != this->data_.end()) {
-            const size_t* res = *std::get_if<1>(&it->second);
-            return res;
-        }
-        return nullptr;
+        return lims_;
     }
 
     const int64_t*
     GetIds() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::IDS);
-        if (it != this->data_.end()) {
-            const int64_t* res = *std::get_if<2>(&it->second);
-            return res;
-        }
-        return nullptr;
+        return ids_;
     }
 
     const void*
     GetTensor() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::TENSOR);
-        if (it != this->data_.end()) {
-            const void* res = *std::get_if<3>(&it->second);
-            return res;
-        }
-        return nullptr;
+        return tensor_;
     }
 
     int64_t
     GetRows() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::ROWS);
-        if (it != this->data_.end()) {
-            int64_t res = *std::get_if<4>(&it->second);
-            return res;
-        }
-        return 0;
+        return rows_;
     }
 
     int64_t
     GetDim() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::DIM);
-        if (it != this->data_.end()) {
-            int64_t res = *std::get_if<4>(&it->second);
-            return res;
-        }
-        return 0;
+        return dim_;
     }
 
     std::string
     GetJsonInfo() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::JSON_INFO);
-        if (it != this->data_.end()) {
-            std::string res = *std::get_if<5>(&it->second);
-            return res;
-        }
-        return "";
+        return json_info_;
     }
 
     std::string
     GetJsonIdSet() const {
-        std::shared_lock lock(mutex_);
-        auto it = this->data_.find(meta::JSON_ID_SET);
-        if (it != this->data_.end()) {
-            std::string res = *std::get_if<5>(&it->second);
-            return res;
-        }
-        return "";
+        return json_id_set_;
     }
 
     void
     SetIsOwner(bool is_owner) {
-        std::unique_lock lock(mutex_);
-        this->is_owner = is_owner;
+        is_owner_ = is_owner;
     }
 
     // deprecated API
@@ -207,7 +134,7 @@ class DataSet {
     void
     Set(const std::string& k, T&& v) {
         std::unique_lock lock(mutex_);
-        data_[k] = Var(std::in_place_type<std::any>, std::forward<T>(v));
+        data_[k] = std::any(std::forward<T>(v));
     }
 
     template <typename T>
@@ -216,18 +143,35 @@ class DataSet {
         std::shared_lock lock(mutex_);
         auto it = this->data_.find(k);
         if (it != this->data_.end()) {
-            return *std::any_cast<T>(std::get_if<std::any>(&it->second));
+            return *std::any_cast<T>(&it->second);
         }
         return T();
     }
 
  private:
+    const void* tensor_ = nullptr;
+    int64_t rows_ = 0;
+    int64_t dim_ = 0;
+    const int64_t* ids_ = nullptr;
+    const float* distance_ = nullptr;
+    const size_t* lims_ = nullptr;
+    std::string json_info_;
+    std::string json_id_set_;
+    bool is_owner_ = true;
+
     mutable std::shared_mutex mutex_;
-    std::map<std::string, Var> data_;
-    bool is_owner = true;
+    std::map<std::string, std::any> data_;
 };
 using DataSetPtr = std::shared_ptr<DataSet>;
 
+// Caller owned range search result, results of query i are [lims[i], lims[i + 1]) of ids and distances. Reusing
+// one buffer across searches reuses its capacity, so a warmed up buffer is filled without allocating.
+struct RangeSearchBuf {
+    std::vector<size_t> lims;
+    std::vector<int64_t> ids;
+    std::vector<float> distances;
+};
+
 inline DataSetPtr
 GenDataSet(const int64_t nb, const int64_t dim, const void* xb) {
     auto ret_ds = std::make_shared<DataSet>();
@@ -17,6 +17,7 @@
 #include "knowhere/log.h"
 
 #ifdef NOT_COMPILE_FOR_SWIG
+#include "knowhere/comp/thread_pool.h"
 #include "knowhere/prometheus_client.h"
 #endif
 
@@ -32,6 +33,42 @@ LoadConfig(BaseConfig* cfg, const Json& json, knowhere::PARAM_TYPE param_type, c
     return Config::Load(*cfg, json_, param_type, msg);
 }
 
+#ifdef NOT_COMPILE_FOR_SWIG
+// Scheduling hints of a search request, see BaseConfig::thread_pool, BaseConfig::task_priority and
+// BaseConfig::max_concurrency.
+inline Status
+GetSearchTaskContext(const BaseConfig& cfg, TaskContext* ctx, std::string* const msg = nullptr) {
+    auto priority = ThreadPool::ParseTaskPriority(cfg.task_priority.value());
+    if (!priority.has_value()) {
+        std::string err = "invalid task_priority " + cfg.task_priority.value() +
+                          ", should be one of interactive, batch and build";
+        LOG_KNOWHERE_ERROR_ << err;
+        if (msg != nullptr) {
+            *msg = err;
+        }
+        return Status::invalid_args;
+    }
+    std::shared_ptr<ThreadPool> pool = nullptr;
+    if (cfg.thread_pool.has_value() && !cfg.thread_pool.value().empty()) {
+        pool = ThreadPool::GetThreadPool(cfg.thread_pool.value());
+        if (pool == nullptr) {
+            std::string err = "thread pool " + cfg.thread_pool.value() + " does not exist";
+            LOG_KNOWHERE_ERROR_ << err;
+            if (msg != nullptr) {
+                *msg = err;
+            }
+            return Status::invalid_args;
+        }
+    }
+    ctx->priority = priority.value();
+    ctx->limiter = cfg.max_concurrency.value() > 0
+                       ? std::make_shared<TaskConcurrencyLimiter>(cfg.max_concurrency.value())
+                       : nullptr;
+    ctx->pool = std::move(pool);
+    return Status::success;
+}
+#endif
+
 template <typename T1>
 class Index {
  public:
@@ -92,9 +129,7 @@ class Index {
     operator=(const Index<T2>& idx) {
         static_assert(std::is_base_of<T1, T2>::value);
         if (node != nullptr) {
-            node->DecRef();
-            if (!node->Ref())
-                delete node;
+            Release(node);
         }
         if (idx.node == nullptr) {
             node = nullptr;
@@ -110,9 +145,7 @@ class Index {
     operator=(Index<T2>&& idx) {
         static_assert(std::is_base_of<T1, T2>::value);
         if (node != nullptr) {
-            node->DecRef();
-            if (!node->Ref())
-                delete node;
+            Release(node);
         }
         node = idx.node;
         idx.node = nullptr;
@@ -135,14 +168,23 @@ class Index {
 
 #ifdef NOT_COMPILE_FOR_SWIG
         knowhere_build_count.Increment();
+        ThreadPool::ScopedTaskContext task_ctx(TaskPriority::BUILD);
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).build_latency);
 #endif
-        return this->node->Build(dataset, *cfg);
+        auto status = this->node->Build(dataset, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        SetResidentBytes(this->node, this->node->Size());
+#endif
+        return status;
     }
 
     Status
     Train(const DataSet& dataset, const Json& json) {
         auto cfg = this->node->CreateConfig();
         RETURN_IF_ERROR(LoadConfig(cfg.get(), json, knowhere::TRAIN, "Train"));
+#ifdef NOT_COMPILE_FOR_SWIG
+        ThreadPool::ScopedTaskContext task_ctx(TaskPriority::BUILD);
+#endif
         return this->node->Train(dataset, *cfg);
     }
 
@@ -150,7 +192,14 @@ class Index {
     Add(const DataSet& dataset, const Json& json) {
         auto cfg = this->node->CreateConfig();
         RETURN_IF_ERROR(LoadConfig(cfg.get(), json, knowhere::TRAIN, "Add"));
-        return this->node->Add(dataset, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        ThreadPool::ScopedTaskContext task_ctx(TaskPriority::BUILD);
+#endif
+        auto status = this->node->Add(dataset, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        SetResidentBytes(this->node, this->node->Size());
+#endif
+        return status;
     }
 
     expected<DataSetPtr>
@@ -172,8 +221,18 @@ class Index {
 
 #ifdef NOT_COMPILE_FOR_SWIG
         knowhere_search_count.Increment();
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).search_latency);
+        TaskContext ctx;
+        const Status ctx_status = GetSearchTaskContext(*cfg, &ctx, &msg);
+        if (ctx_status != Status::success) {
+            expected<DataSetPtr> ret(ctx_status);
+            ret << msg;
+            return ret;
+        }
+        ThreadPool::ScopedTaskContext task_ctx(std::move(ctx));
 #endif
-        return this->node->Search(dataset, *cfg, bitset);
+        const BitsetSummary summary(bitset);
+        return this->node->Search(dataset, *cfg, Summarized(bitset, summary));
     }
 
     expected<DataSetPtr>
@@ -184,8 +243,64 @@ class Index {
 
 #ifdef NOT_COMPILE_FOR_SWIG
         knowhere_range_search_count.Increment();
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).range_search_latency);
+        TaskContext ctx;
+        std::string msg;
+        const Status ctx_status = GetSearchTaskContext(*cfg, &ctx, &msg);
+        if (ctx_status != Status::success) {
+            expected<DataSetPtr> ret(ctx_status);
+            ret << msg;
+            return ret;
+        }
+        ThreadPool::ScopedTaskContext task_ctx(std::move(ctx));
+#endif
+        const BitsetSummary summary(bitset);
+        return this->node->RangeSearch(dataset, *cfg, Summarized(bitset, summary));
+    }
+
+    // Search into caller owned ids and dis, each must hold nq * k entries.
+    Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* dis, const Json& json, const BitsetView& bitset) const {
+        auto cfg = this->node->CreateConfig();
+        RETURN_IF_ERROR(LoadConfig(cfg.get(), json, knowhere::SEARCH, "SearchWithBuf"));
+        std::string msg;
+        RETURN_IF_ERROR(cfg->CheckAndAdjustForSearch(&msg));
+        if (cfg->trace_visit.value()) {
+            LOG_KNOWHERE_ERROR_ << "trace_visit is not supported by SearchWithBuf";
+            return Status::invalid_args;
+        }
+
+#ifdef NOT_COMPILE_FOR_SWIG
+        knowhere_search_count.Increment();
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).search_latency);
+        TaskContext ctx;
+        RETURN_IF_ERROR(GetSearchTaskContext(*cfg, &ctx));
+        ThreadPool::ScopedTaskContext task_ctx(std::move(ctx));
 #endif
-        return this->node->RangeSearch(dataset, *cfg, bitset);
+        const BitsetSummary summary(bitset);
+        return this->node->SearchWithBuf(dataset, ids, dis, *cfg, Summarized(bitset, summary));
+    }
+
+    // Range search into a caller owned buffer that may be reused across calls.
+    Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Json& json, const BitsetView& bitset) const {
+        auto cfg = this->node->CreateConfig();
+        RETURN_IF_ERROR(LoadConfig(cfg.get(), json, knowhere::RANGE_SEARCH, "RangeSearchWithBuf"));
+        RETURN_IF_ERROR(cfg->CheckAndAdjustForRangeSearch());
+        if (cfg->trace_visit.value()) {
+            LOG_KNOWHERE_ERROR_ << "trace_visit is not supported by RangeSearchWithBuf";
+            return Status::invalid_args;
+        }
+
+#ifdef NOT_COMPILE_FOR_SWIG
+        knowhere_range_search_count.Increment();
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).range_search_latency);
+        TaskContext ctx;
+        RETURN_IF_ERROR(GetSearchTaskContext(*cfg, &ctx));
+        ThreadPool::ScopedTaskContext task_ctx(std::move(ctx));
+#endif
+        const BitsetSummary summary(bitset);
+        return this->node->RangeSearchWithBuf(dataset, buf, *cfg, Summarized(bitset, summary));
     }
 
     expected<DataSetPtr>
@@ -225,7 +340,15 @@ class Index {
         if (res != Status::success) {
             return res;
         }
-        return this->node->Deserialize(binset, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        ThreadPool::ScopedTaskContext task_ctx(TaskPriority::BUILD);
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).load_latency);
+#endif
+        auto status = this->node->Deserialize(binset, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        SetResidentBytes(this->node, this->node->Size());
+#endif
+        return status;
     }
 
     Status
@@ -243,7 +366,15 @@ class Index {
         if (res != Status::success) {
             return res;
         }
-        return this->node->DeserializeFromFile(filename, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        ThreadPool::ScopedTaskContext task_ctx(TaskPriority::BUILD);
+        ScopedLatencyTimer timer(*NodeMetrics(this->node).load_latency);
+#endif
+        auto status = this->node->DeserializeFromFile(filename, *cfg);
+#ifdef NOT_COMPILE_FOR_SWIG
+        SetResidentBytes(this->node, this->node->Size());
+#endif
+        return status;
     }
 
     int64_t
@@ -269,9 +400,7 @@ class Index {
     ~Index() {
         if (node == nullptr)
             return;
-        node->DecRef();
-        if (!node->Ref())
-            delete node;
+        Release(node);
     }
 
  private:
@@ -279,6 +408,54 @@ class Index {
         static_assert(std::is_base_of<IndexNode, T1>::value);
     }
 
+    // drops a reference to node, the last one deletes it
+    static void
+    Release(T1* node) {
+        node->DecRef();
+        if (!node->Ref()) {
+#ifdef NOT_COMPILE_FOR_SWIG
+            SetResidentBytes(node, 0);
+#endif
+            delete node;
+        }
+    }
+
+#ifdef NOT_COMPILE_FOR_SWIG
+    // moves the share of node in knowhere_index_resident_bytes to bytes
+    static void
+    SetResidentBytes(IndexNode* node, int64_t bytes) {
+        if (bytes == node->resident_bytes_) {
+            return;
+        }
+        NodeMetrics(node).resident_bytes->Increment(bytes - node->resident_bytes_);
+        node->resident_bytes_ = bytes;
+    }
+
+    // a lookup in a family hashes the labels under its lock, a node does it once and keeps the metrics
+    static const IndexNode::Metrics&
+    NodeMetrics(IndexNode* node) {
+        std::call_once(node->metrics_once_, [node]() {
+            auto type = node->Type();
+            node->metrics_.build_latency = &IndexTypeHistogram(knowhere_build_latency_family, type);
+            node->metrics_.search_latency = &IndexTypeHistogram(knowhere_search_latency_family, type);
+            node->metrics_.range_search_latency = &IndexTypeHistogram(knowhere_range_search_latency_family, type);
+            node->metrics_.load_latency = &IndexTypeHistogram(knowhere_load_latency_family, type);
+            node->metrics_.resident_bytes = &IndexTypeGauge(knowhere_index_resident_bytes_family, type);
+        });
+        return node->metrics_;
+    }
+#endif
+
+    // The bitset a node searches with. The summary is computed once per request so that the node reads it instead of
+    // scanning the bits again, a bitset with no bit set is dropped so that the node takes its unfiltered path.
+    static BitsetView
+    Summarized(const BitsetView& bitset, const BitsetSummary& summary) {
+        if (summary.filtered == 0) {
+            return nullptr;
+        }
+        return bitset.WithSummary(&summary);
+    }
+
     T1* node;
 };
 
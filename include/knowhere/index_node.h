@@ -12,6 +12,9 @@
 #ifndef INDEX_NODE_H
 #define INDEX_NODE_H
 
+#include <algorithm>
+#include <mutex>
+
 #include "knowhere/binaryset.h"
 #include "knowhere/bitsetview.h"
 #include "knowhere/config.h"
@@ -19,8 +22,16 @@
 #include "knowhere/expected.h"
 #include "knowhere/object.h"
 
+namespace prometheus {
+class Gauge;
+class Histogram;
+}  // namespace prometheus
+
 namespace knowhere {
 
+template <typename T>
+class Index;
+
 class IndexNode : public Object {
  public:
     virtual Status
@@ -41,6 +52,38 @@ class IndexNode : public Object {
     virtual expected<DataSetPtr>
     RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const = 0;
 
+    // Search into caller owned ids and dis of nq * k entries each, no result DataSet is created. Indexes that do
+    // not write into the buffers directly fall back to Search and a copy.
+    virtual Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* dis, const Config& cfg,
+                  const BitsetView& bitset) const {
+        auto res = Search(dataset, cfg, bitset);
+        if (!res.has_value()) {
+            return res.error();
+        }
+        auto len = res.value()->GetRows() * res.value()->GetDim();
+        std::copy_n(res.value()->GetIds(), len, ids);
+        std::copy_n(res.value()->GetDistance(), len, dis);
+        return Status::success;
+    }
+
+    // Range search into a caller owned buffer, see RangeSearchBuf. Indexes that do not write into the buffer
+    // directly fall back to RangeSearch and a copy.
+    virtual Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                       const BitsetView& bitset) const {
+        auto res = RangeSearch(dataset, cfg, bitset);
+        if (!res.has_value()) {
+            return res.error();
+        }
+        auto nq = res.value()->GetRows();
+        auto lims = res.value()->GetLims();
+        buf.lims.assign(lims, lims + nq + 1);
+        buf.ids.assign(res.value()->GetIds(), res.value()->GetIds() + lims[nq]);
+        buf.distances.assign(res.value()->GetDistance(), res.value()->GetDistance() + lims[nq]);
+        return Status::success;
+    }
+
     virtual expected<DataSetPtr>
     GetVectorByIds(const DataSet& dataset) const = 0;
 
@@ -76,6 +119,24 @@ class IndexNode : public Object {
 
     virtual ~IndexNode() {
     }
+
+ private:
+    template <typename T>
+    friend class Index;
+
+    // the bytes this node adds to knowhere_index_resident_bytes, kept by Index
+    int64_t resident_bytes_ = 0;
+
+    // the metrics labelled with the type of this node, looked up in their families once by Index::NodeMetrics()
+    struct Metrics {
+        prometheus::Histogram* build_latency = nullptr;
+        prometheus::Histogram* search_latency = nullptr;
+        prometheus::Histogram* range_search_latency = nullptr;
+        prometheus::Histogram* load_latency = nullptr;
+        prometheus::Gauge* resident_bytes = nullptr;
+    };
+    std::once_flag metrics_once_;
+    Metrics metrics_;
 };
 
 }  // namespace knowhere
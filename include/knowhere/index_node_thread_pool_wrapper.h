@@ -39,6 +39,14 @@ class IndexNodeThreadPoolWrapper : public IndexNode {
     expected<DataSetPtr>
     RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override;
 
+    Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* dis, const Config& cfg,
+                  const BitsetView& bitset) const override;
+
+    Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                       const BitsetView& bitset) const override;
+
     expected<DataSetPtr>
     GetVectorByIds(const DataSet& dataset) const override {
         return index_node_->GetVectorByIds(dataset);
@@ -95,6 +103,16 @@ class IndexNodeThreadPoolWrapper : public IndexNode {
     }
 
  private:
+    // the pool named by the thread_pool param of cfg, or the one the current request already picked. nullptr if the
+    // named pool does not exist or there is none
+    std::shared_ptr<ThreadPool>
+    SelectThreadPool(const Config& cfg) const;
+
+    // run func, a search on index_node_, on the pool of this wrapper unless the request picked a named pool
+    template <typename Func>
+    auto
+    Run(const Config& cfg, Func&& func) const -> decltype(func());
+
     std::unique_ptr<IndexNode> index_node_;
     std::shared_ptr<ThreadPool> thread_pool_;
 };
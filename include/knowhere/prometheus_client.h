@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 
+#include "knowhere/comp/metrics.h"
 #include "knowhere/log.h"
 
 namespace knowhere {
@@ -53,6 +54,8 @@ class PrometheusClient {
 /*****************************************************************************/
 // prometheus metrics
 extern const prometheus::Histogram::BucketBoundaries buckets;
+// in milliseconds, from sub-millisecond search phases up to hour long builds
+extern const prometheus::Histogram::BucketBoundaries latency_buckets;
 extern const std::unique_ptr<PrometheusClient> prometheusClient;
 
 #define DEFINE_PROMETHEUS_GAUGE(name, desc)                                                                  \
@@ -70,12 +73,71 @@ extern const std::unique_ptr<PrometheusClient> prometheusClient;
         prometheus::BuildHistogram().Name(#name).Help(desc).Register(knowhere::prometheusClient->GetRegistry()); \
     prometheus::Histogram& name = name##_family.Add({}, knowhere::buckets);
 
+// families whose metrics carry labels, the labelled metrics are added on first use
+#define DEFINE_PROMETHEUS_GAUGE_FAMILY(name, desc)        \
+    prometheus::Family<prometheus::Gauge>& name##_family = \
+        prometheus::BuildGauge().Name(#name).Help(desc).Register(knowhere::prometheusClient->GetRegistry());
+
+#define DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(name, desc)        \
+    prometheus::Family<prometheus::Histogram>& name##_family = \
+        prometheus::BuildHistogram().Name(#name).Help(desc).Register(knowhere::prometheusClient->GetRegistry());
+
 #define DECLARE_PROMETHEUS_GAUGE(name_gauge) extern prometheus::Gauge& name_gauge;
 #define DECLARE_PROMETHEUS_COUNTER(name_counter) extern prometheus::Counter& name_counter;
 #define DECLARE_PROMETHEUS_HISTOGRAM(name_histogram) extern prometheus::Histogram& name_histogram;
+#define DECLARE_PROMETHEUS_GAUGE_FAMILY(name) extern prometheus::Family<prometheus::Gauge>& name##_family;
+#define DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(name) extern prometheus::Family<prometheus::Histogram>& name##_family;
 
 DECLARE_PROMETHEUS_COUNTER(knowhere_build_count);
 DECLARE_PROMETHEUS_COUNTER(knowhere_search_count);
 DECLARE_PROMETHEUS_COUNTER(knowhere_range_search_count);
 
+// latencies of Index<T> calls in milliseconds, labelled by index_type
+DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_build_latency);
+DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_search_latency);
+DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_range_search_latency);
+DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_load_latency);
+// latencies of the phases of a search in milliseconds, labelled by phase, see SearchPhase
+DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_search_phase_latency);
+// Size() of the built or loaded indexes alive, labelled by index_type
+DECLARE_PROMETHEUS_GAUGE_FAMILY(knowhere_index_resident_bytes);
+DECLARE_PROMETHEUS_GAUGE(knowhere_thread_pool_queue_depth);
+// node visits of the DiskANN searches, the hit rate of the node cache is hits / (hits + misses)
+DECLARE_PROMETHEUS_COUNTER(knowhere_diskann_node_cache_hits);
+DECLARE_PROMETHEUS_COUNTER(knowhere_diskann_node_cache_misses);
+DECLARE_PROMETHEUS_COUNTER(knowhere_diskann_node_cache_refresh_count);
+// entry point cache lookups of the graph searches, the hit rate is hits / (hits + misses)
+DECLARE_PROMETHEUS_COUNTER(knowhere_hnsw_entry_cache_hits);
+DECLARE_PROMETHEUS_COUNTER(knowhere_hnsw_entry_cache_misses);
+DECLARE_PROMETHEUS_COUNTER(knowhere_diskann_entry_cache_hits);
+DECLARE_PROMETHEUS_COUNTER(knowhere_diskann_entry_cache_misses);
+
+// the metric of family labelled with index_type
+prometheus::Histogram&
+IndexTypeHistogram(prometheus::Family<prometheus::Histogram>& family, const std::string& index_type);
+
+prometheus::Gauge&
+IndexTypeGauge(prometheus::Family<prometheus::Gauge>& family, const std::string& index_type);
+
+// Observes the time from its construction to its destruction in histogram.
+class ScopedLatencyTimer {
+ public:
+    explicit ScopedLatencyTimer(prometheus::Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {
+    }
+
+    ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+
+    ScopedLatencyTimer&
+    operator=(const ScopedLatencyTimer&) = delete;
+
+    ~ScopedLatencyTimer() {
+        histogram_.Observe(ScopedPhaseTimer::ElapsedMs(start_));
+    }
+
+ private:
+    prometheus::Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
 }  // namespace knowhere
@@ -13,8 +13,10 @@
 
 #include <strings.h>
 
+#include <string>
 #include <vector>
 
+#include "knowhere/binaryset.h"
 #include "knowhere/dataset.h"
 
 namespace knowhere {
@@ -62,4 +64,19 @@ round_down(const T value, const T align) {
     return value / align * align;
 }
 
+// the file of binary `name` next to an index file, the binaries of a set are written to one directory under their names.
+// An index built with refine (HNSW_SQ8 / HNSW_FP16, IVF_PQ_FASTSCAN) keeps its raw vectors in a `<index type>_RAW_DATA`
+// binary of its own, so DeserializeFromFile of /data/HNSW_SQ8 reads them from /data/HNSW_SQ8_RAW_DATA, see
+// LoadBinaryFile()
+inline std::string
+SiblingBinaryPath(const std::string& filename, const std::string& name) {
+    auto pos = filename.rfind('/');
+    return pos == std::string::npos ? name : filename.substr(0, pos + 1) + name;
+}
+
+// reads the binary written to `filename`, which must have exactly `size` bytes, or maps it read-only when mmap is set.
+// Throws std::runtime_error naming the file when it is missing, has another size or can not be read.
+extern BinaryPtr
+LoadBinaryFile(const std::string& filename, size_t size, bool mmap);
+
 }  // namespace knowhere
@@ -0,0 +1,54 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "knowhere/bitsetview.h"
+#include "simd/hook.h"
+
+namespace knowhere {
+
+// Calls func(id) in increasing order for every id in [0, n) that bitset lets through, ids past the end of the bitset
+// are not filtered. The valid ids of a block are listed by the SIMD helper. With a summary the scan stays within the
+// first and last valid id and skips the blocks that are all filtered out.
+template <typename Func>
+void
+ForEachValidId(const BitsetView& bitset, size_t n, Func&& func) {
+    constexpr size_t kBlockBits = BitsetSummary::kBlockBits;
+    const size_t nbits = std::min(n, bitset.size());
+    const BitsetSummary* summary = bitset.summary();
+    size_t lo = 0, hi = nbits;
+    if (summary != nullptr) {
+        lo = summary->first_valid < 0 ? nbits : std::min<size_t>(summary->first_valid, nbits);
+        hi = summary->last_valid < 0 ? lo : std::min<size_t>(summary->last_valid + 1, nbits);
+    }
+    std::vector<uint32_t> ids(kBlockBits);
+    for (size_t begin = lo; begin < hi;) {
+        const size_t block = begin / kBlockBits;
+        const size_t end = std::min((block + 1) * kBlockBits, hi);
+        if (summary == nullptr || !summary->block_all_filtered(block)) {
+            const size_t cnt = faiss::bitset_valid_ids(bitset.data(), begin, end, ids.data());
+            for (size_t i = 0; i < cnt; i++) {
+                func((size_t)ids[i]);
+            }
+        }
+        begin = end;
+    }
+    for (size_t id = nbits; id < n; id++) {
+        func(id);
+    }
+}
+
+}  // namespace knowhere
@@ -15,6 +15,7 @@
 
 #include "common/metric.h"
 #include "common/range_util.h"
+#include "common/tiled_knn.h"
 #include "faiss/utils/binary_distances.h"
 #include "faiss/utils/distances.h"
 #include "knowhere/comp/thread_pool.h"
@@ -54,7 +55,20 @@ BruteForce::Search(const DataSetPtr base_dataset, const DataSetPtr query_dataset
     auto labels = new int64_t[nq * topk];
     auto distances = new float[nq * topk];
 
-    auto pool = ThreadPool::GetGlobalThreadPool();
+    auto pool = ThreadPool::CurrentThreadPool();
+    if (UseTiledKnn(faiss_metric_type, nq)) {
+        if (is_cosine) {
+            Normalize(*query_dataset);
+        }
+        auto status = TiledKnnSearch(pool, faiss_metric_type, (const float*)xq, nq, (const float*)xb, nb, dim, topk,
+                                     distances, labels, bitset);
+        if (status != Status::success) {
+            std::unique_ptr<int64_t[]> auto_delete_ids(labels);
+            std::unique_ptr<float[]> auto_delete_dis(distances);
+            return status;
+        }
+        return GenResultDataSet(nq, cfg.k.value(), labels, distances);
+    }
     std::vector<folly::Future<Status>> futs;
     futs.reserve(nq);
     for (int i = 0; i < nq; ++i) {
@@ -150,7 +164,14 @@ BruteForce::SearchWithBuf(const DataSetPtr base_dataset, const DataSetPtr query_
 
     auto faiss_metric_type = metric_type.value();
 
-    auto pool = ThreadPool::GetGlobalThreadPool();
+    auto pool = ThreadPool::CurrentThreadPool();
+    if (UseTiledKnn(faiss_metric_type, nq)) {
+        if (is_cosine) {
+            Normalize(*query_dataset);
+        }
+        return TiledKnnSearch(pool, faiss_metric_type, (const float*)xq, nq, (const float*)xb, nb, dim, topk, distances,
+                              labels, bitset);
+    }
     std::vector<folly::Future<Status>> futs;
     futs.reserve(nq);
     for (int i = 0; i < nq; ++i) {
@@ -237,16 +258,13 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
     RETURN_IF_ERROR(Config::Load(cfg, config, knowhere::RANGE_SEARCH));
 
     auto radius = cfg.radius.value();
-    bool is_ip = false;
     float range_filter = cfg.range_filter.value();
 
     ASSIGN_OR_RETURN(faiss::MetricType, faiss_metric_type, Str2FaissMetricType(cfg.metric_type.value()));
-    auto pool = ThreadPool::GetGlobalThreadPool();
+    bool is_ip = (faiss_metric_type == faiss::METRIC_INNER_PRODUCT);
+    auto pool = ThreadPool::CurrentThreadPool();
 
-    std::vector<std::vector<int64_t>> result_id_array(nq);
-    std::vector<std::vector<float>> result_dist_array(nq);
-    std::vector<size_t> result_size(nq);
-    std::vector<size_t> result_lims(nq + 1);
+    RangeSearchResultCollector collector(nq, is_ip, radius, range_filter);
     std::vector<folly::Future<Status>> futs;
     futs.reserve(nq);
     for (int i = 0; i < nq; ++i) {
@@ -260,7 +278,6 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
                     break;
                 }
                 case faiss::METRIC_INNER_PRODUCT: {
-                    is_ip = true;
                     auto cur_query = (float*)xq + dim * index;
                     if (is_cosine) {
                         NormalizeVec(cur_query, dim);
@@ -286,18 +303,7 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
                     return Status::invalid_metric_type;
                 }
             }
-            auto elem_cnt = res.lims[1];
-            result_dist_array[index].resize(elem_cnt);
-            result_id_array[index].resize(elem_cnt);
-            result_size[index] = elem_cnt;
-            for (size_t j = 0; j < elem_cnt; j++) {
-                result_dist_array[index][j] = res.distances[j];
-                result_id_array[index][j] = res.labels[j];
-            }
-            if (cfg.range_filter.value() != defaultRangeFilter) {
-                FilterRangeSearchResultForOneNq(result_dist_array[index], result_id_array[index], is_ip, radius,
-                                                range_filter);
-            }
+            collector.Add(index, res.distances, res.labels, res.lims[1]);
             return Status::success;
         }));
     }
@@ -310,7 +316,7 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
     int64_t* ids = nullptr;
     float* distances = nullptr;
     size_t* lims = nullptr;
-    GetRangeSearchResult(result_dist_array, result_id_array, is_ip, nq, radius, range_filter, distances, ids, lims);
+    collector.Finish(distances, ids, lims);
     return GenResultDataSet(nq, ids, distances, lims);
 }
 }  // namespace knowhere
@@ -11,6 +11,7 @@
 
 #include "knowhere/comp/knowhere_config.h"
 
+#include <atomic>
 #include <string>
 
 #ifdef KNOWHERE_WITH_DISKANN
@@ -28,10 +29,17 @@
 #endif
 #ifdef KNOWHERE_WITH_DISKANN
 #include "diskann/aio_context_pool.h"
+#ifdef KNOWHERE_WITH_IO_URING
+#include "diskann/io_uring_aligned_file_reader.h"
+#endif
 #endif
 
 namespace knowhere {
 
+namespace {
+std::atomic<KnowhereConfig::DiskIOBackend> disk_io_backend{KnowhereConfig::DiskIOBackend::LIBAIO};
+}  // namespace
+
 void
 KnowhereConfig::ShowVersion() {
 #define XSTR(x) STR(x)
@@ -134,6 +142,33 @@ KnowhereConfig::SetAioContextPool(size_t num_ctx, size_t max_events) {
 #endif
 }
 
+bool
+KnowhereConfig::SetDiskIOBackend(const DiskIOBackend backend, bool sqpoll, size_t queue_depth) {
+    if (backend == DiskIOBackend::LIBAIO) {
+        LOG_KNOWHERE_INFO_ << "Set DiskANN io backend to libaio";
+        disk_io_backend.store(backend);
+        return true;
+    }
+#if defined(KNOWHERE_WITH_DISKANN) && defined(KNOWHERE_WITH_IO_URING)
+    if (!IoUringAlignedFileReader::is_supported()) {
+        LOG_KNOWHERE_WARNING_ << "io_uring is not supported by the kernel, keep using libaio";
+        return false;
+    }
+    LOG_KNOWHERE_INFO_ << "Set DiskANN io backend to io_uring, sqpoll " << sqpoll << ", queue depth " << queue_depth;
+    IoUringAlignedFileReader::InitGlobalConfig(sqpoll, queue_depth);
+    disk_io_backend.store(backend);
+    return true;
+#else
+    LOG_KNOWHERE_WARNING_ << "knowhere is built without io_uring, keep using libaio";
+    return false;
+#endif
+}
+
+KnowhereConfig::DiskIOBackend
+KnowhereConfig::GetDiskIOBackend() {
+    return disk_io_backend.load();
+}
+
 void
 KnowhereConfig::InitGPUResource(int64_t gpu_id, int64_t res_num) {
 #ifdef KNOWHERE_WITH_GPU
@@ -0,0 +1,159 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+namespace knowhere {
+
+// An approximate, lock-free key/value cache for small trivially copyable entries.
+//
+// The cache is direct-mapped: every key hashes to exactly one slot and a put() simply overwrites whatever lives
+// there. Each slot is guarded by a sequence counter (seqlock), so readers never block and never write shared state
+// except for the striped hit/miss counters. A writer that finds the slot busy drops its update instead of waiting.
+// This trades strict LRU order for scalability: it is meant for hints such as the entry point of a graph search,
+// where a lost or evicted entry only costs a slightly longer search.
+template <typename key_t, typename value_t>
+class concurrent_cache {
+    static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>,
+                  "concurrent_cache only supports trivially copyable keys and values");
+
+ public:
+    constexpr static size_t kDefaultSize = 10000;
+
+    explicit concurrent_cache(size_t cap = kDefaultSize) {
+        resize(cap);
+    }
+
+    concurrent_cache(const concurrent_cache&) = delete;
+    concurrent_cache&
+    operator=(const concurrent_cache&) = delete;
+
+    // Drop all entries and reallocate for at least `cap` entries, 0 disables the cache.
+    // Not thread-safe, call it before the owning index is shared with searchers.
+    void
+    resize(size_t cap) {
+        if (cap == 0) {
+            slots_.reset();
+            mask_ = 0;
+            return;
+        }
+        size_t n = 1;
+        while (n < cap) {
+            n <<= 1;
+        }
+        slots_.reset(new Slot[n]);
+        mask_ = n - 1;
+    }
+
+    void
+    put(const key_t& key, const value_t& value) {
+        if (slots_ == nullptr) {
+            return;
+        }
+        auto& slot = slots_[slot_of(key)];
+        auto seq = slot.seq.load(std::memory_order_relaxed);
+        if ((seq & 1) || !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+            return;
+        }
+        // orders the odd sequence before the data, a reader that sees new data then sees the slot changed
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.key.store(key, std::memory_order_relaxed);
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    bool
+    try_get(const key_t& key, value_t& val) const {
+        if (slots_ == nullptr) {
+            return false;
+        }
+        auto idx = slot_of(key);
+        const auto& slot = slots_[idx];
+        auto seq = slot.seq.load(std::memory_order_acquire);
+        // seq 0 means the slot was never written
+        if (seq != 0 && !(seq & 1)) {
+            auto k = slot.key.load(std::memory_order_relaxed);
+            auto v = slot.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq && k == key) {
+                val = v;
+                stats_[idx & (kStatStripes - 1)].hit.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        stats_[idx & (kStatStripes - 1)].miss.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t
+    capacity() const {
+        return slots_ == nullptr ? 0 : mask_ + 1;
+    }
+
+    uint64_t
+    hits() const {
+        uint64_t ret = 0;
+        for (const auto& s : stats_) {
+            ret += s.hit.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    uint64_t
+    misses() const {
+        uint64_t ret = 0;
+        for (const auto& s : stats_) {
+            ret += s.miss.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    int64_t
+    size() const {
+        return sizeof(*this) + capacity() * sizeof(Slot);
+    }
+
+ private:
+    struct Slot {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<key_t> key{};
+        std::atomic<value_t> value{};
+    };
+
+    // hit/miss counters are spread over several cache lines so that concurrent searches do not bounce one line
+    struct alignas(64) Stat {
+        std::atomic<uint64_t> hit{0};
+        std::atomic<uint64_t> miss{0};
+    };
+    constexpr static size_t kStatStripes = 16;
+
+    size_t
+    slot_of(const key_t& key) const {
+        // keys are often hashes already, mix anyway so that structured keys spread over the table
+        uint64_t h = std::hash<key_t>{}(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h & mask_;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    mutable Stat stats_[kStatStripes];
+};
+
+}  // namespace knowhere
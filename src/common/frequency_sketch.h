@@ -0,0 +1,112 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace knowhere {
+
+// An approximate, lock-free access counter for 32-bit keys (count-min sketch).
+//
+// Every key maps to one counter in each of kDepth rows and its estimate is the smallest of them, so an estimate never
+// undercounts and only overcounts by the keys it collides with. add() is kDepth relaxed atomic increments and can be
+// called from any number of searchers at once; concurrent increments are never lost, but halve() racing with add()
+// may drop a few of them, which only makes an estimate slightly low. Call halve() periodically to age the counts so
+// that the sketch follows a changing workload.
+class FrequencySketch {
+ public:
+    constexpr static size_t kDepth = 4;
+
+    // width is rounded up to a power of two; aim for a few counters per distinct key that matters
+    explicit FrequencySketch(size_t width) {
+        size_t n = 1;
+        while (n < width) {
+            n <<= 1;
+        }
+        counters_.reset(new std::atomic<uint32_t>[kDepth * n]);
+        for (size_t i = 0; i < kDepth * n; ++i) {
+            counters_[i].store(0, std::memory_order_relaxed);
+        }
+        mask_ = n - 1;
+    }
+
+    FrequencySketch(const FrequencySketch&) = delete;
+    FrequencySketch&
+    operator=(const FrequencySketch&) = delete;
+
+    void
+    add(uint32_t key) {
+        uint64_t h = hash(key);
+        for (size_t r = 0; r < kDepth; ++r) {
+            auto& c = counters_[r * (mask_ + 1) + index(h, r)];
+            // saturate instead of wrapping around to 0
+            if (c.load(std::memory_order_relaxed) != std::numeric_limits<uint32_t>::max()) {
+                c.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    uint32_t
+    estimate(uint32_t key) const {
+        uint64_t h = hash(key);
+        uint32_t ret = std::numeric_limits<uint32_t>::max();
+        for (size_t r = 0; r < kDepth; ++r) {
+            ret = std::min(ret, counters_[r * (mask_ + 1) + index(h, r)].load(std::memory_order_relaxed));
+        }
+        return ret;
+    }
+
+    // divide every count by two
+    void
+    halve() {
+        for (size_t i = 0; i < kDepth * (mask_ + 1); ++i) {
+            counters_[i].store(counters_[i].load(std::memory_order_relaxed) >> 1, std::memory_order_relaxed);
+        }
+    }
+
+    size_t
+    width() const {
+        return mask_ + 1;
+    }
+
+    int64_t
+    size() const {
+        return sizeof(*this) + kDepth * width() * sizeof(std::atomic<uint32_t>);
+    }
+
+ private:
+    static uint64_t
+    hash(uint32_t key) {
+        uint64_t h = key;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // row r probes h1 + r * h2 (double hashing), with h1 and h2 the two halves of the 64-bit hash
+    size_t
+    index(uint64_t h, size_t row) const {
+        return ((h & 0xffffffffULL) + row * ((h >> 32) | 1)) & mask_;
+    }
+
+    std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+    size_t mask_ = 0;
+};
+
+}  // namespace knowhere
@@ -35,14 +35,64 @@ IndexNodeThreadPoolWrapper::IndexNodeThreadPoolWrapper(std::unique_ptr<IndexNode
     : index_node_(std::move(index_node)), thread_pool_(thread_pool) {
 }
 
+std::shared_ptr<ThreadPool>
+IndexNodeThreadPoolWrapper::SelectThreadPool(const Config& cfg) const {
+    const auto& base_cfg = static_cast<const BaseConfig&>(cfg);
+    if (!base_cfg.thread_pool.has_value() || base_cfg.thread_pool.value().empty()) {
+        return ThreadPool::CurrentTaskContext().pool;
+    }
+    auto pool = ThreadPool::GetThreadPool(base_cfg.thread_pool.value());
+    if (pool == nullptr) {
+        LOG_KNOWHERE_ERROR_ << "thread pool " << base_cfg.thread_pool.value() << " does not exist";
+    }
+    return pool;
+}
+
+template <typename Func>
+auto
+IndexNodeThreadPoolWrapper::Run(const Config& cfg, Func&& func) const -> decltype(func()) {
+    const auto& base_cfg = static_cast<const BaseConfig&>(cfg);
+    auto ctx = ThreadPool::CurrentTaskContext();
+    if (ctx.pool != nullptr || (base_cfg.thread_pool.has_value() && !base_cfg.thread_pool.value().empty())) {
+        // a request on a named pool stays on the calling thread and only fans out to that pool, pushing it there as
+        // well could leave every thread of the pool waiting for tasks queued behind it
+        ctx.pool = SelectThreadPool(cfg);
+        if (ctx.pool == nullptr) {
+            return Status::invalid_args;
+        }
+        ThreadPool::ScopedTaskContext task_ctx(std::move(ctx));
+        return func();
+    }
+    // only the tasks the search fans out to count against its concurrency cap, the task waiting for them does not
+    ThreadPool::ScopedTaskContext outer_ctx(TaskContext{ctx.priority, nullptr, nullptr});
+    return thread_pool_
+        ->push([&, ctx]() {
+            ThreadPool::ScopedTaskContext inner_ctx(ctx);
+            return func();
+        })
+        .get();
+}
+
 expected<DataSetPtr>
 IndexNodeThreadPoolWrapper::Search(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
-    return thread_pool_->push([&]() { return this->index_node_->Search(dataset, cfg, bitset); }).get();
+    return Run(cfg, [&]() { return this->index_node_->Search(dataset, cfg, bitset); });
 }
 
 expected<DataSetPtr>
 IndexNodeThreadPoolWrapper::RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
-    return thread_pool_->push([&]() { return this->index_node_->RangeSearch(dataset, cfg, bitset); }).get();
+    return Run(cfg, [&]() { return this->index_node_->RangeSearch(dataset, cfg, bitset); });
+}
+
+Status
+IndexNodeThreadPoolWrapper::SearchWithBuf(const DataSet& dataset, int64_t* ids, float* dis, const Config& cfg,
+                                          const BitsetView& bitset) const {
+    return Run(cfg, [&]() { return this->index_node_->SearchWithBuf(dataset, ids, dis, cfg, bitset); });
+}
+
+Status
+IndexNodeThreadPoolWrapper::RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                                               const BitsetView& bitset) const {
+    return Run(cfg, [&]() { return this->index_node_->RangeSearchWithBuf(dataset, buf, cfg, bitset); });
 }
 
 }  // namespace knowhere
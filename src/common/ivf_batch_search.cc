@@ -0,0 +1,167 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "common/ivf_batch_search.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "faiss/utils/Heap.h"
+#include "knowhere/log.h"
+#include "simd/hook.h"
+
+namespace knowhere {
+
+namespace {
+
+constexpr int64_t kMinQueryBlockSize = 16;
+// a larger block shares more list scans but the queries of the block must still fit next to the list chunk in L2
+constexpr int64_t kMaxQueryBlockSize = 256;
+// budget for one chunk of a list, leaves room in a typical 512KB-1MB L2 for the queries and the heaps
+constexpr int64_t kListChunkBytes = 256 * 1024;
+constexpr int64_t kMinListChunkSize = 64;
+constexpr int64_t kMaxListChunkSize = 4096;
+
+using idx_t = faiss::Index::idx_t;
+
+// Search queries [q_begin, q_end) with one heap of size k per query in heap_dis/heap_ids (query q_begin first).
+template <class C>
+void
+SearchBlock(const faiss::IndexIVF& index, const float* xq, int64_t q_begin, int64_t q_end, int64_t k, int64_t nprobe,
+            float* heap_dis, int64_t* heap_ids, const BitsetView& bitset) {
+    const int64_t dim = index.d;
+    const int64_t bs = q_end - q_begin;
+    const float* block_xq = xq + q_begin * dim;
+
+    std::vector<float> coarse_dis(bs * nprobe);
+    std::vector<idx_t> coarse_ids(bs * nprobe);
+    index.quantizer->search(bs, block_xq, nprobe, coarse_dis.data(), coarse_ids.data());
+
+    // invert the assignment, afterwards the queries probing one list are adjacent and lists come in storage order
+    std::vector<std::pair<idx_t, int64_t>> probes;
+    probes.reserve(bs * nprobe);
+    for (int64_t i = 0; i < bs * nprobe; ++i) {
+        // -1 when there are fewer centroids than nprobe
+        if (coarse_ids[i] >= 0) {
+            probes.emplace_back(coarse_ids[i], i / nprobe);
+        }
+    }
+    std::sort(probes.begin(), probes.end());
+
+    for (int64_t q = 0; q < bs; ++q) {
+        faiss::heap_heapify<C>(k, heap_dis + q * k, heap_ids + q * k);
+    }
+
+    const int64_t chunk_size =
+        std::clamp<int64_t>(kListChunkBytes / (dim * sizeof(float)), kMinListChunkSize, kMaxListChunkSize);
+    std::vector<float> dis(chunk_size);
+    for (size_t p_begin = 0; p_begin < probes.size();) {
+        const idx_t list_no = probes[p_begin].first;
+        size_t p_end = p_begin;
+        while (p_end < probes.size() && probes[p_end].first == list_no) {
+            ++p_end;
+        }
+
+        const int64_t list_size = index.invlists->list_size(list_no);
+        if (list_size > 0) {
+            const float* list_vecs =
+                reinterpret_cast<const float*>(index.arranged_codes.data()) + index.prefix_sum[list_no] * dim;
+            faiss::InvertedLists::ScopedIds sids(index.invlists, list_no);
+            const idx_t* list_ids = sids.get();
+
+            for (int64_t c0 = 0; c0 < list_size; c0 += chunk_size) {
+                const int64_t cs = std::min(chunk_size, list_size - c0);
+                const float* chunk = list_vecs + c0 * dim;
+                for (size_t p = p_begin; p < p_end; ++p) {
+                    const int64_t q = probes[p].second;
+                    const float* query = block_xq + q * dim;
+                    if constexpr (C::is_max) {
+                        faiss::fvec_L2sqr_ny(dis.data(), query, chunk, dim, cs);
+                    } else {
+                        faiss::fvec_inner_products_ny(dis.data(), query, chunk, dim, cs);
+                    }
+                    float* simi = heap_dis + q * k;
+                    int64_t* idxi = heap_ids + q * k;
+                    for (int64_t j = 0; j < cs; ++j) {
+                        if (!C::cmp(simi[0], dis[j])) {
+                            continue;
+                        }
+                        const int64_t id = list_ids[c0 + j];
+                        if (!bitset.empty() && bitset.test(id)) {
+                            continue;
+                        }
+                        faiss::heap_replace_top<C>(k, simi, idxi, dis[j], id);
+                    }
+                }
+            }
+        }
+        p_begin = p_end;
+    }
+
+    for (int64_t q = 0; q < bs; ++q) {
+        faiss::heap_reorder<C>(k, heap_dis + q * k, heap_ids + q * k);
+    }
+}
+
+template <class C>
+void
+IvfFlatBatchSearchImpl(const std::shared_ptr<ThreadPool>& pool, const faiss::IndexIVF& index, const float* xq,
+                       int64_t nq, int64_t k, int64_t nprobe, float* distances, int64_t* labels,
+                       const BitsetView& bitset) {
+    // as few blocks as keep the pool busy, the larger a block the more queries share each list scan
+    const int64_t pool_size = std::max<int64_t>(1, pool->size());
+    const int64_t block_size =
+        std::clamp<int64_t>((nq + pool_size - 1) / pool_size, kMinQueryBlockSize, kMaxQueryBlockSize);
+    const int64_t n_blocks = (nq + block_size - 1) / block_size;
+
+    std::vector<folly::Future<folly::Unit>> futs;
+    futs.reserve(n_blocks);
+    for (int64_t b = 0; b < n_blocks; ++b) {
+        futs.emplace_back(pool->push([&, b] {
+            ThreadPool::ScopedOmpSetter setter(1);
+            const int64_t q_begin = b * block_size;
+            const int64_t q_end = std::min(nq, q_begin + block_size);
+            SearchBlock<C>(index, xq, q_begin, q_end, k, nprobe, distances + q_begin * k, labels + q_begin * k,
+                           bitset);
+        }));
+    }
+    for (auto& fut : futs) {
+        fut.wait();
+    }
+}
+
+}  // namespace
+
+Status
+IvfFlatBatchSearch(const std::shared_ptr<ThreadPool>& pool, const faiss::IndexIVF& index, const float* xq, int64_t nq,
+                   int64_t k, int64_t nprobe, float* distances, int64_t* labels, const BitsetView& bitset) {
+    nprobe = std::min<int64_t>(nprobe, index.nlist);
+    if (k <= 0 || nprobe <= 0) {
+        LOG_KNOWHERE_ERROR_ << "invalid k " << k << " or nprobe " << nprobe << " for ivf batch search";
+        return Status::invalid_args;
+    }
+    switch (index.metric_type) {
+        case faiss::METRIC_L2:
+            IvfFlatBatchSearchImpl<faiss::CMax<float, int64_t>>(pool, index, xq, nq, k, nprobe, distances, labels,
+                                                                bitset);
+            return Status::success;
+        case faiss::METRIC_INNER_PRODUCT:
+            IvfFlatBatchSearchImpl<faiss::CMin<float, int64_t>>(pool, index, xq, nq, k, nprobe, distances, labels,
+                                                                bitset);
+            return Status::success;
+        default:
+            LOG_KNOWHERE_ERROR_ << "ivf batch search does not support metric type " << index.metric_type;
+            return Status::invalid_metric_type;
+    }
+}
+
+}  // namespace knowhere
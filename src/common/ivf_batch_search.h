@@ -0,0 +1,44 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <memory>
+
+#include "faiss/IndexIVF.h"
+#include "knowhere/bitsetview.h"
+#include "knowhere/comp/thread_pool.h"
+#include "knowhere/expected.h"
+
+namespace knowhere {
+
+// Below this many queries two queries rarely probe the same list, so grouping them only adds the coarse
+// quantization and inversion overhead to the per-query path.
+constexpr int64_t kIvfBatchNqThreshold = 16;
+
+inline bool
+UseIvfBatchSearch(faiss::MetricType metric, int64_t nq) {
+    return nq >= kIvfBatchNqThreshold &&
+           (metric == faiss::MetricType::METRIC_L2 || metric == faiss::MetricType::METRIC_INNER_PRODUCT);
+}
+
+// Knn search of a batch of queries on an IVF_FLAT index whose vectors live in `arranged_codes`.
+//
+// The queries are split into blocks, one pool task per block. A task coarse-quantizes its queries, inverts the
+// assignment into list -> queries and then walks the probed lists in list order. Each list is streamed once in
+// chunks that stay in L2, and every chunk is compared against all queries of the block that probe it, so the
+// vectors of a popular list are read once per block instead of once per query. Vectors whose bit is set in `bitset`
+// are skipped. Results are sorted, missing entries are filled with id -1.
+Status
+IvfFlatBatchSearch(const std::shared_ptr<ThreadPool>& pool, const faiss::IndexIVF& index, const float* xq, int64_t nq,
+                   int64_t k, int64_t nprobe, float* distances, int64_t* labels, const BitsetView& bitset);
+
+}  // namespace knowhere
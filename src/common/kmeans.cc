@@ -0,0 +1,496 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "common/kmeans.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+#include "knowhere/log.h"
+#include "simd/hook.h"
+
+#ifndef FINTEGER
+#define FINTEGER long
+#endif
+
+extern "C" {
+
+/* declare BLAS functions, see http://www.netlib.org/clapack/cblas/ */
+
+int
+sgemm_(const char* transa, const char* transb, FINTEGER* m, FINTEGER* n, FINTEGER* k, const float* alpha,
+       const float* a, FINTEGER* lda, const float* b, FINTEGER* ldb, float* beta, float* c, FINTEGER* ldc);
+}
+
+namespace knowhere {
+
+namespace {
+
+// one GEMM multiplies a block of points by a block of centroids, 4MB of inner products at most
+constexpr size_t kAssignPointBlock = 1024;
+constexpr size_t kAssignCentroidBlock = 1024;
+// k-means++ seeding costs k passes over its input, it runs on a sample of this many points per centroid
+constexpr size_t kSeedPointsPerCentroid = 64;
+// a bit above machine epsilon for float16, as in faiss
+constexpr float kSplitEps = 1.0f / 1024;
+
+// Calls func(begin, end) on one contiguous range of [0, n) per pool thread, ranges are at least min_range long.
+// Without a pool func runs once on the whole range on the calling thread.
+template <typename Func>
+void
+ParallelRanges(const std::shared_ptr<ThreadPool>& pool, size_t n, size_t min_range, Func&& func) {
+    size_t n_ranges = pool == nullptr ? 1 : std::min<size_t>(pool->size(), std::max<size_t>(1, n / min_range));
+    if (n_ranges <= 1) {
+        func(size_t(0), n);
+        return;
+    }
+    std::vector<folly::Future<folly::Unit>> futs;
+    futs.reserve(n_ranges);
+    for (size_t r = 0; r < n_ranges; ++r) {
+        futs.emplace_back(pool->push([&, r] { func(n * r / n_ranges, n * (r + 1) / n_ranges); }));
+    }
+    for (auto& fut : futs) {
+        fut.wait();
+    }
+}
+
+// m distinct indices of [0, n) in increasing order
+std::vector<size_t>
+SampleDistinct(size_t n, size_t m, std::mt19937_64& rng) {
+    std::vector<size_t> ids;
+    if (m >= n) {
+        ids.resize(n);
+        std::iota(ids.begin(), ids.end(), 0);
+        return ids;
+    }
+    if (m * 2 > n) {
+        ids.resize(n);
+        std::iota(ids.begin(), ids.end(), 0);
+        for (size_t i = 0; i < m; ++i) {
+            std::swap(ids[i], ids[std::uniform_int_distribution<size_t>(i, n - 1)(rng)]);
+        }
+        ids.resize(m);
+    } else {
+        // Floyd's algorithm
+        std::unordered_set<size_t> picked;
+        picked.reserve(m);
+        for (size_t j = n - m; j < n; ++j) {
+            size_t t = std::uniform_int_distribution<size_t>(0, j)(rng);
+            picked.insert(picked.count(t) ? j : t);
+        }
+        ids.assign(picked.begin(), picked.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void
+GatherRows(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t d, const std::vector<size_t>& ids,
+           float* out) {
+    ParallelRanges(pool, ids.size(), kAssignPointBlock, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::memcpy(out + i * d, x + ids[i] * d, d * sizeof(float));
+        }
+    });
+}
+
+void
+AssignRange(const float* x, size_t begin, size_t end, size_t d, const float* centroids, const float* c_norms,
+            size_t k, bool inner_product, int64_t* assign, float* dis) {
+    std::vector<float> ip_block(kAssignPointBlock * std::min(k, kAssignCentroidBlock));
+    std::vector<float> best(kAssignPointBlock);
+    for (size_t i0 = begin; i0 < end; i0 += kAssignPointBlock) {
+        const size_t i1 = std::min(end, i0 + kAssignPointBlock);
+        FINTEGER ni = i1 - i0;
+        std::fill(best.begin(), best.begin() + ni, std::numeric_limits<float>::max());
+        for (size_t j0 = 0; j0 < k; j0 += kAssignCentroidBlock) {
+            const size_t j1 = std::min(k, j0 + kAssignCentroidBlock);
+            FINTEGER nj = j1 - j0, di = d;
+            float one = 1, zero = 0;
+            // ip_block is ni x nj row major: the inner products of the points with the centroids
+            sgemm_("Transpose", "Not transpose", &nj, &ni, &di, &one, centroids + j0 * d, &di, x + i0 * d, &di, &zero,
+                   ip_block.data(), &nj);
+            for (FINTEGER i = 0; i < ni; ++i) {
+                const float* row = ip_block.data() + i * nj;
+                float& best_i = best[i];
+                int64_t& assign_i = assign[i0 + i];
+                for (FINTEGER j = 0; j < nj; ++j) {
+                    // minimized: -<x, c> or |c|^2 - 2 <x, c>, |x|^2 is the same for all the centroids
+                    float v = inner_product ? -row[j] : c_norms[j0 + j] - 2 * row[j];
+                    if (v < best_i) {
+                        best_i = v;
+                        assign_i = j0 + j;
+                    }
+                }
+            }
+        }
+        if (dis != nullptr) {
+            for (FINTEGER i = 0; i < ni; ++i) {
+                dis[i0 + i] =
+                    inner_product ? -best[i] : std::max(0.0f, faiss::fvec_norm_L2sqr(x + (i0 + i) * d, d) + best[i]);
+            }
+        }
+    }
+}
+
+std::vector<float>
+CentroidNorms(const float* centroids, size_t d, size_t k) {
+    std::vector<float> c_norms(k);
+    for (size_t c = 0; c < k; ++c) {
+        c_norms[c] = faiss::fvec_norm_L2sqr(centroids + c * d, d);
+    }
+    return c_norms;
+}
+
+void
+Normalize(float* centroids, size_t d, size_t c0, size_t c1) {
+    for (size_t c = c0; c < c1; ++c) {
+        float* ci = centroids + c * d;
+        float norm = std::sqrt(faiss::fvec_norm_L2sqr(ci, d));
+        if (norm > 0) {
+            for (size_t j = 0; j < d; ++j) {
+                ci[j] /= norm;
+            }
+        }
+    }
+}
+
+// relative improvement from prev to cur, the objective is minimized for L2 and maximized for inner product
+double
+RelativeImprovement(double prev, double cur, bool inner_product) {
+    if (prev == 0) {
+        return 0;
+    }
+    return (inner_product ? cur - prev : prev - cur) / std::abs(prev);
+}
+
+// Greedy k-means++ on a sample of x, or k random points of x. Every step draws a few candidates with a probability
+// proportional to their squared distance to the closest centroid so far and keeps the one that lowers the sum of
+// these distances most, which avoids most of the bad picks of plain k-means++.
+void
+Seed(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, size_t k, bool kmeans_plus_plus,
+     std::mt19937_64& rng, float* centroids) {
+    if (!kmeans_plus_plus) {
+        GatherRows(pool, x, d, SampleDistinct(n, k, rng), centroids);
+        return;
+    }
+    auto ids = SampleDistinct(n, k * kSeedPointsPerCentroid, rng);
+    std::vector<float> sample(ids.size() * d);
+    GatherRows(pool, x, d, ids, sample.data());
+    const size_t m = ids.size();
+    const size_t n_trials = 2 + (size_t)std::log((double)k);
+    const size_t n_blocks = (m + kAssignPointBlock - 1) / kAssignPointBlock;
+
+    // the sums are taken per block of points and then in block order, so that they do not depend on the pool
+    std::vector<double> block_sums(n_blocks * n_trials);
+    std::vector<size_t> trials(n_trials);
+    std::vector<float> min_dis(m, std::numeric_limits<float>::max());
+    auto update_min_dis = [&](const float* center) {
+        ParallelRanges(pool, m, kAssignPointBlock, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                min_dis[i] = std::min(min_dis[i], faiss::fvec_L2sqr(sample.data() + i * d, center, d));
+            }
+        });
+    };
+
+    size_t pick = std::uniform_int_distribution<size_t>(0, m - 1)(rng);
+    std::memcpy(centroids, sample.data() + pick * d, d * sizeof(float));
+    update_min_dis(centroids);
+    for (size_t c = 1; c < k; ++c) {
+        double total = 0;
+        for (auto v : min_dis) {
+            total += v;
+        }
+        if (total <= 0) {
+            // all the points are on a centroid already
+            pick = std::uniform_int_distribution<size_t>(0, m - 1)(rng);
+            std::memcpy(centroids + c * d, sample.data() + pick * d, d * sizeof(float));
+            continue;
+        }
+        for (auto& trial : trials) {
+            double r = std::uniform_real_distribution<double>(0, total)(rng);
+            trial = m - 1;
+            for (size_t i = 0; i < m; ++i) {
+                r -= min_dis[i];
+                if (r <= 0 && min_dis[i] > 0) {
+                    trial = i;
+                    break;
+                }
+            }
+        }
+        ParallelRanges(pool, n_blocks, 1, [&](size_t b0, size_t b1) {
+            for (size_t b = b0; b < b1; ++b) {
+                for (size_t t = 0; t < n_trials; ++t) {
+                    const float* center = sample.data() + trials[t] * d;
+                    double sum = 0;
+                    for (size_t i = b * kAssignPointBlock; i < std::min(m, (b + 1) * kAssignPointBlock); ++i) {
+                        sum += std::min(min_dis[i], faiss::fvec_L2sqr(sample.data() + i * d, center, d));
+                    }
+                    block_sums[b * n_trials + t] = sum;
+                }
+            }
+        });
+        size_t best = 0;
+        double best_sum = std::numeric_limits<double>::max();
+        for (size_t t = 0; t < n_trials; ++t) {
+            double sum = 0;
+            for (size_t b = 0; b < n_blocks; ++b) {
+                sum += block_sums[b * n_trials + t];
+            }
+            if (sum < best_sum) {
+                best = t;
+                best_sum = sum;
+            }
+        }
+        std::memcpy(centroids + c * d, sample.data() + trials[best] * d, d * sizeof(float));
+        update_min_dis(centroids + c * d);
+    }
+}
+
+// Gives every empty cluster half of a large one, picked with a probability that grows with its size. The centroid is
+// copied with a small symmetric perturbation so that the next assignment splits the points.
+int64_t
+SplitEmptyClusters(size_t d, size_t k, size_t n, std::vector<int64_t>& counts, float* centroids,
+                   std::mt19937_64& rng) {
+    int64_t nsplit = 0;
+    std::uniform_real_distribution<double> uniform(0, 1);
+    const double denom = std::max<double>(1, (double)n - (double)k);
+    for (size_t ci = 0; ci < k; ++ci) {
+        if (counts[ci] != 0) {
+            continue;
+        }
+        size_t cj = 0;
+        for (;; cj = (cj + 1) % k) {
+            if (counts[cj] > 1 && uniform(rng) < (counts[cj] - 1) / denom) {
+                break;
+            }
+        }
+        std::memcpy(centroids + ci * d, centroids + cj * d, d * sizeof(float));
+        for (size_t j = 0; j < d; ++j) {
+            float sign = j % 2 == 0 ? 1 : -1;
+            centroids[ci * d + j] *= 1 + sign * kSplitEps;
+            centroids[cj * d + j] *= 1 - sign * kSplitEps;
+        }
+        counts[ci] = counts[cj] / 2;
+        counts[cj] -= counts[ci];
+        nsplit++;
+    }
+    return nsplit;
+}
+
+double
+Sum(const std::vector<float>& v) {
+    double sum = 0;
+    for (auto x : v) {
+        sum += x;
+    }
+    return sum;
+}
+
+void
+TrainFullBatch(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, size_t k,
+               const KMeansConfig& cfg, std::mt19937_64& rng, float* centroids, KMeansStats& stats) {
+    std::vector<float> sample;
+    if (cfg.max_points_per_centroid > 0 && n > k * cfg.max_points_per_centroid) {
+        auto ids = SampleDistinct(n, k * cfg.max_points_per_centroid, rng);
+        sample.resize(ids.size() * d);
+        GatherRows(pool, x, d, ids, sample.data());
+        x = sample.data();
+        n = ids.size();
+    }
+    Seed(pool, x, n, d, k, cfg.kmeans_plus_plus, rng, centroids);
+
+    std::vector<int64_t> assign(n);
+    std::vector<float> dis(n);
+    std::vector<int64_t> counts(k);
+    double prev = 0;
+    for (int64_t it = 0; it < cfg.niter; ++it) {
+        KMeansAssign(pool, x, n, d, centroids, k, cfg.inner_product, assign.data(), dis.data());
+        double obj = Sum(dis);
+        stats.iterations = it + 1;
+        stats.objectives.push_back(obj);
+        if (it > 0 && RelativeImprovement(prev, obj, cfg.inner_product) < cfg.tol) {
+            stats.converged = true;
+            break;
+        }
+        prev = obj;
+
+        // every range of centroids is owned by one thread, which scans all the assignments for its own points
+        ParallelRanges(pool, k, 1, [&](size_t c0, size_t c1) {
+            std::memset(centroids + c0 * d, 0, (c1 - c0) * d * sizeof(float));
+            std::fill(counts.begin() + c0, counts.begin() + c1, 0);
+            for (size_t i = 0; i < n; ++i) {
+                size_t c = assign[i];
+                if (c < c0 || c >= c1) {
+                    continue;
+                }
+                counts[c]++;
+                float* ci = centroids + c * d;
+                const float* xi = x + i * d;
+                for (size_t j = 0; j < d; ++j) {
+                    ci[j] += xi[j];
+                }
+            }
+            for (size_t c = c0; c < c1; ++c) {
+                if (counts[c] > 0) {
+                    float inv = 1.0f / counts[c];
+                    for (size_t j = 0; j < d; ++j) {
+                        centroids[c * d + j] *= inv;
+                    }
+                }
+            }
+        });
+        auto nsplit = SplitEmptyClusters(d, k, n, counts, centroids, rng);
+        if (cfg.spherical) {
+            Normalize(centroids, d, 0, k);
+        }
+        LOG_KNOWHERE_DEBUG_ << "k-means iteration " << it << ", objective " << obj << ", " << nsplit << " splits";
+    }
+}
+
+void
+TrainMiniBatch(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, size_t k,
+               const KMeansConfig& cfg, std::mt19937_64& rng, float* centroids, KMeansStats& stats) {
+    const size_t batch_size = std::min<size_t>(cfg.batch_size, n);
+    // visit no more points than the full batch mode would
+    const size_t full_batch_n = cfg.max_points_per_centroid > 0 ? std::min(n, k * cfg.max_points_per_centroid) : n;
+    const int64_t max_steps = std::max<int64_t>(1, cfg.niter * full_batch_n / batch_size);
+    const int64_t eval_interval = std::max<int64_t>(1, cfg.eval_interval);
+
+    // the objective is always measured on the same points, so that two checks differ by the centroids only
+    auto eval_ids = SampleDistinct(n, std::max<int64_t>(1, cfg.eval_size), rng);
+    std::vector<float> eval(eval_ids.size() * d);
+    GatherRows(pool, x, d, eval_ids, eval.data());
+    std::vector<int64_t> eval_assign(eval_ids.size());
+    std::vector<float> eval_dis(eval_ids.size());
+
+    Seed(pool, x, n, d, k, cfg.kmeans_plus_plus, rng, centroids);
+
+    std::vector<int64_t> seen(k, 0);
+    std::vector<size_t> batch_ids(batch_size);
+    std::vector<float> batch(batch_size * d);
+    std::vector<int64_t> assign(batch_size);
+    std::uniform_int_distribution<size_t> uniform(0, n - 1);
+    double best = 0;
+    int64_t checks_under_tol = 0;
+    for (int64_t step = 0; step < max_steps; ++step) {
+        for (auto& id : batch_ids) {
+            id = uniform(rng);
+        }
+        // read the data front to back
+        std::sort(batch_ids.begin(), batch_ids.end());
+        GatherRows(pool, x, d, batch_ids, batch.data());
+        KMeansAssign(pool, batch.data(), batch_size, d, centroids, k, cfg.inner_product, assign.data(), nullptr);
+
+        // c += (sum of its batch points - m * c) / (points seen so far), m being its number of batch points
+        ParallelRanges(pool, k, 1, [&](size_t c0, size_t c1) {
+            std::vector<float> sums((c1 - c0) * d, 0.0f);
+            std::vector<int64_t> m(c1 - c0, 0);
+            for (size_t i = 0; i < batch_size; ++i) {
+                size_t c = assign[i];
+                if (c < c0 || c >= c1) {
+                    continue;
+                }
+                m[c - c0]++;
+                float* s = sums.data() + (c - c0) * d;
+                const float* xi = batch.data() + i * d;
+                for (size_t j = 0; j < d; ++j) {
+                    s[j] += xi[j];
+                }
+            }
+            for (size_t c = c0; c < c1; ++c) {
+                if (m[c - c0] == 0) {
+                    continue;
+                }
+                seen[c] += m[c - c0];
+                float inv = 1.0f / seen[c];
+                float keep = 1.0f - m[c - c0] * inv;
+                float* ci = centroids + c * d;
+                const float* s = sums.data() + (c - c0) * d;
+                for (size_t j = 0; j < d; ++j) {
+                    ci[j] = ci[j] * keep + s[j] * inv;
+                }
+            }
+            if (cfg.spherical) {
+                Normalize(centroids, d, c0, c1);
+            }
+        });
+        stats.iterations = step + 1;
+
+        if ((step + 1) % eval_interval != 0 && step + 1 != max_steps) {
+            continue;
+        }
+        KMeansAssign(pool, eval.data(), eval_ids.size(), d, centroids, k, cfg.inner_product, eval_assign.data(),
+                     eval_dis.data());
+        double obj = Sum(eval_dis);
+        stats.objectives.push_back(obj);
+        LOG_KNOWHERE_DEBUG_ << "mini-batch k-means step " << step << ", objective " << obj;
+        // a single noisy step must not stop training: compare with the best so far, and only stop after patience
+        // checks in a row made no progress
+        if (stats.objectives.size() > 1) {
+            checks_under_tol = RelativeImprovement(best, obj, cfg.inner_product) < cfg.tol ? checks_under_tol + 1 : 0;
+            if (checks_under_tol >= std::max<int64_t>(1, cfg.patience)) {
+                stats.converged = true;
+                break;
+            }
+        }
+        if (stats.objectives.size() == 1 || RelativeImprovement(best, obj, cfg.inner_product) > 0) {
+            best = obj;
+        }
+        // centroids no batch point has gone to yet restart on a point of the last batch
+        for (size_t c = 0; c < k; ++c) {
+            if (seen[c] == 0) {
+                std::memcpy(centroids + c * d, batch.data() + uniform(rng) % batch_size * d, d * sizeof(float));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+void
+KMeansAssign(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, const float* centroids,
+             size_t k, bool inner_product, int64_t* assign, float* dis) {
+    std::vector<float> c_norms;
+    if (!inner_product) {
+        c_norms = CentroidNorms(centroids, d, k);
+    }
+    ParallelRanges(pool, n, kAssignPointBlock, [&](size_t begin, size_t end) {
+        AssignRange(x, begin, end, d, centroids, c_norms.data(), k, inner_product, assign, dis);
+    });
+}
+
+Status
+KMeansTrain(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, size_t k,
+            const KMeansConfig& cfg, float* centroids, KMeansStats* stats) {
+    if (d == 0 || k == 0 || n < k) {
+        LOG_KNOWHERE_ERROR_ << "k-means needs at least as many points as centroids, got " << n << " points for " << k
+                            << " centroids in " << d << " dimensions";
+        return Status::invalid_args;
+    }
+    KMeansStats local_stats;
+    KMeansStats& st = stats != nullptr ? *stats : local_stats;
+    st = KMeansStats();
+    std::mt19937_64 rng(cfg.seed);
+    if (cfg.batch_size > 0 && (size_t)cfg.batch_size < n) {
+        TrainMiniBatch(pool, x, n, d, k, cfg, rng, centroids, st);
+    } else {
+        TrainFullBatch(pool, x, n, d, k, cfg, rng, centroids, st);
+    }
+    return Status::success;
+}
+
+}  // namespace knowhere
@@ -0,0 +1,76 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "knowhere/comp/thread_pool.h"
+#include "knowhere/expected.h"
+
+namespace knowhere {
+
+struct KMeansConfig {
+    // full batch: number of Lloyd iterations. mini-batch: the number of steps is capped so that the points visited
+    // do not exceed niter passes over the full batch training set.
+    int64_t niter = 25;
+    // points drawn per mini-batch step, 0 runs full batch Lloyd iterations
+    int64_t batch_size = 0;
+    // full batch training uses a random sample of at most k * max_points_per_centroid points, 0 keeps all of them
+    int64_t max_points_per_centroid = 256;
+    // stop when the relative improvement of the objective falls below tol
+    double tol = 1e-4;
+    // mini-batch: number of consecutive checks under tol before stopping, the objective of a step is noisy
+    int64_t patience = 3;
+    // mini-batch: the objective is measured every eval_interval steps on a fixed random sample of this many points
+    int64_t eval_size = 16384;
+    int64_t eval_interval = 8;
+    // assign by largest inner product instead of smallest L2 distance
+    bool inner_product = false;
+    // normalize the centroids after every update
+    bool spherical = false;
+    // seed with k-means++ on a sample of the data instead of with random points
+    bool kmeans_plus_plus = false;
+    int64_t seed = 1234;
+};
+
+struct KMeansStats {
+    // Lloyd iterations or mini-batch steps that were run
+    int64_t iterations = 0;
+    // sum of the squared distances (of the inner products with inner_product) between the points and their centroid,
+    // over the training set in full batch mode and over the evaluation sample in mini-batch mode; one entry per check
+    std::vector<double> objectives;
+    // true if training stopped on tol before running out of iterations
+    bool converged = false;
+};
+
+// Nearest centroid of each of the n points of x (n * d). Distances come from a GEMM between blocks of points and
+// blocks of centroids, the points are split into one contiguous shard per pool thread. dis (optional) receives the
+// squared L2 distance, or the inner product with inner_product. pool can be nullptr to run on the calling thread.
+void
+KMeansAssign(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, const float* centroids,
+             size_t k, bool inner_product, int64_t* assign, float* dis);
+
+// Trains k centroids (k * d, written to centroids) on the n points of x.
+//
+// With batch_size = 0 this is Lloyd's algorithm on a random sample of the data. Otherwise every step draws
+// batch_size points from all of x and moves each centroid towards the mean of its points in the batch with a
+// learning rate of 1 / (points it has seen so far), which needs neither a copy of the data nor a pass over all of it.
+// In both modes the pool threads own contiguous shards of points for the assignment and disjoint ranges of centroids
+// for the update, so nothing is shared between threads but the read-only inputs. Empty clusters are filled by
+// splitting large ones. pool can be nullptr to run on the calling thread, e.g. when the caller is a pool task itself.
+Status
+KMeansTrain(const std::shared_ptr<ThreadPool>& pool, const float* x, size_t n, size_t d, size_t k,
+            const KMeansConfig& cfg, float* centroids, KMeansStats* stats = nullptr);
+
+}  // namespace knowhere
@@ -16,6 +16,10 @@ namespace knowhere {
 const prometheus::Histogram::BucketBoundaries buckets = {1,   2,    4,    8,    16,   32,    64,    128,  256,
                                                          512, 1024, 2048, 4096, 8192, 16384, 32768, 65536};
 
+const prometheus::Histogram::BucketBoundaries latency_buckets = {0.01, 0.025, 0.05, 0.1,  0.25,  0.5,   1,     2.5,
+                                                                 5,    10,    25,   50,   100,   250,   500,   1000,
+                                                                 2500, 5000,  10000, 60000, 600000, 3600000};
+
 const std::unique_ptr<PrometheusClient> prometheusClient = std::make_unique<PrometheusClient>();
 
 /*******************************************************************************
@@ -29,4 +33,67 @@ DEFINE_PROMETHEUS_COUNTER(knowhere_build_count, "knowhere index build count")
 DEFINE_PROMETHEUS_COUNTER(knowhere_search_count, "knowhere search count")
 DEFINE_PROMETHEUS_COUNTER(knowhere_range_search_count, "knowhere range search count")
 
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_build_latency, "knowhere index build latency in milliseconds")
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_search_latency, "knowhere search latency in milliseconds")
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_range_search_latency, "knowhere range search latency in milliseconds")
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_load_latency, "knowhere index deserialize latency in milliseconds")
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(knowhere_search_phase_latency, "knowhere search phase latency in milliseconds")
+DEFINE_PROMETHEUS_GAUGE_FAMILY(knowhere_index_resident_bytes, "knowhere bytes of the built or loaded indexes")
+DEFINE_PROMETHEUS_GAUGE(knowhere_thread_pool_queue_depth, "knowhere thread pool tasks waiting to start")
+DEFINE_PROMETHEUS_COUNTER(knowhere_diskann_node_cache_hits, "knowhere diskann node visits served by the node cache")
+DEFINE_PROMETHEUS_COUNTER(knowhere_diskann_node_cache_misses, "knowhere diskann node visits read from disk")
+DEFINE_PROMETHEUS_COUNTER(knowhere_diskann_node_cache_refresh_count, "knowhere diskann adaptive node cache refreshes")
+DEFINE_PROMETHEUS_COUNTER(knowhere_hnsw_entry_cache_hits, "knowhere hnsw searches started from a cached entry point")
+DEFINE_PROMETHEUS_COUNTER(knowhere_hnsw_entry_cache_misses, "knowhere hnsw searches without a cached entry point")
+DEFINE_PROMETHEUS_COUNTER(knowhere_diskann_entry_cache_hits, "knowhere diskann searches started from a cached medoid")
+DEFINE_PROMETHEUS_COUNTER(knowhere_diskann_entry_cache_misses, "knowhere diskann searches without a cached medoid")
+
+prometheus::Histogram&
+IndexTypeHistogram(prometheus::Family<prometheus::Histogram>& family, const std::string& index_type) {
+    return family.Add({{"index_type", index_type}}, latency_buckets);
+}
+
+prometheus::Gauge&
+IndexTypeGauge(prometheus::Family<prometheus::Gauge>& family, const std::string& index_type) {
+    return family.Add({{"index_type", index_type}});
+}
+
+void
+ObserveSearchPhase(SearchPhase phase, double ms) {
+    // in the order of SearchPhase
+    static prometheus::Histogram* const histograms[] = {
+        &knowhere_search_phase_latency_family.Add({{"phase", "coarse_quantization"}}, latency_buckets),
+        &knowhere_search_phase_latency_family.Add({{"phase", "list_scan"}}, latency_buckets),
+        &knowhere_search_phase_latency_family.Add({{"phase", "graph_hops"}}, latency_buckets),
+        &knowhere_search_phase_latency_family.Add({{"phase", "io_wait"}}, latency_buckets),
+        &knowhere_search_phase_latency_family.Add({{"phase", "result_assembly"}}, latency_buckets),
+    };
+    histograms[static_cast<int>(phase)]->Observe(ms);
+}
+
+void
+AddThreadPoolQueueDepth(int64_t delta) {
+    knowhere_thread_pool_queue_depth.Increment(delta);
+}
+
+void
+CountNodeCacheAccesses(uint64_t hits, uint64_t misses) {
+    knowhere_diskann_node_cache_hits.Increment(hits);
+    knowhere_diskann_node_cache_misses.Increment(misses);
+}
+
+void
+CountNodeCacheRefresh() {
+    knowhere_diskann_node_cache_refresh_count.Increment();
+}
+
+void
+CountEntryCacheLookup(EntryCacheIndex index, bool hit) {
+    static prometheus::Counter* const counters[][2] = {
+        {&knowhere_hnsw_entry_cache_misses, &knowhere_hnsw_entry_cache_hits},
+        {&knowhere_diskann_entry_cache_misses, &knowhere_diskann_entry_cache_hits},
+    };
+    counters[static_cast<int>(index)][hit]->Increment();
+}
+
 }  // namespace knowhere
@@ -12,118 +12,99 @@
 #include "range_util.h"
 
 #include <algorithm>
-#include <cinttypes>
 
+#include "knowhere/comp/metrics.h"
+#include "knowhere/config.h"
 #include "knowhere/log.h"
 namespace knowhere {
 
-///////////////////////////////////////////////////////////////////////////////
-// For Faiss index types
-size_t
-CountValidRangeSearchResult(const faiss::RangeSearchResult& res, const bool is_ip, const int64_t nq, const float radius,
-                            const float range_filter, size_t*& lims) {
-    lims = new size_t[nq + 1];
-    lims[0] = 0;
-    for (int64_t i = 0; i < nq; i++) {
-        int64_t valid = 0;
-        for (size_t j = res.lims[i]; j < res.lims[i + 1]; j++) {
-            if (distance_in_range(res.distances[j], radius, range_filter, is_ip)) {
-                valid++;
-            }
-        }
-        lims[i + 1] = lims[i] + valid;
-    }
-    return lims[nq];
+namespace {
+constexpr size_t kMinChunkSize = 64;
+constexpr size_t kMaxChunkSize = 64 * 1024;
+}  // namespace
+
+RangeSearchResultCollector::RangeSearchResultCollector(const int64_t nq, const bool is_ip, const float radius,
+                                                       const float range_filter)
+    : nq_(nq),
+      is_ip_(is_ip),
+      radius_(radius),
+      range_filter_(range_filter),
+      filter_(range_filter != defaultRangeFilter),
+      results_(nq) {
 }
 
 void
-FilterRangeSearchResultForOneNq(const int64_t i_size, const float* i_distances, const int64_t* i_labels,
-                                const bool is_ip, const float radius, const float range_filter, const int64_t o_size,
-                                float* o_distances, int64_t* o_labels, const BitsetView& bitset) {
-    int64_t num = 0;
-    for (int64_t i = 0; i < i_size; i++) {
-        auto dis = i_distances[i];
-        auto id = i_labels[i];
-        KNOWHERE_THROW_IF_NOT_MSG(bitset.empty() || !bitset.test(id), "bitset invalid");
-        if (distance_in_range(dis, radius, range_filter, is_ip)) {
-            o_labels[num] = id;
-            o_distances[num] = dis;
-            num++;
-        }
-    }
-    KNOWHERE_THROW_IF_NOT_FMT(num == o_size, "%" SCNd64 " not equal %" SCNd64, num, o_size);
+RangeSearchResultCollector::AddChunk(QueryResult& result) {
+    // chunks grow geometrically, most queries only ever touch the first small one
+    size_t capacity = result.chunks.empty() ? kMinChunkSize : std::min(result.chunks.back().capacity * 2, kMaxChunkSize);
+    Chunk chunk;
+    chunk.distances.reset(new float[capacity]);
+    chunk.labels.reset(new int64_t[capacity]);
+    chunk.capacity = capacity;
+    result.chunks.emplace_back(std::move(chunk));
 }
 
 void
-GetRangeSearchResult(const faiss::RangeSearchResult& res, const bool is_ip, const int64_t nq, const float radius,
-                     const float range_filter, float*& distances, int64_t*& labels, size_t*& lims,
-                     const BitsetView& bitset) {
-    auto total_valid = CountValidRangeSearchResult(res, is_ip, nq, radius, range_filter, lims);
-    LOG_KNOWHERE_DEBUG_ << "Range search: is_ip " << (is_ip ? "True" : "False") << ", radius " << radius
-                        << ", range_filter " << range_filter << ", total result num " << total_valid;
-
-    distances = new float[total_valid];
-    labels = new int64_t[total_valid];
-
-#pragma omp parallel for
-    for (auto i = 0; i < nq; i++) {
-        FilterRangeSearchResultForOneNq(res.lims[i + 1] - res.lims[i], res.distances + res.lims[i],
-                                        res.labels + res.lims[i], is_ip, radius, range_filter, lims[i + 1] - lims[i],
-                                        distances + lims[i], labels + lims[i], bitset);
+RangeSearchResultCollector::Add(const int64_t q, const float* distances, const int64_t* labels, const size_t n) {
+    auto& result = results_[q];
+    for (size_t i = 0; i < n; i++) {
+        if (filter_ && !distance_in_range(distances[i], radius_, range_filter_, is_ip_)) {
+            continue;
+        }
+        if (result.chunks.empty() || result.chunks.back().size == result.chunks.back().capacity) {
+            AddChunk(result);
+        }
+        auto& chunk = result.chunks.back();
+        chunk.distances[chunk.size] = distances[i];
+        chunk.labels[chunk.size] = labels[i];
+        chunk.size++;
+        result.count++;
     }
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// for HNSW and DiskANN
 void
-FilterRangeSearchResultForOneNq(std::vector<float>& distances, std::vector<int64_t>& labels, const bool is_ip,
-                                const float radius, const float range_filter) {
-    KNOWHERE_THROW_IF_NOT_FMT(distances.size() == labels.size(), "distances' size %ld not equal to labels' size %ld",
-                              distances.size(), labels.size());
-    auto len = distances.size();
-    size_t valid_cnt = 0;
-    for (size_t i = 0; i < len; i++) {
-        auto dist = distances[i];
-        auto id = labels[i];
-        if (distance_in_range(dist, radius, range_filter, is_ip)) {
-            distances[valid_cnt] = dist;
-            labels[valid_cnt] = id;
-            valid_cnt++;
+RangeSearchResultCollector::Scatter(const size_t* lims, float* distances, int64_t* labels) const {
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t i = 0; i < nq_; i++) {
+        auto offset = lims[i];
+        for (const auto& chunk : results_[i].chunks) {
+            std::copy_n(chunk.distances.get(), chunk.size, distances + offset);
+            std::copy_n(chunk.labels.get(), chunk.size, labels + offset);
+            offset += chunk.size;
         }
     }
-    if (valid_cnt != distances.size()) {
-        distances.resize(valid_cnt);
-        labels.resize(valid_cnt);
-    }
 }
 
 void
-GetRangeSearchResult(const std::vector<std::vector<float>>& result_distances,
-                     const std::vector<std::vector<int64_t>>& result_labels, const bool is_ip, const int64_t nq,
-                     const float radius, const float range_filter, float*& distances, int64_t*& labels, size_t*& lims) {
-    KNOWHERE_THROW_IF_NOT_FMT(result_distances.size() == (size_t)nq, "result distances size %ld not equal to %" SCNd64,
-                              result_distances.size(), nq);
-    KNOWHERE_THROW_IF_NOT_FMT(result_labels.size() == (size_t)nq, "result labels size %ld not equal to %" SCNd64,
-                              result_labels.size(), nq);
-
-    lims = new size_t[nq + 1];
+RangeSearchResultCollector::Finish(float*& distances, int64_t*& labels, size_t*& lims) const {
+    ScopedPhaseTimer timer(SearchPhase::RESULT_ASSEMBLY);
+    lims = new size_t[nq_ + 1];
     lims[0] = 0;
-    // all distances must be in range scope
-    for (int64_t i = 0; i < nq; i++) {
-        lims[i + 1] = lims[i] + result_distances[i].size();
+    for (int64_t i = 0; i < nq_; i++) {
+        lims[i + 1] = lims[i] + results_[i].count;
     }
+    LOG_KNOWHERE_DEBUG_ << "Range search: is_ip " << (is_ip_ ? "True" : "False") << ", radius " << radius_
+                        << ", range_filter " << range_filter_ << ", total result num " << lims[nq_];
 
-    size_t total_valid = lims[nq];
-    LOG_KNOWHERE_DEBUG_ << "Range search: is_ip " << (is_ip ? "True" : "False") << ", radius " << radius
-                        << ", range_filter " << range_filter << ", total result num " << total_valid;
-
-    distances = new float[total_valid];
-    labels = new int64_t[total_valid];
+    distances = new float[lims[nq_]];
+    labels = new int64_t[lims[nq_]];
+    Scatter(lims, distances, labels);
+}
 
-    for (auto i = 0; i < nq; i++) {
-        std::copy_n(result_distances[i].data(), lims[i + 1] - lims[i], distances + lims[i]);
-        std::copy_n(result_labels[i].data(), lims[i + 1] - lims[i], labels + lims[i]);
+void
+RangeSearchResultCollector::Finish(RangeSearchBuf& buf) const {
+    ScopedPhaseTimer timer(SearchPhase::RESULT_ASSEMBLY);
+    buf.lims.resize(nq_ + 1);
+    buf.lims[0] = 0;
+    for (int64_t i = 0; i < nq_; i++) {
+        buf.lims[i + 1] = buf.lims[i] + results_[i].count;
     }
+    LOG_KNOWHERE_DEBUG_ << "Range search: is_ip " << (is_ip_ ? "True" : "False") << ", radius " << radius_
+                        << ", range_filter " << range_filter_ << ", total result num " << buf.lims[nq_];
+
+    buf.distances.resize(buf.lims[nq_]);
+    buf.ids.resize(buf.lims[nq_]);
+    Scatter(buf.lims.data(), buf.distances.data(), buf.ids.data());
 }
 
 }  // namespace knowhere
@@ -13,9 +13,11 @@
 
 #include <faiss/impl/AuxIndexStructures.h>
 
+#include <memory>
 #include <vector>
 
 #include "knowhere/bitsetview.h"
+#include "knowhere/dataset.h"
 
 namespace knowhere {
 
@@ -24,18 +26,68 @@ distance_in_range(const float dist, const float radius, const float range_filter
     return ((is_ip && radius < dist && dist <= range_filter) || (!is_ip && range_filter <= dist && dist < radius));
 }
 
-void
-GetRangeSearchResult(const faiss::RangeSearchResult& res, const bool is_ip, const int64_t nq, const float radius,
-                     const float range_filter, float*& distances, int64_t*& labels, size_t*& lims,
-                     const BitsetView& bitset);
+// Collects the range search results of nq queries that are searched concurrently, one task per query at a time.
+// Hits outside (radius, range_filter] are dropped as they are added, and every query appends into its own list of
+// chunks that never move, so a hit is copied exactly once more: by Finish(), which takes a prefix sum over the
+// per-query counts and then scatters all queries into the final arrays in parallel.
+class RangeSearchResultCollector {
+ public:
+    RangeSearchResultCollector(const int64_t nq, const bool is_ip, const float radius, const float range_filter);
 
-void
-FilterRangeSearchResultForOneNq(std::vector<float>& distances, std::vector<int64_t>& labels, const bool is_ip,
-                                const float radius, const float range_filter);
+    // not thread safe for the same query
+    void
+    Add(const int64_t q, const float* distances, const int64_t* labels, const size_t n);
 
-void
-GetRangeSearchResult(const std::vector<std::vector<float>>& result_distances,
-                     const std::vector<std::vector<int64_t>>& result_labels, const bool is_ip, const int64_t nq,
-                     const float radius, const float range_filter, float*& distances, int64_t*& labels, size_t*& lims);
+    void
+    Add(const int64_t q, const float distance, const int64_t label) {
+        if (filter_ && !distance_in_range(distance, radius_, range_filter_, is_ip_)) {
+            return;
+        }
+        auto& result = results_[q];
+        if (result.chunks.empty() || result.chunks.back().size == result.chunks.back().capacity) {
+            AddChunk(result);
+        }
+        auto& chunk = result.chunks.back();
+        chunk.distances[chunk.size] = distance;
+        chunk.labels[chunk.size] = label;
+        chunk.size++;
+        result.count++;
+    }
+
+    // lims, distances and labels are allocated with new[]
+    void
+    Finish(float*& distances, int64_t*& labels, size_t*& lims) const;
+
+    void
+    Finish(RangeSearchBuf& buf) const;
+
+ private:
+    struct Chunk {
+        std::unique_ptr<float[]> distances;
+        std::unique_ptr<int64_t[]> labels;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    // one per query, aligned so that queries appended by different threads do not share a cache line
+    struct alignas(64) QueryResult {
+        std::vector<Chunk> chunks;
+        size_t count = 0;
+    };
+
+    static void
+    AddChunk(QueryResult& result);
+
+    void
+    Scatter(const size_t* lims, float* distances, int64_t* labels) const;
+
+    int64_t nq_;
+    bool is_ip_;
+    float radius_;
+    float range_filter_;
+    // the indexes only return hits within radius, so only a range_filter has to be checked here
+    bool filter_;
+    std::vector<QueryResult> results_;
+};
 
 }  // namespace knowhere
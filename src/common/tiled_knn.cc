@@ -0,0 +1,152 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "common/tiled_knn.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "faiss/utils/Heap.h"
+#include "knowhere/log.h"
+#include "simd/hook.h"
+
+namespace knowhere {
+
+namespace {
+
+constexpr int64_t kQueryBlockSize = 16;
+// budget for one base block, leaves room in a typical 512KB-1MB L2 for the queries and the heaps
+constexpr int64_t kBaseBlockBytes = 256 * 1024;
+constexpr int64_t kMinBaseBlockSize = 64;
+constexpr int64_t kMaxBaseBlockSize = 4096;
+// do not split the base into slices smaller than this, the merge would cost more than it saves
+constexpr int64_t kMinBaseSliceSize = 16384;
+
+// Search queries [q_begin, q_end) against base rows [b_begin, b_end), keeping one heap of size k per query in
+// heap_dis/heap_ids (query q_begin first).
+template <class C>
+void
+SearchTile(const float* xq, int64_t q_begin, int64_t q_end, const float* xb, int64_t b_begin, int64_t b_end,
+           int64_t dim, int64_t k, int64_t base_block, float* heap_dis, int64_t* heap_ids, const BitsetView& bitset) {
+    for (int64_t q = q_begin; q < q_end; ++q) {
+        faiss::heap_heapify<C>(k, heap_dis + (q - q_begin) * k, heap_ids + (q - q_begin) * k);
+    }
+
+    std::vector<float> dis(base_block);
+    for (int64_t b0 = b_begin; b0 < b_end; b0 += base_block) {
+        const int64_t bs = std::min(base_block, b_end - b0);
+        const float* block = xb + b0 * dim;
+        for (int64_t q = q_begin; q < q_end; ++q) {
+            const float* query = xq + q * dim;
+            if constexpr (C::is_max) {
+                faiss::fvec_L2sqr_ny(dis.data(), query, block, dim, bs);
+            } else {
+                faiss::fvec_inner_products_ny(dis.data(), query, block, dim, bs);
+            }
+            float* simi = heap_dis + (q - q_begin) * k;
+            int64_t* idxi = heap_ids + (q - q_begin) * k;
+            for (int64_t j = 0; j < bs; ++j) {
+                if (!C::cmp(simi[0], dis[j])) {
+                    continue;
+                }
+                const int64_t id = b0 + j;
+                if (!bitset.empty() && bitset.test(id)) {
+                    continue;
+                }
+                faiss::heap_replace_top<C>(k, simi, idxi, dis[j], id);
+            }
+        }
+    }
+}
+
+template <class C>
+void
+TiledKnnSearchImpl(const std::shared_ptr<ThreadPool>& pool, const float* xq, int64_t nq, const float* xb, int64_t nb,
+                   int64_t dim, int64_t k, float* distances, int64_t* labels, const BitsetView& bitset) {
+    const int64_t base_block =
+        std::clamp<int64_t>(kBaseBlockBytes / (dim * sizeof(float)), kMinBaseBlockSize, kMaxBaseBlockSize);
+    const int64_t n_qblocks = (nq + kQueryBlockSize - 1) / kQueryBlockSize;
+
+    // split the base as well when there are too few query blocks to occupy the pool
+    int64_t n_slices = std::max<int64_t>(1, (pool->size() + n_qblocks - 1) / n_qblocks);
+    n_slices = std::min(n_slices, std::max<int64_t>(1, nb / kMinBaseSliceSize));
+    const int64_t slice_size = (nb + n_slices - 1) / n_slices;
+
+    // slice 0 builds its heaps in the output buffers, the other slices in scratch that is merged afterwards
+    std::vector<float> slice_dis((n_slices - 1) * nq * k);
+    std::vector<int64_t> slice_ids((n_slices - 1) * nq * k);
+    auto heap_dis_of = [&](int64_t s) { return s == 0 ? distances : slice_dis.data() + (s - 1) * nq * k; };
+    auto heap_ids_of = [&](int64_t s) { return s == 0 ? labels : slice_ids.data() + (s - 1) * nq * k; };
+
+    std::vector<folly::Future<folly::Unit>> futs;
+    futs.reserve(n_qblocks * n_slices);
+    for (int64_t qb = 0; qb < n_qblocks; ++qb) {
+        for (int64_t s = 0; s < n_slices; ++s) {
+            futs.emplace_back(pool->push([&, qb, s] {
+                const int64_t q_begin = qb * kQueryBlockSize;
+                const int64_t q_end = std::min(nq, q_begin + kQueryBlockSize);
+                const int64_t b_begin = std::min(nb, s * slice_size);
+                const int64_t b_end = std::min(nb, b_begin + slice_size);
+                SearchTile<C>(xq, q_begin, q_end, xb, b_begin, b_end, dim, k, base_block, heap_dis_of(s) + q_begin * k,
+                              heap_ids_of(s) + q_begin * k, bitset);
+            }));
+        }
+    }
+    for (auto& fut : futs) {
+        fut.wait();
+    }
+    futs.clear();
+
+    for (int64_t qb = 0; qb < n_qblocks; ++qb) {
+        futs.emplace_back(pool->push([&, qb] {
+            const int64_t q_begin = qb * kQueryBlockSize;
+            const int64_t q_end = std::min(nq, q_begin + kQueryBlockSize);
+            for (int64_t q = q_begin; q < q_end; ++q) {
+                float* simi = distances + q * k;
+                int64_t* idxi = labels + q * k;
+                for (int64_t s = 1; s < n_slices; ++s) {
+                    const float* src_dis = heap_dis_of(s) + q * k;
+                    const int64_t* src_ids = heap_ids_of(s) + q * k;
+                    for (int64_t j = 0; j < k; ++j) {
+                        if (src_ids[j] != -1 && C::cmp(simi[0], src_dis[j])) {
+                            faiss::heap_replace_top<C>(k, simi, idxi, src_dis[j], src_ids[j]);
+                        }
+                    }
+                }
+                faiss::heap_reorder<C>(k, simi, idxi);
+            }
+        }));
+    }
+    for (auto& fut : futs) {
+        fut.wait();
+    }
+}
+
+}  // namespace
+
+Status
+TiledKnnSearch(const std::shared_ptr<ThreadPool>& pool, faiss::MetricType metric, const float* xq, int64_t nq,
+               const float* xb, int64_t nb, int64_t dim, int64_t k, float* distances, int64_t* labels,
+               const BitsetView& bitset) {
+    switch (metric) {
+        case faiss::METRIC_L2:
+            TiledKnnSearchImpl<faiss::CMax<float, int64_t>>(pool, xq, nq, xb, nb, dim, k, distances, labels, bitset);
+            return Status::success;
+        case faiss::METRIC_INNER_PRODUCT:
+            TiledKnnSearchImpl<faiss::CMin<float, int64_t>>(pool, xq, nq, xb, nb, dim, k, distances, labels, bitset);
+            return Status::success;
+        default:
+            LOG_KNOWHERE_ERROR_ << "tiled knn search does not support metric type " << metric;
+            return Status::invalid_metric_type;
+    }
+}
+
+}  // namespace knowhere
@@ -0,0 +1,45 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <memory>
+
+#include "faiss/MetricType.h"
+#include "knowhere/bitsetview.h"
+#include "knowhere/comp/thread_pool.h"
+#include "knowhere/expected.h"
+
+namespace knowhere {
+
+// Below this many queries one pool task per query is faster: every task streams the base on its own, but there is
+// enough of them to keep all threads busy and no merge step is needed.
+constexpr int64_t kTiledKnnNqThreshold = 16;
+
+inline bool
+UseTiledKnn(faiss::MetricType metric, int64_t nq) {
+    return nq >= kTiledKnnNqThreshold &&
+           (metric == faiss::MetricType::METRIC_L2 || metric == faiss::MetricType::METRIC_INNER_PRODUCT);
+}
+
+// Exhaustive float knn search for a batch of queries.
+//
+// Queries are processed in blocks and the base in blocks sized to stay in L2, so that one pass over a base block
+// serves a whole query block. Each pool task owns a query block and a slice of the base and keeps a top-k heap per
+// query; slices of the same query block are merged at the end. Vectors whose bit is set in `bitset` are skipped.
+// Results are sorted, missing entries are filled with id -1. For COSINE the caller normalizes both sides and passes
+// METRIC_INNER_PRODUCT.
+Status
+TiledKnnSearch(const std::shared_ptr<ThreadPool>& pool, faiss::MetricType metric, const float* xq, int64_t nq,
+               const float* xb, int64_t nb, int64_t dim, int64_t k, float* distances, int64_t* labels,
+               const BitsetView& bitset);
+
+}  // namespace knowhere
@@ -11,9 +11,15 @@
 
 #include "knowhere/utils.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <cmath>
 #include <cstdint>
+#include <stdexcept>
 
+#include "io/fileIO.h"
 #include "knowhere/log.h"
 #include "simd/hook.h"
 
@@ -57,4 +63,39 @@ Normalize(const DataSet& dataset) {
     }
 }
 
+BinaryPtr
+LoadBinaryFile(const std::string& filename, size_t size, bool mmap) {
+    if (access(filename.c_str(), R_OK) != 0) {
+        throw std::runtime_error("Can not read " + filename);
+    }
+    auto input = FileReader(filename);
+    if (input.size() != size) {
+        input.close();
+        throw std::runtime_error(filename + " has " + std::to_string(input.size()) + " bytes, " +
+                                 std::to_string(size) + " expected");
+    }
+    auto bin = std::make_shared<Binary>();
+    bin->size = size;
+    if (mmap && size > 0) {
+        auto ptr = (uint8_t*)::mmap(nullptr, size, PROT_READ, MAP_SHARED, input.descriptor(), 0);
+        input.close();
+        if (ptr == MAP_FAILED) {
+            throw std::runtime_error("Can not map " + filename);
+        }
+        bin->data = std::shared_ptr<uint8_t[]>(ptr, [size](uint8_t* p) { munmap(p, size); });
+        return bin;
+    }
+    bin->data = std::shared_ptr<uint8_t[]>(new uint8_t[size]);
+    for (size_t done = 0; done < size;) {
+        auto n = input.read((char*)bin->data.get() + done, size - done);
+        if (n <= 0) {
+            input.close();
+            throw std::runtime_error("Can not read " + filename);
+        }
+        done += n;
+    }
+    input.close();
+    return bin;
+}
+
 }  // namespace knowhere
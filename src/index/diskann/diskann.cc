@@ -18,10 +18,14 @@
 #include "diskann/pq_flash_index.h"
 #include "index/diskann/diskann_config.h"
 #include "knowhere/comp/index_param.h"
+#include "knowhere/comp/knowhere_config.h"
 #include "knowhere/comp/thread_pool.h"
 #include "knowhere/expected.h"
 #ifndef _WINDOWS
 #include "diskann/linux_aligned_file_reader.h"
+#ifdef KNOWHERE_WITH_IO_URING
+#include "diskann/io_uring_aligned_file_reader.h"
+#endif
 #else
 #include "diskann/windows_aligned_file_reader.h"
 #endif
@@ -64,6 +68,16 @@ class DiskANNIndexNode : public IndexNode {
     expected<DataSetPtr>
     RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override;
 
+    Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* distances, const Config& cfg,
+                  const BitsetView& bitset) const override {
+        return SearchImpl(dataset, cfg, bitset, ids, distances, nullptr);
+    }
+
+    Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                       const BitsetView& bitset) const override;
+
     expected<DataSetPtr>
     GetVectorByIds(const DataSet& dataset) const override;
 
@@ -154,7 +168,16 @@ class DiskANNIndexNode : public IndexNode {
     }
 
     uint64_t
-    GetCachedNodeNum(const float cache_dram_budget, const uint64_t data_dim, const uint64_t max_degree);
+    GetCachedNodeNum(const float cache_dram_budget, const uint64_t data_dim, const uint64_t max_degree,
+                     const bool adaptive_cache = false);
+
+    Status
+    SearchImpl(const DataSet& dataset, const Config& cfg, const BitsetView& bitset, int64_t* p_id, float* p_dist,
+               const feder::diskann::FederResultUniq& feder_result) const;
+
+    Status
+    RangeSearchByQuery(const DataSet& dataset, const Config& cfg, const BitsetView& bitset,
+                       std::unique_ptr<RangeSearchResultCollector>& collector) const;
 
     std::string index_prefix_;
     mutable std::mutex preparation_lock_;
@@ -171,6 +194,9 @@ class DiskANNIndexNode : public IndexNode {
 namespace knowhere {
 namespace {
 static constexpr float kCacheExpansionRate = 1.2;
+// per cached node, what an adaptive node cache needs on top of the node: its share of the access sketch and of the
+// ring of missed nodes, and a second copy of the cache maps while a refresh swaps them
+static constexpr uint32_t kAdaptiveCacheBytesPerNode = 128;
 static constexpr int kSearchListSizeMaxValue = 200;
 
 Status
@@ -377,9 +403,18 @@ DiskANNIndexNode<T>::Deserialize(const BinarySet& binset, const Config& cfg) {
     // load diskann pq code and meta info
     std::shared_ptr<AlignedFileReader> reader = nullptr;
 
+#ifdef KNOWHERE_WITH_IO_URING
+    if (KnowhereConfig::GetDiskIOBackend() == KnowhereConfig::DiskIOBackend::IO_URING) {
+        reader.reset(new IoUringAlignedFileReader());
+    } else {
+        reader.reset(new LinuxAlignedFileReader());
+    }
+#else
     reader.reset(new LinuxAlignedFileReader());
+#endif
 
     pq_flash_index_ = std::make_unique<diskann::PQFlashIndex<T>>(reader, diskann_metric);
+    pq_flash_index_->set_entry_cache_size(prep_conf.entry_cache_size.value());
     auto disk_ann_call = [&]() {
         int res = pq_flash_index_->load(pool_->size(), index_prefix_.c_str());
         if (res != 0) {
@@ -403,6 +438,7 @@ DiskANNIndexNode<T>::Deserialize(const BinarySet& binset, const Config& cfg) {
     // load cache
     auto cached_nodes_file = diskann::get_cached_nodes_file(index_prefix_);
     std::vector<uint32_t> node_list;
+    const bool adaptive_cache = prep_conf.cache_refresh_queries.value() > 0;
     if (file_exists(cached_nodes_file)) {
         LOG_KNOWHERE_INFO_ << "Reading cached nodes from file.";
         size_t num_nodes, nodes_id_dim;
@@ -412,9 +448,17 @@ DiskANNIndexNode<T>::Deserialize(const BinarySet& binset, const Config& cfg) {
         if (cached_nodes_ids != nullptr) {
             delete[] cached_nodes_ids;
         }
+        if (adaptive_cache) {
+            // the list was sized for a static cache at build
+            node_list.resize(std::min<size_t>(
+                node_list.size(), GetCachedNodeNum(prep_conf.search_cache_budget_gb.value(),
+                                                   pq_flash_index_->get_data_dim(), pq_flash_index_->get_max_degree(),
+                                                   true)));
+        }
     } else {
-        auto num_nodes_to_cache = GetCachedNodeNum(prep_conf.search_cache_budget_gb.value(),
-                                                   pq_flash_index_->get_data_dim(), pq_flash_index_->get_max_degree());
+        auto num_nodes_to_cache =
+            GetCachedNodeNum(prep_conf.search_cache_budget_gb.value(), pq_flash_index_->get_data_dim(),
+                             pq_flash_index_->get_max_degree(), adaptive_cache);
         if (num_nodes_to_cache > pq_flash_index_->get_num_points() / 3) {
             LOG_KNOWHERE_ERROR_ << "Failed to generate cache, num_nodes_to_cache(" << num_nodes_to_cache
                                 << ") is larger than 1/3 of the total data number.";
@@ -448,6 +492,7 @@ DiskANNIndexNode<T>::Deserialize(const BinarySet& binset, const Config& cfg) {
             LOG_KNOWHERE_ERROR_ << "Failed to load cache for DiskANN.";
             return Status::diskann_inner_error;
         }
+        pq_flash_index_->enable_adaptive_cache(prep_conf.cache_refresh_queries.value());
     }
 
     // warmup
@@ -500,6 +545,41 @@ DiskANNIndexNode<T>::Deserialize(const BinarySet& binset, const Config& cfg) {
 template <typename T>
 expected<DataSetPtr>
 DiskANNIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
+    auto search_conf = static_cast<const DiskANNConfig&>(cfg);
+    auto k = static_cast<uint64_t>(search_conf.k.value());
+    auto nq = dataset.GetRows();
+
+    feder::diskann::FederResultUniq feder_result;
+    if (search_conf.trace_visit.value()) {
+        if (nq != 1) {
+            return Status::invalid_args;
+        }
+        feder_result = std::make_unique<feder::diskann::FederResult>();
+        feder_result->visit_info_.SetQueryConfig(search_conf.k.value(), search_conf.beamwidth.value(),
+                                                 search_conf.search_list_size.value());
+    }
+
+    std::unique_ptr<int64_t[]> p_id(new int64_t[k * nq]);
+    std::unique_ptr<float[]> p_dist(new float[k * nq]);
+    RETURN_IF_ERROR(SearchImpl(dataset, cfg, bitset, p_id.get(), p_dist.get(), feder_result));
+
+    auto res = GenResultDataSet(nq, k, p_id.release(), p_dist.release());
+
+    // set visit_info json string into result dataset
+    if (feder_result != nullptr) {
+        Json json_visit_info, json_id_set;
+        nlohmann::to_json(json_visit_info, feder_result->visit_info_);
+        nlohmann::to_json(json_id_set, feder_result->id_set_);
+        res->SetJsonInfo(json_visit_info.dump());
+        res->SetJsonIdSet(json_id_set.dump());
+    }
+    return res;
+}
+
+template <typename T>
+Status
+DiskANNIndexNode<T>::SearchImpl(const DataSet& dataset, const Config& cfg, const BitsetView& bitset, int64_t* p_id,
+                                float* p_dist, const feder::diskann::FederResultUniq& feder_result) const {
     if (!is_prepared_.load() || !pq_flash_index_) {
         LOG_KNOWHERE_ERROR_ << "Failed to load diskann.";
         return Status::empty_index;
@@ -525,28 +605,28 @@ DiskANNIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const Bit
     auto dim = dataset.GetDim();
     auto xq = static_cast<const T*>(dataset.GetTensor());
 
-    feder::diskann::FederResultUniq feder_result;
-    if (search_conf.trace_visit.value()) {
-        if (nq != 1) {
-            return Status::invalid_args;
-        }
-        feder_result = std::make_unique<feder::diskann::FederResult>();
-        feder_result->visit_info_.SetQueryConfig(search_conf.k.value(), search_conf.beamwidth.value(),
-                                                 search_conf.search_list_size.value());
-    }
-
-    auto p_id = new int64_t[k * nq];
-    auto p_dist = new float[k * nq];
-
     bool all_searches_are_good = true;
+    auto pool = ThreadPool::CurrentThreadPool(pool_);
     std::vector<folly::Future<folly::Unit>> futures;
     futures.reserve(nq);
-    for (int64_t row = 0; row < nq; ++row) {
-        futures.emplace_back(pool_->push([&, index = row]() {
-            pq_flash_index_->cached_beam_search(xq + (index * dim), k, lsearch, p_id + (index * k),
-                                                p_dist + (index * k), beamwidth, false, nullptr, feder_result, bitset,
-                                                filter_ratio, for_tuning);
-        }));
+    if (search_conf.pipelined_search.value() && feder_result == nullptr) {
+        auto pipeline_width = static_cast<uint64_t>(search_conf.pipeline_width.value());
+        for (int64_t row = 0; row < nq; row += pipeline_width) {
+            auto batch_size = std::min<uint64_t>(pipeline_width, nq - row);
+            futures.emplace_back(pool->push([&, index = row, batch_size]() {
+                pq_flash_index_->pipelined_beam_search(xq + (index * dim), batch_size, dim, k, lsearch,
+                                                       p_id + (index * k), p_dist + (index * k), beamwidth,
+                                                       pipeline_width, bitset, filter_ratio, for_tuning);
+            }));
+        }
+    } else {
+        for (int64_t row = 0; row < nq; ++row) {
+            futures.emplace_back(pool->push([&, index = row]() {
+                pq_flash_index_->cached_beam_search(xq + (index * dim), k, lsearch, p_id + (index * k),
+                                                    p_dist + (index * k), beamwidth, false, nullptr, feder_result,
+                                                    bitset, filter_ratio, for_tuning);
+            }));
+        }
     }
     for (auto& future : futures) {
         if (TryDiskANNCall([&]() { future.wait(); }) != Status::success) {
@@ -557,23 +637,13 @@ DiskANNIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const Bit
     if (!all_searches_are_good) {
         return Status::diskann_inner_error;
     }
-
-    auto res = GenResultDataSet(nq, k, p_id, p_dist);
-
-    // set visit_info json string into result dataset
-    if (feder_result != nullptr) {
-        Json json_visit_info, json_id_set;
-        nlohmann::to_json(json_visit_info, feder_result->visit_info_);
-        nlohmann::to_json(json_id_set, feder_result->id_set_);
-        res->SetJsonInfo(json_visit_info.dump());
-        res->SetJsonIdSet(json_id_set.dump());
-    }
-    return res;
+    return Status::success;
 }
 
 template <typename T>
-expected<DataSetPtr>
-DiskANNIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
+Status
+DiskANNIndexNode<T>::RangeSearchByQuery(const DataSet& dataset, const Config& cfg, const BitsetView& bitset,
+                                        std::unique_ptr<RangeSearchResultCollector>& collector) const {
     if (!is_prepared_.load() || !pq_flash_index_) {
         LOG_KNOWHERE_ERROR_ << "Failed to load diskann.";
         return Status::empty_index;
@@ -601,27 +671,20 @@ DiskANNIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, cons
     auto nq = dataset.GetRows();
     auto xq = static_cast<const T*>(dataset.GetTensor());
 
-    int64_t* p_id = nullptr;
-    float* p_dist = nullptr;
-    size_t* p_lims = nullptr;
-
-    std::vector<std::vector<int64_t>> result_id_array(nq);
-    std::vector<std::vector<float>> result_dist_array(nq);
+    collector = std::make_unique<RangeSearchResultCollector>(nq, is_ip, radius, range_filter);
 
+    auto pool = ThreadPool::CurrentThreadPool(pool_);
     std::vector<folly::Future<folly::Unit>> futures;
     futures.reserve(nq);
     bool all_searches_are_good = true;
     for (int64_t row = 0; row < nq; ++row) {
-        futures.emplace_back(pool_->push([&, index = row]() {
-            std::vector<int64_t> indices;
-            std::vector<float> distances;
-            pq_flash_index_->range_search(xq + (index * dim), radius, min_k, max_k, result_id_array[index],
-                                          result_dist_array[index], beamwidth, search_list_and_k_ratio, bitset);
-            // filter range search result
-            if (search_conf.range_filter.value() != defaultRangeFilter) {
-                FilterRangeSearchResultForOneNq(result_dist_array[index], result_id_array[index], is_ip, radius,
-                                                range_filter);
-            }
+        futures.emplace_back(pool->push([&, index = row]() {
+            pq_flash_index_->range_search(
+                xq + (index * dim), radius, min_k, max_k,
+                [&](const int64_t* ids, const float* dists, const uint64_t n) {
+                    collector->Add(index, dists, ids, n);
+                },
+                beamwidth, search_list_and_k_ratio, bitset);
         }));
     }
     for (auto& future : futures) {
@@ -632,10 +695,30 @@ DiskANNIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, cons
     if (!all_searches_are_good) {
         return Status::diskann_inner_error;
     }
+    return Status::success;
+}
+
+template <typename T>
+expected<DataSetPtr>
+DiskANNIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
+    std::unique_ptr<RangeSearchResultCollector> collector;
+    RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, collector));
+
+    int64_t* p_id = nullptr;
+    float* p_dist = nullptr;
+    size_t* p_lims = nullptr;
+    collector->Finish(p_dist, p_id, p_lims);
+    return GenResultDataSet(dataset.GetRows(), p_id, p_dist, p_lims);
+}
 
-    GetRangeSearchResult(result_dist_array, result_id_array, is_ip, nq, radius, search_conf.range_filter.value(),
-                         p_dist, p_id, p_lims);
-    return GenResultDataSet(nq, p_id, p_dist, p_lims);
+template <typename T>
+Status
+DiskANNIndexNode<T>::RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                                        const BitsetView& bitset) const {
+    std::unique_ptr<RangeSearchResultCollector> collector;
+    RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, collector));
+    collector->Finish(buf);
+    return Status::success;
 }
 
 /*
@@ -691,8 +774,11 @@ DiskANNIndexNode<T>::GetIndexMeta(const Config& cfg) const {
 template <typename T>
 uint64_t
 DiskANNIndexNode<T>::GetCachedNodeNum(const float cache_dram_budget, const uint64_t data_dim,
-                                      const uint64_t max_degree) {
+                                      const uint64_t max_degree, const bool adaptive_cache) {
     uint32_t one_cached_node_budget = (max_degree + 1) * sizeof(unsigned) + sizeof(T) * data_dim;
+    if (adaptive_cache) {
+        one_cached_node_budget += kAdaptiveCacheBytesPerNode;
+    }
     auto num_nodes_to_cache =
         static_cast<uint64_t>(1024 * 1024 * 1024 * cache_dram_budget) / (one_cached_node_budget * kCacheExpansionRate);
     return num_nodes_to_cache;
@@ -78,6 +78,20 @@ class DiskANNConfig : public BaseConfig {
     // value should be in range of [0.0, 1.0] which means when greater or equal to x% of the bits are set,
     // use PQ + Refine. Default to -1.0f, negative vlaues will use dynamic threshold calculator given topk.
     CFG_FLOAT filter_threshold;
+    // Number of query hashes whose best entry medoid is remembered across searches, so that a repeated query skips
+    // the medoid selection. Use 0 to disable.
+    CFG_INT entry_cache_size;
+    // Keep the reads of a query in flight across iterations and expand each node as soon as its sector arrives
+    // instead of waiting for the whole beam. Helps when IO latency varies a lot between reads. Trace visit, which
+    // needs the per-iteration beams, always uses the regular search.
+    CFG_BOOL pipelined_search;
+    // With pipelined search, the number of queries one search thread interleaves on its IO context. Every query
+    // needs its own scratch, so threads only take more than one query when scratches are idle.
+    CFG_INT pipeline_width;
+    // Refresh the node cache from the traffic every cache_refresh_queries searches: the nodes visited most since the
+    // last refresh replace the least visited cached ones, within the same search_cache_budget_gb. Use 0 to keep the
+    // cache loaded at deserialization.
+    CFG_INT cache_refresh_queries;
     KNOHWERE_DECLARE_CONFIG(DiskANNConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(metric_type)
             .set_default("L2")
@@ -156,6 +170,25 @@ class DiskANNConfig : public BaseConfig {
             .set_default(-1.0f)
             .set_range(-1.0f, 1.0f)
             .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(entry_cache_size)
+            .description("the number of cached query entry points, 0 to disable.")
+            .set_default(10000)
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .for_deserialize();
+        KNOWHERE_CONFIG_DECLARE_FIELD(pipelined_search)
+            .description("keep reads in flight across search iterations.")
+            .set_default(false)
+            .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(pipeline_width)
+            .description("the number of queries a search thread interleaves in pipelined search.")
+            .set_default(4)
+            .set_range(1, 16)
+            .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(cache_refresh_queries)
+            .description("the number of searches between two refreshes of the node cache, 0 to disable.")
+            .set_default(0)
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .for_deserialize();
     }
 
     inline Status
@@ -11,6 +11,7 @@
 
 #include "common/metric.h"
 #include "common/range_util.h"
+#include "common/tiled_knn.h"
 #include "faiss/IndexBinaryFlat.h"
 #include "faiss/IndexFlat.h"
 #include "faiss/index_io.h"
@@ -65,12 +66,22 @@ class FlatIndexNode : public IndexNode {
 
     expected<DataSetPtr>
     Search(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override {
+        auto k = static_cast<const FlatConfig&>(cfg).k.value();
+        auto nq = dataset.GetRows();
+        std::unique_ptr<int64_t[]> ids(new (std::nothrow) int64_t[k * nq]);
+        std::unique_ptr<float[]> distances(new (std::nothrow) float[k * nq]);
+        RETURN_IF_ERROR(SearchWithBuf(dataset, ids.get(), distances.get(), cfg, bitset));
+        return GenResultDataSet(nq, k, ids.release(), distances.release());
+    }
+
+    Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* distances, const Config& cfg,
+                  const BitsetView& bitset) const override {
         if (!index_) {
             LOG_KNOWHERE_WARNING_ << "search on empty index";
             return Status::empty_index;
         }
 
-        DataSetPtr results = std::make_shared<DataSet>();
         const FlatConfig& f_cfg = static_cast<const FlatConfig&>(cfg);
 
         // do normalize for COSINE metric type
@@ -83,16 +94,18 @@ class FlatIndexNode : public IndexNode {
         auto x = dataset.GetTensor();
         auto dim = dataset.GetDim();
 
-        auto len = k * nq;
-        int64_t* ids = nullptr;
-        float* distances = nullptr;
+        auto pool = ThreadPool::CurrentThreadPool(pool_);
         try {
-            ids = new (std::nothrow) int64_t[len];
-            distances = new (std::nothrow) float[len];
+            if constexpr (std::is_same<T, faiss::IndexFlat>::value) {
+                if (UseTiledKnn(index_->metric_type, nq)) {
+                    return TiledKnnSearch(pool, index_->metric_type, (const float*)x, nq, index_->get_xb(),
+                                         index_->ntotal, dim, k, distances, ids, bitset);
+                }
+            }
             std::vector<folly::Future<folly::Unit>> futs;
             futs.reserve(nq);
             for (int i = 0; i < nq; ++i) {
-                futs.emplace_back(pool_->push([&, index = i] {
+                futs.emplace_back(pool->push([&, index = i] {
                     ThreadPool::ScopedOmpSetter setter(1);
                     auto cur_ids = ids + k * index;
                     auto cur_dis = distances + k * index;
@@ -114,84 +127,31 @@ class FlatIndexNode : public IndexNode {
                 fut.wait();
             }
         } catch (const std::exception& e) {
-            std::unique_ptr<int64_t[]> auto_delete_ids(ids);
-            std::unique_ptr<float[]> auto_delete_dis(distances);
             LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
             return Status::faiss_inner_error;
         }
-
-        return GenResultDataSet(nq, k, ids, distances);
+        return Status::success;
     }
 
     expected<DataSetPtr>
     RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override {
-        if (!index_) {
-            LOG_KNOWHERE_WARNING_ << "range search on empty index";
-            return Status::empty_index;
-        }
-
-        const FlatConfig& f_cfg = static_cast<const FlatConfig&>(cfg);
-
-        // do normalize for COSINE metric type
-        if (IsMetricType(f_cfg.metric_type.value(), knowhere::metric::COSINE)) {
-            Normalize(dataset);
-        }
-
-        auto nq = dataset.GetRows();
-        auto xq = dataset.GetTensor();
-        auto dim = dataset.GetDim();
-
-        float radius = f_cfg.radius.value();
-        float range_filter = f_cfg.range_filter.value();
-        bool is_ip = (index_->metric_type == faiss::METRIC_INNER_PRODUCT);
+        std::unique_ptr<RangeSearchResultCollector> collector;
+        RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, collector));
 
         int64_t* ids = nullptr;
         float* distances = nullptr;
         size_t* lims = nullptr;
+        collector->Finish(distances, ids, lims);
+        return GenResultDataSet(dataset.GetRows(), ids, distances, lims);
+    }
 
-        std::vector<std::vector<int64_t>> result_id_array(nq);
-        std::vector<std::vector<float>> result_dist_array(nq);
-        std::vector<size_t> result_size(nq);
-        std::vector<size_t> result_lims(nq + 1);
-
-        try {
-            std::vector<folly::Future<folly::Unit>> futs;
-            futs.reserve(nq);
-            for (int i = 0; i < nq; ++i) {
-                futs.emplace_back(pool_->push([&, index = i] {
-                    ThreadPool::ScopedOmpSetter setter(1);
-                    faiss::RangeSearchResult res(1);
-                    if constexpr (std::is_same<T, faiss::IndexFlat>::value) {
-                        index_->range_search(1, (const float*)xq + index * dim, radius, &res, bitset);
-                    }
-                    if constexpr (std::is_same<T, faiss::IndexBinaryFlat>::value) {
-                        index_->range_search(1, (const uint8_t*)xq + index * dim / 8, radius, &res, bitset);
-                    }
-                    auto elem_cnt = res.lims[1];
-                    result_dist_array[index].resize(elem_cnt);
-                    result_id_array[index].resize(elem_cnt);
-                    result_size[index] = elem_cnt;
-                    for (size_t j = 0; j < elem_cnt; j++) {
-                        result_dist_array[index][j] = res.distances[j];
-                        result_id_array[index][j] = res.labels[j];
-                    }
-                    if (f_cfg.range_filter.value() != defaultRangeFilter) {
-                        FilterRangeSearchResultForOneNq(result_dist_array[index], result_id_array[index], is_ip, radius,
-                                                        range_filter);
-                    }
-                }));
-            }
-            for (auto& fut : futs) {
-                fut.wait();
-            }
-            GetRangeSearchResult(result_dist_array, result_id_array, is_ip, nq, radius, range_filter, distances, ids,
-                                 lims);
-        } catch (const std::exception& e) {
-            LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
-            return Status::faiss_inner_error;
-        }
-
-        return GenResultDataSet(nq, ids, distances, lims);
+    Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                       const BitsetView& bitset) const override {
+        std::unique_ptr<RangeSearchResultCollector> collector;
+        RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, collector));
+        collector->Finish(buf);
+        return Status::success;
     }
 
     expected<DataSetPtr>
@@ -281,12 +241,14 @@ class FlatIndexNode : public IndexNode {
         MemoryIOReader reader;
         reader.total = binary->size;
         reader.data_ = binary->data.get();
+        // the vectors stay in the binary, which the index then shares the ownership of
+        reader.owner = binary->data;
         if constexpr (std::is_same<T, faiss::IndexFlat>::value) {
-            faiss::Index* index = faiss::read_index(&reader);
+            faiss::Index* index = faiss::read_index(&reader, faiss::IO_FLAG_ZERO_COPY);
             index_.reset(static_cast<T*>(index));
         }
         if constexpr (std::is_same<T, faiss::IndexBinaryFlat>::value) {
-            faiss::IndexBinary* index = faiss::read_index_binary(&reader);
+            faiss::IndexBinary* index = faiss::read_index_binary(&reader, faiss::IO_FLAG_ZERO_COPY);
             index_.reset(static_cast<T*>(index));
         }
         return Status::success;
@@ -343,6 +305,59 @@ class FlatIndexNode : public IndexNode {
     }
 
  private:
+    // range search each query on its own, collector is created here and holds the filtered hits of all queries
+    Status
+    RangeSearchByQuery(const DataSet& dataset, const Config& cfg, const BitsetView& bitset,
+                       std::unique_ptr<RangeSearchResultCollector>& collector) const {
+        if (!index_) {
+            LOG_KNOWHERE_WARNING_ << "range search on empty index";
+            return Status::empty_index;
+        }
+
+        const FlatConfig& f_cfg = static_cast<const FlatConfig&>(cfg);
+
+        // do normalize for COSINE metric type
+        if (IsMetricType(f_cfg.metric_type.value(), knowhere::metric::COSINE)) {
+            Normalize(dataset);
+        }
+
+        auto nq = dataset.GetRows();
+        auto xq = dataset.GetTensor();
+        auto dim = dataset.GetDim();
+
+        float radius = f_cfg.radius.value();
+        float range_filter = f_cfg.range_filter.value();
+        bool is_ip = (index_->metric_type == faiss::METRIC_INNER_PRODUCT);
+
+        collector = std::make_unique<RangeSearchResultCollector>(nq, is_ip, radius, range_filter);
+
+        auto pool = ThreadPool::CurrentThreadPool(pool_);
+        try {
+            std::vector<folly::Future<folly::Unit>> futs;
+            futs.reserve(nq);
+            for (int i = 0; i < nq; ++i) {
+                futs.emplace_back(pool->push([&, index = i] {
+                    ThreadPool::ScopedOmpSetter setter(1);
+                    faiss::RangeSearchResult res(1);
+                    if constexpr (std::is_same<T, faiss::IndexFlat>::value) {
+                        index_->range_search(1, (const float*)xq + index * dim, radius, &res, bitset);
+                    }
+                    if constexpr (std::is_same<T, faiss::IndexBinaryFlat>::value) {
+                        index_->range_search(1, (const uint8_t*)xq + index * dim / 8, radius, &res, bitset);
+                    }
+                    collector->Add(index, res.distances, res.labels, res.lims[1]);
+                }));
+            }
+            for (auto& fut : futs) {
+                fut.wait();
+            }
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
+            return Status::faiss_inner_error;
+        }
+        return Status::success;
+    }
+
     std::unique_ptr<T> index_;
     std::shared_ptr<ThreadPool> pool_;
 };
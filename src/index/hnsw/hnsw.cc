@@ -30,6 +30,10 @@
 #include "knowhere/utils.h"
 
 namespace knowhere {
+// HNSW over plain vectors, or over SQ8 / FP16 codes when quant_type is set. The quantized variants walk the graph on
+// the codes and, when built with refine, rerank the final ef candidates against raw vectors serialized as a separate
+// binary, see RawDataName() and SiblingBinaryPath().
+template <hnswlib::QuantType quant_type>
 class HnswIndexNode : public IndexNode {
  public:
     HnswIndexNode(const Object& object) : index_(nullptr) {
@@ -41,8 +45,29 @@ class HnswIndexNode : public IndexNode {
         auto rows = dataset.GetRows();
         auto dim = dataset.GetDim();
         auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
+        hnswlib::GraphReorder reorder;
+        RETURN_IF_ERROR(ParseGraphReorder(hnsw_cfg.graph_reorder.value(), &reorder));
         hnswlib::SpaceInterface<float>* space = nullptr;
-        if (IsMetricType(hnsw_cfg.metric_type.value(), metric::L2)) {
+        if constexpr (quant_type != hnswlib::QuantType::NONE) {
+            hnswlib::SQSpace* sq_space = nullptr;
+            if (IsMetricType(hnsw_cfg.metric_type.value(), metric::L2)) {
+                sq_space = new (std::nothrow) hnswlib::L2SQSpace(dim, quant_type);
+            } else if (IsMetricType(hnsw_cfg.metric_type.value(), metric::IP)) {
+                sq_space = new (std::nothrow) hnswlib::InnerProductSQSpace(dim, quant_type);
+            } else if (IsMetricType(hnsw_cfg.metric_type.value(), metric::COSINE)) {
+                sq_space = new (std::nothrow) hnswlib::CosineSQSpace(dim, quant_type);
+            } else {
+                LOG_KNOWHERE_WARNING_ << "metric type not support in " << Type() << ": "
+                                      << hnsw_cfg.metric_type.value();
+                return Status::invalid_metric_type;
+            }
+            if (sq_space == nullptr) {
+                LOG_KNOWHERE_WARNING_ << "memory malloc error.";
+                return Status::malloc_error;
+            }
+            sq_space->train((const float*)dataset.GetTensor(), rows);
+            space = sq_space;
+        } else if (IsMetricType(hnsw_cfg.metric_type.value(), metric::L2)) {
             space = new (std::nothrow) hnswlib::L2Space(dim);
         } else if (IsMetricType(hnsw_cfg.metric_type.value(), metric::IP)) {
             space = new (std::nothrow) hnswlib::InnerProductSpace(dim);
@@ -62,6 +87,18 @@ class HnswIndexNode : public IndexNode {
             LOG_KNOWHERE_WARNING_ << "memory malloc error.";
             return Status::malloc_error;
         }
+        if constexpr (quant_type != hnswlib::QuantType::NONE) {
+            if (static_cast<const HnswSQConfig&>(cfg).refine.value()) {
+                try {
+                    index->enableRawData();
+                } catch (std::exception& e) {
+                    LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
+                    delete index;
+                    return Status::malloc_error;
+                }
+            }
+        }
+        index->setEntryCacheSize(hnsw_cfg.entry_cache_size.value());
         if (this->index_) {
             delete this->index_;
             LOG_KNOWHERE_WARNING_ << "index not empty, deleted old index";
@@ -81,13 +118,28 @@ class HnswIndexNode : public IndexNode {
         auto rows = dataset.GetRows();
         auto tensor = dataset.GetTensor();
         auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
-        index_->addPoint(tensor, 0);
+        if (hnsw_cfg.build_batch_size.value() > 0) {
+            try {
+                index_->addPointsBatched(tensor, rows, hnsw_cfg.build_batch_size.value());
+            } catch (std::exception& e) {
+                LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
+                return Status::hnsw_inner_error;
+            }
+        } else {
+            index_->addPoint(tensor, 0);
 
 #pragma omp parallel for
-        for (int i = 1; i < rows; ++i) {
-            index_->addPoint(((const char*)tensor + index_->data_size_ * i), i);
+            for (int i = 1; i < rows; ++i) {
+                index_->addPoint(((const char*)tensor + index_->getVectorSize() * i), i);
+            }
         }
         build_time.RecordSection("");
+        try {
+            RETURN_IF_ERROR(ReorderGraph(hnsw_cfg));
+        } catch (std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
+            return Status::hnsw_inner_error;
+        }
         LOG_KNOWHERE_INFO_ << "HNSW built with #points num:" << index_->max_elements_ << " #M:" << index_->M_
                            << " #max level:" << index_->maxlevel_ << " #ef_construction:" << index_->ef_construction_
                            << " #dim:" << *(size_t*)(index_->space_->get_dist_func_param());
@@ -96,13 +148,7 @@ class HnswIndexNode : public IndexNode {
 
     expected<DataSetPtr>
     Search(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override {
-        if (!index_) {
-            LOG_KNOWHERE_WARNING_ << "search on empty index";
-            return Status::empty_index;
-        }
         auto nq = dataset.GetRows();
-        auto xq = dataset.GetTensor();
-
         auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
         auto k = hnsw_cfg.k.value();
 
@@ -114,38 +160,11 @@ class HnswIndexNode : public IndexNode {
             feder_result = std::make_unique<feder::hnsw::FederResult>();
         }
 
-        auto p_id = new int64_t[k * nq];
-        auto p_dist = new float[k * nq];
-
-        hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value(), hnsw_cfg.for_tuning.value()};
-        bool transform =
-            (index_->metric_type_ == hnswlib::Metric::INNER_PRODUCT || index_->metric_type_ == hnswlib::Metric::COSINE);
+        std::unique_ptr<int64_t[]> p_id(new int64_t[k * nq]);
+        std::unique_ptr<float[]> p_dist(new float[k * nq]);
+        RETURN_IF_ERROR(SearchImpl(dataset, p_id.get(), p_dist.get(), cfg, bitset, feder_result));
 
-        std::vector<folly::Future<folly::Unit>> futs;
-        futs.reserve(nq);
-        for (int i = 0; i < nq; ++i) {
-            futs.emplace_back(pool_->push([&, idx = i]() {
-                auto single_query = (const char*)xq + idx * index_->data_size_;
-                auto rst = index_->searchKnn((void*)single_query, k, bitset, &param, feder_result);
-                size_t rst_size = rst.size();
-                auto p_single_dis = p_dist + idx * k;
-                auto p_single_id = p_id + idx * k;
-                for (size_t idx = 0; idx < rst_size; ++idx) {
-                    const auto& [dist, id] = rst[idx];
-                    p_single_dis[idx] = transform ? (-dist) : dist;
-                    p_single_id[idx] = id;
-                }
-                for (size_t idx = rst_size; idx < (size_t)k; idx++) {
-                    p_single_dis[idx] = float(1.0 / 0.0);
-                    p_single_id[idx] = -1;
-                }
-            }));
-        }
-        for (auto& fut : futs) {
-            fut.wait();
-        }
-
-        auto res = GenResultDataSet(nq, k, p_id, p_dist);
+        auto res = GenResultDataSet(nq, k, p_id.release(), p_dist.release());
 
         // set visit_info json string into result dataset
         if (feder_result != nullptr) {
@@ -158,23 +177,25 @@ class HnswIndexNode : public IndexNode {
         return res;
     }
 
+    Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* dis, const Config& cfg,
+                  const BitsetView& bitset) const override {
+        return SearchImpl(dataset, ids, dis, cfg, bitset, nullptr);
+    }
+
+    Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                       const BitsetView& bitset) const override {
+        std::unique_ptr<RangeSearchResultCollector> collector;
+        RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, nullptr, collector));
+        collector->Finish(buf);
+        return Status::success;
+    }
+
     expected<DataSetPtr>
     RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override {
-        if (!index_) {
-            LOG_KNOWHERE_WARNING_ << "range search on empty index";
-            return Status::empty_index;
-        }
-
         auto nq = dataset.GetRows();
-        auto xq = dataset.GetTensor();
-
         auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
-        bool is_ip =
-            (index_->metric_type_ == hnswlib::Metric::INNER_PRODUCT || index_->metric_type_ == hnswlib::Metric::COSINE);
-        float range_filter = hnsw_cfg.range_filter.value();
-
-        float radius_for_calc = (is_ip ? -hnsw_cfg.radius.value() : hnsw_cfg.radius.value());
-        float radius_for_filter = hnsw_cfg.radius.value();
 
         feder::hnsw::FederResultUniq feder_result;
         if (hnsw_cfg.trace_visit.value()) {
@@ -184,45 +205,13 @@ class HnswIndexNode : public IndexNode {
             feder_result = std::make_unique<feder::hnsw::FederResult>();
         }
 
-        hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value()};
+        std::unique_ptr<RangeSearchResultCollector> collector;
+        RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, feder_result, collector));
 
         int64_t* ids = nullptr;
         float* dis = nullptr;
         size_t* lims = nullptr;
-
-        std::vector<std::vector<int64_t>> result_id_array(nq);
-        std::vector<std::vector<float>> result_dist_array(nq);
-        std::vector<size_t> result_size(nq);
-        std::vector<size_t> result_lims(nq + 1);
-
-        std::vector<folly::Future<folly::Unit>> futs;
-        futs.reserve(nq);
-        for (int64_t i = 0; i < nq; ++i) {
-            futs.emplace_back(pool_->push([&, idx = i]() {
-                auto single_query = (const char*)xq + idx * index_->data_size_;
-                auto rst = index_->searchRange((void*)single_query, radius_for_calc, bitset, &param, feder_result);
-                auto elem_cnt = rst.size();
-                result_dist_array[idx].resize(elem_cnt);
-                result_id_array[idx].resize(elem_cnt);
-                for (size_t j = 0; j < elem_cnt; j++) {
-                    auto& p = rst[j];
-                    result_dist_array[idx][j] = (is_ip ? (-p.first) : p.first);
-                    result_id_array[idx][j] = p.second;
-                }
-                result_size[idx] = rst.size();
-                if (hnsw_cfg.range_filter.value() != defaultRangeFilter) {
-                    FilterRangeSearchResultForOneNq(result_dist_array[idx], result_id_array[idx], is_ip,
-                                                    radius_for_filter, range_filter);
-                }
-            }));
-        }
-        for (auto& fut : futs) {
-            fut.wait();
-        }
-
-        // filter range search result
-        GetRangeSearchResult(result_dist_array, result_id_array, is_ip, nq, radius_for_filter, range_filter, dis, ids,
-                             lims);
+        collector->Finish(dis, ids, lims);
 
         auto res = GenResultDataSet(nq, ids, dis, lims);
 
@@ -249,11 +238,20 @@ class HnswIndexNode : public IndexNode {
 
         char* data = nullptr;
         try {
-            data = new char[index_->data_size_ * rows];
+            const size_t vec_size = index_->getVectorSize();
+            data = new char[vec_size * rows];
             for (int64_t i = 0; i < rows; i++) {
                 int64_t id = ids[i];
                 assert(id >= 0 && id < (int64_t)index_->cur_element_count);
-                std::copy_n(index_->getDataByInternalId(id), index_->data_size_, data + i * index_->data_size_);
+                auto internal_id = index_->getInternalId(id);
+                if (index_->raw_data_ != nullptr) {
+                    std::copy_n((const char*)(index_->raw_data_ + internal_id * dim), vec_size, data + i * vec_size);
+                } else if (index_->sq_space_ != nullptr) {
+                    // lossy, the codes are all there is
+                    index_->sq_space_->decode(index_->getDataByInternalId(internal_id), (float*)(data + i * vec_size));
+                } else {
+                    std::copy_n(index_->getDataByInternalId(internal_id), vec_size, data + i * vec_size);
+                }
             }
             return GenResultDataSet(rows, dim, data);
         } catch (std::exception& e) {
@@ -265,7 +263,7 @@ class HnswIndexNode : public IndexNode {
 
     bool
     HasRawData(const std::string& metric_type) const override {
-        return true;
+        return quant_type == hnswlib::QuantType::NONE || (index_ != nullptr && index_->raw_data_ != nullptr);
     }
 
     expected<DataSetPtr>
@@ -278,7 +276,7 @@ class HnswIndexNode : public IndexNode {
         auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
         auto overview_levels = hnsw_cfg.overview_levels.value();
         feder::hnsw::HNSWMeta meta(index_->ef_construction_, index_->M_, index_->cur_element_count, index_->maxlevel_,
-                                   index_->enterpoint_node_, overview_levels);
+                                   index_->getExternalLabel(index_->enterpoint_node_), overview_levels);
         std::unordered_set<int64_t> id_set;
 
         for (int i = 0; i < overview_levels; i++) {
@@ -308,6 +306,12 @@ class HnswIndexNode : public IndexNode {
             index_->saveIndex(writer);
             std::shared_ptr<uint8_t[]> data(writer.data_);
             binset.Append(Type(), data, writer.rp);
+            if (index_->raw_data_ != nullptr) {
+                MemoryIOWriter raw_writer;
+                index_->saveRawData(raw_writer);
+                std::shared_ptr<uint8_t[]> raw_data(raw_writer.data_);
+                binset.Append(RawDataName(), raw_data, raw_writer.rp);
+            }
         } catch (std::exception& e) {
             LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
             return Status::hnsw_inner_error;
@@ -334,6 +338,17 @@ class HnswIndexNode : public IndexNode {
             hnswlib::SpaceInterface<float>* space = nullptr;
             index_ = new (std::nothrow) hnswlib::HierarchicalNSW<float>(space);
             index_->loadIndex(reader);
+            RETURN_IF_ERROR(CheckQuantType());
+            // the raw vectors are borrowed from the binary set, a reorder below makes its own copy
+            raw_binary_ = binset.GetByName(RawDataName());
+            if (raw_binary_ != nullptr) {
+                index_->setRawData((const float*)raw_binary_->data.get(), raw_binary_->size / index_->getVectorSize());
+            } else if (index_->expectsRawData()) {
+                LOG_KNOWHERE_ERROR_ << Type() << " was built with refine, the binary set has no " << RawDataName();
+                return Status::invalid_binary_set;
+            }
+            RETURN_IF_ERROR(ReorderGraph(static_cast<const HnswConfig&>(config)));
+            index_->setEntryCacheSize(static_cast<const HnswConfig&>(config).entry_cache_size.value());
             LOG_KNOWHERE_INFO_ << "Loaded HNSW index. #points num:" << index_->max_elements_ << " #M:" << index_->M_
                                << " #max level:" << index_->maxlevel_
                                << " #ef_construction:" << index_->ef_construction_
@@ -352,8 +367,23 @@ class HnswIndexNode : public IndexNode {
         }
         try {
             hnswlib::SpaceInterface<float>* space = nullptr;
+            raw_binary_.reset();
             index_ = new (std::nothrow) hnswlib::HierarchicalNSW<float>(space);
             index_->loadIndex(filename, config);
+            RETURN_IF_ERROR(CheckQuantType());
+            if (index_->expectsRawData()) {
+                // the raw vectors are mapped as well when the index is
+                auto cfg = static_cast<const BaseConfig&>(config);
+                try {
+                    index_->loadRawData(SiblingBinaryPath(filename, RawDataName()),
+                                        cfg.enable_mmap.has_value() && cfg.enable_mmap.value());
+                } catch (const std::exception& e) {
+                    LOG_KNOWHERE_ERROR_ << Type() << " was built with refine, " << e.what();
+                    return Status::invalid_binary_set;
+                }
+            }
+            RETURN_IF_ERROR(ReorderGraph(static_cast<const HnswConfig&>(config)));
+            index_->setEntryCacheSize(static_cast<const HnswConfig&>(config).entry_cache_size.value());
         } catch (std::exception& e) {
             LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
             return Status::hnsw_inner_error;
@@ -363,7 +393,11 @@ class HnswIndexNode : public IndexNode {
 
     std::unique_ptr<BaseConfig>
     CreateConfig() const override {
-        return std::make_unique<HnswConfig>();
+        if constexpr (quant_type != hnswlib::QuantType::NONE) {
+            return std::make_unique<HnswSQConfig>();
+        } else {
+            return std::make_unique<HnswConfig>();
+        }
     }
 
     int64_t
@@ -392,7 +426,13 @@ class HnswIndexNode : public IndexNode {
 
     std::string
     Type() const override {
-        return knowhere::IndexEnum::INDEX_HNSW;
+        if constexpr (quant_type == hnswlib::QuantType::SQ8) {
+            return knowhere::IndexEnum::INDEX_HNSW_SQ8;
+        } else if constexpr (quant_type == hnswlib::QuantType::FP16) {
+            return knowhere::IndexEnum::INDEX_HNSW_FP16;
+        } else {
+            return knowhere::IndexEnum::INDEX_HNSW;
+        }
     }
 
     ~HnswIndexNode() override {
@@ -402,6 +442,91 @@ class HnswIndexNode : public IndexNode {
     }
 
  private:
+    Status
+    SearchImpl(const DataSet& dataset, int64_t* p_id, float* p_dist, const Config& cfg, const BitsetView& bitset,
+               const feder::hnsw::FederResultUniq& feder_result) const {
+        if (!index_) {
+            LOG_KNOWHERE_WARNING_ << "search on empty index";
+            return Status::empty_index;
+        }
+        auto nq = dataset.GetRows();
+        auto xq = dataset.GetTensor();
+
+        auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
+        auto k = hnsw_cfg.k.value();
+
+        hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value(), hnsw_cfg.for_tuning.value()};
+        bool transform =
+            (index_->metric_type_ == hnswlib::Metric::INNER_PRODUCT || index_->metric_type_ == hnswlib::Metric::COSINE);
+
+        auto pool = ThreadPool::CurrentThreadPool(pool_);
+        std::vector<folly::Future<folly::Unit>> futs;
+        futs.reserve(nq);
+        for (int i = 0; i < nq; ++i) {
+            futs.emplace_back(pool->push([&, idx = i]() {
+                auto single_query = (const char*)xq + idx * index_->getVectorSize();
+                auto rst = index_->searchKnn((void*)single_query, k, bitset, &param, feder_result);
+                size_t rst_size = rst.size();
+                auto p_single_dis = p_dist + idx * k;
+                auto p_single_id = p_id + idx * k;
+                for (size_t idx = 0; idx < rst_size; ++idx) {
+                    const auto& [dist, id] = rst[idx];
+                    p_single_dis[idx] = transform ? (-dist) : dist;
+                    p_single_id[idx] = id;
+                }
+                for (size_t idx = rst_size; idx < (size_t)k; idx++) {
+                    p_single_dis[idx] = float(1.0 / 0.0);
+                    p_single_id[idx] = -1;
+                }
+            }));
+        }
+        for (auto& fut : futs) {
+            fut.wait();
+        }
+        return Status::success;
+    }
+
+    // range search each query on its own, collector is created here and holds the filtered hits of all queries
+    Status
+    RangeSearchByQuery(const DataSet& dataset, const Config& cfg, const BitsetView& bitset,
+                       const feder::hnsw::FederResultUniq& feder_result,
+                       std::unique_ptr<RangeSearchResultCollector>& collector) const {
+        if (!index_) {
+            LOG_KNOWHERE_WARNING_ << "range search on empty index";
+            return Status::empty_index;
+        }
+
+        auto nq = dataset.GetRows();
+        auto xq = dataset.GetTensor();
+
+        auto hnsw_cfg = static_cast<const HnswConfig&>(cfg);
+        bool is_ip =
+            (index_->metric_type_ == hnswlib::Metric::INNER_PRODUCT || index_->metric_type_ == hnswlib::Metric::COSINE);
+        float radius_for_calc = (is_ip ? -hnsw_cfg.radius.value() : hnsw_cfg.radius.value());
+
+        hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value()};
+
+        collector = std::make_unique<RangeSearchResultCollector>(nq, is_ip, hnsw_cfg.radius.value(),
+                                                                 hnsw_cfg.range_filter.value());
+
+        auto pool = ThreadPool::CurrentThreadPool(pool_);
+        std::vector<folly::Future<folly::Unit>> futs;
+        futs.reserve(nq);
+        for (int64_t i = 0; i < nq; ++i) {
+            futs.emplace_back(pool->push([&, idx = i]() {
+                auto single_query = (const char*)xq + idx * index_->getVectorSize();
+                auto rst = index_->searchRange((void*)single_query, radius_for_calc, bitset, &param, feder_result);
+                for (const auto& [dist, id] : rst) {
+                    collector->Add(idx, is_ip ? (-dist) : dist, id);
+                }
+            }));
+        }
+        for (auto& fut : futs) {
+            fut.wait();
+        }
+        return Status::success;
+    }
+
     void
     UpdateLevelLinkList(int32_t level, feder::hnsw::HNSWMeta& meta, std::unordered_set<int64_t>& id_set) const {
         if (!(level > 0 && level <= index_->maxlevel_)) {
@@ -416,7 +541,7 @@ class HnswIndexNode : public IndexNode {
         // get all elements in current level
         for (size_t i = 0; i < index_->cur_element_count; i++) {
             // elements in high level also exist in low level
-            if (index_->element_levels_[i] >= level) {
+            if (index_->getElementLevel(i) >= level) {
                 level_elements.emplace_back(i);
             }
         }
@@ -430,19 +555,80 @@ class HnswIndexNode : public IndexNode {
             std::vector<int64_t> neighbors(size);
             for (int i = 0; i < size; i++) {
                 hnswlib::tableint cand = datal[i];
-                neighbors[i] = cand;
+                neighbors[i] = index_->getExternalLabel(cand);
             }
-            id_set.insert(curr_id);
+            id_set.insert(index_->getExternalLabel(curr_id));
             id_set.insert(neighbors.begin(), neighbors.end());
-            meta.AddNodeInfo(level, curr_id, std::move(neighbors));
+            meta.AddNodeInfo(level, index_->getExternalLabel(curr_id), std::move(neighbors));
         }
     }
 
  private:
+    static Status
+    ParseGraphReorder(const std::string& name, hnswlib::GraphReorder* method) {
+        if (name == "none") {
+            *method = hnswlib::GraphReorder::NONE;
+        } else if (name == "bfs") {
+            *method = hnswlib::GraphReorder::BFS;
+        } else if (name == "rcm") {
+            *method = hnswlib::GraphReorder::RCM;
+        } else {
+            LOG_KNOWHERE_ERROR_ << "invalid graph_reorder " << name << ", should be one of none, bfs and rcm";
+            return Status::invalid_args;
+        }
+        return Status::success;
+    }
+
+    // the raw vectors the final ef candidates of HNSW_SQ8 / HNSW_FP16 are reranked against
+    std::string
+    RawDataName() const {
+        return Type() + "_RAW_DATA";
+    }
+
+    // a binary of one HNSW variant must not be loaded as another
+    Status
+    CheckQuantType() const {
+        auto loaded = index_->sq_space_ == nullptr ? hnswlib::QuantType::NONE : index_->sq_space_->qtype();
+        if (loaded != quant_type) {
+            LOG_KNOWHERE_ERROR_ << "binary of quant type " << (int)loaded << " can not be loaded as " << Type();
+            return Status::invalid_binary_set;
+        }
+        return Status::success;
+    }
+
+    // renumber a just built or loaded graph as asked by graph_reorder, an index that was saved reordered keeps its
+    // order
+    Status
+    ReorderGraph(const HnswConfig& cfg) {
+        hnswlib::GraphReorder method;
+        RETURN_IF_ERROR(ParseGraphReorder(cfg.graph_reorder.value(), &method));
+        if (method == hnswlib::GraphReorder::NONE || !index_->internal_to_external_.empty()) {
+            return Status::success;
+        }
+        if (index_->mmap_enabled_) {
+            LOG_KNOWHERE_WARNING_ << "graph_reorder is ignored for a mmapped HNSW index";
+            return Status::success;
+        }
+        knowhere::TimeRecorder reorder_time("Reordering HNSW graph cost");
+        index_->reorderGraph(method);
+        reorder_time.RecordSection("");
+        return Status::success;
+    }
+
     hnswlib::HierarchicalNSW<float>* index_;
+    // keeps the raw vectors borrowed by index_ alive
+    BinaryPtr raw_binary_;
     std::shared_ptr<ThreadPool> pool_;
 };
 
-KNOWHERE_REGISTER_GLOBAL(HNSW, [](const Object& object) { return Index<HnswIndexNode>::Create(object); });
+KNOWHERE_REGISTER_GLOBAL(HNSW, [](const Object& object) {
+    return Index<HnswIndexNode<hnswlib::QuantType::NONE>>::Create(object);
+});
+KNOWHERE_REGISTER_GLOBAL(HNSW_SQ8, [](const Object& object) {
+    return Index<HnswIndexNode<hnswlib::QuantType::SQ8>>::Create(object);
+});
+KNOWHERE_REGISTER_GLOBAL(HNSW_FP16, [](const Object& object) {
+    return Index<HnswIndexNode<hnswlib::QuantType::FP16>>::Create(object);
+});
 
 }  // namespace knowhere
@@ -30,6 +30,9 @@ class HnswConfig : public BaseConfig {
     CFG_INT efConstruction;
     CFG_INT ef;
     CFG_INT overview_levels;
+    CFG_INT entry_cache_size;
+    CFG_STRING graph_reorder;
+    CFG_INT build_batch_size;
     KNOHWERE_DECLARE_CONFIG(HnswConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(M).description("hnsw M").set_default(30).set_range(1, 2048).for_train();
         KNOWHERE_CONFIG_DECLARE_FIELD(efConstruction)
@@ -48,6 +51,24 @@ class HnswConfig : public BaseConfig {
             .set_default(3)
             .set_range(1, 5)
             .for_feder();
+        KNOWHERE_CONFIG_DECLARE_FIELD(entry_cache_size)
+            .description("number of cached query entry points, 0 to disable")
+            .set_default(10000)
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .for_train()
+            .for_deserialize()
+            .for_deserialize_from_file();
+        KNOWHERE_CONFIG_DECLARE_FIELD(graph_reorder)
+            .description("renumber the graph for locality after build or load, one of none, bfs and rcm")
+            .set_default("none")
+            .for_train()
+            .for_deserialize()
+            .for_deserialize_from_file();
+        KNOWHERE_CONFIG_DECLARE_FIELD(build_batch_size)
+            .description("insert up to this many points per round against a frozen graph, 0 to insert one by one")
+            .set_default(0)
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .for_train();
     }
 
     inline Status
@@ -74,6 +95,17 @@ class HnswConfig : public BaseConfig {
     }
 };
 
+class HnswSQConfig : public HnswConfig {
+ public:
+    CFG_BOOL refine;
+    KNOHWERE_DECLARE_CONFIG(HnswSQConfig) {
+        KNOWHERE_CONFIG_DECLARE_FIELD(refine)
+            .description("keep the raw vectors to rerank the final ef candidates walked on SQ8 / FP16 codes")
+            .set_default(false)
+            .for_train();
+    }
+};
+
 }  // namespace knowhere
 
 #endif /* HNSW_CONFIG_H */
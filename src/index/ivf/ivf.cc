@@ -9,6 +9,8 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include "common/ivf_batch_search.h"
+#include "common/kmeans.h"
 #include "common/metric.h"
 #include "common/range_util.h"
 #include "faiss/IndexBinaryFlat.h"
@@ -16,6 +18,7 @@
 #include "faiss/IndexFlat.h"
 #include "faiss/IndexIVFFlat.h"
 #include "faiss/IndexIVFPQ.h"
+#include "faiss/IndexIVFPQFastScan.h"
 #include "faiss/IndexScalarQuantizer.h"
 #include "faiss/index_io.h"
 #include "index/ivf/ivf_config.h"
@@ -25,6 +28,7 @@
 #include "knowhere/feder/IVFFlat.h"
 #include "knowhere/log.h"
 #include "knowhere/utils.h"
+#include "simd/hook.h"
 
 namespace knowhere {
 
@@ -41,9 +45,12 @@ struct QuantizerT<faiss::IndexBinaryIVF> {
 template <typename T>
 class IvfIndexNode : public IndexNode {
  public:
-    IvfIndexNode(const Object& object) : index_(nullptr) {
+    // sq_type picks the scalar quantizer of IndexIVFScalarQuantizer, the other indexes ignore it
+    IvfIndexNode(const Object& object, faiss::QuantizerType sq_type = faiss::QuantizerType::QT_8bit)
+        : index_(nullptr), sq_type_(sq_type) {
         static_assert(std::is_same<T, faiss::IndexIVFFlat>::value || std::is_same<T, faiss::IndexIVFFlatCC>::value ||
                           std::is_same<T, faiss::IndexIVFPQ>::value ||
+                          std::is_same<T, faiss::IndexIVFPQFastScan>::value ||
                           std::is_same<T, faiss::IndexIVFScalarQuantizer>::value ||
                           std::is_same<T, faiss::IndexBinaryIVF>::value,
                       "not support");
@@ -57,6 +64,12 @@ class IvfIndexNode : public IndexNode {
     Search(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override;
     expected<DataSetPtr>
     RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const override;
+    Status
+    SearchWithBuf(const DataSet& dataset, int64_t* ids, float* distances, const Config& cfg,
+                  const BitsetView& bitset) const override;
+    Status
+    RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                       const BitsetView& bitset) const override;
     expected<DataSetPtr>
     GetVectorByIds(const DataSet& dataset) const override;
     bool
@@ -70,6 +83,9 @@ class IvfIndexNode : public IndexNode {
         if constexpr (std::is_same<faiss::IndexIVFPQ, T>::value) {
             return false;
         }
+        if constexpr (std::is_same<faiss::IndexIVFPQFastScan, T>::value) {
+            return refine_data_ != nullptr && !IsMetricType(metric_type, metric::COSINE);
+        }
         if constexpr (std::is_same<faiss::IndexIVFScalarQuantizer, T>::value) {
             return false;
         }
@@ -98,6 +114,9 @@ class IvfIndexNode : public IndexNode {
         if constexpr (std::is_same<faiss::IndexIVFPQ, T>::value) {
             return std::make_unique<IvfPqConfig>();
         }
+        if constexpr (std::is_same<faiss::IndexIVFPQFastScan, T>::value) {
+            return std::make_unique<IvfPqFastScanConfig>();
+        }
         if constexpr (std::is_same<faiss::IndexIVFScalarQuantizer, T>::value) {
             return std::make_unique<IvfSqConfig>();
         }
@@ -141,11 +160,28 @@ class IvfIndexNode : public IndexNode {
             auto precomputed_table = nlist * pq.M * pq.ksub * sizeof(float);
             return (capacity + centroid_table + precomputed_table);
         }
+        if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+            // every list is padded to a multiple of bbs codes of M2 / 2 bytes
+            size_t codes = 0;
+            for (size_t i = 0; i < index_->nlist; i++) {
+                auto list_size = index_->invlists->list_size(i);
+                codes += (list_size + index_->bbs - 1) / index_->bbs * index_->bbs * index_->M2 / 2;
+            }
+            auto nb = index_->invlists->compute_ntotal();
+            auto pq = index_->pq;
+            auto capacity = codes + nb * sizeof(int64_t) + index_->nlist * index_->d * sizeof(float);
+            auto centroid_table = pq.M * pq.ksub * pq.dsub * sizeof(float);
+            auto precomputed_table = index_->precomputed_table.nbytes();
+            auto refine = refine_data_ != nullptr ? refine_data_->size : 0;
+            return (capacity + centroid_table + precomputed_table + refine);
+        }
         if constexpr (std::is_same<T, faiss::IndexIVFScalarQuantizer>::value) {
             auto nb = index_->invlists->compute_ntotal();
             auto code_size = index_->code_size;
             auto nlist = index_->nlist;
-            return (nb * code_size + nb * sizeof(int64_t) + 2 * code_size + nlist * code_size);
+            auto d = index_->d;
+            auto trained = index_->sq.trained.size() * sizeof(float);
+            return (nb * code_size + nb * sizeof(int64_t) + trained + nlist * d * sizeof(float));
         }
         if constexpr (std::is_same<T, faiss::IndexBinaryIVF>::value) {
             auto nb = index_->invlists->compute_ntotal();
@@ -172,8 +208,22 @@ class IvfIndexNode : public IndexNode {
         if constexpr (std::is_same<T, faiss::IndexIVFPQ>::value) {
             return knowhere::IndexEnum::INDEX_FAISS_IVFPQ;
         }
+        if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+            return knowhere::IndexEnum::INDEX_FAISS_IVFPQ_FASTSCAN;
+        }
         if constexpr (std::is_same<T, faiss::IndexIVFScalarQuantizer>::value) {
-            return knowhere::IndexEnum::INDEX_FAISS_IVFSQ8;
+            switch (sq_type_) {
+                case faiss::QuantizerType::QT_4bit:
+                    return knowhere::IndexEnum::INDEX_FAISS_IVFSQ4;
+                case faiss::QuantizerType::QT_6bit:
+                    return knowhere::IndexEnum::INDEX_FAISS_IVFSQ6;
+                case faiss::QuantizerType::QT_fp16:
+                    return knowhere::IndexEnum::INDEX_FAISS_IVFFP16;
+                case faiss::QuantizerType::QT_bf16:
+                    return knowhere::IndexEnum::INDEX_FAISS_IVFBF16;
+                default:
+                    return knowhere::IndexEnum::INDEX_FAISS_IVFSQ8;
+            }
         }
         if constexpr (std::is_same<T, faiss::IndexBinaryIVF>::value) {
             return knowhere::IndexEnum::INDEX_FAISS_BIN_IVFFLAT;
@@ -181,8 +231,32 @@ class IvfIndexNode : public IndexNode {
     };
 
  private:
+    Status
+    RangeSearchByQuery(const DataSet& dataset, const Config& cfg, const BitsetView& bitset,
+                       std::unique_ptr<RangeSearchResultCollector>& collector) const;
+
+    Status
+    CheckQuantizerType() const;
+
+    void
+    Refine(const float* query, int64_t k, const float* cand_distances, const int64_t* cand_ids, int64_t n_cand,
+           float* distances, int64_t* ids) const;
+
+    std::string
+    RawDataName() const {
+        return Type() + "_RAW_DATA";
+    }
+
+    // written after the faiss binary of an index built with refine, which can not be loaded without its raw vectors
+    static constexpr uint32_t kRefineMagic = 0x46525649;  // "IVRF"
+
     std::unique_ptr<T> index_;
     std::shared_ptr<ThreadPool> pool_;
+    faiss::QuantizerType sq_type_;
+    // IVF_PQ_FASTSCAN built with refine: raw vectors by id, shared with the binary set they are serialized to
+    BinaryPtr refine_data_;
+    // bytes allocated for refine_data_ by Add, 0 when it is borrowed from a binary set
+    size_t refine_capacity_ = 0;
 };
 
 }  // namespace knowhere
@@ -221,6 +295,29 @@ MatchNbits(int64_t size, int64_t nbits) {
     return nbits;
 }
 
+// Trains the coarse quantizer with the mini-batch k-means of common/kmeans.h instead of faiss::Clustering. faiss then
+// finds the quantizer trained and only trains the rest of the index (PQ, SQ) in index->train().
+void
+TrainQuantizerMiniBatch(const std::shared_ptr<ThreadPool>& pool, faiss::IndexIVF* index, const float* data,
+                        int64_t rows, int64_t batch_size) {
+    KMeansConfig kmeans_cfg;
+    kmeans_cfg.batch_size = batch_size;
+    kmeans_cfg.niter = index->cp.niter;
+    kmeans_cfg.max_points_per_centroid = index->cp.max_points_per_centroid;
+    kmeans_cfg.spherical = index->cp.spherical;
+    kmeans_cfg.seed = index->cp.seed;
+    kmeans_cfg.inner_product = index->metric_type == faiss::METRIC_INNER_PRODUCT;
+    std::vector<float> centroids(index->nlist * index->d);
+    KMeansStats stats;
+    if (KMeansTrain(pool, data, rows, index->d, index->nlist, kmeans_cfg, centroids.data(), &stats) !=
+        Status::success) {
+        throw std::runtime_error("mini-batch k-means of the coarse quantizer failed");
+    }
+    LOG_KNOWHERE_INFO_ << "mini-batch k-means of " << index->nlist << " lists ran " << stats.iterations
+                       << " steps, converged: " << stats.converged;
+    index->quantizer->add(index->nlist, centroids.data());
+}
+
 template <typename T>
 Status
 IvfIndexNode<T>::Train(const DataSet& dataset, const Config& cfg) {
@@ -254,7 +351,6 @@ IvfIndexNode<T>::Train(const DataSet& dataset, const Config& cfg) {
             auto nlist = MatchNlist(rows, ivf_flat_cfg.nlist.value());
             qzr = new (std::nothrow) typename QuantizerT<T>::type(dim, metric.value());
             index = std::make_unique<faiss::IndexIVFFlat>(qzr, dim, nlist, metric.value());
-            index->train(rows, (const float*)data);
         }
         if constexpr (std::is_same<faiss::IndexIVFFlatCC, T>::value) {
             const IvfFlatCcConfig& ivf_flat_cc_cfg = static_cast<const IvfFlatCcConfig&>(cfg);
@@ -263,7 +359,6 @@ IvfIndexNode<T>::Train(const DataSet& dataset, const Config& cfg) {
             bool is_cosine = base_cfg.metric_type.value() == metric::COSINE;
             index = std::make_unique<faiss::IndexIVFFlatCC>(qzr, dim, nlist, ivf_flat_cc_cfg.ssize.value(), is_cosine,
                                                             metric.value());
-            index->train(rows, (const float*)data);
         }
         if constexpr (std::is_same<faiss::IndexIVFPQ, T>::value) {
             const IvfPqConfig& ivf_pq_cfg = static_cast<const IvfPqConfig&>(cfg);
@@ -271,15 +366,19 @@ IvfIndexNode<T>::Train(const DataSet& dataset, const Config& cfg) {
             auto nbits = MatchNbits(rows, ivf_pq_cfg.nbits.value());
             qzr = new (std::nothrow) typename QuantizerT<T>::type(dim, metric.value());
             index = std::make_unique<faiss::IndexIVFPQ>(qzr, dim, nlist, ivf_pq_cfg.m.value(), nbits, metric.value());
-            index->train(rows, (const float*)data);
+        }
+        if constexpr (std::is_same<faiss::IndexIVFPQFastScan, T>::value) {
+            const IvfPqFastScanConfig& ivf_pq_fs_cfg = static_cast<const IvfPqFastScanConfig&>(cfg);
+            auto nlist = MatchNlist(rows, ivf_pq_fs_cfg.nlist.value());
+            qzr = new (std::nothrow) typename QuantizerT<T>::type(dim, metric.value());
+            index = std::make_unique<faiss::IndexIVFPQFastScan>(qzr, dim, nlist, ivf_pq_fs_cfg.m.value(), 4,
+                                                                metric.value());
         }
         if constexpr (std::is_same<faiss::IndexIVFScalarQuantizer, T>::value) {
             const IvfSqConfig& ivf_sq_cfg = static_cast<const IvfSqConfig&>(cfg);
             auto nlist = MatchNlist(rows, ivf_sq_cfg.nlist.value());
             qzr = new (std::nothrow) typename QuantizerT<T>::type(dim, metric.value());
-            index = std::make_unique<faiss::IndexIVFScalarQuantizer>(qzr, dim, nlist, faiss::QuantizerType::QT_8bit,
-                                                                     metric.value());
-            index->train(rows, (const float*)data);
+            index = std::make_unique<faiss::IndexIVFScalarQuantizer>(qzr, dim, nlist, sq_type_, metric.value());
         }
         if constexpr (std::is_same<faiss::IndexBinaryIVF, T>::value) {
             const IvfBinConfig& ivf_bin_cfg = static_cast<const IvfBinConfig&>(cfg);
@@ -287,6 +386,15 @@ IvfIndexNode<T>::Train(const DataSet& dataset, const Config& cfg) {
             qzr = new (std::nothrow) typename QuantizerT<T>::type(dim, metric.value());
             index = std::make_unique<faiss::IndexBinaryIVF>(qzr, dim, nlist, metric.value());
             index->train(rows, (const uint8_t*)data);
+        } else {
+            auto kmeans_batch_size = static_cast<const IvfConfig&>(cfg).kmeans_batch_size.value();
+            // IVF_FLAT_CC trains COSINE on a normalized copy of the data, it keeps faiss::Clustering
+            bool cc_cosine = std::is_same_v<faiss::IndexIVFFlatCC, T> &&
+                             IsMetricType(base_cfg.metric_type.value(), knowhere::metric::COSINE);
+            if (kmeans_batch_size > 0 && !cc_cosine) {
+                TrainQuantizerMiniBatch(pool_, index.get(), (const float*)data, rows, kmeans_batch_size);
+            }
+            index->train(rows, (const float*)data);
         }
         index->own_fields = true;
     } catch (std::exception& e) {
@@ -297,6 +405,8 @@ IvfIndexNode<T>::Train(const DataSet& dataset, const Config& cfg) {
         return Status::faiss_inner_error;
     }
     index_ = std::move(index);
+    refine_data_.reset();
+    refine_capacity_ = 0;
 
     return Status::success;
 }
@@ -336,11 +446,35 @@ IvfIndexNode<T>::Add(const DataSet& dataset, const Config& cfg) {
                 index_->prefix_sum[i] = curr_index;
                 curr_index += list_size;
             }
+            // GetVectorByIds finds a vector through prefix_sum and the list offset of its id
+            index_->make_direct_map(true);
         } else if constexpr (std::is_same<faiss::IndexBinaryIVF, T>::value) {
             index_->add(rows, (const uint8_t*)data);
         } else {
             index_->add(rows, (const float*)data);
         }
+        if constexpr (std::is_same<faiss::IndexIVFPQFastScan, T>::value) {
+            if (static_cast<const IvfPqFastScanConfig&>(cfg).refine.value()) {
+                // ids are assigned in insertion order, so the raw vectors are appended as they come. The buffer
+                // grows geometrically, a binary set it was serialized to keeps its own size and never sees the
+                // appended bytes
+                auto vec_size = index_->d * sizeof(float);
+                size_t old_size = refine_data_ != nullptr ? refine_data_->size : 0;
+                size_t new_size = old_size + rows * vec_size;
+                if (new_size > refine_capacity_) {
+                    auto capacity = std::max(new_size, refine_capacity_ * 2);
+                    auto refine = std::make_shared<Binary>();
+                    refine->data = std::shared_ptr<uint8_t[]>(new uint8_t[capacity]);
+                    if (old_size > 0) {
+                        std::copy_n(refine_data_->data.get(), old_size, refine->data.get());
+                    }
+                    refine_data_ = refine;
+                    refine_capacity_ = capacity;
+                }
+                std::copy_n((const uint8_t*)data, rows * vec_size, refine_data_->data.get() + old_size);
+                refine_data_->size = new_size;
+            }
+        }
 
     } catch (std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
@@ -352,6 +486,19 @@ IvfIndexNode<T>::Add(const DataSet& dataset, const Config& cfg) {
 template <typename T>
 expected<DataSetPtr>
 IvfIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
+    auto rows = dataset.GetRows();
+    auto k = static_cast<const IvfConfig&>(cfg).k.value();
+
+    std::unique_ptr<int64_t[]> ids(new (std::nothrow) int64_t[rows * k]);
+    std::unique_ptr<float[]> distances(new (std::nothrow) float[rows * k]);
+    RETURN_IF_ERROR(SearchWithBuf(dataset, ids.get(), distances.get(), cfg, bitset));
+    return GenResultDataSet(rows, k, ids.release(), distances.release());
+}
+
+template <typename T>
+Status
+IvfIndexNode<T>::SearchWithBuf(const DataSet& dataset, int64_t* ids, float* distances, const Config& cfg,
+                               const BitsetView& bitset) const {
     if (!this->index_) {
         LOG_KNOWHERE_WARNING_ << "search on empty index";
         return Status::empty_index;
@@ -375,14 +522,30 @@ IvfIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const BitsetV
     auto k = ivf_cfg.k.value();
     auto nprobe = ivf_cfg.nprobe.value();
 
-    int64_t* ids(new (std::nothrow) int64_t[rows * k]);
-    float* distances(new (std::nothrow) float[rows * k]);
+    // the lists always filter while they are scanned, only a request that filters out every id skips the scan
+    if constexpr (!std::is_same<T, faiss::IndexBinaryIVF>::value) {
+        if (ChooseFilterStrategy(bitset, index_->ntotal, 0.0f, 1.0f) == FilterStrategy::ALL_FILTERED) {
+            bool is_ip = index_->metric_type == faiss::METRIC_INNER_PRODUCT;
+            std::fill(ids, ids + rows * k, -1);
+            std::fill(distances, distances + rows * k,
+                      is_ip ? std::numeric_limits<float>::lowest() : std::numeric_limits<float>::max());
+            return Status::success;
+        }
+    }
+
     int32_t* i_distances = reinterpret_cast<int32_t*>(distances);
+    auto pool = ThreadPool::CurrentThreadPool(pool_);
     try {
+        if constexpr (std::is_same<T, faiss::IndexIVFFlat>::value) {
+            // large batches share the scan of each probed list among all queries probing it
+            if (UseIvfBatchSearch(index_->metric_type, rows) && !index_->arranged_codes.empty()) {
+                return IvfFlatBatchSearch(pool, *index_, (const float*)data, rows, k, nprobe, distances, ids, bitset);
+            }
+        }
         std::vector<folly::Future<folly::Unit>> futs;
         futs.reserve(rows);
         for (int i = 0; i < rows; ++i) {
-            futs.emplace_back(pool_->push([&, index = i] {
+            futs.emplace_back(pool->push([&, index = i] {
                 ThreadPool::ScopedOmpSetter setter(1);
                 auto offset = k * index;
                 if constexpr (std::is_same<T, faiss::IndexBinaryIVF>::value) {
@@ -397,6 +560,20 @@ IvfIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const BitsetV
                     auto cur_data = (const float*)data + index * dim;
                     index_->search_without_codes_thread_safe(1, cur_data, k, distances + offset, ids + offset, nprobe,
                                                              0, bitset);
+                } else if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+                    auto cur_data = (const float*)data + index * dim;
+                    if (refine_data_ == nullptr) {
+                        index_->search_thread_safe(1, cur_data, k, distances + offset, ids + offset, nprobe, 0, bitset);
+                    } else {
+                        auto refine_k = static_cast<const IvfPqFastScanConfig&>(cfg).refine_k.value();
+                        auto n_cand = std::max<int64_t>(k, std::ceil(k * refine_k));
+                        std::vector<float> cand_distances(n_cand);
+                        std::vector<int64_t> cand_ids(n_cand);
+                        index_->search_thread_safe(1, cur_data, n_cand, cand_distances.data(), cand_ids.data(),
+                                                   nprobe, 0, bitset);
+                        Refine(cur_data, k, cand_distances.data(), cand_ids.data(), n_cand, distances + offset,
+                               ids + offset);
+                    }
                 } else {
                     auto cur_data = (const float*)data + index * dim;
                     index_->search_thread_safe(1, cur_data, k, distances + offset, ids + offset, nprobe, 0, bitset);
@@ -407,19 +584,50 @@ IvfIndexNode<T>::Search(const DataSet& dataset, const Config& cfg, const BitsetV
             fut.wait();
         }
     } catch (const std::exception& e) {
-        delete[] ids;
-        delete[] distances;
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
         return Status::faiss_inner_error;
     }
+    return Status::success;
+}
 
-    auto res = GenResultDataSet(rows, ivf_cfg.k.value(), ids, distances);
-    return res;
+// rerank the fast scan candidates by their distances to the raw vectors
+template <typename T>
+void
+IvfIndexNode<T>::Refine(const float* query, int64_t k, const float* cand_distances, const int64_t* cand_ids,
+                        int64_t n_cand, float* distances, int64_t* ids) const {
+    auto d = index_->d;
+    auto raw = (const float*)refine_data_->data.get();
+    bool is_ip = index_->metric_type == faiss::METRIC_INNER_PRODUCT;
+    std::vector<std::pair<float, int64_t>> cands;
+    cands.reserve(n_cand);
+    for (int64_t i = 0; i < n_cand; i++) {
+        if (cand_ids[i] < 0) {
+            continue;
+        }
+        auto x = raw + cand_ids[i] * d;
+        auto dis = is_ip ? faiss::fvec_inner_product(query, x, d) : faiss::fvec_L2sqr(query, x, d);
+        cands.emplace_back(dis, cand_ids[i]);
+    }
+    auto top = std::min(k, static_cast<int64_t>(cands.size()));
+    auto cmp = [is_ip](const std::pair<float, int64_t>& a, const std::pair<float, int64_t>& b) {
+        return is_ip ? a.first > b.first : a.first < b.first;
+    };
+    std::partial_sort(cands.begin(), cands.begin() + top, cands.end(), cmp);
+    for (int64_t i = 0; i < k; i++) {
+        distances[i] = i < top ? cands[i].first
+                               : (is_ip ? std::numeric_limits<float>::lowest() : std::numeric_limits<float>::max());
+        ids[i] = i < top ? cands[i].second : -1;
+    }
 }
 
 template <typename T>
-expected<DataSetPtr>
-IvfIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
+Status
+IvfIndexNode<T>::RangeSearchByQuery(const DataSet& dataset, const Config& cfg, const BitsetView& bitset,
+                                    std::unique_ptr<RangeSearchResultCollector>& collector) const {
+    if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+        LOG_KNOWHERE_WARNING_ << "range search is not supported by " << Type();
+        return Status::not_implemented;
+    }
     if (!this->index_) {
         LOG_KNOWHERE_WARNING_ << "range search on empty index";
         return Status::empty_index;
@@ -444,20 +652,14 @@ IvfIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, const Bi
     float range_filter = ivf_cfg.range_filter.value();
     bool is_ip = (index_->metric_type == faiss::METRIC_INNER_PRODUCT);
 
-    int64_t* ids = nullptr;
-    float* distances = nullptr;
-    size_t* lims = nullptr;
-
-    std::vector<std::vector<int64_t>> result_id_array(nq);
-    std::vector<std::vector<float>> result_dist_array(nq);
-    std::vector<size_t> result_size(nq);
-    std::vector<size_t> result_lims(nq + 1);
+    collector = std::make_unique<RangeSearchResultCollector>(nq, is_ip, radius, range_filter);
 
+    auto pool = ThreadPool::CurrentThreadPool(pool_);
     try {
         std::vector<folly::Future<folly::Unit>> futs;
         futs.reserve(nq);
         for (int i = 0; i < nq; ++i) {
-            futs.emplace_back(pool_->push([&, index = i] {
+            futs.emplace_back(pool->push([&, index = i] {
                 ThreadPool::ScopedOmpSetter setter(1);
                 faiss::RangeSearchResult res(1);
                 if constexpr (std::is_same<T, faiss::IndexBinaryIVF>::value) {
@@ -470,30 +672,40 @@ IvfIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, const Bi
                     auto cur_data = (const float*)xq + index * dim;
                     index_->range_search_thread_safe(1, cur_data, radius, &res, index_->nlist, 0, bitset);
                 }
-                auto elem_cnt = res.lims[1];
-                result_dist_array[index].resize(elem_cnt);
-                result_id_array[index].resize(elem_cnt);
-                result_size[index] = elem_cnt;
-                for (size_t j = 0; j < elem_cnt; j++) {
-                    result_dist_array[index][j] = res.distances[j];
-                    result_id_array[index][j] = res.labels[j];
-                }
-                if (range_filter != defaultRangeFilter) {
-                    FilterRangeSearchResultForOneNq(result_dist_array[index], result_id_array[index], is_ip, radius,
-                                                    range_filter);
-                }
+                collector->Add(index, res.distances, res.labels, res.lims[1]);
             }));
         }
         for (auto& fut : futs) {
             fut.wait();
         }
-        GetRangeSearchResult(result_dist_array, result_id_array, is_ip, nq, radius, range_filter, distances, ids, lims);
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
         return Status::faiss_inner_error;
     }
+    return Status::success;
+}
 
-    return GenResultDataSet(nq, ids, distances, lims);
+template <typename T>
+expected<DataSetPtr>
+IvfIndexNode<T>::RangeSearch(const DataSet& dataset, const Config& cfg, const BitsetView& bitset) const {
+    std::unique_ptr<RangeSearchResultCollector> collector;
+    RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, collector));
+
+    int64_t* ids = nullptr;
+    float* distances = nullptr;
+    size_t* lims = nullptr;
+    collector->Finish(distances, ids, lims);
+    return GenResultDataSet(dataset.GetRows(), ids, distances, lims);
+}
+
+template <typename T>
+Status
+IvfIndexNode<T>::RangeSearchWithBuf(const DataSet& dataset, RangeSearchBuf& buf, const Config& cfg,
+                                    const BitsetView& bitset) const {
+    std::unique_ptr<RangeSearchResultCollector> collector;
+    RETURN_IF_ERROR(RangeSearchByQuery(dataset, cfg, bitset, collector));
+    collector->Finish(buf);
+    return Status::success;
 }
 
 template <typename T>
@@ -533,7 +745,7 @@ IvfIndexNode<T>::GetVectorByIds(const DataSet& dataset) const {
         float* data = nullptr;
         try {
             data = new float[dim * rows];
-            index_->make_direct_map(true);
+            // the direct map is built when the vectors are added or loaded
             for (int64_t i = 0; i < rows; i++) {
                 int64_t id = ids[i];
                 assert(id >= 0 && id < index_->ntotal);
@@ -565,6 +777,22 @@ IvfIndexNode<T>::GetVectorByIds(const DataSet& dataset) const {
             LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
             return Status::faiss_inner_error;
         }
+    } else if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+        if (refine_data_ == nullptr) {
+            return Status::not_implemented;
+        }
+        auto dim = Dim();
+        auto rows = dataset.GetRows();
+        auto ids = dataset.GetIds();
+        auto raw = (const float*)refine_data_->data.get();
+
+        auto data = new float[dim * rows];
+        for (int64_t i = 0; i < rows; i++) {
+            int64_t id = ids[i];
+            assert(id >= 0 && id < index_->ntotal);
+            std::copy_n(raw + id * dim, dim, data + i * dim);
+        }
+        return GenResultDataSet(rows, dim, data);
     } else {
         return Status::not_implemented;
     }
@@ -578,8 +806,8 @@ IvfIndexNode<faiss::IndexIVFFlat>::GetIndexMeta(const Config& config) const {
         return Status::empty_index;
     }
 
-    auto ivf_index = dynamic_cast<faiss::IndexIVF*>(index_.get());
-    auto ivf_quantizer = dynamic_cast<faiss::IndexFlat*>(ivf_index->quantizer);
+    auto ivf_index = dynamic_cast<const faiss::IndexIVF*>(index_.get());
+    auto ivf_quantizer = dynamic_cast<const faiss::IndexFlat*>(ivf_index->quantizer);
 
     int64_t dim = ivf_index->d;
     int64_t nlist = ivf_index->nlist;
@@ -621,8 +849,20 @@ IvfIndexNode<T>::Serialize(BinarySet& binset) const {
         } else {
             faiss::write_index(index_.get(), &writer);
         }
+        if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+            if (refine_data_ != nullptr) {
+                uint32_t magic = kRefineMagic;
+                writer.write(&magic, sizeof(magic));
+            }
+        }
         std::shared_ptr<uint8_t[]> data(writer.data_);
         binset.Append(Type(), data, writer.rp);
+        if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+            if (refine_data_ != nullptr) {
+                // a binary of its own, Add may append to the buffer past this size later
+                binset.Append(RawDataName(), refine_data_->data, refine_data_->size);
+            }
+        }
         return Status::success;
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
@@ -645,17 +885,32 @@ IvfIndexNode<T>::Deserialize(const BinarySet& binset, const Config& config) {
     MemoryIOReader reader;
     reader.total = binary->size;
     reader.data_ = binary->data.get();
+    // the inverted lists keep views of the binary instead of a copy, and share its ownership
+    reader.owner = binary->data;
     try {
         if constexpr (std::is_same<T, faiss::IndexBinaryIVF>::value) {
-            index_.reset(static_cast<T*>(faiss::read_index_binary(&reader)));
+            index_.reset(static_cast<T*>(faiss::read_index_binary(&reader, faiss::IO_FLAG_ZERO_COPY)));
         } else {
-            index_.reset(static_cast<T*>(faiss::read_index(&reader)));
+            index_.reset(static_cast<T*>(faiss::read_index(&reader, faiss::IO_FLAG_ZERO_COPY)));
         }
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
         return Status::faiss_inner_error;
     }
-    return Status::success;
+    if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+        // the raw vectors stay borrowed from the binary set
+        refine_data_ = binset.GetByName(RawDataName());
+        refine_capacity_ = 0;
+        uint32_t magic = 0;
+        if (reader.rp + sizeof(magic) <= reader.total) {
+            reader(&magic, sizeof(magic), 1);
+        }
+        if (magic == kRefineMagic && refine_data_ == nullptr) {
+            LOG_KNOWHERE_ERROR_ << Type() << " was built with refine, the binary set has no " << RawDataName();
+            return Status::invalid_binary_set;
+        }
+    }
+    return CheckQuantizerType();
 }
 
 template <typename T>
@@ -667,9 +922,16 @@ IvfIndexNode<T>::DeserializeFromFile(const std::string& filename, const Config&
     if (cfg.enable_mmap.value()) {
         io_flags |= faiss::IO_FLAG_MMAP;
     }
+    uint32_t magic = 0;
     try {
         if constexpr (std::is_same<T, faiss::IndexBinaryIVF>::value) {
             index_.reset(static_cast<T*>(faiss::read_index_binary(filename.data(), io_flags)));
+        } else if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+            faiss::FileIOReader reader(filename.data());
+            index_.reset(static_cast<T*>(faiss::read_index(&reader, io_flags)));
+            if (fread(&magic, sizeof(magic), 1, reader.f) != 1) {
+                magic = 0;
+            }
         } else {
             index_.reset(static_cast<T*>(faiss::read_index(filename.data(), io_flags)));
         }
@@ -677,6 +939,33 @@ IvfIndexNode<T>::DeserializeFromFile(const std::string& filename, const Config&
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
         return Status::faiss_inner_error;
     }
+    if constexpr (std::is_same<T, faiss::IndexIVFPQFastScan>::value) {
+        refine_data_.reset();
+        refine_capacity_ = 0;
+        if (magic == kRefineMagic) {
+            // the raw vectors are mapped as well when the index is
+            try {
+                refine_data_ = LoadBinaryFile(SiblingBinaryPath(filename, RawDataName()),
+                                              index_->ntotal * index_->d * sizeof(float), cfg.enable_mmap.value());
+            } catch (const std::exception& e) {
+                LOG_KNOWHERE_ERROR_ << Type() << " was built with refine, " << e.what();
+                return Status::invalid_binary_set;
+            }
+        }
+    }
+    return CheckQuantizerType();
+}
+
+// an IVF_SQ* index only loads the binaries of its own quantizer, IVF_SQ8 can not serve IVF_SQ4 codes
+template <typename T>
+Status
+IvfIndexNode<T>::CheckQuantizerType() const {
+    if constexpr (std::is_same<T, faiss::IndexIVFScalarQuantizer>::value) {
+        if (index_->sq.qtype != sq_type_) {
+            LOG_KNOWHERE_ERROR_ << "quantizer type " << index_->sq.qtype << " of the binary does not match " << Type();
+            return Status::invalid_binary_set;
+        }
+    }
     return Status::success;
 }
 
@@ -694,31 +983,64 @@ IvfIndexNode<faiss::IndexIVFFlat>::Deserialize(const BinarySet& binset, const Co
     MemoryIOReader reader;
     reader.total = binary->size;
     reader.data_ = binary->data.get();
+    // the arranged vectors are borrowed from the binary when they are aligned in it
+    reader.owner = binary->data;
     try {
-        index_.reset(static_cast<faiss::IndexIVFFlat*>(faiss::read_index_nm(&reader)));
+        index_.reset(static_cast<faiss::IndexIVFFlat*>(faiss::read_index_nm(&reader, faiss::IO_FLAG_ZERO_COPY)));
+
+        if (index_->arranged_codes.empty()) {
+            // older binaries only keep the ids, construct arranged data from original data
+            auto binary = binset.GetByName("RAW_DATA");
+            if (binary == nullptr) {
+                LOG_KNOWHERE_ERROR_ << "Invalid binary set.";
+                return Status::invalid_binary_set;
+            }
+            auto invlists = index_->invlists;
+            auto d = index_->d;
+            size_t nb = binary->size / invlists->code_size;
+            index_->prefix_sum.resize(invlists->nlist);
+            size_t curr_index = 0;
+
+            auto ails = dynamic_cast<faiss::ArrayInvertedLists*>(invlists);
+            index_->arranged_codes.resize(d * nb * sizeof(float));
+            for (size_t i = 0; i < invlists->nlist; i++) {
+                auto list_size = ails->ids[i].size();
+                for (size_t j = 0; j < list_size; j++) {
+                    memcpy(index_->arranged_codes.data() + d * (curr_index + j) * sizeof(float),
+                           binary->data.get() + d * ails->ids[i][j] * sizeof(float), d * sizeof(float));
+                }
+                index_->prefix_sum[i] = curr_index;
+                curr_index += list_size;
+            }
+        }
+        if (index_->direct_map.no()) {
+            index_->make_direct_map(true);
+        }
+    } catch (const std::exception& e) {
+        LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+        return Status::faiss_inner_error;
+    }
+    return Status::success;
+}
+
+template <>
+Status
+IvfIndexNode<faiss::IndexIVFFlat>::DeserializeFromFile(const std::string& filename, const Config& config) {
+    auto cfg = static_cast<const knowhere::BaseConfig&>(config);
 
-        // Construct arranged data from original data
-        auto binary = binset.GetByName("RAW_DATA");
-        if (binary == nullptr) {
-            LOG_KNOWHERE_ERROR_ << "Invalid binary set.";
+    int io_flags = 0;
+    if (cfg.enable_mmap.value()) {
+        io_flags |= faiss::IO_FLAG_MMAP;
+    }
+    try {
+        index_.reset(static_cast<faiss::IndexIVFFlat*>(faiss::read_index_nm(filename.data(), io_flags)));
+        if (index_->arranged_codes.empty()) {
+            LOG_KNOWHERE_ERROR_ << "the file has no vectors, it needs the RAW_DATA of the binary set";
+            index_.reset();
             return Status::invalid_binary_set;
         }
-        auto invlists = index_->invlists;
-        auto d = index_->d;
-        size_t nb = binary->size / invlists->code_size;
-        index_->prefix_sum.resize(invlists->nlist);
-        size_t curr_index = 0;
-
-        auto ails = dynamic_cast<faiss::ArrayInvertedLists*>(invlists);
-        index_->arranged_codes.resize(d * nb * sizeof(float));
-        for (size_t i = 0; i < invlists->nlist; i++) {
-            auto list_size = ails->ids[i].size();
-            for (size_t j = 0; j < list_size; j++) {
-                memcpy(index_->arranged_codes.data() + d * (curr_index + j) * sizeof(float),
-                       binary->data.get() + d * ails->ids[i][j] * sizeof(float), d * sizeof(float));
-            }
-            index_->prefix_sum[i] = curr_index;
-            curr_index += list_size;
+        if (index_->direct_map.no()) {
+            index_->make_direct_map(true);
         }
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
@@ -749,6 +1071,9 @@ KNOWHERE_REGISTER_GLOBAL(IVFPQ,
                          [](const Object& object) { return Index<IvfIndexNode<faiss::IndexIVFPQ>>::Create(object); });
 KNOWHERE_REGISTER_GLOBAL(IVF_PQ,
                          [](const Object& object) { return Index<IvfIndexNode<faiss::IndexIVFPQ>>::Create(object); });
+KNOWHERE_REGISTER_GLOBAL(IVF_PQ_FASTSCAN, [](const Object& object) {
+    return Index<IvfIndexNode<faiss::IndexIVFPQFastScan>>::Create(object);
+});
 
 KNOWHERE_REGISTER_GLOBAL(IVFSQ, [](const Object& object) {
     return Index<IvfIndexNode<faiss::IndexIVFScalarQuantizer>>::Create(object);
@@ -756,5 +1081,17 @@ KNOWHERE_REGISTER_GLOBAL(IVFSQ, [](const Object& object) {
 KNOWHERE_REGISTER_GLOBAL(IVF_SQ8, [](const Object& object) {
     return Index<IvfIndexNode<faiss::IndexIVFScalarQuantizer>>::Create(object);
 });
+KNOWHERE_REGISTER_GLOBAL(IVF_SQ4, [](const Object& object) {
+    return Index<IvfIndexNode<faiss::IndexIVFScalarQuantizer>>::Create(object, faiss::QuantizerType::QT_4bit);
+});
+KNOWHERE_REGISTER_GLOBAL(IVF_SQ6, [](const Object& object) {
+    return Index<IvfIndexNode<faiss::IndexIVFScalarQuantizer>>::Create(object, faiss::QuantizerType::QT_6bit);
+});
+KNOWHERE_REGISTER_GLOBAL(IVF_FP16, [](const Object& object) {
+    return Index<IvfIndexNode<faiss::IndexIVFScalarQuantizer>>::Create(object, faiss::QuantizerType::QT_fp16);
+});
+KNOWHERE_REGISTER_GLOBAL(IVF_BF16, [](const Object& object) {
+    return Index<IvfIndexNode<faiss::IndexIVFScalarQuantizer>>::Create(object, faiss::QuantizerType::QT_bf16);
+});
 
 }  // namespace knowhere
@@ -19,6 +19,7 @@ class IvfConfig : public BaseConfig {
  public:
     CFG_INT nlist;
     CFG_INT nprobe;
+    CFG_INT kmeans_batch_size;
     KNOHWERE_DECLARE_CONFIG(IvfConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(nlist)
             .set_default(128)
@@ -30,6 +31,11 @@ class IvfConfig : public BaseConfig {
             .description("number of probes at query time.")
             .for_search()
             .set_range(1, 65536);
+        KNOWHERE_CONFIG_DECLARE_FIELD(kmeans_batch_size)
+            .set_default(0)
+            .description("points per step of mini-batch k-means for the coarse quantizer, 0 trains on the full batch.")
+            .for_train()
+            .set_range(0, 1 << 24);
     }
 };
 
@@ -57,6 +63,26 @@ class IvfPqConfig : public IvfConfig {
     }
 };
 
+// 4-bit PQ codes scanned with in-register lookup tables, nbits is always 4
+class IvfPqFastScanConfig : public IvfConfig {
+ public:
+    CFG_INT m;
+    CFG_BOOL refine;
+    CFG_FLOAT refine_k;
+    KNOHWERE_DECLARE_CONFIG(IvfPqFastScanConfig) {
+        KNOWHERE_CONFIG_DECLARE_FIELD(m).description("m").set_default(4).for_train().set_range(1, 65536);
+        KNOWHERE_CONFIG_DECLARE_FIELD(refine)
+            .description("keep the raw vectors to rerank the k * refine_k best PQ candidates by exact distance")
+            .set_default(false)
+            .for_train();
+        KNOWHERE_CONFIG_DECLARE_FIELD(refine_k)
+            .description("with refine, k * refine_k candidates are reranked")
+            .set_default(2.0f)
+            .for_search()
+            .set_range(1.0f, 100.0f);
+    }
+};
+
 class IvfSqConfig : public IvfConfig {};
 
 class IvfBinConfig : public IvfConfig {};
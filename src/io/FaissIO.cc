@@ -61,4 +61,20 @@ MemoryIOReader::operator()(void* ptr, size_t size, size_t nitems) {
     return nitems;
 }
 
+const void*
+MemoryIOReader::borrow(size_t nbytes, std::shared_ptr<const void>* owner) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // the data is stored little-endian and has to be swapped, see read()
+    return nullptr;
+#else
+    if (this->owner == nullptr || rp > total || total - rp < nbytes) {
+        return nullptr;
+    }
+    const void* ptr = data_ + rp;
+    rp += nbytes;
+    *owner = this->owner;
+    return ptr;
+#endif
+}
+
 }  // namespace knowhere
@@ -13,6 +13,8 @@
 
 #include <faiss/impl/io.h>
 
+#include <memory>
+
 namespace knowhere {
 
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
@@ -96,10 +98,16 @@ struct MemoryIOReader : public faiss::IOReader {
     uint8_t* data_;
     size_t rp = 0;
     size_t total = 0;
+    // set it to the buffer data_ points into to let faiss::IO_FLAG_ZERO_COPY reads keep views of data_ instead of
+    // copying it
+    std::shared_ptr<uint8_t[]> owner;
 
     size_t
     operator()(void* ptr, size_t size, size_t nitems) override;
 
+    const void*
+    borrow(size_t nbytes, std::shared_ptr<const void>* owner) override;
+
     template <typename T>
     size_t
     read(T* ptr, size_t size, size_t nitems = 1) {
@@ -16,6 +16,7 @@
 #include <immintrin.h>
 
 #include <cassert>
+#include <cstring>
 
 namespace faiss {
 
@@ -195,5 +196,258 @@ fvec_Linf_avx(const float* x, const float* y, size_t d) {
     return _mm_cvtss_f32(msum2);
 }
 
+static inline float
+hsum_ps(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_extractf128_ps(v, 1), _mm256_castps256_ps128(v));
+    s = _mm_hadd_ps(s, s);
+    s = _mm_hadd_ps(s, s);
+    return _mm_cvtss_f32(s);
+}
+
+static inline int32_t
+hsum_epi32(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_extracti128_si256(v, 1), _mm256_castsi256_si128(v));
+    s = _mm_hadd_epi32(s, s);
+    s = _mm_hadd_epi32(s, s);
+    return _mm_cvtsi128_si32(s);
+}
+
+// 8 sq8 codes as floats, not yet scaled
+static inline __m256
+load_u8_ps(const uint8_t* y) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)y)));
+}
+
+static inline __m256
+load_fp16_ps(const uint16_t* y) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)y));
+}
+
+static inline float
+fp16_to_fp32(uint16_t h) {
+    return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(h)));
+}
+
+float
+fvec_L2sqr_sq8_avx(const float* x, const uint8_t* y, size_t d, float vmin, float scale) {
+    const __m256 mvmin = _mm256_set1_ps(vmin);
+    const __m256 mscale = _mm256_set1_ps(scale);
+    __m256 msum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= d; i += 8) {
+        const __m256 my = _mm256_add_ps(mvmin, _mm256_mul_ps(mscale, load_u8_ps(y + i)));
+        const __m256 a_m_b = _mm256_sub_ps(_mm256_loadu_ps(x + i), my);
+        msum = _mm256_add_ps(msum, _mm256_mul_ps(a_m_b, a_m_b));
+    }
+    float res = hsum_ps(msum);
+    for (; i < d; i++) {
+        const float tmp = x[i] - (vmin + scale * y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fvec_inner_product_sq8_avx(const float* x, const uint8_t* y, size_t d, float vmin, float scale) {
+    // sum(x * (vmin + scale * y)) = vmin * sum(x) + scale * sum(x * y)
+    __m256 msum_x = _mm256_setzero_ps();
+    __m256 msum_xy = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= d; i += 8) {
+        const __m256 mx = _mm256_loadu_ps(x + i);
+        msum_x = _mm256_add_ps(msum_x, mx);
+        msum_xy = _mm256_add_ps(msum_xy, _mm256_mul_ps(mx, load_u8_ps(y + i)));
+    }
+    float sum_x = hsum_ps(msum_x);
+    float sum_xy = hsum_ps(msum_xy);
+    for (; i < d; i++) {
+        sum_x += x[i];
+        sum_xy += x[i] * y[i];
+    }
+    return vmin * sum_x + scale * sum_xy;
+}
+
+float
+fvec_L2sqr_fp16_avx(const float* x, const uint16_t* y, size_t d) {
+    __m256 msum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= d; i += 8) {
+        const __m256 a_m_b = _mm256_sub_ps(_mm256_loadu_ps(x + i), load_fp16_ps(y + i));
+        msum = _mm256_add_ps(msum, _mm256_mul_ps(a_m_b, a_m_b));
+    }
+    float res = hsum_ps(msum);
+    for (; i < d; i++) {
+        const float tmp = x[i] - fp16_to_fp32(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fvec_inner_product_fp16_avx(const float* x, const uint16_t* y, size_t d) {
+    __m256 msum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= d; i += 8) {
+        msum = _mm256_add_ps(msum, _mm256_mul_ps(_mm256_loadu_ps(x + i), load_fp16_ps(y + i)));
+    }
+    float res = hsum_ps(msum);
+    for (; i < d; i++) {
+        res += x[i] * fp16_to_fp32(y[i]);
+    }
+    return res;
+}
+
+int32_t
+u8vec_L2sqr_avx(const uint8_t* x, const uint8_t* y, size_t d) {
+    // widen to int16, madd sums adjacent squares into int32 lanes
+    __m256i msum = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        const __m256i mx = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(x + i)));
+        const __m256i my = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i)));
+        const __m256i a_m_b = _mm256_sub_epi16(mx, my);
+        msum = _mm256_add_epi32(msum, _mm256_madd_epi16(a_m_b, a_m_b));
+    }
+    int32_t res = hsum_epi32(msum);
+    for (; i < d; i++) {
+        const int32_t tmp = (int32_t)x[i] - (int32_t)y[i];
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+int32_t
+u8vec_inner_product_avx(const uint8_t* x, const uint8_t* y, size_t d) {
+    __m256i msum = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        const __m256i mx = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(x + i)));
+        const __m256i my = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i)));
+        msum = _mm256_add_epi32(msum, _mm256_madd_epi16(mx, my));
+    }
+    int32_t res = hsum_epi32(msum);
+    for (; i < d; i++) {
+        res += (int32_t)x[i] * (int32_t)y[i];
+    }
+    return res;
+}
+
+float
+fp16vec_L2sqr_avx(const uint16_t* x, const uint16_t* y, size_t d) {
+    __m256 msum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= d; i += 8) {
+        const __m256 a_m_b = _mm256_sub_ps(load_fp16_ps(x + i), load_fp16_ps(y + i));
+        msum = _mm256_add_ps(msum, _mm256_mul_ps(a_m_b, a_m_b));
+    }
+    float res = hsum_ps(msum);
+    for (; i < d; i++) {
+        const float tmp = fp16_to_fp32(x[i]) - fp16_to_fp32(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fp16vec_inner_product_avx(const uint16_t* x, const uint16_t* y, size_t d) {
+    __m256 msum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= d; i += 8) {
+        msum = _mm256_add_ps(msum, _mm256_mul_ps(load_fp16_ps(x + i), load_fp16_ps(y + i)));
+    }
+    float res = hsum_ps(msum);
+    for (; i < d; i++) {
+        res += fp16_to_fp32(x[i]) * fp16_to_fp32(y[i]);
+    }
+    return res;
+}
+
+namespace {
+
+// the positions of the set bits of every byte value, padded with zeros
+struct BytePositions {
+    uint8_t pos[256][8];
+
+    constexpr BytePositions() : pos() {
+        for (int byte = 0; byte < 256; byte++) {
+            int n = 0;
+            for (int b = 0; b < 8; b++) {
+                if (byte & (1 << b)) {
+                    pos[byte][n++] = b;
+                }
+            }
+        }
+    }
+};
+
+constexpr BytePositions kBytePositions;
+
+}  // namespace
+
+// A 64-bit word at a time, every byte of the inverted word expands to the positions of its valid ids through the
+// lookup table. All 8 lanes are stored and the output advances by the popcount of the byte, which never writes past
+// the ids of the bytes read so far.
+size_t
+bitset_valid_ids_avx(const uint8_t* bits, size_t begin, size_t end, uint32_t* out) {
+    size_t n = 0;
+    size_t i = begin;
+    for (; i < end && (i & 63) != 0; i++) {
+        if (!(bits[i >> 3] & (1 << (i & 7)))) {
+            out[n++] = i;
+        }
+    }
+    for (; i + 64 <= end; i += 64) {
+        uint64_t valid;
+        memcpy(&valid, bits + (i >> 3), sizeof(valid));
+        valid = ~valid;
+        if (valid == 0) {
+            continue;
+        }
+        for (size_t b = 0; b < 8; b++) {
+            const uint8_t byte = (valid >> (b * 8)) & 0xff;
+            const __m256i pos = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)kBytePositions.pos[byte]));
+            const __m256i ids = _mm256_add_epi32(pos, _mm256_set1_epi32(i + b * 8));
+            _mm256_storeu_si256((__m256i*)(out + n), ids);
+            n += __builtin_popcount(byte);
+        }
+    }
+    for (; i < end; i++) {
+        if (!(bits[i >> 3] & (1 << (i & 7)))) {
+            out[n++] = i;
+        }
+    }
+    return n;
+}
+
+// 8 lanes at a time, the codes of a chunk are widened to indexes into its table and gathered. Two accumulators take
+// the even and the odd chunks so that consecutive gathers do not wait on each other.
+void
+pq_lookup_blocked_avx(const uint8_t* codes, size_t n, size_t nchunks, const float* tables, float* dis) {
+    for (size_t i = 0; i < n; i += 8) {
+        const uint8_t* code = codes + (i / 16) * 16 * nchunks + i % 16;
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        size_t c = 0;
+        for (; c + 2 <= nchunks; c += 2) {
+            const __m256i idx0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(code + c * 16)));
+            const __m256i idx1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(code + c * 16 + 16)));
+            acc0 = _mm256_add_ps(acc0, _mm256_i32gather_ps(tables + c * 256, idx0, 4));
+            acc1 = _mm256_add_ps(acc1, _mm256_i32gather_ps(tables + c * 256 + 256, idx1, 4));
+        }
+        if (c < nchunks) {
+            const __m256i idx0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(code + c * 16)));
+            acc0 = _mm256_add_ps(acc0, _mm256_i32gather_ps(tables + c * 256, idx0, 4));
+        }
+        const __m256 res = _mm256_add_ps(acc0, acc1);
+        if (i + 8 <= n) {
+            _mm256_storeu_ps(dis + i, res);
+        } else {
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(n - i)), lanes);
+            _mm256_maskstore_ps(dis + i, mask, res);
+        }
+    }
+}
+
 }  // namespace faiss
 #endif
@@ -15,6 +15,7 @@
 #include <immintrin.h>
 
 #include <cassert>
+#include <cstring>
 #include <cstdio>
 #include <string>
 
@@ -249,6 +250,212 @@ fvec_Linf_avx512(const float* x, const float* y, size_t d) {
     return _mm_cvtss_f32(msum2);
 }
 
+// 16 sq8 codes as floats, not yet scaled
+static inline __m512
+load_u8_ps(const uint8_t* y) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)y)));
+}
+
+static inline __m512
+load_fp16_ps(const uint16_t* y) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)y));
+}
+
+static inline float
+fp16_to_fp32(uint16_t h) {
+    return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(h)));
+}
+
+float
+fvec_L2sqr_sq8_avx512(const float* x, const uint8_t* y, size_t d, float vmin, float scale) {
+    const __m512 mvmin = _mm512_set1_ps(vmin);
+    const __m512 mscale = _mm512_set1_ps(scale);
+    __m512 msum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        const __m512 my = _mm512_fmadd_ps(mscale, load_u8_ps(y + i), mvmin);
+        const __m512 a_m_b = _mm512_loadu_ps(x + i) - my;
+        msum = _mm512_fmadd_ps(a_m_b, a_m_b, msum);
+    }
+    float res = _mm512_reduce_add_ps(msum);
+    for (; i < d; i++) {
+        const float tmp = x[i] - (vmin + scale * y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fvec_inner_product_sq8_avx512(const float* x, const uint8_t* y, size_t d, float vmin, float scale) {
+    // sum(x * (vmin + scale * y)) = vmin * sum(x) + scale * sum(x * y)
+    __m512 msum_x = _mm512_setzero_ps();
+    __m512 msum_xy = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        const __m512 mx = _mm512_loadu_ps(x + i);
+        msum_x += mx;
+        msum_xy = _mm512_fmadd_ps(mx, load_u8_ps(y + i), msum_xy);
+    }
+    float sum_x = _mm512_reduce_add_ps(msum_x);
+    float sum_xy = _mm512_reduce_add_ps(msum_xy);
+    for (; i < d; i++) {
+        sum_x += x[i];
+        sum_xy += x[i] * y[i];
+    }
+    return vmin * sum_x + scale * sum_xy;
+}
+
+float
+fvec_L2sqr_fp16_avx512(const float* x, const uint16_t* y, size_t d) {
+    __m512 msum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        const __m512 a_m_b = _mm512_loadu_ps(x + i) - load_fp16_ps(y + i);
+        msum = _mm512_fmadd_ps(a_m_b, a_m_b, msum);
+    }
+    float res = _mm512_reduce_add_ps(msum);
+    for (; i < d; i++) {
+        const float tmp = x[i] - fp16_to_fp32(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fvec_inner_product_fp16_avx512(const float* x, const uint16_t* y, size_t d) {
+    __m512 msum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        msum = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), load_fp16_ps(y + i), msum);
+    }
+    float res = _mm512_reduce_add_ps(msum);
+    for (; i < d; i++) {
+        res += x[i] * fp16_to_fp32(y[i]);
+    }
+    return res;
+}
+
+int32_t
+u8vec_L2sqr_avx512(const uint8_t* x, const uint8_t* y, size_t d) {
+    // widen to int16, madd sums adjacent squares into int32 lanes
+    __m512i msum = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 32 <= d; i += 32) {
+        const __m512i mx = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(x + i)));
+        const __m512i my = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(y + i)));
+        const __m512i a_m_b = _mm512_sub_epi16(mx, my);
+        msum = _mm512_add_epi32(msum, _mm512_madd_epi16(a_m_b, a_m_b));
+    }
+    int32_t res = _mm512_reduce_add_epi32(msum);
+    for (; i < d; i++) {
+        const int32_t tmp = (int32_t)x[i] - (int32_t)y[i];
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+int32_t
+u8vec_inner_product_avx512(const uint8_t* x, const uint8_t* y, size_t d) {
+    __m512i msum = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 32 <= d; i += 32) {
+        const __m512i mx = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(x + i)));
+        const __m512i my = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(y + i)));
+        msum = _mm512_add_epi32(msum, _mm512_madd_epi16(mx, my));
+    }
+    int32_t res = _mm512_reduce_add_epi32(msum);
+    for (; i < d; i++) {
+        res += (int32_t)x[i] * (int32_t)y[i];
+    }
+    return res;
+}
+
+float
+fp16vec_L2sqr_avx512(const uint16_t* x, const uint16_t* y, size_t d) {
+    __m512 msum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        const __m512 a_m_b = load_fp16_ps(x + i) - load_fp16_ps(y + i);
+        msum = _mm512_fmadd_ps(a_m_b, a_m_b, msum);
+    }
+    float res = _mm512_reduce_add_ps(msum);
+    for (; i < d; i++) {
+        const float tmp = fp16_to_fp32(x[i]) - fp16_to_fp32(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fp16vec_inner_product_avx512(const uint16_t* x, const uint16_t* y, size_t d) {
+    __m512 msum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        msum = _mm512_fmadd_ps(load_fp16_ps(x + i), load_fp16_ps(y + i), msum);
+    }
+    float res = _mm512_reduce_add_ps(msum);
+    for (; i < d; i++) {
+        res += fp16_to_fp32(x[i]) * fp16_to_fp32(y[i]);
+    }
+    return res;
+}
+
+// 16 bits at a time, the inverted bits select the lanes of the 16 consecutive ids to compress into out
+size_t
+bitset_valid_ids_avx512(const uint8_t* bits, size_t begin, size_t end, uint32_t* out) {
+    size_t n = 0;
+    size_t i = begin;
+    for (; i < end && (i & 15) != 0; i++) {
+        if (!(bits[i >> 3] & (1 << (i & 7)))) {
+            out[n++] = i;
+        }
+    }
+    const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for (; i + 16 <= end; i += 16) {
+        uint16_t word;
+        memcpy(&word, bits + (i >> 3), sizeof(word));
+        const __mmask16 valid = ~word;
+        if (valid == 0) {
+            continue;
+        }
+        _mm512_mask_compressstoreu_epi32(out + n, valid, _mm512_add_epi32(iota, _mm512_set1_epi32(i)));
+        n += __builtin_popcount(valid);
+    }
+    for (; i < end; i++) {
+        if (!(bits[i >> 3] & (1 << (i & 7)))) {
+            out[n++] = i;
+        }
+    }
+    return n;
+}
+
+// a block of 16 lanes at a time, see pq_lookup_blocked_avx
+void
+pq_lookup_blocked_avx512(const uint8_t* codes, size_t n, size_t nchunks, const float* tables, float* dis) {
+    for (size_t i = 0; i < n; i += 16) {
+        const uint8_t* code = codes + i * nchunks;
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        size_t c = 0;
+        for (; c + 2 <= nchunks; c += 2) {
+            const __m512i idx0 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(code + c * 16)));
+            const __m512i idx1 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(code + c * 16 + 16)));
+            acc0 = _mm512_add_ps(acc0, _mm512_i32gather_ps(idx0, tables + c * 256, 4));
+            acc1 = _mm512_add_ps(acc1, _mm512_i32gather_ps(idx1, tables + c * 256 + 256, 4));
+        }
+        if (c < nchunks) {
+            const __m512i idx0 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(code + c * 16)));
+            acc0 = _mm512_add_ps(acc0, _mm512_i32gather_ps(idx0, tables + c * 256, 4));
+        }
+        const __m512 res = _mm512_add_ps(acc0, acc1);
+        if (i + 16 <= n) {
+            _mm512_storeu_ps(dis + i, res);
+        } else {
+            _mm512_mask_storeu_ps(dis + i, (__mmask16)((1u << (n - i)) - 1), res);
+        }
+    }
+}
+
 }  // namespace faiss
 
 #endif
@@ -32,6 +32,46 @@ fvec_L1_avx512(const float* x, const float* y, size_t d);
 float
 fvec_Linf_avx512(const float* x, const float* y, size_t d);
 
+/// squared L2 distance to a sq8 code decoded as vmin + scale * y
+float
+fvec_L2sqr_sq8_avx512(const float* x, const uint8_t* y, size_t d, float vmin, float scale);
+
+/// inner product with a sq8 code decoded as vmin + scale * y
+float
+fvec_inner_product_sq8_avx512(const float* x, const uint8_t* y, size_t d, float vmin, float scale);
+
+/// squared L2 distance to a fp16 vector
+float
+fvec_L2sqr_fp16_avx512(const float* x, const uint16_t* y, size_t d);
+
+/// inner product with a fp16 vector
+float
+fvec_inner_product_fp16_avx512(const float* x, const uint16_t* y, size_t d);
+
+/// squared L2 distance between two uint8 vectors
+int32_t
+u8vec_L2sqr_avx512(const uint8_t* x, const uint8_t* y, size_t d);
+
+/// inner product of two uint8 vectors
+int32_t
+u8vec_inner_product_avx512(const uint8_t* x, const uint8_t* y, size_t d);
+
+/// squared L2 distance between two fp16 vectors
+float
+fp16vec_L2sqr_avx512(const uint16_t* x, const uint16_t* y, size_t d);
+
+/// inner product of two fp16 vectors
+float
+fp16vec_inner_product_avx512(const uint16_t* x, const uint16_t* y, size_t d);
+
+/// writes the ids in [begin, end) whose bit is not set to out, returns their number
+size_t
+bitset_valid_ids_avx512(const uint8_t* bits, size_t begin, size_t end, uint32_t* out);
+
+/// PQ distances of n codes stored in blocks of 16, chunk-major within a block
+void
+pq_lookup_blocked_avx512(const uint8_t* codes, size_t n, size_t nchunks, const float* tables, float* dis);
+
 }  // namespace faiss
 
 #endif /* DISTANCES_AVX512_H */
@@ -10,8 +10,40 @@
 #include "distances_ref.h"
 
 #include <cmath>
+#include <cstring>
 namespace faiss {
 
+namespace {
+
+// IEEE half to float without F16C, handles subnormals, inf and nan
+inline float
+fp16_to_fp32(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        bits = sign;
+    } else {
+        // subnormal, normalize the mantissa
+        exp = 113;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+}  // namespace
+
 float
 fvec_L2sqr_ref(const float* x, const float* y, size_t d) {
     size_t i;
@@ -96,4 +128,110 @@ fvec_madd_and_argmin_ref(size_t n, const float* a, float bf, const float* b, flo
     return imin;
 }
 
+float
+fvec_L2sqr_sq8_ref(const float* x, const uint8_t* y, size_t d, float vmin, float scale) {
+    float res = 0;
+    for (size_t i = 0; i < d; i++) {
+        const float tmp = x[i] - (vmin + scale * y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fvec_inner_product_sq8_ref(const float* x, const uint8_t* y, size_t d, float vmin, float scale) {
+    float res = 0;
+    for (size_t i = 0; i < d; i++) res += x[i] * (vmin + scale * y[i]);
+    return res;
+}
+
+float
+fvec_L2sqr_fp16_ref(const float* x, const uint16_t* y, size_t d) {
+    float res = 0;
+    for (size_t i = 0; i < d; i++) {
+        const float tmp = x[i] - fp16_to_fp32(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fvec_inner_product_fp16_ref(const float* x, const uint16_t* y, size_t d) {
+    float res = 0;
+    for (size_t i = 0; i < d; i++) res += x[i] * fp16_to_fp32(y[i]);
+    return res;
+}
+
+int32_t
+u8vec_L2sqr_ref(const uint8_t* x, const uint8_t* y, size_t d) {
+    int32_t res = 0;
+    for (size_t i = 0; i < d; i++) {
+        const int32_t tmp = (int32_t)x[i] - (int32_t)y[i];
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+int32_t
+u8vec_inner_product_ref(const uint8_t* x, const uint8_t* y, size_t d) {
+    int32_t res = 0;
+    for (size_t i = 0; i < d; i++) res += (int32_t)x[i] * (int32_t)y[i];
+    return res;
+}
+
+float
+fp16vec_L2sqr_ref(const uint16_t* x, const uint16_t* y, size_t d) {
+    float res = 0;
+    for (size_t i = 0; i < d; i++) {
+        const float tmp = fp16_to_fp32(x[i]) - fp16_to_fp32(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+float
+fp16vec_inner_product_ref(const uint16_t* x, const uint16_t* y, size_t d) {
+    float res = 0;
+    for (size_t i = 0; i < d; i++) res += fp16_to_fp32(x[i]) * fp16_to_fp32(y[i]);
+    return res;
+}
+
+size_t
+bitset_valid_ids_ref(const uint8_t* bits, size_t begin, size_t end, uint32_t* out) {
+    size_t n = 0;
+    size_t i = begin;
+    for (; i < end && (i & 63) != 0; i++) {
+        if (!(bits[i >> 3] & (1 << (i & 7)))) {
+            out[n++] = i;
+        }
+    }
+    for (; i + 64 <= end; i += 64) {
+        uint64_t valid;
+        memcpy(&valid, bits + (i >> 3), sizeof(valid));
+        valid = ~valid;
+        while (valid != 0) {
+            out[n++] = i + __builtin_ctzll(valid);
+            valid &= valid - 1;
+        }
+    }
+    for (; i < end; i++) {
+        if (!(bits[i >> 3] & (1 << (i & 7)))) {
+            out[n++] = i;
+        }
+    }
+    return n;
+}
+
+void
+pq_lookup_blocked_ref(const uint8_t* codes, size_t n, size_t nchunks, const float* tables, float* dis) {
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t* code = codes + (i / 16) * 16 * nchunks + i % 16;
+        float res = 0;
+        for (size_t c = 0; c < nchunks; c++) {
+            res += tables[c * 256 + code[c * 16]];
+        }
+        dis[i] = res;
+    }
+}
+
 }  // namespace faiss
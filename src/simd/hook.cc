@@ -45,6 +45,18 @@ decltype(fvec_inner_products_ny) fvec_inner_products_ny = fvec_inner_products_ny
 decltype(fvec_madd) fvec_madd = fvec_madd_ref;
 decltype(fvec_madd_and_argmin) fvec_madd_and_argmin = fvec_madd_and_argmin_ref;
 
+decltype(fvec_L2sqr_sq8) fvec_L2sqr_sq8 = fvec_L2sqr_sq8_ref;
+decltype(fvec_inner_product_sq8) fvec_inner_product_sq8 = fvec_inner_product_sq8_ref;
+decltype(fvec_L2sqr_fp16) fvec_L2sqr_fp16 = fvec_L2sqr_fp16_ref;
+decltype(fvec_inner_product_fp16) fvec_inner_product_fp16 = fvec_inner_product_fp16_ref;
+decltype(u8vec_L2sqr) u8vec_L2sqr = u8vec_L2sqr_ref;
+decltype(u8vec_inner_product) u8vec_inner_product = u8vec_inner_product_ref;
+decltype(fp16vec_L2sqr) fp16vec_L2sqr = fp16vec_L2sqr_ref;
+decltype(fp16vec_inner_product) fp16vec_inner_product = fp16vec_inner_product_ref;
+
+decltype(bitset_valid_ids) bitset_valid_ids = bitset_valid_ids_ref;
+decltype(pq_lookup_blocked) pq_lookup_blocked = pq_lookup_blocked_ref;
+
 #if defined(__x86_64__)
 bool
 cpu_support_avx512() {
@@ -82,6 +94,18 @@ fvec_hook(std::string& simd_type) {
         fvec_madd = fvec_madd_sse;
         fvec_madd_and_argmin = fvec_madd_and_argmin_sse;
 
+        fvec_L2sqr_sq8 = fvec_L2sqr_sq8_avx512;
+        fvec_inner_product_sq8 = fvec_inner_product_sq8_avx512;
+        fvec_L2sqr_fp16 = fvec_L2sqr_fp16_avx512;
+        fvec_inner_product_fp16 = fvec_inner_product_fp16_avx512;
+        u8vec_L2sqr = u8vec_L2sqr_avx512;
+        u8vec_inner_product = u8vec_inner_product_avx512;
+        fp16vec_L2sqr = fp16vec_L2sqr_avx512;
+        fp16vec_inner_product = fp16vec_inner_product_avx512;
+
+        bitset_valid_ids = bitset_valid_ids_avx512;
+        pq_lookup_blocked = pq_lookup_blocked_avx512;
+
         simd_type = "AVX512";
     } else if (use_avx2 && cpu_support_avx2()) {
         fvec_inner_product = fvec_inner_product_avx;
@@ -95,6 +119,18 @@ fvec_hook(std::string& simd_type) {
         fvec_madd = fvec_madd_sse;
         fvec_madd_and_argmin = fvec_madd_and_argmin_sse;
 
+        fvec_L2sqr_sq8 = fvec_L2sqr_sq8_avx;
+        fvec_inner_product_sq8 = fvec_inner_product_sq8_avx;
+        fvec_L2sqr_fp16 = fvec_L2sqr_fp16_avx;
+        fvec_inner_product_fp16 = fvec_inner_product_fp16_avx;
+        u8vec_L2sqr = u8vec_L2sqr_avx;
+        u8vec_inner_product = u8vec_inner_product_avx;
+        fp16vec_L2sqr = fp16vec_L2sqr_avx;
+        fp16vec_inner_product = fp16vec_inner_product_avx;
+
+        bitset_valid_ids = bitset_valid_ids_avx;
+        pq_lookup_blocked = pq_lookup_blocked_avx;
+
         simd_type = "AVX2";
     } else if (use_sse4_2 && cpu_support_sse4_2()) {
         fvec_inner_product = fvec_inner_product_sse;
@@ -108,6 +144,18 @@ fvec_hook(std::string& simd_type) {
         fvec_madd = fvec_madd_sse;
         fvec_madd_and_argmin = fvec_madd_and_argmin_sse;
 
+        fvec_L2sqr_sq8 = fvec_L2sqr_sq8_ref;
+        fvec_inner_product_sq8 = fvec_inner_product_sq8_ref;
+        fvec_L2sqr_fp16 = fvec_L2sqr_fp16_ref;
+        fvec_inner_product_fp16 = fvec_inner_product_fp16_ref;
+        u8vec_L2sqr = u8vec_L2sqr_ref;
+        u8vec_inner_product = u8vec_inner_product_ref;
+        fp16vec_L2sqr = fp16vec_L2sqr_ref;
+        fp16vec_inner_product = fp16vec_inner_product_ref;
+
+        bitset_valid_ids = bitset_valid_ids_ref;
+        pq_lookup_blocked = pq_lookup_blocked_ref;
+
         simd_type = "SSE4_2";
     } else {
         fvec_inner_product = fvec_inner_product_ref;
@@ -121,6 +169,18 @@ fvec_hook(std::string& simd_type) {
         fvec_madd = fvec_madd_ref;
         fvec_madd_and_argmin = fvec_madd_and_argmin_ref;
 
+        fvec_L2sqr_sq8 = fvec_L2sqr_sq8_ref;
+        fvec_inner_product_sq8 = fvec_inner_product_sq8_ref;
+        fvec_L2sqr_fp16 = fvec_L2sqr_fp16_ref;
+        fvec_inner_product_fp16 = fvec_inner_product_fp16_ref;
+        u8vec_L2sqr = u8vec_L2sqr_ref;
+        u8vec_inner_product = u8vec_inner_product_ref;
+        fp16vec_L2sqr = fp16vec_L2sqr_ref;
+        fp16vec_inner_product = fp16vec_inner_product_ref;
+
+        bitset_valid_ids = bitset_valid_ids_ref;
+        pq_lookup_blocked = pq_lookup_blocked_ref;
+
         simd_type = "GENERIC";
     }
 #endif
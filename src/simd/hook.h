@@ -12,6 +12,7 @@
 #ifndef HOOK_H
 #define HOOK_H
 
+#include <cstdint>
 #include <string>
 namespace faiss {
 
@@ -25,6 +26,27 @@ extern void (*fvec_inner_products_ny)(float*, const float*, const float*, size_t
 extern void (*fvec_madd)(size_t, const float*, float, const float*, float*);
 extern int (*fvec_madd_and_argmin)(size_t, const float*, float, const float*, float*);
 
+// distances against compressed vectors, used by the quantized HNSW spaces. The sq8 kernels decode y as
+// vmin + scale * code, the fp16 kernels read y as IEEE half floats.
+extern float (*fvec_L2sqr_sq8)(const float*, const uint8_t*, size_t, float, float);
+extern float (*fvec_inner_product_sq8)(const float*, const uint8_t*, size_t, float, float);
+extern float (*fvec_L2sqr_fp16)(const float*, const uint16_t*, size_t);
+extern float (*fvec_inner_product_fp16)(const float*, const uint16_t*, size_t);
+// code to code, the u8 kernels stay in integers and are exact for d <= 32768
+extern int32_t (*u8vec_L2sqr)(const uint8_t*, const uint8_t*, size_t);
+extern int32_t (*u8vec_inner_product)(const uint8_t*, const uint8_t*, size_t);
+extern float (*fp16vec_L2sqr)(const uint16_t*, const uint16_t*, size_t);
+extern float (*fp16vec_inner_product)(const uint16_t*, const uint16_t*, size_t);
+
+// writes the ids in [begin, end) whose bit is not set (the ids a filter bitset lets through) to out, which must hold
+// end - begin entries, and returns their number
+extern size_t (*bitset_valid_ids)(const uint8_t* bits, size_t begin, size_t end, uint32_t* out);
+
+// PQ distance of n codes with nchunks bytes each: dis[i] = sum over c of tables[c * 256 + code(i, c)]. The codes are
+// stored in blocks of 16 and chunk-major within a block, code(i, c) is codes[(i / 16) * 16 * nchunks + c * 16 + i % 16].
+// The last block is read in full, its unused lanes may hold any value.
+extern void (*pq_lookup_blocked)(const uint8_t* codes, size_t n, size_t nchunks, const float* tables, float* dis);
+
 #if defined(__x86_64__)
 extern bool use_avx512;
 extern bool use_avx2;
@@ -156,3 +156,49 @@ TEST_CASE("Test Brute Force", "[binary vector]") {
         }
     }
 }
+
+TEST_CASE("Test Brute Force Tiled Search", "[float vector]") {
+    using Catch::Approx;
+
+    // large enough nq to take the tiled path and nb to split the base into several slices
+    const int64_t nb = 40000;
+    const int64_t nq = 100;
+    const int64_t dim = 32;
+    const int64_t k = 10;
+
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP);
+    auto filtered = GENERATE(as<size_t>{}, 0, 20000, 39995);
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 7);
+    const auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filtered);
+    knowhere::BitsetView bitset(bitset_data.data(), nb);
+
+    const knowhere::Json conf = {
+        {knowhere::meta::DIM, dim},
+        {knowhere::meta::METRIC_TYPE, metric},
+        {knowhere::meta::TOPK, k},
+    };
+
+    auto res = knowhere::BruteForce::Search(train_ds, query_ds, conf, bitset);
+    REQUIRE(res.has_value());
+    auto ids = res.value()->GetIds();
+    auto dist = res.value()->GetDistance();
+
+    // compare with the one-task-per-query path
+    auto xq = (const float*)query_ds->GetTensor();
+    for (int64_t i = 0; i < nq; i++) {
+        auto one_ds = knowhere::GenDataSet(1, dim, xq + i * dim);
+        auto gt = knowhere::BruteForce::Search(train_ds, one_ds, conf, bitset);
+        REQUIRE(gt.has_value());
+        auto gt_ids = gt.value()->GetIds();
+        auto gt_dist = gt.value()->GetDistance();
+        for (int64_t j = 0; j < k; j++) {
+            REQUIRE((ids[i * k + j] == -1) == (gt_ids[j] == -1));
+            if (ids[i * k + j] != -1) {
+                REQUIRE(!bitset.test(ids[i * k + j]));
+                REQUIRE(dist[i * k + j] == Approx(gt_dist[j]));
+            }
+        }
+    }
+}
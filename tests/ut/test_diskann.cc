@@ -9,7 +9,14 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "catch2/catch_approx.hpp"
 #include "catch2/catch_test_macros.hpp"
@@ -17,9 +24,11 @@
 #include "index/diskann/diskann.cc"
 #include "index/diskann/diskann_config.h"
 #include "knowhere/comp/brute_force.h"
+#include "knowhere/comp/knowhere_config.h"
 #include "knowhere/comp/local_file_manager.h"
 #include "knowhere/expected.h"
 #include "knowhere/factory.h"
+#include "knowhere/prometheus_client.h"
 #include "utils.h"
 #if __has_include(<filesystem>)
 #include <filesystem>
@@ -275,6 +284,58 @@ TEST_CASE("Test DiskANNIndexNode.", "[diskann]") {
                 REQUIRE(GetKNNRecall(*knn_gt_ptr, *res.value()) == knn_recall);
             }
 
+            // knn search through io_uring, skipped when the build or the kernel does not support it
+            if (knowhere::KnowhereConfig::SetDiskIOBackend(knowhere::KnowhereConfig::DiskIOBackend::IO_URING)) {
+                auto diskann_uring = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+                diskann_uring.Deserialize(binset, deserialize_json);
+                knowhere::KnowhereConfig::SetDiskIOBackend(knowhere::KnowhereConfig::DiskIOBackend::LIBAIO);
+                auto res = diskann_uring.Search(*query_ds, knn_json, nullptr);
+                REQUIRE(res.has_value());
+                REQUIRE(GetKNNRecall(*knn_gt_ptr, *res.value()) == knn_recall);
+            }
+
+            // pipelined knn search, with and without a filter
+            {
+                knowhere::Json pipelined_json = knn_json;
+                pipelined_json["pipelined_search"] = true;
+                pipelined_json["pipeline_width"] = 3;
+                auto res = diskann.Search(*query_ds, pipelined_json, nullptr);
+                REQUIRE(res.has_value());
+                REQUIRE(GetKNNRecall(*knn_gt_ptr, *res.value()) > kKnnRecall);
+
+                auto bitset_data = GenerateBitsetWithRandomTbitsSet(kNumRows, 0.4f * kNumRows);
+                knowhere::BitsetView bitset(bitset_data.data(), kNumRows);
+                auto results = diskann.Search(*query_ds, pipelined_json, bitset);
+                REQUIRE(results.has_value());
+                auto gt = knowhere::BruteForce::Search(base_ds, query_ds, pipelined_json, bitset);
+                REQUIRE(GetKNNRecall(*gt.value(), *results.value()) >= kKnnRecall);
+            }
+
+            // knn search with an adaptive node cache, refreshes change what is cached but not the results
+            {
+                knowhere::Json adaptive_json = deserialize_json;
+                adaptive_json["cache_refresh_queries"] = 5;
+                auto diskann_adaptive = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+                REQUIRE(diskann_adaptive.Deserialize(binset, adaptive_json) == knowhere::Status::success);
+                const double refreshes = knowhere::knowhere_diskann_node_cache_refresh_count.Value();
+                for (int i = 0; i < 3; ++i) {
+                    auto res = diskann_adaptive.Search(*query_ds, knn_json, nullptr);
+                    REQUIRE(res.has_value());
+                    REQUIRE(GetKNNRecall(*knn_gt_ptr, *res.value()) == knn_recall);
+                }
+                // the refresher thread replaces the cached nodes the queries never visit by the ones they missed,
+                // later searches read the reused slots
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                while (knowhere::knowhere_diskann_node_cache_refresh_count.Value() == refreshes &&
+                       std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                REQUIRE(knowhere::knowhere_diskann_node_cache_refresh_count.Value() > refreshes);
+                auto res = diskann_adaptive.Search(*query_ds, knn_json, nullptr);
+                REQUIRE(res.has_value());
+                REQUIRE(GetKNNRecall(*knn_gt_ptr, *res.value()) == knn_recall);
+            }
+
             // knn search with bitset
             std::vector<std::function<std::vector<uint8_t>(size_t, size_t)>> gen_bitset_funcs = {
                 GenerateBitsetWithFirstTbitsSet, GenerateBitsetWithRandomTbitsSet};
@@ -306,6 +367,45 @@ TEST_CASE("Test DiskANNIndexNode.", "[diskann]") {
             auto ap = GetRangeSearchRecall(*range_search_gt_ptr, *range_search_res.value());
             float standard_ap = metric_range_ap_map[metric_str];
             REQUIRE(ap > standard_ap);
+
+            // search into caller owned buffers, without an entry cache so that both paths start from the same medoid
+            {
+                knowhere::Json buf_deserialize_json = deserialize_json;
+                buf_deserialize_json["entry_cache_size"] = 0;
+                auto diskann_buf = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+                REQUIRE(diskann_buf.Deserialize(binset, buf_deserialize_json) == knowhere::Status::success);
+
+                auto results = diskann_buf.Search(*query_ds, knn_json, nullptr);
+                REQUIRE(results.has_value());
+                std::vector<int64_t> ids(kNumQueries * kK);
+                std::vector<float> dist(kNumQueries * kK);
+                REQUIRE(diskann_buf.SearchWithBuf(*query_ds, ids.data(), dist.data(), knn_json, nullptr) ==
+                        knowhere::Status::success);
+                for (uint32_t i = 0; i < kNumQueries * kK; ++i) {
+                    REQUIRE(ids[i] == results.value()->GetIds()[i]);
+                    REQUIRE(dist[i] == Catch::Approx(results.value()->GetDistance()[i]));
+                }
+
+                auto range_results = diskann_buf.RangeSearch(*query_ds, range_json, nullptr);
+                REQUIRE(range_results.has_value());
+                auto lims = range_results.value()->GetLims();
+                knowhere::RangeSearchBuf buf;
+                // the second call reuses the memory left by the first one
+                for (int round = 0; round < 2; ++round) {
+                    REQUIRE(diskann_buf.RangeSearchWithBuf(*query_ds, buf, range_json, nullptr) ==
+                            knowhere::Status::success);
+                    REQUIRE(buf.lims.size() == kNumQueries + 1);
+                    REQUIRE(buf.ids.size() == lims[kNumQueries]);
+                    REQUIRE(buf.distances.size() == lims[kNumQueries]);
+                    for (uint32_t i = 0; i <= kNumQueries; ++i) {
+                        REQUIRE(buf.lims[i] == lims[i]);
+                    }
+                    for (size_t i = 0; i < lims[kNumQueries]; ++i) {
+                        REQUIRE(buf.ids[i] == range_results.value()->GetIds()[i]);
+                        REQUIRE(buf.distances[i] == Catch::Approx(range_results.value()->GetDistance()[i]));
+                    }
+                }
+            }
         }
     }
     fs::remove_all(kDir);
@@ -387,3 +487,340 @@ TEST_CASE("Test DiskANN GetVectorByIds", "[diskann]") {
     fs::remove_all(kDir);
     fs::remove(kDir);
 }
+
+// fewer points than the 256 PQ centers, the pivots are padded instead of failing the build
+TEST_CASE("Test DiskANN build with few points", "[diskann]") {
+    constexpr uint32_t kFewRows = 100;
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+    REQUIRE_NOTHROW(fs::create_directories(kL2IndexDir));
+
+    auto base_gen = [&] {
+        knowhere::Json json;
+        json["dim"] = kDim;
+        json["metric_type"] = knowhere::metric::L2;
+        json["k"] = kK;
+        json["index_prefix"] = kL2IndexPrefix;
+        return json;
+    };
+
+    auto build_gen = [&]() {
+        knowhere::Json json = base_gen();
+        json["data_path"] = kRawDataPath;
+        json["max_degree"] = 24;
+        json["search_list_size"] = 64;
+        json["pq_code_budget_gb"] = sizeof(float) * kDim * kFewRows * 0.125 / (1024 * 1024 * 1024);
+        json["build_dram_budget_gb"] = 32.0;
+        return json;
+    };
+
+    auto query_ds = GenDataSet(kNumQueries, kDim, 42);
+    auto base_ds = GenDataSet(kFewRows, kDim, 30);
+    WriteRawDataToDisk(kRawDataPath, static_cast<const float*>(base_ds->GetTensor()), kFewRows, kDim);
+
+    std::shared_ptr<knowhere::FileManager> file_manager = std::make_shared<knowhere::LocalFileManager>();
+    auto diskann_index_pack = knowhere::Pack(file_manager);
+    knowhere::DataSet* ds_ptr = nullptr;
+    {
+        auto diskann = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+        REQUIRE(diskann.Build(*ds_ptr, build_gen()) == knowhere::Status::success);
+    }
+
+    auto diskann = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+    knowhere::BinarySet binset;
+    REQUIRE(diskann.Deserialize(binset, base_gen()) == knowhere::Status::success);
+
+    knowhere::Json search_json = base_gen();
+    search_json["search_list_size"] = 36;
+    search_json["beamwidth"] = 8;
+    auto res = diskann.Search(*query_ds, search_json, nullptr);
+    REQUIRE(res.has_value());
+    auto gt = knowhere::BruteForce::Search(base_ds, query_ds, base_gen(), nullptr);
+    REQUIRE(gt.has_value());
+    REQUIRE(GetKNNRecall(*gt.value(), *res.value()) >= kKnnRecall);
+
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+}
+
+// the build streams the base file, prepares the IP and COSINE points while reading them and writes the disk layout
+// straight from the graph in memory, nothing but the index files is left behind
+TEST_CASE("Test DiskANN streaming build", "[diskann]") {
+    // 1009 is prime, the last sector of the graph is only partly filled whatever the nodes per sector
+    auto rows = GENERATE(as<uint32_t>{}, kNumRows, 1009);
+    auto metric_str = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP, knowhere::metric::COSINE);
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+    REQUIRE_NOTHROW(fs::create_directories(kL2IndexDir));
+
+    auto base_gen = [&] {
+        knowhere::Json json;
+        json["dim"] = kDim;
+        json["metric_type"] = metric_str;
+        json["k"] = kK;
+        json["index_prefix"] = kL2IndexPrefix;
+        return json;
+    };
+
+    auto build_gen = [&]() {
+        knowhere::Json json = base_gen();
+        json["data_path"] = kRawDataPath;
+        json["max_degree"] = 56;
+        json["search_list_size"] = 128;
+        json["pq_code_budget_gb"] = sizeof(float) * kDim * rows * 0.125 / (1024 * 1024 * 1024);
+        json["search_cache_budget_gb"] = sizeof(float) * kDim * rows * 0.125 / (1024 * 1024 * 1024);
+        json["build_dram_budget_gb"] = 32.0;
+        return json;
+    };
+
+    auto query_ds = GenDataSet(kNumQueries, kDim, 42);
+    auto base_ds = GenDataSet(rows, kDim, 30);
+    WriteRawDataToDisk(kRawDataPath, static_cast<const float*>(base_ds->GetTensor()), rows, kDim);
+
+    std::shared_ptr<knowhere::FileManager> file_manager = std::make_shared<knowhere::LocalFileManager>();
+    auto diskann_index_pack = knowhere::Pack(file_manager);
+    knowhere::DataSet* ds_ptr = nullptr;
+    {
+        auto diskann = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+        REQUIRE(diskann.Build(*ds_ptr, build_gen()) == knowhere::Status::success);
+    }
+    REQUIRE_FALSE(fs::exists(kL2IndexPrefix + "_prepped_base.bin"));
+    REQUIRE_FALSE(fs::exists(kL2IndexPrefix + "_mem.index"));
+    for (const auto& entry : fs::directory_iterator(kL2IndexDir)) {
+        REQUIRE(entry.path().filename().string().find("prepped") == std::string::npos);
+    }
+
+    auto diskann = knowhere::IndexFactory::Instance().Create("DISKANN", diskann_index_pack);
+    knowhere::BinarySet binset;
+    REQUIRE(diskann.Deserialize(binset, base_gen()) == knowhere::Status::success);
+    REQUIRE(diskann.Count() == static_cast<int64_t>(rows));
+
+    knowhere::Json search_json = base_gen();
+    search_json["search_list_size"] = 36;
+    search_json["beamwidth"] = 8;
+    auto res = diskann.Search(*query_ds, search_json, nullptr);
+    REQUIRE(res.has_value());
+    auto gt = knowhere::BruteForce::Search(base_ds, query_ds, base_gen(), nullptr);
+    REQUIRE(gt.has_value());
+    REQUIRE(GetKNNRecall(*gt.value(), *res.value()) >= kKnnRecall);
+    // the distances of the results are the exact ones of the metric, not those of the prepared points
+    for (uint32_t i = 0; i < kNumQueries * kK; ++i) {
+        if (res.value()->GetIds()[i] != gt.value()->GetIds()[i]) {
+            continue;
+        }
+        REQUIRE(res.value()->GetDistance()[i] ==
+                Catch::Approx(gt.value()->GetDistance()[i]).epsilon(1e-3).margin(1e-3));
+    }
+
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+}
+
+// the full precision points appended behind the graph when the disk index stores PQ codes, knowhere does not build
+// with reorder data so diskann is called directly
+TEST_CASE("Test DiskANN build with reorder data", "[diskann]") {
+    constexpr uint32_t kRows = 1009;
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+    REQUIRE_NOTHROW(fs::create_directories(kL2IndexDir));
+
+    auto base_ds = GenDataSet(kRows, kDim, 30);
+    auto xb = static_cast<const float*>(base_ds->GetTensor());
+    WriteRawDataToDisk(kRawDataPath, xb, kRows, kDim);
+
+    diskann::BuildConfig config;
+    config.data_file_path = kRawDataPath;
+    config.index_file_path = kL2IndexPrefix;
+    config.compare_metric = diskann::Metric::L2;
+    config.max_degree = 24;
+    config.search_list_size = 64;
+    config.pq_code_size_gb = sizeof(float) * kDim * kRows * 0.125 / (1024 * 1024 * 1024);
+    config.index_mem_gb = 32.0;
+    config.disk_pq_dims = 16;
+    config.reorder = true;
+    REQUIRE(diskann::build_disk_index<float>(config) == 0);
+
+    std::ifstream reader(diskann::get_disk_index_filename(kL2IndexPrefix), std::ios::binary);
+    REQUIRE(reader.good());
+    std::vector<uint64_t> meta(11);
+    reader.read((char*)meta.data(), meta.size() * sizeof(uint64_t));
+    const uint64_t file_size = meta[0], npts = meta[1], nnodes_per_sector = meta[4];
+    const uint64_t reorder_start = meta[8], reorder_dim = meta[9], reorder_per_sector = meta[10];
+    REQUIRE(npts == kRows);
+    REQUIRE(meta[7] == 1);
+    REQUIRE(reorder_dim == kDim);
+    REQUIRE(nnodes_per_sector > 0);
+    REQUIRE(kRows % nnodes_per_sector != 0);
+    REQUIRE(kRows % reorder_per_sector != 0);
+    const uint64_t n_sectors = (kRows + nnodes_per_sector - 1) / nnodes_per_sector;
+    const uint64_t n_reorder_sectors = (kRows + reorder_per_sector - 1) / reorder_per_sector;
+    REQUIRE(reorder_start == n_sectors + 1);
+    REQUIRE(file_size == (n_sectors + n_reorder_sectors + 1) * SECTOR_LEN);
+    REQUIRE(fs::file_size(diskann::get_disk_index_filename(kL2IndexPrefix)) == file_size);
+
+    // every point once, in order, and zeros behind the last one
+    std::vector<char> sector(SECTOR_LEN);
+    for (uint64_t s = 0; s < n_reorder_sectors; ++s) {
+        reader.seekg((reorder_start + s) * SECTOR_LEN);
+        reader.read(sector.data(), SECTOR_LEN);
+        for (uint64_t j = 0; j < reorder_per_sector; ++j) {
+            const uint64_t id = s * reorder_per_sector + j;
+            const float* vec = (const float*)(sector.data() + j * kDim * sizeof(float));
+            if (id < kRows) {
+                REQUIRE(std::equal(vec, vec + kDim, xb + id * kDim));
+            } else {
+                REQUIRE(std::all_of(vec, vec + kDim, [](float v) { return v == 0.0f; }));
+            }
+        }
+    }
+    reader.close();
+
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+}
+
+TEST_CASE("Test DiskANN Entry Cache", "[diskann]") {
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+    REQUIRE_NOTHROW(fs::create_directories(kL2IndexDir));
+
+    knowhere::Json json;
+    json["dim"] = kDim;
+    json["metric_type"] = knowhere::metric::L2;
+    json["k"] = kK;
+    json["index_prefix"] = kL2IndexPrefix;
+    json["data_path"] = kRawDataPath;
+    json["max_degree"] = 24;
+    json["search_list_size"] = 64;
+    json["pq_code_budget_gb"] = sizeof(float) * kDim * kNumRows * 0.125 / (1024 * 1024 * 1024);
+    json["build_dram_budget_gb"] = 32.0;
+    auto base_ds = GenDataSet(kNumRows, kDim, 30);
+    auto xb = static_cast<const float*>(base_ds->GetTensor());
+    WriteRawDataToDisk(kRawDataPath, xb, kNumRows, kDim);
+    {
+        std::shared_ptr<knowhere::FileManager> file_manager = std::make_shared<knowhere::LocalFileManager>();
+        auto diskann = knowhere::IndexFactory::Instance().Create("DISKANN", knowhere::Pack(file_manager));
+        knowhere::DataSet* ds_ptr = nullptr;
+        REQUIRE(diskann.Build(*ds_ptr, json) == knowhere::Status::success);
+    }
+
+    std::shared_ptr<AlignedFileReader> reader = std::make_shared<LinuxAlignedFileReader>();
+    diskann::PQFlashIndex<float> index(reader, diskann::Metric::L2);
+    REQUIRE(index.load(1, kL2IndexPrefix.c_str()) == 0);
+    index.set_entry_cache_size(100);
+
+    const double prometheus_hits = knowhere::knowhere_diskann_entry_cache_hits.Value();
+    const double prometheus_misses = knowhere::knowhere_diskann_entry_cache_misses.Value();
+    std::vector<int64_t> ids(kK);
+    std::vector<float> dists(kK);
+    index.cached_beam_search(xb, kK, 36, ids.data(), dists.data(), 8);
+    REQUIRE(index.get_entry_cache_hits() == 0);
+    REQUIRE(index.get_entry_cache_misses() == 1);
+    index.cached_beam_search(xb, kK, 36, ids.data(), dists.data(), 8);
+    REQUIRE(index.get_entry_cache_hits() == 1);
+    REQUIRE(index.get_entry_cache_misses() == 1);
+
+    // tuning searches skip the cache, and a disabled cache is never looked up
+    index.cached_beam_search(xb, kK, 36, ids.data(), dists.data(), 8, false, nullptr, nullptr, nullptr, -1.0f, true);
+    index.set_entry_cache_size(0);
+    index.cached_beam_search(xb, kK, 36, ids.data(), dists.data(), 8);
+    REQUIRE(index.get_entry_cache_hits() == 1);
+    REQUIRE(index.get_entry_cache_misses() == 1);
+    REQUIRE(knowhere::knowhere_diskann_entry_cache_hits.Value() - prometheus_hits == 1);
+    REQUIRE(knowhere::knowhere_diskann_entry_cache_misses.Value() - prometheus_misses == 1);
+
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+}
+
+// a longer candidate list continues the range search where the shorter one stopped
+TEST_CASE("Test DiskANN range search resumes between rounds", "[diskann]") {
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+    REQUIRE_NOTHROW(fs::create_directories(kL2IndexDir));
+
+    knowhere::Json json;
+    json["dim"] = kDim;
+    json["metric_type"] = knowhere::metric::L2;
+    json["k"] = kK;
+    json["radius"] = CFG_FLOAT::value_type(200000);
+    json["range_filter"] = CFG_FLOAT::value_type(0);
+    json["index_prefix"] = kL2IndexPrefix;
+    json["data_path"] = kRawDataPath;
+    json["max_degree"] = 56;
+    json["search_list_size"] = 128;
+    json["pq_code_budget_gb"] = sizeof(float) * kDim * kNumRows * 0.125 / (1024 * 1024 * 1024);
+    json["build_dram_budget_gb"] = 32.0;
+    auto query_ds = GenDataSet(kNumQueries, kDim, 42);
+    auto base_ds = GenDataSet(kNumRows, kDim, 30);
+    WriteRawDataToDisk(kRawDataPath, static_cast<const float*>(base_ds->GetTensor()), kNumRows, kDim);
+    {
+        std::shared_ptr<knowhere::FileManager> file_manager = std::make_shared<knowhere::LocalFileManager>();
+        auto diskann = knowhere::IndexFactory::Instance().Create("DISKANN", knowhere::Pack(file_manager));
+        knowhere::DataSet* ds_ptr = nullptr;
+        REQUIRE(diskann.Build(*ds_ptr, json) == knowhere::Status::success);
+    }
+
+    // no node cache, every expanded node is read from disk
+    std::shared_ptr<AlignedFileReader> reader = std::make_shared<LinuxAlignedFileReader>();
+    diskann::PQFlashIndex<float> index(reader, diskann::Metric::L2);
+    REQUIRE(index.load(1, kL2IndexPrefix.c_str()) == 0);
+    auto xq = static_cast<const float*>(query_ds->GetTensor());
+
+    SECTION("Test streamed hits against brute force") {
+        auto gt = knowhere::BruteForce::RangeSearch(base_ds, query_ds, json, nullptr);
+        REQUIRE(gt.has_value());
+        auto gt_lims = gt.value()->GetLims();
+        auto gt_ids = gt.value()->GetIds();
+        auto gt_dists = gt.value()->GetDistance();
+        size_t found = 0;
+        for (uint32_t q = 0; q < kNumQueries; q++) {
+            std::vector<int64_t> ids;
+            std::vector<float> dists;
+            auto n = index.range_search(
+                xq + q * kDim, 200000, 10, 8000,
+                [&](const int64_t* batch_ids, const float* batch_dists, const uint64_t batch_n) {
+                    ids.insert(ids.end(), batch_ids, batch_ids + batch_n);
+                    dists.insert(dists.end(), batch_dists, batch_dists + batch_n);
+                },
+                8, 2.0f);
+            REQUIRE(n == ids.size());
+            REQUIRE(std::is_sorted(dists.begin(), dists.end()));
+
+            std::unordered_map<int64_t, float> expected;
+            for (size_t j = gt_lims[q]; j < gt_lims[q + 1]; j++) {
+                expected.emplace(gt_ids[j], gt_dists[j]);
+            }
+            for (size_t j = 0; j < ids.size(); j++) {
+                auto it = expected.find(ids[j]);
+                REQUIRE(it != expected.end());
+                REQUIRE(dists[j] == Catch::Approx(it->second).epsilon(1e-3));
+            }
+            found += ids.size();
+        }
+        REQUIRE(found >= kL2RangeAp * gt_lims[kNumQueries]);
+    }
+
+    SECTION("Test later rounds do not read the nodes again") {
+        // with everything in range every expanded node is a hit, so a node read twice would show up as a duplicate
+        // hit or as more reads than hits
+        const double range = std::numeric_limits<float>::max();
+        for (uint32_t q = 0; q < 10; q++) {
+            std::vector<int64_t> ids;
+            std::vector<float> dists;
+            diskann::QueryStats one_round;
+            auto n_one_round =
+                index.range_search(xq + q * kDim, range, 10, 10, ids, dists, 8, 2.0f, nullptr, &one_round);
+            REQUIRE(one_round.n_ios == n_one_round);
+
+            diskann::QueryStats stats;
+            auto n = index.range_search(xq + q * kDim, range, 10, 200, ids, dists, 8, 2.0f, nullptr, &stats);
+            REQUIRE(n > n_one_round);
+            REQUIRE(std::unordered_set<int64_t>(ids.begin(), ids.end()).size() == n);
+            REQUIRE(stats.n_ios == n);
+        }
+    }
+
+    fs::remove_all(kDir);
+    fs::remove(kDir);
+}
@@ -9,9 +9,14 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include <filesystem>
+
 #include "catch2/catch_approx.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/generators/catch_generators.hpp"
+#include "faiss/IndexIVFFlat.h"
+#include "faiss/index_io.h"
+#include "io/FaissIO.h"
 #include "knowhere/comp/index_param.h"
 #include "knowhere/comp/knowhere_config.h"
 #include "knowhere/factory.h"
@@ -196,3 +201,76 @@ TEST_CASE("Test Float Get Vector By Ids", "[Float GetVectorByIds]") {
         }
     }
 }
+
+// IVF_FLAT binaries written before the vectors were stored with the lists ("IwFl") only keep the ids, the vectors
+// come from the RAW_DATA of the binary set
+TEST_CASE("Test IVF_FLAT binary without vectors", "[Float GetVectorByIds]") {
+    const int64_t nb = 1000;
+    const int64_t nq = 100;
+    const int64_t dim = 128;
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = 10;
+    json[knowhere::indexparam::NLIST] = 16;
+    json[knowhere::indexparam::NPROBE] = 4;
+
+    auto train_ds = GenDataSet(nb, dim);
+    auto train_ds_copy = CopyDataSet(train_ds, nb);
+    auto query_ds = GenDataSet(nq, dim, 43);
+    auto ids_ds = GenIdsDataSet(nb, nq);
+
+    auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT);
+    REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+    auto expected = idx.Search(*query_ds, json, nullptr);
+    REQUIRE(expected.has_value());
+    knowhere::BinarySet bs;
+    REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+
+    // write the index without its vectors, the way older versions did
+    auto binary = bs.GetByName(idx.Type());
+    knowhere::MemoryIOReader reader;
+    reader.total = binary->size;
+    reader.data_ = binary->data.get();
+    std::unique_ptr<faiss::IndexIVFFlat> ivf(static_cast<faiss::IndexIVFFlat*>(faiss::read_index_nm(&reader)));
+    ivf->arranged_codes = faiss::MaybeOwnedVector<uint8_t>();
+    knowhere::MemoryIOWriter writer;
+    faiss::write_index_nm(ivf.get(), &writer);
+    std::shared_ptr<uint8_t[]> data(writer.data_);
+    REQUIRE(std::string((const char*)data.get(), 4) == "IwFl");
+
+    knowhere::BinarySet old_bs;
+    old_bs.Append(idx.Type(), data, writer.rp);
+    auto loaded = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT);
+    REQUIRE(loaded.Deserialize(old_bs) == knowhere::Status::invalid_binary_set);
+
+    knowhere::BinaryPtr raw = std::make_shared<knowhere::Binary>();
+    raw->data = std::shared_ptr<uint8_t[]>((uint8_t*)train_ds->GetTensor(), [](uint8_t*) {});
+    raw->size = nb * dim * sizeof(float);
+    old_bs.Append("RAW_DATA", raw);
+    REQUIRE(loaded.Deserialize(old_bs) == knowhere::Status::success);
+
+    auto results = loaded.GetVectorByIds(*ids_ds);
+    REQUIRE(results.has_value());
+    auto xb = (const float*)train_ds_copy->GetTensor();
+    auto res_data = (const float*)results.value()->GetTensor();
+    REQUIRE(results.value()->GetRows() == nq);
+    REQUIRE(results.value()->GetDim() == dim);
+    for (int i = 0; i < nq; ++i) {
+        const auto id = ids_ds->GetIds()[i];
+        for (int j = 0; j < dim; ++j) {
+            REQUIRE(res_data[i * dim + j] == xb[id * dim + j]);
+        }
+    }
+    auto loaded_results = loaded.Search(*query_ds, json, nullptr);
+    REQUIRE(loaded_results.has_value());
+    REQUIRE(GetKNNRecall(*expected.value(), *loaded_results.value()) == 1.0f);
+
+    // a file has no RAW_DATA to rebuild the vectors from
+    auto path = std::filesystem::temp_directory_path() / "ivf_flat_without_vectors";
+    faiss::write_index_nm(ivf.get(), path.c_str());
+    auto from_file = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT);
+    REQUIRE(from_file.DeserializeFromFile(path, json) == knowhere::Status::invalid_binary_set);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,434 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/generators/catch_generators.hpp"
+#include "hnswlib/hnswalg.h"
+#include "hnswlib/visited_list_pool.h"
+#include "knowhere/comp/brute_force.h"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/comp/thread_pool.h"
+#include "knowhere/factory.h"
+#include "knowhere/prometheus_client.h"
+#include "io/FaissIO.h"
+#include "utils.h"
+
+TEST_CASE("Test Hnsw Visited List", "[hnsw]") {
+    const size_t n = 1000;
+
+    SECTION("Test fresh list after every acquire") {
+        hnswlib::VisitedListPool pool(n);
+        // run past the 16-bit tag wraparound to make sure old marks never leak into a new query
+        for (size_t round = 0; round < 70000; ++round) {
+            auto visited = pool.getFreeVisitedList();
+            auto id = round % n;
+            REQUIRE_FALSE(visited.get(id));
+            REQUIRE_FALSE(visited.get((id + 1) % n));
+            visited.set(id);
+            REQUIRE(visited.get(id));
+        }
+    }
+
+    SECTION("Test nested and concurrent acquire") {
+        hnswlib::VisitedListPool pool(n, 2);
+        {
+            auto outer = pool.getFreeVisitedList();
+            outer.set(1);
+            auto inner = pool.getFreeVisitedList();
+            REQUIRE_FALSE(inner.get(1));
+            inner.set(2);
+            REQUIRE_FALSE(outer.get(2));
+        }
+
+        std::vector<std::thread> threads;
+        std::vector<int> failures(8, 0);
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t round = 0; round < 2000; ++round) {
+                    auto visited = pool.getFreeVisitedList();
+                    for (size_t i = 0; i < n; i += 7) {
+                        failures[t] += visited.get(i);
+                        visited.set(i);
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        for (auto f : failures) {
+            REQUIRE(f == 0);
+        }
+        REQUIRE(pool.size() > 0);
+    }
+}
+
+TEST_CASE("Test Hnsw Entry Cache", "[hnsw]") {
+    const int64_t nb = 1000, dim = 16;
+    const auto train_ds = GenDataSet(nb, dim);
+    auto xb = (const float*)train_ds->GetTensor();
+
+    hnswlib::HierarchicalNSW<float> index(new hnswlib::L2Space(dim), nb);
+    for (int64_t i = 0; i < nb; i++) {
+        index.addPoint(xb + i * dim, i);
+    }
+    index.setEntryCacheSize(100);
+
+    const double prometheus_hits = knowhere::knowhere_hnsw_entry_cache_hits.Value();
+    const double prometheus_misses = knowhere::knowhere_hnsw_entry_cache_misses.Value();
+    hnswlib::SearchParam param{64, false};
+    std::vector<float> query(xb, xb + dim);
+    index.searchKnn(query.data(), 10, nullptr, &param);
+    REQUIRE(index.getEntryCacheHits() == 0);
+    REQUIRE(index.getEntryCacheMisses() == 1);
+    index.searchKnn(query.data(), 10, nullptr, &param);
+    REQUIRE(index.getEntryCacheHits() == 1);
+    REQUIRE(index.getEntryCacheMisses() == 1);
+
+    // tuning searches skip the cache, and a disabled cache is never looked up
+    hnswlib::SearchParam tuning_param{64, true};
+    index.searchKnn(query.data(), 10, nullptr, &tuning_param);
+    index.setEntryCacheSize(0);
+    index.searchKnn(query.data(), 10, nullptr, &param);
+    REQUIRE(index.getEntryCacheHits() == 1);
+    REQUIRE(index.getEntryCacheMisses() == 1);
+    REQUIRE(knowhere::knowhere_hnsw_entry_cache_hits.Value() - prometheus_hits == 1);
+    REQUIRE(knowhere::knowhere_hnsw_entry_cache_misses.Value() - prometheus_misses == 1);
+}
+
+TEST_CASE("Test Hnsw Graph Reorder", "[hnsw]") {
+    const int64_t nb = 2000, nq = 20;
+    const int64_t dim = 32;
+    const int64_t topk = 10;
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = CopyDataSet(train_ds, nq);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 200;
+    json[knowhere::indexparam::EF] = 64;
+    auto gt = knowhere::BruteForce::Search(train_ds, query_ds, json, nullptr);
+
+    const auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, nb / 2);
+    const knowhere::BitsetView bitset(bitset_data.data(), nb);
+
+    auto check = [&](const knowhere::Index<knowhere::IndexNode>& idx) {
+        auto res = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(res.has_value());
+        REQUIRE(GetKNNRecall(*gt.value(), *res.value()) > 0.9f);
+        // every query is a base vector and has to find itself
+        for (int64_t i = 0; i < nq; i++) {
+            REQUIRE(res.value()->GetIds()[i * topk] == i);
+        }
+
+        res = idx.Search(*query_ds, json, bitset);
+        REQUIRE(res.has_value());
+        for (int64_t i = 0; i < nq * topk; i++) {
+            auto id = res.value()->GetIds()[i];
+            REQUIRE((id == -1 || !bitset.test(id)));
+        }
+
+        std::vector<int64_t> ids = {0, 7, nb / 2, nb - 1};
+        auto ids_ds = knowhere::GenIdsDataSet(ids.size(), ids.data());
+        auto vectors = idx.GetVectorByIds(*ids_ds);
+        REQUIRE(vectors.has_value());
+        auto xb = (const float*)train_ds->GetTensor();
+        auto data = (const float*)vectors.value()->GetTensor();
+        for (size_t i = 0; i < ids.size(); i++) {
+            REQUIRE(std::equal(data + i * dim, data + (i + 1) * dim, xb + ids[i] * dim));
+        }
+    };
+
+    SECTION("Test reorder at build") {
+        auto method = GENERATE(as<std::string>{}, "bfs", "rcm");
+        json[knowhere::indexparam::GRAPH_REORDER] = method;
+        auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        check(idx);
+
+        // the order is saved with the index and no second reorder happens on load
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        auto loaded = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(loaded.Deserialize(bs, json) == knowhere::Status::success);
+        check(loaded);
+    }
+
+    SECTION("Test reorder at load") {
+        json[knowhere::indexparam::GRAPH_REORDER] = "none";
+        auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+
+        json[knowhere::indexparam::GRAPH_REORDER] = "rcm";
+        auto loaded = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(loaded.Deserialize(bs, json) == knowhere::Status::success);
+        check(loaded);
+    }
+
+    SECTION("Test invalid reorder") {
+        json[knowhere::indexparam::GRAPH_REORDER] = "gorder";
+        auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::invalid_args);
+    }
+}
+
+TEST_CASE("Test Hnsw Batched Build", "[hnsw]") {
+    const int64_t nb = 2000, nq = 20;
+    const int64_t dim = 32;
+    const int64_t topk = 10;
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = CopyDataSet(train_ds, nq);
+
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP, knowhere::metric::COSINE);
+    auto batch_size = GENERATE(as<int64_t>{}, 1, 100, 500);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = metric;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 200;
+    json[knowhere::indexparam::EF] = 64;
+    json[knowhere::indexparam::BUILD_BATCH_SIZE] = batch_size;
+    auto gt = knowhere::BruteForce::Search(train_ds, query_ds, json, nullptr);
+
+    auto build = [&](int num_threads) {
+        knowhere::ThreadPool::ScopedOmpSetter setter(num_threads);
+        auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        return std::make_pair(idx, bs.GetByName(knowhere::IndexEnum::INDEX_HNSW));
+    };
+
+    // every list holds at most maxM (maxM0 on level 0) distinct neighbors other than the node itself, and each of
+    // them lives on that level
+    auto check_graph = [&](const knowhere::BinaryPtr& binary) {
+        knowhere::MemoryIOReader reader;
+        reader.total = binary->size;
+        reader.data_ = binary->data.get();
+        hnswlib::HierarchicalNSW<float> graph(nullptr);
+        graph.loadIndex(reader);
+        REQUIRE(graph.cur_element_count == (size_t)nb);
+        REQUIRE(graph.getElementLevel(graph.enterpoint_node_) == graph.maxlevel_);
+
+        int64_t bad_lists = 0;
+        for (hnswlib::tableint i = 0; i < nb; i++) {
+            for (int level = 0; level <= graph.getElementLevel(i); level++) {
+                auto list = graph.get_linklist_at_level(i, level);
+                auto size = graph.getListCount(list);
+                auto links = (const hnswlib::tableint*)(list + 1);
+                std::vector<hnswlib::tableint> sorted(links, links + size);
+                std::sort(sorted.begin(), sorted.end());
+                bool ok = size <= (level == 0 ? graph.maxM0_ : graph.maxM_) && (level > 0 || size > 0) &&
+                          std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end();
+                for (auto nbr : sorted) {
+                    ok = ok && nbr != i && nbr < (hnswlib::tableint)nb && graph.getElementLevel(nbr) >= level;
+                }
+                bad_lists += !ok;
+            }
+        }
+        REQUIRE(bad_lists == 0);
+    };
+
+    // the levels are drawn before the rounds, so the graph does not depend on the thread count or schedule
+    const int num_threads = std::max(4u, std::thread::hardware_concurrency());
+    knowhere::BinaryPtr binaries[2];
+    for (int i = 0; i < 2; i++) {
+        auto [idx, binary] = build(i == 0 ? 1 : num_threads);
+        auto res = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(res.has_value());
+        REQUIRE(GetKNNRecall(*gt.value(), *res.value()) > 0.9f);
+        check_graph(binary);
+        binaries[i] = binary;
+    }
+    REQUIRE(binaries[0]->size == binaries[1]->size);
+    REQUIRE(std::equal(binaries[0]->data.get(), binaries[0]->data.get() + binaries[0]->size,
+                       binaries[1]->data.get()));
+}
+
+TEST_CASE("Test Hnsw Quantized", "[hnsw]") {
+    const int64_t nb = 2000, nq = 20;
+    const int64_t dim = 32;
+    const int64_t topk = 10;
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = CopyDataSet(train_ds, nq);
+
+    auto name = GENERATE(as<std::string>{}, knowhere::IndexEnum::INDEX_HNSW_SQ8, knowhere::IndexEnum::INDEX_HNSW_FP16);
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP, knowhere::metric::COSINE);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = metric;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 200;
+    json[knowhere::indexparam::EF] = 64;
+    auto gt = knowhere::BruteForce::Search(train_ds, query_ds, json, nullptr);
+
+    SECTION("Test search on codes") {
+        json[knowhere::indexparam::REFINE] = false;
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        REQUIRE_FALSE(idx.HasRawData(metric));
+        auto res = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(res.has_value());
+        REQUIRE(GetKNNRecall(*gt.value(), *res.value()) > 0.8f);
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        REQUIRE(bs.binary_map_.size() == 1);
+        auto loaded = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(loaded.Deserialize(bs, json) == knowhere::Status::success);
+        auto loaded_res = loaded.Search(*query_ds, json, nullptr);
+        REQUIRE(loaded_res.has_value());
+        REQUIRE(std::equal(res.value()->GetIds(), res.value()->GetIds() + nq * topk, loaded_res.value()->GetIds()));
+    }
+
+    SECTION("Test search with refine") {
+        json[knowhere::indexparam::REFINE] = true;
+        json[knowhere::indexparam::GRAPH_REORDER] = "bfs";
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        REQUIRE(idx.HasRawData(metric));
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        REQUIRE(bs.Contains(name + "_RAW_DATA"));
+        auto loaded = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(loaded.Deserialize(bs, json) == knowhere::Status::success);
+
+        for (auto* index : {&idx, &loaded}) {
+            auto res = index->Search(*query_ds, json, nullptr);
+            REQUIRE(res.has_value());
+            REQUIRE(GetKNNRecall(*gt.value(), *res.value()) > 0.9f);
+            // reranked distances are the exact ones
+            for (int64_t i = 0; i < nq * topk; i++) {
+                if (res.value()->GetIds()[i] != gt.value()->GetIds()[i]) {
+                    continue;
+                }
+                REQUIRE(std::abs(res.value()->GetDistance()[i] - gt.value()->GetDistance()[i]) <
+                        1e-3f * (1.0f + std::abs(gt.value()->GetDistance()[i])));
+            }
+
+            std::vector<int64_t> ids = {0, 7, nb / 2, nb - 1};
+            auto ids_ds = knowhere::GenIdsDataSet(ids.size(), ids.data());
+            auto vectors = index->GetVectorByIds(*ids_ds);
+            REQUIRE(vectors.has_value());
+            auto xb = (const float*)train_ds->GetTensor();
+            auto data = (const float*)vectors.value()->GetTensor();
+            for (size_t i = 0; i < ids.size(); i++) {
+                REQUIRE(std::equal(data + i * dim, data + (i + 1) * dim, xb + ids[i] * dim));
+            }
+        }
+    }
+
+    SECTION("Test range search with refine") {
+        json[knowhere::indexparam::REFINE] = true;
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+
+        // a radius among the distances of the top k, so that many vectors sit within the quantization error of it
+        std::vector<float> kth(nq);
+        for (int64_t i = 0; i < nq; i++) {
+            kth[i] = gt.value()->GetDistance()[i * topk + topk / 2];
+        }
+        std::nth_element(kth.begin(), kth.begin() + nq / 2, kth.end());
+        const float radius = kth[nq / 2];
+        json[knowhere::meta::RADIUS] = radius;
+        auto range_gt = knowhere::BruteForce::RangeSearch(train_ds, query_ds, json, nullptr);
+        REQUIRE(range_gt.has_value());
+        auto res = idx.RangeSearch(*query_ds, json, nullptr);
+        REQUIRE(res.has_value());
+
+        auto gt_lims = range_gt.value()->GetLims();
+        auto lims = res.value()->GetLims();
+        size_t found = 0;
+        for (int64_t i = 0; i < nq; i++) {
+            std::unordered_map<int64_t, float> exact;
+            for (size_t j = gt_lims[i]; j < gt_lims[i + 1]; j++) {
+                exact[range_gt.value()->GetIds()[j]] = range_gt.value()->GetDistance()[j];
+            }
+            // only exact distances within the radius are returned, also for vectors whose codes are outside it
+            for (size_t j = lims[i]; j < lims[i + 1]; j++) {
+                auto it = exact.find(res.value()->GetIds()[j]);
+                REQUIRE(it != exact.end());
+                REQUIRE(std::abs(res.value()->GetDistance()[j] - it->second) <
+                        1e-3f * (1.0f + std::abs(it->second)));
+                found++;
+            }
+        }
+        REQUIRE(gt_lims[nq] > static_cast<size_t>(nq));
+        REQUIRE(found >= 0.95f * gt_lims[nq]);
+    }
+
+    SECTION("Test load with refine from file") {
+        json[knowhere::indexparam::REFINE] = true;
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        auto res = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(res.has_value());
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        // every binary of the set is written under its name to the same directory
+        auto dir = std::filesystem::current_path() / "hnsw_refine_test";
+        std::filesystem::create_directories(dir);
+        for (auto& [binary_name, binary] : bs.binary_map_) {
+            std::ofstream writer(dir / binary_name, std::ios::binary | std::ios::trunc);
+            writer.write((const char*)binary->data.get(), binary->size);
+        }
+
+        for (bool mmap : {false, true}) {
+            json["enable_mmap"] = mmap;
+            auto loaded = knowhere::IndexFactory::Instance().Create(name);
+            REQUIRE(loaded.DeserializeFromFile(dir / name, json) == knowhere::Status::success);
+            REQUIRE(loaded.HasRawData(metric));
+            auto loaded_res = loaded.Search(*query_ds, json, nullptr);
+            REQUIRE(loaded_res.has_value());
+            REQUIRE(std::equal(res.value()->GetIds(), res.value()->GetIds() + nq * topk, loaded_res.value()->GetIds()));
+            REQUIRE(std::equal(res.value()->GetDistance(), res.value()->GetDistance() + nq * topk,
+                               loaded_res.value()->GetDistance()));
+        }
+
+        // an index built with refine is not loaded without its raw vectors
+        std::filesystem::remove(dir / (name + "_RAW_DATA"));
+        auto loaded = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(loaded.DeserializeFromFile(dir / name, json) == knowhere::Status::invalid_binary_set);
+        bs.binary_map_.erase(name + "_RAW_DATA");
+        REQUIRE(loaded.Deserialize(bs, json) == knowhere::Status::invalid_binary_set);
+        std::filesystem::remove_all(dir);
+    }
+
+    SECTION("Test load as another type") {
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        // the binary is stored under the name of its own type
+        bs.Append(knowhere::IndexEnum::INDEX_HNSW, bs.GetByName(name));
+        auto loaded = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(loaded.Deserialize(bs, json) == knowhere::Status::invalid_binary_set);
+    }
+}
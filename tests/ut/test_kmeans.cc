@@ -0,0 +1,130 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <random>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/generators/catch_generators.hpp"
+#include "common/kmeans.h"
+#include "knowhere/comp/thread_pool.h"
+#include "simd/hook.h"
+
+namespace {
+// n points around k well separated means with unit variance per dimension
+std::vector<float>
+GenBlobs(size_t n, size_t d, size_t k, std::vector<float>& means) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> normal(0, 1);
+    means.resize(k * d);
+    for (auto& v : means) {
+        v = normal(rng) * 20;
+    }
+    std::vector<float> x(n * d);
+    for (size_t i = 0; i < n; ++i) {
+        size_t c = i % k;
+        for (size_t j = 0; j < d; ++j) {
+            x[i * d + j] = means[c * d + j] + normal(rng);
+        }
+    }
+    return x;
+}
+
+double
+Objective(const float* x, size_t n, size_t d, const float* centroids, size_t k) {
+    std::vector<int64_t> assign(n);
+    std::vector<float> dis(n);
+    knowhere::KMeansAssign(nullptr, x, n, d, centroids, k, false, assign.data(), dis.data());
+    double sum = 0;
+    for (auto v : dis) {
+        sum += v;
+    }
+    return sum;
+}
+}  // namespace
+
+TEST_CASE("Test KMeansAssign", "[kmeans]") {
+    const size_t n = 3000, d = 24, k = 1100;
+    std::vector<float> centroids;
+    auto x = GenBlobs(n, d, k, centroids);
+    auto pool = knowhere::ThreadPool::GetGlobalThreadPool();
+    auto inner_product = GENERATE(false, true);
+
+    std::vector<int64_t> assign(n);
+    std::vector<float> dis(n);
+    knowhere::KMeansAssign(pool, x.data(), n, d, centroids.data(), k, inner_product, assign.data(), dis.data());
+    for (size_t i = 0; i < n; ++i) {
+        const float* xi = x.data() + i * d;
+        int64_t best = 0;
+        float best_v = inner_product ? faiss::fvec_inner_product(xi, centroids.data(), d)
+                                     : faiss::fvec_L2sqr(xi, centroids.data(), d);
+        for (size_t c = 1; c < k; ++c) {
+            float v = inner_product ? faiss::fvec_inner_product(xi, centroids.data() + c * d, d)
+                                    : faiss::fvec_L2sqr(xi, centroids.data() + c * d, d);
+            if (inner_product ? v > best_v : v < best_v) {
+                best = c;
+                best_v = v;
+            }
+        }
+        REQUIRE(assign[i] == best);
+        REQUIRE(std::abs(dis[i] - best_v) <= 1e-3f * std::max(1.0f, std::abs(best_v)));
+    }
+}
+
+TEST_CASE("Test KMeansTrain", "[kmeans]") {
+    const size_t n = 20000, d = 16, k = 20;
+    std::vector<float> means;
+    auto x = GenBlobs(n, d, k, means);
+    auto pool = knowhere::ThreadPool::GetGlobalThreadPool();
+    // with the true means every point is at about d from its centroid
+    const double ideal = Objective(x.data(), n, d, means.data(), k);
+
+    SECTION("full batch and mini-batch") {
+        auto batch_size = GENERATE(0, 1024);
+        knowhere::KMeansConfig cfg;
+        cfg.batch_size = batch_size;
+        cfg.kmeans_plus_plus = true;
+        cfg.niter = 50;
+        std::vector<float> centroids(k * d);
+        knowhere::KMeansStats stats;
+        REQUIRE(knowhere::KMeansTrain(pool, x.data(), n, d, k, cfg, centroids.data(), &stats) ==
+                knowhere::Status::success);
+        REQUIRE(stats.iterations > 0);
+        REQUIRE(!stats.objectives.empty());
+        REQUIRE(Objective(x.data(), n, d, centroids.data(), k) < ideal * 1.1);
+    }
+
+    SECTION("same result without a pool") {
+        knowhere::KMeansConfig cfg;
+        std::vector<float> a(k * d), b(k * d);
+        REQUIRE(knowhere::KMeansTrain(pool, x.data(), n, d, k, cfg, a.data()) == knowhere::Status::success);
+        REQUIRE(knowhere::KMeansTrain(nullptr, x.data(), n, d, k, cfg, b.data()) == knowhere::Status::success);
+        REQUIRE(a == b);
+    }
+
+    SECTION("spherical") {
+        knowhere::KMeansConfig cfg;
+        cfg.spherical = true;
+        cfg.inner_product = true;
+        cfg.batch_size = 512;
+        std::vector<float> centroids(k * d);
+        REQUIRE(knowhere::KMeansTrain(pool, x.data(), n, d, k, cfg, centroids.data()) == knowhere::Status::success);
+        for (size_t c = 0; c < k; ++c) {
+            REQUIRE(std::abs(faiss::fvec_norm_L2sqr(centroids.data() + c * d, d) - 1.0f) < 1e-4f);
+        }
+    }
+
+    SECTION("fewer points than centroids") {
+        std::vector<float> centroids(k * d);
+        REQUIRE(knowhere::KMeansTrain(pool, x.data(), k - 1, d, k, knowhere::KMeansConfig(), centroids.data()) ==
+                knowhere::Status::invalid_args);
+    }
+}
@@ -126,6 +126,7 @@ TEST_CASE("Search mmap", "[float metrics]") {
         using std::make_tuple;
         auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC, ivfflatcc_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
@@ -149,10 +150,40 @@ TEST_CASE("Search mmap", "[float metrics]") {
         }
     }
 
+    SECTION("Test HNSW Upper Levels") {
+        // a small M puts many nodes on the upper levels, which a mapped load uses in place
+        knowhere::Json json = hnsw_gen();
+        json[knowhere::indexparam::HNSW_M] = 4;
+        json[knowhere::indexparam::GRAPH_REORDER] = "bfs";
+        auto enable_mmap = GENERATE(true, false);
+        json["enable_mmap"] = enable_mmap;
+        auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_HNSW);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        auto expected = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(expected.has_value());
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        auto binary = bs.GetByName(idx.Type());
+
+        reload_from_file(idx, *train_ds, json);
+        auto results = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        REQUIRE(std::equal(results.value()->GetIds(), results.value()->GetIds() + nq * topk,
+                           expected.value()->GetIds()));
+
+        // the loaded index writes the binary it was loaded from
+        knowhere::BinarySet reloaded;
+        REQUIRE(idx.Serialize(reloaded) == knowhere::Status::success);
+        auto reloaded_binary = reloaded.GetByName(idx.Type());
+        REQUIRE(reloaded_binary->size == binary->size);
+        REQUIRE(std::equal(binary->data.get(), binary->data.get() + binary->size, reloaded_binary->data.get()));
+    }
+
     SECTION("Test Range Search") {
         using std::make_tuple;
         auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC, ivfflatcc_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
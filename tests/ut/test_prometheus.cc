@@ -21,4 +21,23 @@ TEST_CASE("Test prometheus client", "[prometheus client]") {
         std::cout << str << std::endl;
         CHECK(str.length() >= 0);
     }
+
+    SECTION("check latency and resource metrics") {
+        {
+            knowhere::ScopedLatencyTimer timer(
+                knowhere::IndexTypeHistogram(knowhere::knowhere_search_latency_family, "TEST_INDEX"));
+            knowhere::ScopedPhaseTimer phase_timer(knowhere::SearchPhase::RESULT_ASSEMBLY);
+        }
+        knowhere::IndexTypeGauge(knowhere::knowhere_index_resident_bytes_family, "TEST_INDEX").Set(1024);
+        knowhere::AddThreadPoolQueueDepth(1);
+        knowhere::AddThreadPoolQueueDepth(-1);
+
+        auto str = knowhere::prometheusClient->GetMetrics();
+        CHECK(str.find("knowhere_search_latency") != std::string::npos);
+        CHECK(str.find("knowhere_search_phase_latency") != std::string::npos);
+        CHECK(str.find("result_assembly") != std::string::npos);
+        CHECK(str.find("knowhere_index_resident_bytes") != std::string::npos);
+        CHECK(str.find("knowhere_thread_pool_queue_depth") != std::string::npos);
+        knowhere::IndexTypeGauge(knowhere::knowhere_index_resident_bytes_family, "TEST_INDEX").Set(0);
+    }
 }
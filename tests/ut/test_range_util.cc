@@ -72,7 +72,7 @@ CountValidRangeSearchResult(const std::vector<std::vector<float>>& distances, co
 }
 }  // namespace
 
-TEST_CASE("Test GetRangeSearchResult for HNSW/DiskANN", "[range search]") {
+TEST_CASE("Test RangeSearchResultCollector for HNSW/DiskANN", "[range search]") {
     const int64_t nq = 10;
     const int64_t label_min = 0, label_max = 10000;
     const float dist_min = 0.0, dist_max = 100.0;
@@ -81,18 +81,19 @@ TEST_CASE("Test GetRangeSearchResult for HNSW/DiskANN", "[range search]") {
 
     GenRangeSearchResult(gen_labels, gen_distances, nq, label_min, label_max, dist_min, dist_max);
 
-    auto GetRangeSearchResult = [](std::vector<std::vector<float>>& result_distances,
-                                   std::vector<std::vector<int64_t>>& result_labels, const bool is_ip, const int64_t nq,
-                                   const float radius, const float range_filter) -> knowhere::DataSetPtr {
+    // the graph indexes add their hits one at a time as the search walks them
+    auto GetRangeSearchResult = [&](const bool is_ip, const float radius,
+                                    const float range_filter) -> knowhere::DataSetPtr {
+        knowhere::RangeSearchResultCollector collector(nq, is_ip, radius, range_filter);
+        for (auto i = 0; i < nq; i++) {
+            for (size_t j = 0; j < gen_labels[i].size(); j++) {
+                collector.Add(i, gen_distances[i][j], gen_labels[i][j]);
+            }
+        }
         float* distances;
         int64_t* labels;
         size_t* lims;
-        for (auto i = 0; i < nq; i++) {
-            knowhere::FilterRangeSearchResultForOneNq(result_distances[i], result_labels[i], is_ip, radius,
-                                                      range_filter);
-        }
-        knowhere::GetRangeSearchResult(result_distances, result_labels, is_ip, nq, radius, range_filter, distances,
-                                       labels, lims);
+        collector.Finish(distances, labels, lims);
         return knowhere::GenResultDataSet(nq, labels, distances, lims);
     };
 
@@ -106,10 +107,13 @@ TEST_CASE("Test GetRangeSearchResult for HNSW/DiskANN", "[range search]") {
         for (bool is_ip : {true, false}) {
             float radius = is_ip ? std::get<0>(item) : std::get<1>(item);
             float range_filter = is_ip ? std::get<1>(item) : std::get<0>(item);
-            std::vector<std::vector<int64_t>> bak_labels = gen_labels;
-            std::vector<std::vector<float>> bak_distances = gen_distances;
-            auto result = GetRangeSearchResult(bak_distances, bak_labels, is_ip, nq, radius, range_filter);
+            auto result = GetRangeSearchResult(is_ip, radius, range_filter);
             REQUIRE(result->GetLims()[nq] == CountValidRangeSearchResult(gen_distances, radius, range_filter, is_ip));
+            for (auto i = 0; i < nq; i++) {
+                for (size_t j = result->GetLims()[i]; j < result->GetLims()[i + 1]; j++) {
+                    REQUIRE(knowhere::distance_in_range(result->GetDistance()[j], radius, range_filter, is_ip));
+                }
+            }
         }
     }
 }
@@ -157,7 +161,7 @@ CountValidRangeSearchResult(const float* distances, const size_t* lims, const in
 }
 }  // namespace
 
-TEST_CASE("Test GetRangeSearchResult for Faiss", "[range search]") {
+TEST_CASE("Test RangeSearchResultCollector for Faiss", "[range search]") {
     const int64_t nq = 10;
     const int64_t label_min = 0, label_max = 10000;
     const float dist_min = 0.0, dist_max = 100.0;
@@ -165,10 +169,6 @@ TEST_CASE("Test GetRangeSearchResult for Faiss", "[range search]") {
     faiss::RangeSearchResult res(nq);
     GenRangeSearchResult(res, nq, label_min, label_max, dist_min, dist_max);
 
-    float* distances;
-    int64_t* labels;
-    size_t* lims;
-
     std::vector<std::tuple<float, float>> test_sets = {
         std::make_tuple(-10.0, -1.0), std::make_tuple(-10.0, 0.0),   std::make_tuple(-10.0, 50.0),
         std::make_tuple(0.0, 50.0),   std::make_tuple(0.0, 100.0),   std::make_tuple(50.0, 100.0),
@@ -179,10 +179,81 @@ TEST_CASE("Test GetRangeSearchResult for Faiss", "[range search]") {
         for (bool is_ip : {true, false}) {
             float radius = is_ip ? std::get<0>(item) : std::get<1>(item);
             float range_filter = is_ip ? std::get<1>(item) : std::get<0>(item);
-            knowhere::GetRangeSearchResult(res, is_ip, nq, radius, range_filter, distances, labels, lims, nullptr);
+            // the faiss indexes add the hits of a query in one go
+            knowhere::RangeSearchResultCollector collector(nq, is_ip, radius, range_filter);
+            for (int64_t i = 0; i < nq; i++) {
+                collector.Add(i, res.distances + res.lims[i], res.labels + res.lims[i], res.lims[i + 1] - res.lims[i]);
+            }
+            float* distances;
+            int64_t* labels;
+            size_t* lims;
+            collector.Finish(distances, labels, lims);
             auto result = knowhere::GenResultDataSet(nq, labels, distances, lims);
             REQUIRE(result->GetLims()[nq] ==
                     CountValidRangeSearchResult(res.distances, res.lims, nq, radius, range_filter, is_ip));
+            for (int64_t i = 0; i < nq; i++) {
+                for (size_t j = result->GetLims()[i]; j < result->GetLims()[i + 1]; j++) {
+                    REQUIRE(knowhere::distance_in_range(result->GetDistance()[j], radius, range_filter, is_ip));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Test RangeSearchResultCollector", "[range search]") {
+    const int64_t nq = 10;
+    const int64_t label_min = 0, label_max = 10000;
+    const float dist_min = 0.0, dist_max = 100.0;
+    std::vector<std::vector<int64_t>> gen_labels;
+    std::vector<std::vector<float>> gen_distances;
+
+    GenRangeSearchResult(gen_labels, gen_distances, nq, label_min, label_max, dist_min, dist_max);
+    // one query with enough hits to span several chunks
+    gen_labels[0].resize(200000);
+    gen_distances[0].resize(200000);
+    for (size_t j = 0; j < gen_labels[0].size(); j++) {
+        gen_labels[0][j] = j;
+        gen_distances[0][j] = (j % 1000) / 10.0f;
+    }
+
+    for (bool is_ip : {true, false}) {
+        float radius = is_ip ? 10.0f : 90.0f;
+        float range_filter = is_ip ? 90.0f : 10.0f;
+
+        knowhere::RangeSearchResultCollector collector(nq, is_ip, radius, range_filter);
+        for (int64_t i = 0; i < nq; i++) {
+            if (i % 2 == 0) {
+                collector.Add(i, gen_distances[i].data(), gen_labels[i].data(), gen_labels[i].size());
+            } else {
+                for (size_t j = 0; j < gen_labels[i].size(); j++) {
+                    collector.Add(i, gen_distances[i][j], gen_labels[i][j]);
+                }
+            }
+        }
+        float* distances;
+        int64_t* labels;
+        size_t* lims;
+        collector.Finish(distances, labels, lims);
+        auto result = knowhere::GenResultDataSet(nq, labels, distances, lims);
+
+        knowhere::RangeSearchBuf buf;
+        collector.Finish(buf);
+        REQUIRE(buf.lims.size() == nq + 1);
+
+        for (int64_t i = 0; i < nq; i++) {
+            std::vector<int64_t> expected_labels;
+            for (size_t j = 0; j < gen_labels[i].size(); j++) {
+                if (knowhere::distance_in_range(gen_distances[i][j], radius, range_filter, is_ip)) {
+                    expected_labels.push_back(gen_labels[i][j]);
+                }
+            }
+            REQUIRE(lims[i + 1] - lims[i] == expected_labels.size());
+            REQUIRE(buf.lims[i + 1] == lims[i + 1]);
+            for (size_t j = 0; j < expected_labels.size(); j++) {
+                REQUIRE(labels[lims[i] + j] == expected_labels[j]);
+                REQUIRE(buf.ids[lims[i] + j] == expected_labels[j]);
+                REQUIRE(knowhere::distance_in_range(distances[lims[i] + j], radius, range_filter, is_ip));
+            }
         }
     }
 }
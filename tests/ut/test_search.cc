@@ -9,9 +9,15 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include <filesystem>
+#include <fstream>
+
 #include "catch2/catch_approx.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/generators/catch_generators.hpp"
+#include "faiss/IndexFlat.h"
+#include "faiss/IndexScalarQuantizer.h"
+#include "faiss/index_io.h"
 #include "faiss/utils/binary_distances.h"
 #include "hnswlib/hnswalg.h"
 #include "knowhere/bitsetview.h"
@@ -20,6 +26,7 @@
 #include "knowhere/comp/knowhere_config.h"
 #include "knowhere/factory.h"
 #include "knowhere/log.h"
+#include "io/FaissIO.h"
 #include "utils.h"
 
 namespace {
@@ -61,6 +68,12 @@ TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
 
     auto ivfsq_gen = ivfflat_gen;
 
+    auto ivf_minibatch_gen = [&ivfflat_gen]() {
+        knowhere::Json json = ivfflat_gen();
+        json[knowhere::indexparam::KMEANS_BATCH_SIZE] = 256;
+        return json;
+    };
+
     auto flat_gen = base_gen;
 
     auto ivfpq_gen = [&ivfflat_gen]() {
@@ -110,6 +123,8 @@ TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
             make_tuple(knowhere::IndexEnum::INDEX_HNSW, hnsw_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivf_minibatch_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivf_minibatch_gen),
         }));
         auto idx = knowhere::IndexFactory::Instance().Create(name);
         auto cfg_json = gen().dump();
@@ -191,6 +206,85 @@ TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
         }
     }
 
+    SECTION("Test IVF_FLAT Batched Search") {
+        const int64_t batch_nq = 64;
+        auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT);
+        knowhere::Json json = ivfflat_gen();
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        load_raw_data(idx, *train_ds, json);
+
+        const auto batch_ds = GenDataSet(batch_nq, dim, 7);
+        const auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, nb / 2);
+        knowhere::BitsetView bitset(bitset_data.data(), nb);
+        auto results = idx.Search(*batch_ds, json, bitset);
+        REQUIRE(results.has_value());
+        auto ids = results.value()->GetIds();
+        auto dist = results.value()->GetDistance();
+
+        // compare with the one-task-per-query path
+        auto xq = (const float*)batch_ds->GetTensor();
+        for (int64_t i = 0; i < batch_nq; i++) {
+            auto one_ds = knowhere::GenDataSet(1, dim, xq + i * dim);
+            auto gt = idx.Search(*one_ds, json, bitset);
+            REQUIRE(gt.has_value());
+            auto gt_ids = gt.value()->GetIds();
+            auto gt_dist = gt.value()->GetDistance();
+            for (int64_t j = 0; j < topk; j++) {
+                REQUIRE((ids[i * topk + j] == -1) == (gt_ids[j] == -1));
+                if (ids[i * topk + j] != -1) {
+                    REQUIRE(!bitset.test(ids[i * topk + j]));
+                    REQUIRE(dist[i * topk + j] == Approx(gt_dist[j]));
+                }
+            }
+        }
+    }
+
+    SECTION("Test Search With Buf") {
+        using std::make_tuple;
+        auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_HNSW, hnsw_gen),
+        }));
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        auto cfg_json = gen().dump();
+        CAPTURE(name, cfg_json);
+        knowhere::Json json = knowhere::Json::parse(cfg_json);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        if (name == knowhere::IndexEnum::INDEX_FAISS_IVFFLAT) {
+            load_raw_data(idx, *train_ds, json);
+        }
+
+        auto results = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        std::vector<int64_t> ids(nq * topk);
+        std::vector<float> dist(nq * topk);
+        REQUIRE(idx.SearchWithBuf(*query_ds, ids.data(), dist.data(), json, nullptr) == knowhere::Status::success);
+        for (int64_t i = 0; i < nq * topk; i++) {
+            REQUIRE(ids[i] == results.value()->GetIds()[i]);
+            REQUIRE(dist[i] == Approx(results.value()->GetDistance()[i]));
+        }
+
+        auto range_results = idx.RangeSearch(*query_ds, json, nullptr);
+        REQUIRE(range_results.has_value());
+        auto lims = range_results.value()->GetLims();
+        knowhere::RangeSearchBuf buf;
+        // the second call reuses the memory left by the first one
+        for (int round = 0; round < 2; round++) {
+            REQUIRE(idx.RangeSearchWithBuf(*query_ds, buf, json, nullptr) == knowhere::Status::success);
+            REQUIRE(buf.lims.size() == (size_t)nq + 1);
+            REQUIRE(buf.ids.size() == lims[nq]);
+            REQUIRE(buf.distances.size() == lims[nq]);
+            for (int64_t i = 0; i <= nq; i++) {
+                REQUIRE(buf.lims[i] == lims[i]);
+            }
+            for (size_t i = 0; i < lims[nq]; i++) {
+                REQUIRE(buf.ids[i] == range_results.value()->GetIds()[i]);
+            }
+        }
+    }
+
     SECTION("Test Serialize/Deserialize") {
         using std::make_tuple;
         auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
@@ -220,6 +314,175 @@ TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
         REQUIRE(results.has_value());
     }
 
+    SECTION("Test Zero-Copy Deserialize") {
+        using std::make_tuple;
+        auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
+        }));
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        auto json = gen();
+        CAPTURE(name, json.dump());
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        auto results = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        auto binary = bs.GetByName(name);
+        std::vector<uint8_t> bytes(binary->data.get(), binary->data.get() + binary->size);
+        auto idx_ = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx_.Deserialize(bs) == knowhere::Status::success);
+        // the loaded index shares the buffer instead of copying it, and keeps it alive
+        REQUIRE(binary->data.use_count() > 1);
+        bs = knowhere::BinarySet();
+        binary.reset();
+
+        auto results_ = idx_.Search(*query_ds, json, nullptr);
+        REQUIRE(results_.has_value());
+        REQUIRE(GetKNNRecall(*results.value(), *results_.value()) == 1.0f);
+        knowhere::BinarySet bs_;
+        REQUIRE(idx_.Serialize(bs_) == knowhere::Status::success);
+        auto binary_ = bs_.GetByName(name);
+        REQUIRE(std::vector<uint8_t>(binary_->data.get(), binary_->data.get() + binary_->size) == bytes);
+    }
+
+    SECTION("Test IVF_SQ Variants") {
+        using std::make_tuple;
+        auto [name, threshold] = GENERATE(table<std::string, float>({
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ4, 0.3f),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ6, kKnnRecallThreshold),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFP16, kKnnRecallThreshold),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFBF16, kKnnRecallThreshold),
+        }));
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        auto json = ivfsq_gen();
+        CAPTURE(name, json.dump());
+        REQUIRE(idx.Type() == name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        REQUIRE(idx.Count() == nb);
+
+        auto sq8 = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8);
+        REQUIRE(sq8.Build(*train_ds, json) == knowhere::Status::success);
+        if (name == knowhere::IndexEnum::INDEX_FAISS_IVFSQ4 || name == knowhere::IndexEnum::INDEX_FAISS_IVFSQ6) {
+            REQUIRE(idx.Size() < sq8.Size());
+        } else {
+            REQUIRE(idx.Size() > sq8.Size());
+        }
+
+        auto results = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        REQUIRE(GetKNNRecall(*gt.value(), *results.value()) > threshold);
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        auto idx_ = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx_.Deserialize(bs) == knowhere::Status::success);
+        REQUIRE(idx_.Size() == idx.Size());
+        auto results_ = idx_.Search(*query_ds, json, nullptr);
+        REQUIRE(results_.has_value());
+        REQUIRE(GetKNNRecall(*results.value(), *results_.value()) == 1.0f);
+
+        // the binary keeps its quantizer, another IVF_SQ type must refuse it
+        bs.Append(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, bs.GetByName(name));
+        auto wrong = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8);
+        REQUIRE(wrong.Deserialize(bs) == knowhere::Status::invalid_binary_set);
+    }
+
+    SECTION("Test IVF_PQ_FASTSCAN") {
+        auto refine = GENERATE(false, true);
+        auto json = ivfflat_gen();
+        json[knowhere::indexparam::M] = 32;
+        json[knowhere::indexparam::REFINE] = refine;
+        json[knowhere::indexparam::REFINE_K] = 10.0;
+        CAPTURE(refine, json.dump());
+
+        auto name = knowhere::IndexEnum::INDEX_FAISS_IVFPQ_FASTSCAN;
+        auto idx = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx.Type() == name);
+        REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+        REQUIRE(idx.Count() == nb);
+        REQUIRE(idx.Size() > 0);
+        REQUIRE(idx.HasRawData(metric) == (refine && knowhere::IsMetricType(metric, knowhere::metric::L2)));
+
+        auto results = idx.Search(*query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        if (refine) {
+            // reranking only the k fast scan results keeps the recall of the 4-bit codes
+            auto few_json = json;
+            few_json[knowhere::indexparam::REFINE_K] = 1.0;
+            auto few = idx.Search(*query_ds, few_json, nullptr);
+            REQUIRE(few.has_value());
+            REQUIRE(GetKNNRecall(*gt.value(), *results.value()) > GetKNNRecall(*gt.value(), *few.value()));
+        }
+        REQUIRE(idx.RangeSearch(*query_ds, json, nullptr).error() == knowhere::Status::not_implemented);
+
+        auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, nb / 2);
+        knowhere::BitsetView bitset(bitset_data.data(), nb);
+        auto filtered = idx.Search(*query_ds, json, bitset);
+        REQUIRE(filtered.has_value());
+        auto ids = filtered.value()->GetIds();
+        for (int64_t i = 0; i < nq * topk; ++i) {
+            REQUIRE((ids[i] == -1 || !bitset.test(ids[i])));
+        }
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        auto idx_ = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(idx_.Deserialize(bs) == knowhere::Status::success);
+        REQUIRE(idx_.Size() == idx.Size());
+        auto results_ = idx_.Search(*query_ds, json, nullptr);
+        REQUIRE(results_.has_value());
+        REQUIRE(GetKNNRecall(*results.value(), *results_.value()) == 1.0f);
+
+        // adding in batches appends the raw vectors behind the binary set serialized above
+        auto batched = knowhere::IndexFactory::Instance().Create(name);
+        REQUIRE(batched.Train(*train_ds, json) == knowhere::Status::success);
+        auto xb = (const float*)train_ds->GetTensor();
+        for (int64_t begin = 0; begin < nb; begin += nb / 4) {
+            auto batch_ds = knowhere::GenDataSet(nb / 4, dim, xb + begin * dim);
+            REQUIRE(batched.Add(*batch_ds, json) == knowhere::Status::success);
+            knowhere::BinarySet batch_bs;
+            REQUIRE(batched.Serialize(batch_bs) == knowhere::Status::success);
+            if (refine) {
+                auto raw = batch_bs.GetByName(std::string(name) + "_RAW_DATA");
+                REQUIRE(raw->size == (begin + nb / 4) * dim * (int64_t)sizeof(float));
+                REQUIRE(std::equal(xb, xb + (begin + nb / 4) * dim, (const float*)raw->data.get()));
+            }
+        }
+        auto batched_results = batched.Search(*query_ds, json, nullptr);
+        REQUIRE(batched_results.has_value());
+        REQUIRE(std::equal(results.value()->GetIds(), results.value()->GetIds() + nq * topk,
+                           batched_results.value()->GetIds()));
+
+        // from file the raw vectors are read from their own file next to the index
+        auto dir = std::filesystem::current_path() / "fastscan_refine_test";
+        std::filesystem::create_directories(dir);
+        for (auto& [binary_name, binary] : bs.binary_map_) {
+            std::ofstream writer(dir / binary_name, std::ios::binary | std::ios::trunc);
+            writer.write((const char*)binary->data.get(), binary->size);
+        }
+        for (bool mmap : {false, true}) {
+            json["enable_mmap"] = mmap;
+            auto loaded = knowhere::IndexFactory::Instance().Create(name);
+            REQUIRE(loaded.DeserializeFromFile(dir / name, json) == knowhere::Status::success);
+            REQUIRE(loaded.HasRawData(metric) == idx.HasRawData(metric));
+            auto loaded_results = loaded.Search(*query_ds, json, nullptr);
+            REQUIRE(loaded_results.has_value());
+            REQUIRE(GetKNNRecall(*results.value(), *loaded_results.value()) == 1.0f);
+        }
+        if (refine) {
+            std::filesystem::remove(dir / (std::string(name) + "_RAW_DATA"));
+            auto loaded = knowhere::IndexFactory::Instance().Create(name);
+            REQUIRE(loaded.DeserializeFromFile(dir / name, json) == knowhere::Status::invalid_binary_set);
+            bs.binary_map_.erase(std::string(name) + "_RAW_DATA");
+            REQUIRE(loaded.Deserialize(bs) == knowhere::Status::invalid_binary_set);
+        }
+        std::filesystem::remove_all(dir);
+    }
+
     SECTION("Test IVFPQ with invalid params") {
         auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IVFPQ);
         uint32_t nb = 1000;
@@ -452,3 +715,52 @@ TEST_CASE("Test Mem Index With Binary Vector", "[bool metrics]") {
     }
 #endif
 }
+
+TEST_CASE("Test Zero-Copy Deserialize Alignment", "[float metrics]") {
+    const int64_t nb = 1000, nq = 10, dim = 16, k = 5;
+    auto train_ds = GenDataSet(nb, dim);
+    auto query_ds = GenDataSet(nq, dim);
+    auto xb = (const float*)train_ds->GetTensor();
+    auto xq = (const float*)query_ds->GetTensor();
+
+    faiss::IndexFlatL2 flat(dim);
+    flat.add(nb, xb);
+    faiss::IndexFlatL2 quantizer(dim);
+    faiss::IndexIVFScalarQuantizer ivf(&quantizer, dim, 16, faiss::QuantizerType::QT_8bit);
+    ivf.train(nb, xb);
+    ivf.add(nb, xb);
+
+    // the float payload of IndexFlat is not aligned in the binary, and the binary itself may start anywhere
+    auto offset = GENERATE(0, 1, 2, 3);
+    for (const faiss::Index* index : std::vector<const faiss::Index*>{&flat, &ivf}) {
+        CAPTURE(offset, index == &flat);
+        knowhere::MemoryIOWriter writer;
+        faiss::write_index(index, &writer);
+        std::unique_ptr<uint8_t[]> written(writer.data_);
+        std::shared_ptr<uint8_t[]> buf(new uint8_t[writer.rp + offset]);
+        std::copy_n(written.get(), writer.rp, buf.get() + offset);
+
+        knowhere::MemoryIOReader reader;
+        reader.data_ = buf.get() + offset;
+        reader.total = writer.rp;
+        reader.owner = buf;
+        std::unique_ptr<const faiss::Index> loaded(faiss::read_index(&reader, faiss::IO_FLAG_ZERO_COPY));
+        buf.reset();
+
+        const faiss::IndexFlat* loaded_flat = dynamic_cast<const faiss::IndexFlat*>(loaded.get());
+        if (loaded_flat == nullptr) {
+            auto loaded_ivf = dynamic_cast<const faiss::IndexIVF*>(loaded.get());
+            REQUIRE(loaded_ivf != nullptr);
+            loaded_flat = dynamic_cast<const faiss::IndexFlat*>(loaded_ivf->quantizer);
+        }
+        REQUIRE(loaded_flat != nullptr);
+        REQUIRE(reinterpret_cast<uintptr_t>(loaded_flat->get_xb()) % alignof(float) == 0);
+
+        std::vector<float> dis(nq * k), loaded_dis(nq * k);
+        std::vector<faiss::Index::idx_t> ids(nq * k), loaded_ids(nq * k);
+        index->search(nq, xq, k, dis.data(), ids.data());
+        loaded->search(nq, xq, k, loaded_dis.data(), loaded_ids.data());
+        REQUIRE(ids == loaded_ids);
+        REQUIRE(dis == loaded_dis);
+    }
+}
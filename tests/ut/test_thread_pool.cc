@@ -0,0 +1,161 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/generators/catch_generators.hpp"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/comp/thread_pool.h"
+#include "knowhere/factory.h"
+#include "utils.h"
+
+TEST_CASE("Test ThreadPool scheduling", "[thread pool]") {
+    auto pool = std::make_shared<knowhere::ThreadPool>(4);
+
+    SECTION("Test priority is inherited") {
+        knowhere::ThreadPool::ScopedTaskContext ctx(knowhere::TaskPriority::BUILD);
+        auto priority = pool->push([&]() {
+                                return pool->push([]() { return knowhere::ThreadPool::CurrentTaskContext().priority; })
+                                    .get();
+                            })
+                            .get();
+        REQUIRE(priority == knowhere::TaskPriority::BUILD);
+        REQUIRE(knowhere::ThreadPool::CurrentTaskContext().priority == knowhere::TaskPriority::BUILD);
+    }
+
+    SECTION("Test concurrency cap") {
+        constexpr size_t kCap = 2;
+        std::atomic<int32_t> running = 0;
+        std::atomic<int32_t> max_running = 0;
+        std::vector<folly::Future<folly::Unit>> futs;
+        {
+            knowhere::ThreadPool::ScopedTaskContext ctx(knowhere::TaskPriority::BATCH, kCap);
+            for (int i = 0; i < 32; ++i) {
+                futs.emplace_back(pool->push([&]() {
+                    auto now = ++running;
+                    auto prev = max_running.load();
+                    while (prev < now && !max_running.compare_exchange_weak(prev, now)) {
+                    }
+                    // a capped task runs without the cap, so waiting on a nested task must not deadlock
+                    pool->push([]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }).wait();
+                    --running;
+                }));
+            }
+        }
+        for (auto& fut : futs) {
+            fut.wait();
+        }
+        REQUIRE(max_running.load() <= static_cast<int32_t>(kCap));
+        REQUIRE(max_running.load() > 0);
+    }
+
+    SECTION("Test named pools") {
+        auto named = knowhere::ThreadPool::CreateThreadPool("test_named_pool", 2);
+        REQUIRE(named != nullptr);
+        REQUIRE(knowhere::ThreadPool::CreateThreadPool("test_named_pool", 3) == named);
+        REQUIRE(knowhere::ThreadPool::GetThreadPool("test_named_pool") == named);
+        REQUIRE(knowhere::ThreadPool::GetThreadPool("test_no_such_pool") == nullptr);
+    }
+
+    SECTION("Test parse priority") {
+        REQUIRE(knowhere::ThreadPool::ParseTaskPriority("interactive") == knowhere::TaskPriority::INTERACTIVE);
+        REQUIRE(knowhere::ThreadPool::ParseTaskPriority("batch") == knowhere::TaskPriority::BATCH);
+        REQUIRE(knowhere::ThreadPool::ParseTaskPriority("build") == knowhere::TaskPriority::BUILD);
+        REQUIRE(!knowhere::ThreadPool::ParseTaskPriority("urgent").has_value());
+    }
+}
+
+TEST_CASE("Test search with scheduling hints", "[thread pool]") {
+    const int64_t nb = 1000, nq = 10;
+    const int64_t dim = 64;
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = CopyDataSet(train_ds, nq);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = 5;
+
+    auto idx = knowhere::IndexFactory::Instance().Create(knowhere::IndexEnum::INDEX_FAISS_IDMAP);
+    REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+    auto gt = idx.Search(*query_ds, json, nullptr);
+    REQUIRE(gt.has_value());
+
+    json[knowhere::meta::TASK_PRIORITY] = "batch";
+    json[knowhere::meta::MAX_CONCURRENCY] = 2;
+    auto res = idx.Search(*query_ds, json, nullptr);
+    REQUIRE(res.has_value());
+    REQUIRE(GetKNNRecall(*gt.value(), *res.value()) == 1.0f);
+
+    json[knowhere::meta::TASK_PRIORITY] = "urgent";
+    res = idx.Search(*query_ds, json, nullptr);
+    REQUIRE(!res.has_value());
+    REQUIRE(res.error() == knowhere::Status::invalid_args);
+}
+
+TEST_CASE("Test search on a named thread pool", "[thread pool]") {
+    const int64_t nb = 1000, nq = 10;
+    const int64_t dim = 64;
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = CopyDataSet(train_ds, nq);
+
+    auto name = GENERATE(as<std::string>{}, knowhere::IndexEnum::INDEX_FAISS_IDMAP, knowhere::IndexEnum::INDEX_HNSW);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = 5;
+    json[knowhere::meta::RADIUS] = 10.0f;
+    json[knowhere::meta::RANGE_FILTER] = 0.0f;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 100;
+    json[knowhere::indexparam::EF] = 32;
+
+    auto idx = knowhere::IndexFactory::Instance().Create(name);
+    REQUIRE(idx.Build(*train_ds, json) == knowhere::Status::success);
+    auto gt = idx.Search(*query_ds, json, nullptr);
+    REQUIRE(gt.has_value());
+
+    // a single thread pool held by a blocker: the search can only finish once its per-query tasks get that thread
+    auto pool = knowhere::ThreadPool::CreateThreadPool("test_search_pool", 1);
+    REQUIRE(pool != nullptr);
+    folly::Promise<folly::Unit> release;
+    auto blocker = pool->push([fut = release.getSemiFuture()]() mutable { std::move(fut).get(); });
+
+    json[knowhere::meta::THREAD_POOL] = "test_search_pool";
+    auto search = std::async(std::launch::async, [&]() { return idx.Search(*query_ds, json, nullptr); });
+    auto range_search = std::async(std::launch::async, [&]() { return idx.RangeSearch(*query_ds, json, nullptr); });
+    REQUIRE(search.wait_for(std::chrono::milliseconds(200)) == std::future_status::timeout);
+    REQUIRE(range_search.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+
+    release.setValue();
+    blocker.wait();
+    auto res = search.get();
+    REQUIRE(res.has_value());
+    REQUIRE(GetKNNRecall(*gt.value(), *res.value()) == 1.0f);
+    REQUIRE(range_search.get().has_value());
+
+    json[knowhere::meta::THREAD_POOL] = "test_no_such_pool";
+    res = idx.Search(*query_ds, json, nullptr);
+    REQUIRE(!res.has_value());
+    REQUIRE(res.error() == knowhere::Status::invalid_args);
+    res = idx.RangeSearch(*query_ds, json, nullptr);
+    REQUIRE(!res.has_value());
+    REQUIRE(res.error() == knowhere::Status::invalid_args);
+    REQUIRE(res.what().find("test_no_such_pool") != std::string::npos);
+}
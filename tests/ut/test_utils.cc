@@ -9,14 +9,25 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include <random>
+#include <thread>
 #include <vector>
 
 #include "catch2/catch_approx.hpp"
 #include "catch2/catch_test_macros.hpp"
+#include "catch2/generators/catch_generators.hpp"
+#include "common/bitset_util.h"
+#include "common/concurrent_cache.h"
+#include "common/frequency_sketch.h"
 #include "knowhere/comp/time_recorder.h"
 #include "knowhere/heap.h"
 #include "knowhere/utils.h"
+#include "simd/distances_ref.h"
 #include "utils.h"
+#if defined(__x86_64__)
+#include "simd/distances_avx.h"
+#include "simd/distances_avx512.h"
+#endif
 
 namespace {
 const std::vector<size_t> kBitsetSizes{4, 8, 10, 64, 100, 500, 1024};
@@ -78,6 +89,133 @@ TEST_CASE("Test Bitset Generation", "[utils]") {
     }
 }
 
+TEST_CASE("Test Bitset Summary", "[utils]") {
+    const size_t size = GENERATE(as<size_t>{}, 10, 64, 1000, 4096, 10000);
+    const float ratio = GENERATE(0.0f, 0.01f, 0.5f, 0.95f, 1.0f);
+    const size_t num_filtered = size * ratio;
+    auto bitset_data = GenerateBitsetWithRandomTbitsSet(size, num_filtered);
+    knowhere::BitsetView bitset(bitset_data.data(), size);
+
+    std::vector<uint32_t> valid;
+    for (size_t i = 0; i < size; ++i) {
+        if (!bitset.test(i)) {
+            valid.push_back(i);
+        }
+    }
+
+    SECTION("Summary") {
+        knowhere::BitsetSummary summary(bitset);
+        REQUIRE(summary.filtered == num_filtered);
+        REQUIRE(summary.first_valid == (valid.empty() ? -1 : (int64_t)valid.front()));
+        REQUIRE(summary.last_valid == (valid.empty() ? -1 : (int64_t)valid.back()));
+        size_t total = 0;
+        for (size_t b = 0; b < summary.block_num(); ++b) {
+            size_t cnt = 0;
+            for (size_t i = b * summary.kBlockBits; i < b * summary.kBlockBits + summary.block_bits(b); ++i) {
+                cnt += bitset.test(i);
+            }
+            REQUIRE(summary.block_filtered[b] == cnt);
+            total += summary.block_bits(b);
+        }
+        REQUIRE(total == size);
+        REQUIRE(bitset.WithSummary(&summary).count() == bitset.count());
+    }
+
+    SECTION("Valid Ids") {
+        using ValidIdsFunc = size_t (*)(const uint8_t*, size_t, size_t, uint32_t*);
+        std::vector<ValidIdsFunc> funcs{faiss::bitset_valid_ids_ref};
+#if defined(__x86_64__)
+        if (faiss::cpu_support_avx2()) {
+            funcs.push_back(faiss::bitset_valid_ids_avx);
+        }
+        if (faiss::cpu_support_avx512()) {
+            funcs.push_back(faiss::bitset_valid_ids_avx512);
+        }
+#endif
+        for (auto func : funcs) {
+            for (size_t begin : {size_t(0), size_t(3), size / 3}) {
+                std::vector<uint32_t> ids(size);
+                auto cnt = func(bitset.data(), begin, size, ids.data());
+                ids.resize(cnt);
+                std::vector<uint32_t> expected(std::lower_bound(valid.begin(), valid.end(), begin), valid.end());
+                REQUIRE(ids == expected);
+            }
+        }
+    }
+
+    SECTION("For Each Valid Id") {
+        knowhere::BitsetSummary summary(bitset);
+        for (auto view : {bitset, bitset.WithSummary(&summary)}) {
+            // ids past the end of the bitset are valid
+            std::vector<uint32_t> ids;
+            knowhere::ForEachValidId(view, size + 5, [&](size_t id) { ids.push_back(id); });
+            auto expected = valid;
+            for (size_t i = size; i < size + 5; ++i) {
+                expected.push_back(i);
+            }
+            REQUIRE(ids == expected);
+        }
+    }
+
+    SECTION("Filter Strategy") {
+        knowhere::BitsetSummary summary(bitset);
+        auto strategy = knowhere::ChooseFilterStrategy(bitset.WithSummary(&summary), size, 0.02f, 0.9f);
+        if (num_filtered == 0) {
+            REQUIRE(strategy == knowhere::FilterStrategy::NONE);
+        } else if (num_filtered == size) {
+            REQUIRE(strategy == knowhere::FilterStrategy::ALL_FILTERED);
+        } else if (num_filtered >= size * 0.9f) {
+            REQUIRE(strategy == knowhere::FilterStrategy::BRUTE_FORCE);
+        } else if (num_filtered < size * 0.02f) {
+            REQUIRE(strategy == knowhere::FilterStrategy::POST_FILTER);
+        } else {
+            REQUIRE(strategy == knowhere::FilterStrategy::PRE_FILTER);
+        }
+        REQUIRE(knowhere::ChooseFilterStrategy(nullptr, size, 0.02f, 0.9f) == knowhere::FilterStrategy::NONE);
+    }
+}
+
+TEST_CASE("Test PQ Blocked Lookup", "[utils]") {
+    const size_t n = GENERATE(as<size_t>{}, 1, 15, 16, 17, 40, 512);
+    const size_t nchunks = GENERATE(as<size_t>{}, 1, 3, 32);
+    std::mt19937 rng(n * 131 + nchunks);
+    std::vector<float> tables(nchunks * 256);
+    for (auto& v : tables) {
+        v = (rng() % 1000) / 8.0f;
+    }
+    // the codes of the unused lanes of the last block are random as well
+    std::vector<uint8_t> codes((n + 15) / 16 * 16 * nchunks);
+    for (auto& v : codes) {
+        v = rng();
+    }
+    std::vector<float> expected(n, 0.0f);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t c = 0; c < nchunks; ++c) {
+            expected[i] += tables[c * 256 + codes[(i / 16) * 16 * nchunks + c * 16 + i % 16]];
+        }
+    }
+
+    using LookupFunc = void (*)(const uint8_t*, size_t, size_t, const float*, float*);
+    std::vector<LookupFunc> funcs{faiss::pq_lookup_blocked_ref};
+#if defined(__x86_64__)
+    if (faiss::cpu_support_avx2()) {
+        funcs.push_back(faiss::pq_lookup_blocked_avx);
+    }
+    if (faiss::cpu_support_avx512()) {
+        funcs.push_back(faiss::pq_lookup_blocked_avx512);
+    }
+#endif
+    for (auto func : funcs) {
+        // one more slot that must not be written
+        std::vector<float> dis(n + 1, -1.0f);
+        func(codes.data(), n, nchunks, tables.data(), dis.data());
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(dis[i] == Catch::Approx(expected[i]));
+        }
+        REQUIRE(dis[n] == -1.0f);
+    }
+}
+
 namespace {
 constexpr size_t kHeapSize = 10;
 constexpr size_t kElementCount = 10000;
@@ -108,3 +246,96 @@ TEST_CASE("Test Time Recorder") {
     auto span = tr.ElapseFromBegin("done");
     REQUIRE(span > 0);
 }
+
+TEST_CASE("Test Concurrent Cache", "[utils]") {
+    knowhere::concurrent_cache<uint64_t, uint32_t> cache(100);
+    REQUIRE(cache.capacity() == 128);
+
+    uint32_t val = 0;
+    REQUIRE_FALSE(cache.try_get(5, val));
+    cache.put(5, 7);
+    REQUIRE(cache.try_get(5, val));
+    REQUIRE(val == 7);
+    cache.put(5, 8);
+    REQUIRE(cache.try_get(5, val));
+    REQUIRE(val == 8);
+    REQUIRE(cache.hits() == 2);
+    REQUIRE(cache.misses() == 1);
+
+    // a racing reader either misses or sees a consistent key/value pair
+    std::vector<std::thread> threads;
+    std::vector<int> failures(8, 0);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t i = 0; i < 100000; ++i) {
+                uint64_t key = (i * 7 + t) % 1000;
+                uint32_t got;
+                cache.put(key, key * 3);
+                if (cache.try_get(key, got) && got != key * 3) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (auto f : failures) {
+        REQUIRE(f == 0);
+    }
+
+    cache.resize(0);
+    cache.put(5, 7);
+    REQUIRE_FALSE(cache.try_get(5, val));
+}
+
+TEST_CASE("Test Frequency Sketch", "[utils]") {
+    knowhere::FrequencySketch sketch(1000);
+    REQUIRE(sketch.width() == 1024);
+    REQUIRE(sketch.estimate(3) == 0);
+
+    // a few hot keys over a background of cold ones, added from several threads
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (uint32_t i = 0; i < 10000; ++i) {
+                sketch.add(i % 10);
+                sketch.add(100 + i);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    // never undercounts, and the cold keys stay far below the hot ones
+    for (uint32_t key = 0; key < 10; ++key) {
+        REQUIRE(sketch.estimate(key) >= 4000);
+    }
+    uint32_t cold_max = 0;
+    for (uint32_t key = 100; key < 10100; ++key) {
+        REQUIRE(sketch.estimate(key) >= 4);
+        cold_max = std::max(cold_max, sketch.estimate(key));
+    }
+    REQUIRE(cold_max < 4000);
+
+    auto before = sketch.estimate(0);
+    sketch.halve();
+    REQUIRE(sketch.estimate(0) == before / 2);
+}
+
+TEST_CASE("Test DataSet", "[utils]") {
+    auto ids = new int64_t[4]{0, 1, 2, 3};
+    auto dis = new float[4]{0.0f, 1.0f, 2.0f, 3.0f};
+    auto ds = knowhere::GenResultDataSet(2, 2, ids, dis);
+    REQUIRE(ds->GetRows() == 2);
+    REQUIRE(ds->GetDim() == 2);
+    REQUIRE(ds->GetIds() == ids);
+    REQUIRE(ds->GetDistance() == dis);
+    REQUIRE(ds->GetTensor() == nullptr);
+    REQUIRE(ds->GetLims() == nullptr);
+    REQUIRE(ds->GetJsonInfo().empty());
+
+    ds->Set("nprobe", int64_t(16));
+    REQUIRE(ds->Get<int64_t>("nprobe") == 16);
+    REQUIRE(ds->Get<int64_t>("no_such_key") == 0);
+}
@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <atomic>
+#include <utility>
 
 #ifndef _WINDOWS
 #include <fcntl.h>
@@ -99,4 +100,21 @@ class AlignedFileReader {
   // async reads
   virtual void get_submitted_req(io_context_t &ctx, size_t n_ops) = 0;
   virtual void submit_req( io_context_t &ctx, std::vector<AlignedRead> &read_reqs) = 0;
+  // wait until at least min_nr reads issued by submit_req() are done and
+  // append the bufs of up to max_nr finished reads to done_bufs. A failed read
+  // throws, but only after all reaped bufs have been appended
+  virtual void get_completed_req(io_context_t &ctx, size_t min_nr,
+                                 size_t max_nr,
+                                 std::vector<void *> &done_bufs) = 0;
+  // how many reads one context can have in flight
+  virtual size_t max_in_flight() {
+    return MAX_IO_DEPTH;
+  }
+
+  // long-lived read buffers (e.g. per-thread sector scratch) that readers may
+  // pin up front; reads into other buffers must keep working.
+  // call before the first get_ctx()
+  virtual void register_buffers(
+      const std::vector<std::pair<void *, uint64_t>> &bufs) {
+  }
 };
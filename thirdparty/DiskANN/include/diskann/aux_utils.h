@@ -99,9 +99,10 @@ namespace diskann {
    * parameter cannot be generated successfully, it is set to -1.*/
   template<typename T>
   DISKANN_DLLEXPORT std::unique_ptr<diskann::Index<T>> build_merged_vamana_index(
-      std::string base_file, diskann::Metric _compareMetric, unsigned L,
-      unsigned R, bool accelerate_build, double sampling_rate,
-      double ram_budget, std::string mem_index_path, std::string medoids_file,
+      const PreppedBaseReader<T> &base_reader, bool ip_prepared,
+      diskann::Metric _compareMetric, unsigned L, unsigned R,
+      bool accelerate_build, double sampling_rate, double ram_budget,
+      std::string mem_index_path, std::string medoids_file,
       std::string centroids_file);
 
   template<typename T>
@@ -151,4 +152,19 @@ namespace diskann {
       const std::string output_file,
       const std::string reorder_data_file = std::string(""));
 
+  // the points of base_reader with the graph saved in mem_index_file
+  template<typename T>
+  DISKANN_DLLEXPORT void create_disk_layout(
+      const PreppedBaseReader<T> &base_reader, const std::string mem_index_file,
+      const std::string               output_file,
+      const PreppedBaseReader<float> *reorder_reader = nullptr);
+
+  // the points of base_reader with a graph in memory, no graph file needed
+  template<typename T>
+  DISKANN_DLLEXPORT void create_disk_layout(
+      const PreppedBaseReader<T>               &base_reader,
+      const std::vector<std::vector<unsigned>> &graph, const unsigned medoid,
+      const std::string               output_file,
+      const PreppedBaseReader<float> *reorder_reader = nullptr);
+
 }  // namespace diskann
@@ -146,6 +146,10 @@ namespace diskann {
                                  Parameters  &parameters,
                                  const char  *tag_filename);
 
+    // builds on all the points of base_reader, prepped as they are read
+    DISKANN_DLLEXPORT void build(const PreppedBaseReader<T> &base_reader,
+                                 Parameters                 &parameters);
+
     // Added search overload that takes L as parameter, so that we
     // can customize L on a per-query basis without tampering with "Parameters"
     template<typename IDType>
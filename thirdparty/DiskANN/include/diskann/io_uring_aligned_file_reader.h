@@ -0,0 +1,100 @@
+#pragma once
+#if !defined(_WINDOWS) && defined(KNOWHERE_WITH_IO_URING)
+
+#include <liburing.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "aligned_file_reader.h"
+
+// AlignedFileReader on top of io_uring.
+//
+// Every thread that calls get_ctx() gets its own ring, so no context is ever
+// shared or waited for. The returned IOContext is that ring and must only be
+// used by the calling thread; put_ctx() is a no-op and rings, with their
+// registered buffers, live until the reader is closed. A reader searched from
+// a pool of N threads thus holds at most N rings. Each thread keeps a small
+// thread_local cache of its rings, so get_ctx() only takes ctx_mut the first
+// time a thread reads from a reader. Buffers handed to register_buffers() are registered with each ring
+// and reads into them go through IORING_OP_READ_FIXED, which skips pinning
+// the pages on every request. With sqpoll enabled the first ring of a reader
+// owns a kernel submission thread and the other rings attach to it.
+class IoUringAlignedFileReader : public AlignedFileReader {
+ public:
+  static constexpr unsigned kDefaultQueueDepth =
+      256;  // sync this with diskann MAX_N_SECTOR_READS
+
+  // settings for readers created afterwards
+  static void InitGlobalConfig(bool sqpoll, unsigned queue_depth);
+
+  // whether the running kernel allows creating a ring at all, io_uring may be
+  // compiled out, disabled by sysctl or blocked by seccomp
+  static bool is_supported();
+
+  IoUringAlignedFileReader();
+  ~IoUringAlignedFileReader();
+
+  IOContext get_ctx() override;
+
+  void put_ctx(IOContext ctx) override {
+  }
+
+  // Open & close ops
+  // Blocking calls
+  void open(const std::string &fname) override;
+  void close() override;
+
+  // process batch of aligned requests in parallel
+  // NOTE :: blocking call
+  void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx,
+            bool async = false) override;
+
+  // async reads
+  void get_submitted_req(IOContext &ctx, size_t n_ops) override;
+  void submit_req(IOContext &ctx, std::vector<AlignedRead> &read_reqs) override;
+  void get_completed_req(IOContext &ctx, size_t min_nr, size_t max_nr,
+                         std::vector<void *> &done_bufs) override;
+
+  size_t max_in_flight() override {
+    return queue_depth;
+  }
+
+  void register_buffers(
+      const std::vector<std::pair<void *, uint64_t>> &bufs) override;
+
+ private:
+  struct Ring;
+
+  Ring *create_ring();
+  void  submit(Ring *ring, const AlignedRead *reqs, size_t n_ops);
+  void  flush(Ring *ring, size_t n_ops);
+  size_t reap(Ring *ring, size_t min_nr, size_t max_nr,
+              std::vector<void *> *done_bufs);
+  int   find_fixed_buf(const AlignedRead &req) const;
+
+  FileHandle file_desc = -1;
+  bool       sqpoll;
+  unsigned   queue_depth;
+
+  // registered buffers, sorted by address
+  std::vector<struct iovec> fixed_bufs;
+
+  // guarded by ctx_mut
+  tsl::robin_map<std::thread::id, std::unique_ptr<Ring>> rings;
+  int                                                    sq_owner_fd = -1;
+  // identifies the current set of rings in thread_local caches, replaced on
+  // close() so that no thread can hit a ring that is gone. Never reused,
+  // not even by another reader at the same address
+  std::atomic<uint64_t> generation;
+
+  inline static bool       global_sqpoll = false;
+  inline static unsigned   global_queue_depth = kDefaultQueueDepth;
+  inline static std::mutex global_config_mut;
+};
+
+#endif
@@ -39,6 +39,12 @@ class LinuxAlignedFileReader : public AlignedFileReader {
   // async reads
   void get_submitted_req (io_context_t &ctx, size_t n_ops) override;
   void submit_req(io_context_t &ctx, std::vector<AlignedRead> &read_reqs);
+  void get_completed_req(io_context_t &ctx, size_t min_nr, size_t max_nr,
+                         std::vector<void *> &done_bufs) override;
+
+  size_t max_in_flight() override {
+    return ctx_pool_->max_events_per_ctx();
+  }
 };
 
 #endif
@@ -23,6 +23,12 @@ template<typename T>
 void gen_random_slice(const std::string data_file, double p_val,
                       float *&sampled_data, size_t &slice_size, size_t &ndims);
 
+// samples the points of base_reader, prepped as they are read
+template<typename T>
+void gen_random_slice(const diskann::PreppedBaseReader<T> &base_reader,
+                      double p_val, float *&sampled_data, size_t &slice_size,
+                      size_t &ndims);
+
 template<typename T>
 void gen_random_slice(const T *inputdata, size_t npts, size_t ndims,
                       double p_val, float *&sampled_data, size_t &slice_size);
@@ -43,11 +49,22 @@ int shard_data_into_clusters_only_ids(const std::string data_file,
                                       const size_t dim, const size_t k_base,
                                       std::string prefix_path);
 
+template<typename T>
+int shard_data_into_clusters_only_ids(
+    const diskann::PreppedBaseReader<T> &base_reader, float *pivots,
+    const size_t num_centers, const size_t dim, const size_t k_base,
+    std::string prefix_path);
+
 template<typename T>
 int retrieve_shard_data_from_ids(const std::string data_file,
                                  std::string       idmap_filename,
                                  std::string       data_filename);
 
+template<typename T>
+int retrieve_shard_data_from_ids(
+    const diskann::PreppedBaseReader<T> &base_reader,
+    std::string idmap_filename, std::string data_filename);
+
 template<typename T>
 int partition(const std::string data_file, const float sampling_rate,
               size_t num_centers, size_t max_k_means_reps,
@@ -59,6 +76,12 @@ int partition_with_ram_budget(const std::string data_file,
                               size_t            graph_degree,
                               const std::string prefix_path, size_t k_base);
 
+template<typename T>
+int partition_with_ram_budget(const diskann::PreppedBaseReader<T> &base_reader,
+                              const double sampling_rate, double ram_budget,
+                              size_t            graph_degree,
+                              const std::string prefix_path, size_t k_base);
+
 DISKANN_DLLEXPORT int generate_pq_pivots(
     const float *train_data, size_t num_train, unsigned dim,
     unsigned num_centers, unsigned num_pq_chunks, unsigned max_k_means_reps,
@@ -69,3 +92,9 @@ int generate_pq_data_from_pivots(const std::string data_file,
                                  unsigned num_centers, unsigned num_pq_chunks,
                                  std::string pq_pivots_path,
                                  std::string pq_compressed_vectors_path);
+
+template<typename T>
+int generate_pq_data_from_pivots(
+    const diskann::PreppedBaseReader<T> &base_reader, unsigned num_centers,
+    unsigned num_pq_chunks, std::string pq_pivots_path,
+    std::string pq_compressed_vectors_path);
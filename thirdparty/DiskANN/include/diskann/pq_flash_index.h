@@ -2,13 +2,20 @@
 // Licensed under the MIT license.
 
 #pragma once
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <sstream>
 #include <stack>
 #include <string>
-#include "common/lru_cache.h"
+#include <thread>
+#include "common/concurrent_cache.h"
+#include "common/frequency_sketch.h"
 #include "tsl/robin_map.h"
 #include "tsl/robin_set.h"
 
@@ -104,6 +111,42 @@ namespace diskann {
         const float                                      filter_ratio = -1.0f,
         const bool                                       for_tuning = false);
 
+    // Beam search of nq queries (query i at queries + i * query_stride) that
+    // never waits for a whole beam. Each query keeps up to beam_width sector
+    // reads in flight and expands a node as soon as its sector arrives, so the
+    // next reads go out while the rest of the beam is still on disk. Up to
+    // pipeline_width queries share the io context of the calling thread and
+    // are interleaved on it, every query holds its own ThreadData. Results
+    // go to res_ids / res_dists + i * k_search. Reordering, stats and feder
+    // are not supported; filters that fall back to brute force run each
+    // query through cached_beam_search().
+    DISKANN_DLLEXPORT void pipelined_beam_search(
+        const T *queries, const _u64 nq, const _u64 query_stride,
+        const _u64 k_search, const _u64 l_search, _s64 *res_ids,
+        float *res_dists, const _u64 beam_width, const _u64 pipeline_width,
+        knowhere::BitsetView bitset_view = nullptr,
+        const float filter_ratio = -1.0f, const bool for_tuning = false);
+
+    // receives a batch of range search hits: ids, distances and their number
+    using RangeSearchCallback =
+        std::function<void(const _s64 *, const float *, const _u64)>;
+
+    // Range search: all neighbors within distance of range. The beam search
+    // starts with a candidate list of l_k_ratio * min_l_search and doubles
+    // it, up to l_k_ratio * max_l_search, while at least half of the best
+    // l_search results are in range. A longer list resumes the search where
+    // the previous one stopped: expanded nodes are not read again and the
+    // candidates that did not fit the shorter list are put back into it. If
+    // no such candidate is left the search stops early. The hits are passed
+    // to emit in batches, best first; returns their number.
+    DISKANN_DLLEXPORT _u32 range_search(
+        const T *query1, const double range, const _u64 min_l_search,
+        const _u64 max_l_search, const RangeSearchCallback &emit,
+        const _u64 beam_width, const float l_k_ratio,
+        knowhere::BitsetView bitset_view = nullptr,
+        QueryStats          *stats = nullptr);
+
+    // same as above, the hits are written to indices and distances
     DISKANN_DLLEXPORT _u32 range_search(
         const T *query1, const double range, const _u64 min_l_search,
         const _u64 max_l_search, std::vector<_s64> &indices,
@@ -128,6 +171,29 @@ namespace diskann {
 
     DISKANN_DLLEXPORT diskann::Metric get_metric() const noexcept;
 
+    // resize the query -> entry medoid cache, 0 disables it. Call before
+    // serving queries.
+    DISKANN_DLLEXPORT void set_entry_cache_size(size_t size);
+
+    DISKANN_DLLEXPORT _u64 get_entry_cache_hits() const noexcept;
+
+    DISKANN_DLLEXPORT _u64 get_entry_cache_misses() const noexcept;
+
+    // Lets the node cache follow the traffic: searches count their node
+    // visits, and every refresh_queries searches a background thread moves
+    // the most visited nodes into the cache in place of the least visited
+    // ones. The number of cached nodes stays the one of load_cache_list().
+    // 0 keeps the cache static. Call after load_cache_list() and before
+    // serving queries.
+    DISKANN_DLLEXPORT void enable_adaptive_cache(_u64 refresh_queries);
+
+    // node visits served from the node cache and read from disk
+    DISKANN_DLLEXPORT _u64 get_node_cache_hits() const noexcept;
+
+    DISKANN_DLLEXPORT _u64 get_node_cache_misses() const noexcept;
+
+    DISKANN_DLLEXPORT _u64 get_node_cache_refreshes() const noexcept;
+
    protected:
     DISKANN_DLLEXPORT void use_medoids_data_as_centroids();
     DISKANN_DLLEXPORT void setup_thread_data(_u64 nthreads);
@@ -153,6 +219,97 @@ namespace diskann {
     // If there is no value, there is nothing to do with the given query
     std::optional<float> init_thread_data(ThreadData<T> &data, const T *query1);
 
+    // Candidate list of a beam search. Range search keeps it between rounds
+    // so that a longer list continues the walk instead of restarting it.
+    struct BeamSearchState {
+      // sorted by PQ distance, at least l_search + 1 entries
+      std::vector<Neighbor> retset;
+      unsigned              cur_list_size = 0;
+      // best position in retset that may still hold an unexpanded node
+      unsigned k = 0;
+      // expanded nodes with their full precision distance
+      std::vector<Neighbor> full_retset;
+      // if set, unexpanded candidates that did not fit into a full retset
+      // are kept in dropped
+      bool                  keep_dropped = false;
+      std::vector<Neighbor> dropped;
+      double                io_us = 0;
+    };
+
+    // Fills the PQ distance table of the query in data and seeds state with
+    // the entry point. Returns the hash of the query for the entry cache.
+    uint64_t init_beam_search(ThreadData<T> &data, BeamSearchState &state,
+                              const bool for_tuning);
+
+    // Marks the candidate at pos of state as expanded and moves pos past it.
+    // A candidate filtered out by bitset_view is removed from the list
+    // instead. Returns the id of the candidate.
+    unsigned take_candidate(BeamSearchState &state, unsigned &pos,
+                            knowhere::BitsetView bitset_view);
+
+    // Adds the full precision distance of node id to state and inserts its
+    // unvisited neighbors into the candidate list by PQ distance. Returns the
+    // best position a neighbor was inserted at, cur_list_size if none was.
+    unsigned expand_node(
+        ThreadData<T> &data, BeamSearchState &state, const unsigned id,
+        const T *coords, const _u64 nnbrs, const unsigned *nbrs,
+        const _u64 l_search, QueryStats *stats,
+        const knowhere::feder::diskann::FederResultUniq &feder,
+        knowhere::BitsetView                             bitset_view);
+
+    // Expands the closest unexpanded candidates of state, up to beam_width
+    // per round trip to the disk, until the first l_search candidates are
+    // all expanded.
+    void expand_candidates(
+        ThreadData<T> &data, IOContext &ctx, BeamSearchState &state,
+        const _u64 l_search, const _u64 beam_width, QueryStats *stats,
+        const knowhere::feder::diskann::FederResultUniq &feder,
+        knowhere::BitsetView                             bitset_view);
+
+    // Nodes kept in memory, id -> data in nhood_cache_buf and coord_cache_buf.
+    // A published cache is never modified: searches load the current one
+    // once and keep it, refresh_node_cache() publishes new ones.
+    struct NodeCache {
+      // <id, <neihbors_num, neihbors>>
+      tsl::robin_map<_u32, std::pair<_u32, _u32 *>> nhood;
+      tsl::robin_map<_u32, T *>                      coord;
+    };
+
+    std::shared_ptr<const NodeCache> get_node_cache() const {
+      return std::atomic_load(&node_cache);
+    }
+
+    // Reads the nodes of ids from disk into the cache slots of the same
+    // position and adds them to cache.
+    void load_nodes_to_cache(const std::vector<_u32> &ids,
+                             const std::vector<_u64> &slots, NodeCache &cache);
+
+    // Counts a visit of node id for the adaptive cache, a miss also makes id
+    // a candidate for the next refresh.
+    void record_node_access(const _u32 id, const bool hit) {
+      node_access_sketch->add(id);
+      if (!hit) {
+        auto pos = recent_misses_pos.fetch_add(1, std::memory_order_relaxed);
+        recent_misses[pos % recent_misses_size].store(
+            id, std::memory_order_relaxed);
+      }
+    }
+
+    // Adds the cache hits and misses of a search to the counters.
+    void count_node_cache_accesses(const _u64 hits, const _u64 misses);
+
+    // Looks up the medoid cached for a query. A lookup of an enabled cache
+    // is also counted in the prometheus metrics.
+    bool get_cached_entry_point(const _u64 vec_hash, _u32 &medoid) const;
+
+    // Called once per nq finished queries, wakes up the refresher when a
+    // refresh is due.
+    void maybe_refresh_node_cache(const _u64 nq);
+
+    // Replaces the cached nodes that were visited less than the nodes that
+    // missed recently. Runs on the refresher thread.
+    void refresh_node_cache();
+
     // Brute force search for the given query. Use beam search rather than
     // sending whole bunch of requests at once to avoid all threads sending I/O
     // requests and the time overlaps.
@@ -253,14 +410,30 @@ namespace diskann {
     // closest centroid as the starting point of search
     float *centroid_data = nullptr;
 
-    // nhood_cache
+    // neighborhoods of the cached nodes, max_degree + 1 per slot
     unsigned *nhood_cache_buf = nullptr;
-    tsl::robin_map<_u32, std::pair<_u32, _u32 *>>
-        nhood_cache;  // <id, <neihbors_num, neihbors>>
-
-    // coord_cache
-    T                        *coord_cache_buf = nullptr;
-    tsl::robin_map<_u32, T *> coord_cache;
+    // coordinates of the cached nodes, aligned_dim per slot
+    T   *coord_cache_buf = nullptr;
+    _u64 node_cache_slots = 0;
+    // the cached nodes, always set. Use get_node_cache() from searches.
+    std::shared_ptr<const NodeCache> node_cache;
+    std::atomic<_u64>                node_cache_hits{0};
+    std::atomic<_u64>                node_cache_misses{0};
+
+    // adaptive node cache, see enable_adaptive_cache()
+    _u64                                       cache_refresh_queries = 0;
+    std::unique_ptr<knowhere::FrequencySketch> node_access_sketch;
+    // ring of the last missed nodes, the candidates to enter the cache
+    std::unique_ptr<std::atomic<_u32>[]> recent_misses;
+    _u64                                 recent_misses_size = 0;
+    std::atomic<_u64>                    recent_misses_pos{0};
+    std::atomic<_u64>                    queries_since_refresh{0};
+    std::atomic<_u64>                    node_cache_refreshes{0};
+    std::mutex                           cache_refresh_mutex;
+    std::condition_variable              cache_refresh_cv;
+    bool                                 cache_refresh_pending = false;
+    bool                                 cache_refresh_stop = false;
+    std::thread                          cache_refresher;
 
     // thread-specific scratch
     ConcurrentQueue<ThreadData<T>> thread_data;
@@ -270,7 +443,8 @@ namespace diskann {
     bool                           reorder_data_exists = false;
     _u64                           reoreder_data_offset = 0;
 
-    mutable knowhere::lru_cache<uint64_t, uint32_t> lru_cache;
+    // query hash -> best medoid of the last search with that query
+    mutable knowhere::concurrent_cache<uint64_t, uint32_t> entry_cache;
 
 #ifdef EXEC_ENV_OLS
     // Set to a larger value than the actual header to accommodate
@@ -5,46 +5,34 @@
 
 #include "utils.h"
 #include "concurrent_queue.h"
+#include "simd/hook.h"
 #define NUM_PQ_CENTROIDS 256
+// points per block of the PQ code scratch, see faiss::pq_lookup_blocked
+#define PQ_LOOKUP_BLOCK 16
 
 namespace diskann {
+  // aggregate_coords() writes the codes in blocks of PQ_LOOKUP_BLOCK points,
+  // chunk-major within a block, which is the layout pq_dist_lookup() reads:
+  // a chunk of a whole block is one load of contiguous bytes. Scratch for
+  // n_ids codes must hold ROUND_UP(n_ids, PQ_LOOKUP_BLOCK) * ndims bytes.
   inline void aggregate_coords(const unsigned* ids, const _u64 n_ids,
                                const _u8* all_coords, const _u64 ndims,
                                _u8* out) {
     for (_u64 i = 0; i < n_ids; i++) {
-      memcpy(out + i * ndims, all_coords + ids[i] * ndims, ndims * sizeof(_u8));
+      const _u8* src = all_coords + ids[i] * ndims;
+      _u8*       dst = out + (i / PQ_LOOKUP_BLOCK) * PQ_LOOKUP_BLOCK * ndims +
+                 i % PQ_LOOKUP_BLOCK;
+      for (_u64 chunk = 0; chunk < ndims; chunk++) {
+        dst[chunk * PQ_LOOKUP_BLOCK] = src[chunk];
+      }
     }
   }
 
+  // pq_ids as written by aggregate_coords()
   inline void pq_dist_lookup(const _u8* pq_ids, const _u64 n_pts,
                              const _u64 pq_nchunks, const float* pq_dists,
                              float* dists_out) {
-#if defined(__ARM_NEON) && defined(__aarch64__)
-    __builtin_prefetch((char*) dists_out, 1, 3);
-    __builtin_prefetch((char*) pq_ids, 0, 3);
-    __builtin_prefetch((char*) (pq_ids + 64), 0, 3);
-    __builtin_prefetch((char*) (pq_ids + 128), 0, 3);
-#else
-    _mm_prefetch((char*) dists_out, _MM_HINT_T0);
-    _mm_prefetch((char*) pq_ids, _MM_HINT_T0);
-    _mm_prefetch((char*) (pq_ids + 64), _MM_HINT_T0);
-    _mm_prefetch((char*) (pq_ids + 128), _MM_HINT_T0);
-#endif
-    memset(dists_out, 0, n_pts * sizeof(float));
-    for (_u64 chunk = 0; chunk < pq_nchunks; chunk++) {
-      const float* chunk_dists = pq_dists + 256 * chunk;
-      if (chunk < pq_nchunks - 1) {
-#if defined(__ARM_NEON) && defined(__aarch64__)
-        __builtin_prefetch((char*) (chunk_dists + 256), 0, 3);
-#else
-        _mm_prefetch((char*) (chunk_dists + 256), _MM_HINT_T0);
-#endif
-      }
-      for (_u64 idx = 0; idx < n_pts; idx++) {
-        _u8 pq_centerid = pq_ids[pq_nchunks * idx + chunk];
-        dists_out[idx] += chunk_dists[pq_centerid];
-      }
-    }
+    faiss::pq_lookup_blocked(pq_ids, n_pts, pq_nchunks, pq_dists, dists_out);
   }
 
   class FixedChunkPQTable {
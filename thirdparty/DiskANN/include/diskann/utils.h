@@ -837,6 +837,125 @@ namespace diskann {
     return norms;
   }
 
+  // Hands out the points of a base file with the preprocessing of the metric
+  // applied while reading, so that a build never writes a prepped copy:
+  // INNER_PRODUCT points get the extra coordinate of
+  // prepare_base_for_inner_products, COSINE points are normalized as by
+  // prepare_base_for_cosine, L2 points are read as they are. The constructor
+  // makes the one pass over the file that the max norm (INNER_PRODUCT) or the
+  // norms (COSINE) take. read() opens a stream of its own, so threads may
+  // share a reader.
+  template<typename T>
+  class PreppedBaseReader {
+   public:
+    static constexpr size_t kBlockSize = 100000;
+
+    explicit PreppedBaseReader(const std::string& base_file,
+                               Metric             metric = Metric::L2)
+        : _base_file(base_file), _metric(metric) {
+      get_bin_metadata(base_file, _npts, _base_dim);
+      _dim = metric == Metric::INNER_PRODUCT ? _base_dim + 1 : _base_dim;
+      if (metric == Metric::L2) {
+        return;
+      }
+      if (metric == Metric::COSINE) {
+        _norms.resize(_npts);
+      }
+      const size_t         block_size = (std::min)(_npts, kBlockSize);
+      std::unique_ptr<T[]> block = std::make_unique<T[]>(block_size * _dim);
+      for (size_t start = 0; start < _npts; start += block_size) {
+        const size_t n = (std::min)(block_size, _npts - start);
+        read_raw(start, n, block.get());
+        for (size_t p = 0; p < n; p++) {
+          const float norm = row_norm(block.get() + p * _base_dim);
+          _max_norm = (std::max)(_max_norm, norm);
+          if (metric == Metric::COSINE) {
+            _norms[start + p] = norm;
+          }
+        }
+      }
+    }
+
+    size_t npts() const {
+      return _npts;
+    }
+
+    // dimension of the points handed out, one more than the base file for
+    // INNER_PRODUCT
+    size_t dim() const {
+      return _dim;
+    }
+
+    float max_norm() const {
+      return _max_norm;
+    }
+
+    // norms of the base points, COSINE only
+    const std::vector<float>& norms() const {
+      return _norms;
+    }
+
+    // reads the points [start, start + n) into out, n * dim() values
+    void read(size_t start, size_t n, T* out) const {
+      read_raw(start, n, out);
+      if (_metric == Metric::L2) {
+        return;
+      }
+      // spread the rows backwards so that none is overwritten before it moved
+      for (size_t p = n; p-- > 0;) {
+        T* row = out + p * _dim;
+        if (_dim != _base_dim) {
+          std::memmove(row, out + p * _base_dim, _base_dim * sizeof(T));
+        }
+        const float norm = row_norm(row);
+        if (_metric == Metric::INNER_PRODUCT) {
+          if (_max_norm > 0) {
+            for (size_t j = 0; j < _base_dim; j++) {
+              row[j] = row[j] / _max_norm;
+            }
+          }
+          const float ratio = _max_norm > 0 ? norm / _max_norm : 0;
+          const float res = 1 - ratio * ratio;
+          row[_base_dim] = res <= 0 ? 0 : std::sqrt(res);
+        } else if (norm > 0) {
+          for (size_t j = 0; j < _base_dim; j++) {
+            row[j] = row[j] / norm;
+          }
+        }
+      }
+    }
+
+   private:
+    void read_raw(size_t start, size_t n, T* out) const {
+      std::ifstream reader;
+      reader.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+      try {
+        reader.open(_base_file, std::ios::binary);
+        reader.seekg(2 * sizeof(uint32_t) + start * _base_dim * sizeof(T),
+                     std::ios::beg);
+        reader.read((char*) out, n * _base_dim * sizeof(T));
+      } catch (std::system_error& e) {
+        throw FileException(_base_file, e, __FUNCSIG__, __FILE__, __LINE__);
+      }
+    }
+
+    float row_norm(const T* row) const {
+      float norm = 0;
+      for (size_t j = 0; j < _base_dim; j++) {
+        norm += (float) row[j] * (float) row[j];
+      }
+      return std::sqrt(norm);
+    }
+
+    std::string        _base_file;
+    Metric             _metric;
+    size_t             _npts = 0;
+    size_t             _base_dim = 0;
+    size_t             _dim = 0;
+    float              _max_norm = 0;
+    std::vector<float> _norms;
+  };
+
   // plain saves data as npts X ndims array into filename
   template<typename T>
   void save_Tvecs(const char* filename, T* data, size_t npts, size_t ndims) {
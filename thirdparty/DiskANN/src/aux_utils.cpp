@@ -508,12 +508,13 @@ namespace diskann {
 
   template<typename T>
   std::unique_ptr<diskann::Index<T>> build_merged_vamana_index(
-      std::string base_file, bool ip_prepared, diskann::Metric compareMetric,
-      unsigned L, unsigned R, bool accelerate_build, double sampling_rate,
-      double ram_budget, std::string mem_index_path, std::string medoids_file,
+      const PreppedBaseReader<T> &base_reader, bool ip_prepared,
+      diskann::Metric compareMetric, unsigned L, unsigned R,
+      bool accelerate_build, double sampling_rate, double ram_budget,
+      std::string mem_index_path, std::string medoids_file,
       std::string centroids_file) {
-    size_t base_num, base_dim;
-    diskann::get_bin_metadata(base_file, base_num, base_dim);
+    size_t base_num = base_reader.npts();
+    size_t base_dim = base_reader.dim();
 
     double full_index_ram =
         estimate_ram_usage(base_num, base_dim, sizeof(T), R);
@@ -535,8 +536,9 @@ namespace diskann {
       std::unique_ptr<diskann::Index<T>> _pvamanaIndex =
           std::unique_ptr<diskann::Index<T>>(new diskann::Index<T>(
               compareMetric, ip_prepared, base_dim, base_num, false, false));
-      _pvamanaIndex->build(base_file.c_str(), base_num, paras);
-      _pvamanaIndex->save(mem_index_path.c_str(), true);
+      // the caller lays the disk index out from the graph in memory, the
+      // graph is not saved
+      _pvamanaIndex->build(base_reader, paras);
 
       std::remove(medoids_file.c_str());
       std::remove(centroids_file.c_str());
@@ -544,7 +546,7 @@ namespace diskann {
     }
     std::string merged_index_prefix = mem_index_path + "_tempFiles";
     int         num_parts =
-        partition_with_ram_budget<T>(base_file, sampling_rate, ram_budget,
+        partition_with_ram_budget<T>(base_reader, sampling_rate, ram_budget,
                                      2 * R / 3, merged_index_prefix, 2);
 
     std::string cur_centroid_filepath = merged_index_prefix + "_centroids.bin";
@@ -557,7 +559,7 @@ namespace diskann {
       std::string shard_ids_file = merged_index_prefix + "_subshard-" +
                                    std::to_string(p) + "_ids_uint32.bin";
 
-      retrieve_shard_data_from_ids<T>(base_file, shard_ids_file,
+      retrieve_shard_data_from_ids<T>(base_reader, shard_ids_file,
                                       shard_base_file);
 
       std::string shard_index_file =
@@ -711,7 +713,8 @@ namespace diskann {
         auto pq_table_dists =
             std::shared_ptr<float[]>(new float[256 * aligned_dim]);
         auto scratch_dists = std::shared_ptr<float[]>(new float[R]);
-        auto scratch_ids = std::shared_ptr<_u8[]>(new _u8[R * aligned_dim]);
+        auto scratch_ids = std::shared_ptr<_u8[]>(
+            new _u8[ROUND_UP(R, PQ_LOOKUP_BLOCK) * aligned_dim]);
         pq_table.populate_chunk_distances(query_float.get(),
                                           pq_table_dists.get());
 
@@ -865,242 +868,285 @@ namespace diskann {
     return best_bw;
   }
 
-  template<typename T>
-  void create_disk_layout(const std::string base_file,
-                          const std::string mem_index_file,
-                          const std::string output_file,
-                          const std::string reorder_data_file) {
-    unsigned npts, ndims;
-
-    // amount to read or write in one shot
-    _u64            read_blk_size = 64 * 1024 * 1024;
-    _u64            write_blk_size = read_blk_size;
-    cached_ifstream base_reader(base_file, read_blk_size);
-    base_reader.read((char *) &npts, sizeof(uint32_t));
-    base_reader.read((char *) &ndims, sizeof(uint32_t));
-
-    size_t npts_64, ndims_64;
-    npts_64 = npts;
-    ndims_64 = ndims;
+  namespace {
+    // Hands out the points of a reader one by one, a block at a time.
+    template<typename T>
+    class PointCursor {
+     public:
+      explicit PointCursor(const PreppedBaseReader<T> &reader)
+          : _reader(reader),
+            _block_size((std::min)(reader.npts(),
+                                   (size_t) PreppedBaseReader<T>::kBlockSize)),
+            _block(std::make_unique<T[]>(_block_size * reader.dim())) {
+      }
 
-    // Check if we need to append data for re-ordering
-    bool          append_reorder_data = false;
-    std::ifstream reorder_data_reader;
+      const T *next() {
+        if (_pos == _block_end) {
+          _block_end = (std::min)(_pos + _block_size, _reader.npts());
+          _reader.read(_pos, _block_end - _pos, _block.get());
+          _block_start = _pos;
+        }
+        return _block.get() + (_pos++ - _block_start) * _reader.dim();
+      }
 
-    unsigned npts_reorder_file = 0, ndims_reorder_file = 0;
-    if (reorder_data_file != std::string("")) {
-      append_reorder_data = true;
-      size_t reorder_data_file_size = get_file_size(reorder_data_file);
-      reorder_data_reader.exceptions(std::ofstream::failbit |
-                                     std::ofstream::badbit);
-
-      try {
-        reorder_data_reader.open(reorder_data_file, std::ios::binary);
-        reorder_data_reader.read((char *) &npts_reorder_file, sizeof(unsigned));
-        reorder_data_reader.read((char *) &ndims_reorder_file,
-                                 sizeof(unsigned));
-        if (npts_reorder_file != npts)
+     private:
+      const PreppedBaseReader<T> &_reader;
+      size_t                      _block_size;
+      std::unique_ptr<T[]>        _block;
+      size_t                      _pos = 0;
+      size_t                      _block_start = 0;
+      size_t                      _block_end = 0;
+    };
+
+    // Writes the sectors of a disk index, each node holds its coordinates
+    // from base_reader and the neighbours that next_nhood(node, nnbrs,
+    // nhood) hands out. The full precision vectors of reorder_reader, if
+    // any, follow the nodes.
+    template<typename T, typename NhoodFunc>
+    void write_disk_layout(const PreppedBaseReader<T> &base_reader,
+                           unsigned width_u32, _u64 medoid,
+                           _u64 vamana_frozen_num, NhoodFunc &&next_nhood,
+                           const std::string               output_file,
+                           const PreppedBaseReader<float> *reorder_reader) {
+      // amount to write in one shot
+      _u64            write_blk_size = 64 * 1024 * 1024;
+      cached_ofstream diskann_writer(output_file, write_blk_size);
+      PointCursor<T>  base_cursor(base_reader);
+
+      _u64 npts_64 = base_reader.npts();
+      _u64 ndims_64 = base_reader.dim();
+
+      bool append_reorder_data = reorder_reader != nullptr;
+      _u64 ndims_reorder_file = 0;
+      if (append_reorder_data) {
+        if (reorder_reader->npts() != npts_64)
           throw ANNException(
               "Mismatch in num_points between reorder data file and base file",
               -1, __FUNCSIG__, __FILE__, __LINE__);
-        if (reorder_data_file_size != 8 + sizeof(float) *
-                                              (size_t) npts_reorder_file *
-                                              (size_t) ndims_reorder_file)
-          throw ANNException("Discrepancy in reorder data file size ", -1,
-                             __FUNCSIG__, __FILE__, __LINE__);
-      } catch (std::system_error &e) {
-        throw FileException(reorder_data_file, e, __FUNCSIG__, __FILE__,
-                            __LINE__);
+        ndims_reorder_file = reorder_reader->dim();
       }
-    }
-
-    // create cached reader + writer
-    size_t actual_file_size = get_file_size(mem_index_file);
-    LOG_KNOWHERE_INFO_ << "Vamana index file size: " << actual_file_size;
-    std::ifstream   vamana_reader(mem_index_file, std::ios::binary);
-    cached_ofstream diskann_writer(output_file, write_blk_size);
-
-    // metadata: width, medoid
-    unsigned width_u32, medoid_u32;
-    size_t   index_file_size;
 
-    vamana_reader.read((char *) &index_file_size, sizeof(uint64_t));
-    if (index_file_size != actual_file_size) {
-      std::stringstream stream;
-      stream << "Vamana Index file size does not match expected size per "
-                "meta-data."
-             << " file size from file: " << index_file_size
-             << " actual file size: " << actual_file_size << std::endl;
+      // compute
+      _u64 max_node_len, vamana_frozen_loc = 0;
+      _u64 nsector_per_node;
+      _u64 nnodes_per_sector;
+      if (vamana_frozen_num == 1)
+        vamana_frozen_loc = medoid;
+      max_node_len =
+          (((_u64) width_u32 + 1) * sizeof(unsigned)) + (ndims_64 * sizeof(T));
+
+      bool long_node = max_node_len > SECTOR_LEN;
+      if (long_node) {
+        if (append_reorder_data) {
+          throw diskann::ANNException(
+              "Reorder data for long node is not supported.", -1, __FUNCSIG__,
+              __FILE__, __LINE__);
+        }
+        nsector_per_node = ROUND_UP(max_node_len, SECTOR_LEN) / SECTOR_LEN;
+        nnodes_per_sector = -1;
+        LOG_KNOWHERE_DEBUG_ << "medoid: " << medoid << "B"
+                            << "max_node_len: " << max_node_len << "B"
+                            << "nsector_per_node: " << nsector_per_node << "B";
+      } else {
+        nnodes_per_sector = SECTOR_LEN / max_node_len;
+        nsector_per_node = -1;
+        LOG_KNOWHERE_DEBUG_ << "medoid: " << medoid << "B"
+                            << "max_node_len: " << max_node_len << "B"
+                            << "nnodes_per_sector: " << nnodes_per_sector
+                            << "B";
+      }
 
-      throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__,
-                                  __LINE__);
-    }
-    _u64 vamana_frozen_num = false, vamana_frozen_loc = 0;
+      // number of sectors (1 for meta data)
+      _u64 n_sectors =
+          long_node ? nsector_per_node * npts_64
+                    : ROUND_UP(npts_64, nnodes_per_sector) / nnodes_per_sector;
+      _u64 n_reorder_sectors = 0;
+      _u64 n_data_nodes_per_sector = 0;
 
-    vamana_reader.read((char *) &width_u32, sizeof(unsigned));
-    vamana_reader.read((char *) &medoid_u32, sizeof(unsigned));
-    vamana_reader.read((char *) &vamana_frozen_num, sizeof(_u64));
-    // compute
-    _u64 medoid, max_node_len;
-    _u64 nsector_per_node;
-    _u64 nnodes_per_sector;
-    npts_64 = (_u64) npts;
-    medoid = (_u64) medoid_u32;
-    if (vamana_frozen_num == 1)
-      vamana_frozen_loc = medoid;
-    max_node_len =
-        (((_u64) width_u32 + 1) * sizeof(unsigned)) + (ndims_64 * sizeof(T));
-
-    bool long_node = max_node_len > SECTOR_LEN;
-    if (long_node) {
       if (append_reorder_data) {
-        throw diskann::ANNException(
-            "Reorder data for long node is not supported.", -1, __FUNCSIG__,
-            __FILE__, __LINE__);
+        n_data_nodes_per_sector =
+            SECTOR_LEN / (ndims_reorder_file * sizeof(float));
+        n_reorder_sectors = ROUND_UP(npts_64, n_data_nodes_per_sector) /
+                            n_data_nodes_per_sector;
+      }
+      _u64 disk_index_file_size =
+          (n_sectors + n_reorder_sectors + 1) * SECTOR_LEN;
+
+      // SECTOR_LEN buffer for each sector
+      _u64 sector_buf_size =
+          long_node ? nsector_per_node * SECTOR_LEN : SECTOR_LEN;
+      std::unique_ptr<char[]> sector_buf =
+          std::make_unique<char[]>(sector_buf_size);
+
+      // write first sector with metadata
+      *(_u64 *) (sector_buf.get() + 0 * sizeof(_u64)) = disk_index_file_size;
+      *(_u64 *) (sector_buf.get() + 1 * sizeof(_u64)) = npts_64;
+      *(_u64 *) (sector_buf.get() + 2 * sizeof(_u64)) = medoid;
+      *(_u64 *) (sector_buf.get() + 3 * sizeof(_u64)) = max_node_len;
+      *(_u64 *) (sector_buf.get() + 4 * sizeof(_u64)) = nnodes_per_sector;
+      *(_u64 *) (sector_buf.get() + 5 * sizeof(_u64)) = vamana_frozen_num;
+      *(_u64 *) (sector_buf.get() + 6 * sizeof(_u64)) = vamana_frozen_loc;
+      *(_u64 *) (sector_buf.get() + 7 * sizeof(_u64)) = append_reorder_data;
+      if (append_reorder_data) {
+        *(_u64 *) (sector_buf.get() + 8 * sizeof(_u64)) = n_sectors + 1;
+        *(_u64 *) (sector_buf.get() + 9 * sizeof(_u64)) = ndims_reorder_file;
+        *(_u64 *) (sector_buf.get() + 10 * sizeof(_u64)) =
+            n_data_nodes_per_sector;
       }
-      nsector_per_node = ROUND_UP(max_node_len, SECTOR_LEN) / SECTOR_LEN;
-      nnodes_per_sector = -1;
-      LOG_KNOWHERE_DEBUG_ << "medoid: " << medoid << "B"
-                          << "max_node_len: " << max_node_len << "B"
-                          << "nsector_per_node: " << nsector_per_node << "B";
-    } else {
-      nnodes_per_sector = SECTOR_LEN / max_node_len;
-      nsector_per_node = -1;
-      LOG_KNOWHERE_DEBUG_ << "medoid: " << medoid << "B"
-                          << "max_node_len: " << max_node_len << "B"
-                          << "nnodes_per_sector: " << nnodes_per_sector << "B";
-    }
-
-    // number of sectors (1 for meta data)
-    _u64 n_sectors =
-        long_node ? nsector_per_node * npts_64
-                  : ROUND_UP(npts_64, nnodes_per_sector) / nnodes_per_sector;
-    _u64 n_reorder_sectors = 0;
-    _u64 n_data_nodes_per_sector = 0;
-
-    if (append_reorder_data) {
-      n_data_nodes_per_sector =
-          SECTOR_LEN / (ndims_reorder_file * sizeof(float));
-      n_reorder_sectors =
-          ROUND_UP(npts_64, n_data_nodes_per_sector) / n_data_nodes_per_sector;
-    }
-    _u64 disk_index_file_size =
-        (n_sectors + n_reorder_sectors + 1) * SECTOR_LEN;
-
-    // SECTOR_LEN buffer for each sector
-    _u64 sector_buf_size =
-        long_node ? nsector_per_node * SECTOR_LEN : SECTOR_LEN;
-    std::unique_ptr<char[]> sector_buf =
-        std::make_unique<char[]>(sector_buf_size);
-
-    // write first sector with metadata
-    *(_u64 *) (sector_buf.get() + 0 * sizeof(_u64)) = disk_index_file_size;
-    *(_u64 *) (sector_buf.get() + 1 * sizeof(_u64)) = npts_64;
-    *(_u64 *) (sector_buf.get() + 2 * sizeof(_u64)) = medoid;
-    *(_u64 *) (sector_buf.get() + 3 * sizeof(_u64)) = max_node_len;
-    *(_u64 *) (sector_buf.get() + 4 * sizeof(_u64)) = nnodes_per_sector;
-    *(_u64 *) (sector_buf.get() + 5 * sizeof(_u64)) = vamana_frozen_num;
-    *(_u64 *) (sector_buf.get() + 6 * sizeof(_u64)) = vamana_frozen_loc;
-    *(_u64 *) (sector_buf.get() + 7 * sizeof(_u64)) = append_reorder_data;
-    if (append_reorder_data) {
-      *(_u64 *) (sector_buf.get() + 8 * sizeof(_u64)) = n_sectors + 1;
-      *(_u64 *) (sector_buf.get() + 9 * sizeof(_u64)) = ndims_reorder_file;
-      *(_u64 *) (sector_buf.get() + 10 * sizeof(_u64)) =
-          n_data_nodes_per_sector;
-    }
-
-    diskann_writer.write(sector_buf.get(), SECTOR_LEN);
 
-    if (long_node) {
-      for (_u64 node_id = 0; node_id < npts_64; ++node_id) {
-        memset(sector_buf.get(), 0, sector_buf_size);
-        char *nnbrs = sector_buf.get() + ndims_64 * sizeof(T);
-        char *nhood_buf =
-            sector_buf.get() + (ndims_64 * sizeof(T)) + sizeof(unsigned);
+      diskann_writer.write(sector_buf.get(), SECTOR_LEN);
 
-        // read cur node's nnbrs
-        vamana_reader.read(nnbrs, sizeof(unsigned));
+      // coords of the node first, then the number of neighbours and their ids
+      auto write_node = [&](_u64 node_id, char *node_buf) {
+        unsigned *nnbrs = (unsigned *) (node_buf + ndims_64 * sizeof(T));
+        next_nhood(node_id, nnbrs, nnbrs + 1);
 
         // sanity checks on nnbrs
-        assert(static_cast<uint32_t>(*nnbrs) > 0);
-        assert(static_cast<uint32_t>(*nnbrs) <= width_u32);
-
-        // read node's nhood
-        vamana_reader.read(nhood_buf, *((unsigned *) nnbrs) * sizeof(unsigned));
+        assert(*nnbrs > 0);
+        assert(*nnbrs <= width_u32);
 
-        // write coords of node first
-        base_reader.read((char *) sector_buf.get(), sizeof(T) * ndims_64);
+        memcpy(node_buf, base_cursor.next(), sizeof(T) * ndims_64);
+      };
 
-        diskann_writer.write(sector_buf.get(), sector_buf_size);
+      if (long_node) {
+        for (_u64 node_id = 0; node_id < npts_64; ++node_id) {
+          memset(sector_buf.get(), 0, sector_buf_size);
+          write_node(node_id, sector_buf.get());
+          diskann_writer.write(sector_buf.get(), sector_buf_size);
+        }
+        LOG_KNOWHERE_DEBUG_ << "Output file written.";
+        return;
       }
-      LOG_KNOWHERE_DEBUG_ << "Output file written.";
-      return;
-    }
 
-    LOG_KNOWHERE_DEBUG_ << "# sectors: " << n_sectors;
-    _u64 cur_node_id = 0;
-    for (_u64 sector = 0; sector < n_sectors; sector++) {
-      if (sector % 100000 == 0) {
-        LOG_KNOWHERE_DEBUG_ << "Sector #" << sector << "written";
+      LOG_KNOWHERE_DEBUG_ << "# sectors: " << n_sectors;
+      _u64 cur_node_id = 0;
+      for (_u64 sector = 0; sector < n_sectors; sector++) {
+        if (sector % 100000 == 0) {
+          LOG_KNOWHERE_DEBUG_ << "Sector #" << sector << "written";
+        }
+        memset(sector_buf.get(), 0, SECTOR_LEN);
+        for (_u64 sector_node_id = 0;
+             sector_node_id < nnodes_per_sector && cur_node_id < npts_64;
+             sector_node_id++) {
+          write_node(cur_node_id,
+                     sector_buf.get() + (sector_node_id * max_node_len));
+          cur_node_id++;
+        }
+        // flush sector to disk
+        diskann_writer.write(sector_buf.get(), SECTOR_LEN);
       }
-      memset(sector_buf.get(), 0, SECTOR_LEN);
-      for (_u64 sector_node_id = 0;
-           sector_node_id < nnodes_per_sector && cur_node_id < npts_64;
-           sector_node_id++) {
-        char *sector_node_buf =
-            sector_buf.get() + (sector_node_id * max_node_len);
-        char *nnbrs = sector_node_buf + ndims_64 * sizeof(T);
-        char *nhood_buf =
-            sector_node_buf + (ndims_64 * sizeof(T)) + sizeof(unsigned);
-
-        // read cur node's nnbrs
-        vamana_reader.read(nnbrs, sizeof(unsigned));
+      if (append_reorder_data) {
+        diskann::cout << "Index written. Appending reorder data..."
+                      << std::endl;
 
-        // sanity checks on nnbrs
-        assert(static_cast<uint32_t>(*nnbrs) > 0);
-        assert(static_cast<uint32_t>(*nnbrs) <= width_u32);
+        auto                vec_len = ndims_reorder_file * sizeof(float);
+        PointCursor<float>  reorder_cursor(*reorder_reader);
+        _u64                cur_data_node_id = 0;
 
-        // read node's nhood
-        vamana_reader.read(nhood_buf, *((unsigned *) nnbrs) * sizeof(unsigned));
+        for (_u64 sector = 0; sector < n_reorder_sectors; sector++) {
+          if (sector % 100000 == 0) {
+            diskann::cout << "Reorder data Sector #" << sector << "written"
+                          << std::endl;
+          }
 
-        // write coords of node first
-        base_reader.read(sector_node_buf, sizeof(T) * ndims_64);
+          memset(sector_buf.get(), 0, SECTOR_LEN);
 
-        cur_node_id++;
+          for (_u64 sector_node_id = 0;
+               sector_node_id < n_data_nodes_per_sector &&
+               cur_data_node_id < npts_64;
+               sector_node_id++, cur_data_node_id++) {
+            memcpy(sector_buf.get() + (sector_node_id * vec_len),
+                   reorder_cursor.next(), vec_len);
+          }
+          // flush sector to disk
+          diskann_writer.write(sector_buf.get(), SECTOR_LEN);
+        }
       }
-      // flush sector to disk
-      diskann_writer.write(sector_buf.get(), SECTOR_LEN);
+      LOG_KNOWHERE_DEBUG_ << "Output file written.";
     }
-    if (append_reorder_data) {
-      diskann::cout << "Index written. Appending reorder data..." << std::endl;
+  }  // namespace
 
-      auto                    vec_len = ndims_reorder_file * sizeof(float);
-      std::unique_ptr<char[]> vec_buf = std::make_unique<char[]>(vec_len);
+  template<typename T>
+  void create_disk_layout(const PreppedBaseReader<T>             &base_reader,
+                          const std::vector<std::vector<unsigned>> &graph,
+                          const unsigned medoid, const std::string output_file,
+                          const PreppedBaseReader<float> *reorder_reader) {
+    if (graph.size() < base_reader.npts()) {
+      throw ANNException("Graph has fewer nodes than the base file", -1,
+                         __FUNCSIG__, __FILE__, __LINE__);
+    }
+    unsigned width_u32 = 0;
+    for (size_t i = 0; i < base_reader.npts(); i++) {
+      width_u32 = (std::max)(width_u32, (unsigned) graph[i].size());
+    }
+    write_disk_layout<T>(
+        base_reader, width_u32, medoid, 0,
+        [&](_u64 node_id, unsigned *nnbrs, unsigned *nhood) {
+          *nnbrs = (unsigned) graph[node_id].size();
+          memcpy(nhood, graph[node_id].data(), *nnbrs * sizeof(unsigned));
+        },
+        output_file, reorder_reader);
+  }
 
-      for (_u64 sector = 0; sector < n_reorder_sectors; sector++) {
-        if (sector % 100000 == 0) {
-          diskann::cout << "Reorder data Sector #" << sector << "written"
-                        << std::endl;
-        }
+  template<typename T>
+  void create_disk_layout(const std::string base_file,
+                          const std::string mem_index_file,
+                          const std::string output_file,
+                          const std::string reorder_data_file) {
+    // Check if we need to append data for re-ordering
+    std::unique_ptr<PreppedBaseReader<float>> reorder_reader;
+    if (reorder_data_file != std::string("")) {
+      reorder_reader =
+          std::make_unique<PreppedBaseReader<float>>(reorder_data_file);
+      if (get_file_size(reorder_data_file) !=
+          8 + sizeof(float) * reorder_reader->npts() * reorder_reader->dim())
+        throw ANNException("Discrepancy in reorder data file size ", -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
+    }
+    create_disk_layout<T>(PreppedBaseReader<T>(base_file), mem_index_file,
+                          output_file, reorder_reader.get());
+  }
 
-        memset(sector_buf.get(), 0, SECTOR_LEN);
+  template<typename T>
+  void create_disk_layout(const PreppedBaseReader<T> &base_reader,
+                          const std::string           mem_index_file,
+                          const std::string           output_file,
+                          const PreppedBaseReader<float> *reorder_reader) {
+    // create cached reader
+    size_t actual_file_size = get_file_size(mem_index_file);
+    LOG_KNOWHERE_INFO_ << "Vamana index file size: " << actual_file_size;
+    std::ifstream vamana_reader(mem_index_file, std::ios::binary);
 
-        for (_u64 sector_node_id = 0;
-             sector_node_id < n_data_nodes_per_sector &&
-             sector_node_id < npts_64;
-             sector_node_id++) {
-          memset(vec_buf.get(), 0, vec_len);
-          reorder_data_reader.read(vec_buf.get(), vec_len);
+    // metadata: width, medoid
+    unsigned width_u32, medoid_u32;
+    size_t   index_file_size;
 
-          // copy node buf into sector_node_buf
-          memcpy(sector_buf.get() + (sector_node_id * vec_len), vec_buf.get(),
-                 vec_len);
-        }
-        // flush sector to disk
-        diskann_writer.write(sector_buf.get(), SECTOR_LEN);
-      }
+    vamana_reader.read((char *) &index_file_size, sizeof(uint64_t));
+    if (index_file_size != actual_file_size) {
+      std::stringstream stream;
+      stream << "Vamana Index file size does not match expected size per "
+                "meta-data."
+             << " file size from file: " << index_file_size
+             << " actual file size: " << actual_file_size << std::endl;
+
+      throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__,
+                                  __LINE__);
     }
-    LOG_KNOWHERE_DEBUG_ << "Output file written.";
+    _u64 vamana_frozen_num = false;
+
+    vamana_reader.read((char *) &width_u32, sizeof(unsigned));
+    vamana_reader.read((char *) &medoid_u32, sizeof(unsigned));
+    vamana_reader.read((char *) &vamana_frozen_num, sizeof(_u64));
+
+    // the nodes are stored in order, each one as its count of neighbours
+    // followed by their ids
+    write_disk_layout<T>(
+        base_reader, width_u32, (_u64) medoid_u32, vamana_frozen_num,
+        [&](_u64, unsigned *nnbrs, unsigned *nhood) {
+          vamana_reader.read((char *) nnbrs, sizeof(unsigned));
+          vamana_reader.read((char *) nhood, *nnbrs * sizeof(unsigned));
+        },
+        output_file, reorder_reader);
   }
 
   template<typename T>
@@ -1122,8 +1168,6 @@ namespace diskann {
     bool ip_prepared = false;
 
     std::string base_file = config.data_file_path;
-    std::string data_file_to_use = base_file;
-    std::string data_file_to_save = base_file;
     std::string index_prefix_path = config.index_file_path;
     std::string pq_pivots_path = get_pq_pivots_filename(index_prefix_path);
     std::string pq_compressed_vectors_path =
@@ -1143,40 +1187,29 @@ namespace diskann {
     // optional, used if build mem usage is enough to generate cached nodes
     std::string cached_nodes_file = get_cached_nodes_file(index_prefix_path);
 
-    // output a new base file which contains extra dimension with sqrt(1 -
-    // ||x||^2/M^2) for every x, M is max norm of all points. Extra space on
-    // disk needed!
+    // Inner product search runs as L2 search on the points scaled by the max
+    // norm M with the extra dimension sqrt(1 - ||x||^2/M^2), cosine search
+    // on the normalized points. The reader prepares the points while they
+    // are read, the disk index keeps the raw points for cosine.
+    PreppedBaseReader<T> base_reader(base_file, config.compare_metric);
+    std::unique_ptr<PreppedBaseReader<T>> raw_reader;
     if (config.compare_metric == diskann::Metric::INNER_PRODUCT) {
-      LOG_KNOWHERE_INFO_
-          << "Using Inner Product search, so need to pre-process base "
-             "data into temp file. Please ensure there is additional "
-             "(n*(d+1)*4) bytes for storing pre-processed base vectors, "
-             "apart from the intermin indices and final index.";
-      std::string prepped_base = index_prefix_path + "_prepped_base.bin";
-      data_file_to_use = prepped_base;
-      data_file_to_save = prepped_base;
-      float max_norm_of_base =
-          diskann::prepare_base_for_inner_products<T>(base_file, prepped_base);
+      float       max_norm_of_base = base_reader.max_norm();
       std::string norm_file =
           get_disk_index_max_base_norm_file(disk_index_path);
       diskann::save_bin<float>(norm_file, &max_norm_of_base, 1, 1);
       ip_prepared = true;
     }
     if (config.compare_metric == diskann::Metric::COSINE) {
-      LOG_KNOWHERE_INFO_
-          << "Using Cosine search, so need to pre-process base "
-             "data into temp file. Please ensure there is additional "
-             "(n*d*4) bytes for storing pre-processed base vectors, "
-             "apart from the intermin indices and final index.";
-      std::string prepped_base = index_prefix_path + "_prepped_base.bin";
-      data_file_to_use = prepped_base;
-      auto norms_of_base =
-          diskann::prepare_base_for_cosine<T>(base_file, prepped_base);
       std::string norm_file =
           get_disk_index_max_base_norm_file(disk_index_path);
+      std::vector<float> norms_of_base = base_reader.norms();
       diskann::save_bin<float>(norm_file, norms_of_base.data(),
                                norms_of_base.size(), 1);
+      raw_reader = std::make_unique<PreppedBaseReader<T>>(base_file);
     }
+    const PreppedBaseReader<T> &save_reader =
+        raw_reader != nullptr ? *raw_reader : base_reader;
 
     unsigned R = config.max_degree;
     unsigned L = config.search_list_size;
@@ -1201,9 +1234,8 @@ namespace diskann {
 
     auto s = std::chrono::high_resolution_clock::now();
 
-    size_t points_num, dim;
-
-    diskann::get_bin_metadata(data_file_to_use.c_str(), points_num, dim);
+    size_t points_num = base_reader.npts();
+    size_t dim = base_reader.dim();
 
     size_t num_pq_chunks =
         (size_t) (std::floor)(_u64(pq_code_size_limit / points_num));
@@ -1220,7 +1252,7 @@ namespace diskann {
     double p_val = ((double) MAX_PQ_TRAINING_SET_SIZE / (double) points_num);
     // generates random sample and sets it to train_data and updates
     // train_size
-    gen_random_slice<T>(data_file_to_use.c_str(), p_val, train_data, train_size,
+    gen_random_slice<T>(base_reader, p_val, train_data, train_size,
                         train_dim);
 
     if (use_disk_pq) {
@@ -1229,18 +1261,16 @@ namespace diskann {
 
       LOG_KNOWHERE_DEBUG_ << "Compressing base for disk-PQ into "
                           << disk_pq_dims << " chunks ";
-      generate_pq_pivots(train_data, train_size, (uint32_t) dim, 256,
-                         (uint32_t) disk_pq_dims, NUM_KMEANS_REPS,
-                         disk_pq_pivots_path, false);
-      if (config.compare_metric == diskann::Metric::INNER_PRODUCT ||
-          config.compare_metric == diskann::Metric::COSINE)
-        generate_pq_data_from_pivots<float>(
-            data_file_to_use.c_str(), 256, (uint32_t) disk_pq_dims,
-            disk_pq_pivots_path, disk_pq_compressed_vectors_path);
-      else
-        generate_pq_data_from_pivots<T>(
-            data_file_to_use.c_str(), 256, (uint32_t) disk_pq_dims,
-            disk_pq_pivots_path, disk_pq_compressed_vectors_path);
+      if (generate_pq_pivots(train_data, train_size, (uint32_t) dim, 256,
+                             (uint32_t) disk_pq_dims, NUM_KMEANS_REPS,
+                             disk_pq_pivots_path, false) != 0) {
+        LOG(ERROR) << "Failed to generate the disk PQ pivots";
+        delete[] train_data;
+        return -1;
+      }
+      generate_pq_data_from_pivots<T>(base_reader, 256, (uint32_t) disk_pq_dims,
+                                      disk_pq_pivots_path,
+                                      disk_pq_compressed_vectors_path);
     }
     LOG_KNOWHERE_DEBUG_ << "Training data loaded of size " << train_size;
 
@@ -1251,19 +1281,33 @@ namespace diskann {
       make_zero_mean = false;
 
     auto pq_s = std::chrono::high_resolution_clock::now();
-    generate_pq_pivots(train_data, train_size, (uint32_t) dim, 256,
-                       (uint32_t) num_pq_chunks, NUM_KMEANS_REPS,
-                       pq_pivots_path, make_zero_mean);
+    if (generate_pq_pivots(train_data, train_size, (uint32_t) dim, 256,
+                           (uint32_t) num_pq_chunks, NUM_KMEANS_REPS,
+                           pq_pivots_path, make_zero_mean) != 0) {
+      LOG(ERROR) << "Failed to generate the PQ pivots";
+      delete[] train_data;
+      return -1;
+    }
 
-    generate_pq_data_from_pivots<T>(data_file_to_use.c_str(), 256,
-                                    (uint32_t) num_pq_chunks, pq_pivots_path,
-                                    pq_compressed_vectors_path);
     auto pq_e = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> pq_diff = pq_e - pq_s;
     LOG_KNOWHERE_INFO_ << "Training PQ codes cost: " << pq_diff.count() << "s";
     delete[] train_data;
 
     train_data = nullptr;
+
+    // the points are encoded with the pivots while the graph is built, both
+    // stream the base file
+    auto pq_future = std::async(std::launch::async, [&]() {
+      auto encode_s = std::chrono::high_resolution_clock::now();
+      generate_pq_data_from_pivots<T>(base_reader, 256,
+                                      (uint32_t) num_pq_chunks, pq_pivots_path,
+                                      pq_compressed_vectors_path);
+      std::chrono::duration<double> encode_diff =
+          std::chrono::high_resolution_clock::now() - encode_s;
+      LOG_KNOWHERE_INFO_ << "Encoding PQ codes cost: " << encode_diff.count()
+                         << "s";
+    });
 // Gopal. Splitting diskann_dll into separate DLLs for search and build.
 // This code should only be available in the "build" DLL.
 #if defined(RELEASE_UNUSED_TCMALLOC_MEMORY_AT_CHECKPOINTS) && \
@@ -1273,23 +1317,55 @@ namespace diskann {
 
     auto graph_s = std::chrono::high_resolution_clock::now();
     auto vamana_index = diskann::build_merged_vamana_index<T>(
-        data_file_to_use.c_str(), ip_prepared, diskann::Metric::L2, L, R,
+        base_reader, ip_prepared, diskann::Metric::L2, L, R,
         config.accelerate_build, p_val, indexing_ram_budget, mem_index_path,
         medoids_path, centroids_path);
     auto graph_e = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> graph_diff = graph_e - graph_s;
     LOG_KNOWHERE_INFO_ << "Training graph cost: " << graph_diff.count() << "s";
-    if (!use_disk_pq) {
-      diskann::create_disk_layout<T>(data_file_to_save.c_str(), mem_index_path,
-                                     disk_index_path);
+    pq_future.get();
+
+    // the full precision points appended for reordering, only float points
+    // are supported
+    std::unique_ptr<PreppedBaseReader<float>> reorder_reader;
+    if (use_disk_pq && reorder_data) {
+      if (!std::is_same<T, float>::value) {
+        throw diskann::ANNException(
+            "Reorder data is only supported for float points", -1,
+            __FUNCSIG__, __FILE__, __LINE__);
+      }
+      reorder_reader = std::make_unique<PreppedBaseReader<float>>(
+          base_file, config.compare_metric == diskann::Metric::INNER_PRODUCT
+                         ? diskann::Metric::INNER_PRODUCT
+                         : diskann::Metric::L2);
+    }
+    std::unique_ptr<PreppedBaseReader<_u8>> disk_pq_reader;
+    if (use_disk_pq) {
+      disk_pq_reader = std::make_unique<PreppedBaseReader<_u8>>(
+          disk_pq_compressed_vectors_path);
+    }
+    if (vamana_index != nullptr) {
+      // straight from the graph in memory
+      const auto &graph = *vamana_index->get_graph();
+      const auto  medoid = vamana_index->get_entry_point();
+      if (!use_disk_pq) {
+        diskann::create_disk_layout<T>(save_reader, graph, medoid,
+                                       disk_index_path, nullptr);
+      } else {
+        diskann::create_disk_layout<_u8>(*disk_pq_reader, graph, medoid,
+                                         disk_index_path,
+                                         reorder_reader.get());
+      }
     } else {
-      if (!reorder_data)
-        diskann::create_disk_layout<_u8>(disk_pq_compressed_vectors_path,
-                                         mem_index_path, disk_index_path);
-      else
-        diskann::create_disk_layout<_u8>(disk_pq_compressed_vectors_path,
-                                         mem_index_path, disk_index_path,
-                                         data_file_to_save.c_str());
+      // the merged graph did not fit in memory, stream it from its file
+      if (!use_disk_pq) {
+        diskann::create_disk_layout<T>(save_reader, mem_index_path,
+                                       disk_index_path, nullptr);
+      } else {
+        diskann::create_disk_layout<_u8>(*disk_pq_reader, mem_index_path,
+                                         disk_index_path,
+                                         reorder_reader.get());
+      }
     }
 
     double ten_percent_points = std::ceil(points_num * 0.1);
@@ -1304,9 +1380,14 @@ namespace diskann {
       auto final_graph = vamana_index->get_graph();
       auto entry_point = vamana_index->get_entry_point();
 
+      // size of the graph as saved by Index::save_graph
+      _u64 graph_size = 24;
+      for (const auto &nbrs : *final_graph) {
+        graph_size += (nbrs.size() + 1) * sizeof(unsigned);
+      }
       auto generate_cache_mem_usage =
           kCacheMemFactor *
-          (get_file_size(mem_index_path) + get_file_size(sample_data_file) +
+          (graph_size + get_file_size(sample_data_file) +
            get_file_size(pq_compressed_vectors_path) +
            get_file_size(pq_pivots_path)) /
           (1024 * 1024 * 1024);
@@ -1323,9 +1404,6 @@ namespace diskann {
     std::chrono::duration<double> diff = e - s;
     LOG_KNOWHERE_INFO_ << "Indexing time: " << diff.count() << std::endl;
 
-    if (config.compare_metric == diskann::Metric::INNER_PRODUCT) {
-      std::remove(data_file_to_use.c_str());
-    }
     std::remove(mem_index_path.c_str());
     if (use_disk_pq)
       std::remove(disk_pq_compressed_vectors_path.c_str());
@@ -1341,6 +1419,33 @@ namespace diskann {
   template DISKANN_DLLEXPORT void create_disk_layout<float>(
       const std::string base_file, const std::string mem_index_file,
       const std::string output_file, const std::string reorder_data_file);
+  template DISKANN_DLLEXPORT void create_disk_layout<int8_t>(
+      const PreppedBaseReader<int8_t> &base_reader,
+      const std::string mem_index_file, const std::string output_file,
+      const PreppedBaseReader<float> *reorder_reader);
+  template DISKANN_DLLEXPORT void create_disk_layout<int8_t>(
+      const PreppedBaseReader<int8_t> &base_reader,
+      const std::vector<std::vector<unsigned>> &graph, const unsigned medoid,
+      const std::string output_file,
+      const PreppedBaseReader<float> *reorder_reader);
+  template DISKANN_DLLEXPORT void create_disk_layout<uint8_t>(
+      const PreppedBaseReader<uint8_t> &base_reader,
+      const std::string mem_index_file, const std::string output_file,
+      const PreppedBaseReader<float> *reorder_reader);
+  template DISKANN_DLLEXPORT void create_disk_layout<uint8_t>(
+      const PreppedBaseReader<uint8_t> &base_reader,
+      const std::vector<std::vector<unsigned>> &graph, const unsigned medoid,
+      const std::string output_file,
+      const PreppedBaseReader<float> *reorder_reader);
+  template DISKANN_DLLEXPORT void create_disk_layout<float>(
+      const PreppedBaseReader<float> &base_reader,
+      const std::string mem_index_file, const std::string output_file,
+      const PreppedBaseReader<float> *reorder_reader);
+  template DISKANN_DLLEXPORT void create_disk_layout<float>(
+      const PreppedBaseReader<float> &base_reader,
+      const std::vector<std::vector<unsigned>> &graph, const unsigned medoid,
+      const std::string output_file,
+      const PreppedBaseReader<float> *reorder_reader);
 
   template DISKANN_DLLEXPORT int8_t *load_warmup<int8_t>(
       const std::string &cache_warmup_file, uint64_t &warmup_num,
@@ -1388,29 +1493,26 @@ namespace diskann {
       const BuildConfig &config);
 
   template DISKANN_DLLEXPORT std::unique_ptr<diskann::Index<int8_t>>
-  build_merged_vamana_index<int8_t>(std::string base_file, bool ip_prepared,
-                                    diskann::Metric compareMetric, unsigned L,
-                                    unsigned R, bool accelerate_build,
-                                    double sampling_rate, double ram_budget,
-                                    std::string mem_index_path,
-                                    std::string medoids_path,
-                                    std::string centroids_file);
+  build_merged_vamana_index<int8_t>(
+      const PreppedBaseReader<int8_t> &base_reader, bool ip_prepared,
+      diskann::Metric compareMetric, unsigned L, unsigned R,
+      bool accelerate_build, double sampling_rate, double ram_budget,
+      std::string mem_index_path, std::string medoids_path,
+      std::string centroids_file);
   template DISKANN_DLLEXPORT std::unique_ptr<diskann::Index<float>>
-  build_merged_vamana_index<float>(std::string base_file, bool ip_prepared,
-                                   diskann::Metric compareMetric, unsigned L,
-                                   unsigned R, bool accelerate_build,
-                                   double sampling_rate, double ram_budget,
-                                   std::string mem_index_path,
-                                   std::string medoids_path,
-                                   std::string centroids_file);
+  build_merged_vamana_index<float>(
+      const PreppedBaseReader<float> &base_reader, bool ip_prepared,
+      diskann::Metric compareMetric, unsigned L, unsigned R,
+      bool accelerate_build, double sampling_rate, double ram_budget,
+      std::string mem_index_path, std::string medoids_path,
+      std::string centroids_file);
   template DISKANN_DLLEXPORT std::unique_ptr<diskann::Index<uint8_t>>
-  build_merged_vamana_index<uint8_t>(std::string base_file, bool ip_prepared,
-                                     diskann::Metric compareMetric, unsigned L,
-                                     unsigned R, bool accelerate_build,
-                                     double sampling_rate, double ram_budget,
-                                     std::string mem_index_path,
-                                     std::string medoids_path,
-                                     std::string centroids_file);
+  build_merged_vamana_index<uint8_t>(
+      const PreppedBaseReader<uint8_t> &base_reader, bool ip_prepared,
+      diskann::Metric compareMetric, unsigned L, unsigned R,
+      bool accelerate_build, double sampling_rate, double ram_budget,
+      std::string mem_index_path, std::string medoids_path,
+      std::string centroids_file);
 
   template DISKANN_DLLEXPORT void
   generate_cache_list_from_graph_with_pq<int8_t>(
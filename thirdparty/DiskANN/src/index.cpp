@@ -1881,6 +1881,63 @@ namespace diskann {
     _has_built = true;
   }
 
+  template<typename T, typename TagT>
+  void Index<T, TagT>::build(const PreppedBaseReader<T> &base_reader,
+                             Parameters                 &parameters) {
+    const size_t num_points = base_reader.npts();
+    if (num_points > _max_points || base_reader.dim() != _dim) {
+      std::stringstream stream;
+      stream << "ERROR: Driver requests building on " << num_points
+             << " points of dimension " << base_reader.dim()
+             << ", but index can support only " << _max_points
+             << " points of dimension " << _dim
+             << " as specified in constructor." << std::endl;
+      LOG(ERROR) << stream.str();
+      aligned_free(_data);
+      throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__,
+                                  __LINE__);
+    }
+    if (_enable_tags) {
+      throw diskann::ANNException(
+          "ERROR: building on a reader does not take tags", -1, __FUNCSIG__,
+          __FILE__, __LINE__);
+    }
+
+    const size_t block_size = (std::min)(
+        num_points, (size_t) PreppedBaseReader<T>::kBlockSize);
+    std::unique_ptr<T[]> block = std::make_unique<T[]>(block_size * _dim);
+    for (size_t start = 0; start < num_points; start += block_size) {
+      const size_t n = (std::min)(block_size, num_points - start);
+      base_reader.read(start, n, block.get());
+      for (size_t p = 0; p < n; p++) {
+        T *row = _data + (start + p) * _aligned_dim;
+        std::memcpy(row, block.get() + p * _dim, _dim * sizeof(T));
+        std::memset(row + _dim, 0, (_aligned_dim - _dim) * sizeof(T));
+      }
+    }
+    if (_normalize_vecs) {
+      for (uint64_t i = 0; i < num_points; i++) {
+        normalize(_data + _aligned_dim * i, _aligned_dim);
+      }
+    }
+    LOG_KNOWHERE_INFO_ << "Building start on " << num_points << " points.";
+    _nd = num_points;
+
+    generate_frozen_point();
+    link(parameters);  // Primary func for creating nsg graph
+
+    if (_support_eager_delete) {
+      update_in_graph();  // copying values to in_graph
+    }
+
+    size_t max = 0;
+    for (size_t i = 0; i < _nd; i++) {
+      max = (std::max)(max, _final_graph[i].size());
+    }
+    _width = (std::max)((unsigned) max, _width);
+    _has_built = true;
+  }
+
   template<typename T, typename TagT>
   void Index<T, TagT>::build(const char  *filename,
                              const size_t num_points_to_load,
@@ -0,0 +1,360 @@
+#include "diskann/io_uring_aligned_file_reader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <sstream>
+#include "diskann/utils.h"
+
+namespace {
+  static constexpr uint64_t n_retries = 10;
+  // how long an idle submission thread spins before it sleeps
+  static constexpr unsigned sq_thread_idle_ms = 1000;
+
+  [[noreturn]] void throw_uring_error(const char *op, int err) {
+    std::stringstream ss;
+    ss << op << " failed, errno: " << err << ", " << strerror(err);
+    throw diskann::ANNException(ss.str(), -1, __FUNCSIG__, __FILE__,
+                                __LINE__);
+  }
+
+  // source of IoUringAlignedFileReader::generation values, 0 is never handed
+  // out so that an empty cache slot can not match
+  std::atomic<uint64_t> next_generation{1};
+
+  // rings this thread got from get_ctx(), direct mapped by generation so a
+  // thread serving a handful of readers does not keep evicting them
+  static constexpr size_t ring_cache_size = 16;
+  struct CachedRing {
+    uint64_t  generation = 0;
+    IOContext ctx = nullptr;
+  };
+  thread_local CachedRing ring_cache[ring_cache_size];
+}  // namespace
+
+struct IoUringAlignedFileReader::Ring {
+  struct io_uring ring;
+  bool            fixed_file = false;
+  bool            fixed_bufs = false;
+  // submitted through submit_req() and not yet reaped
+  size_t          in_flight = 0;
+
+  ~Ring() {
+    io_uring_queue_exit(&ring);
+  }
+};
+
+void IoUringAlignedFileReader::InitGlobalConfig(bool sqpoll,
+                                                unsigned queue_depth) {
+  if (queue_depth == 0) {
+    LOG(ERROR) << "queue_depth should be bigger than 0";
+    return;
+  }
+  std::scoped_lock lk(global_config_mut);
+  global_sqpoll = sqpoll;
+  global_queue_depth = queue_depth;
+}
+
+bool IoUringAlignedFileReader::is_supported() {
+  struct io_uring ring;
+  int             ret = io_uring_queue_init(2, &ring, 0);
+  if (ret < 0) {
+    LOG(WARNING) << "io_uring is not available, errno: " << -ret << ", "
+                 << strerror(-ret);
+    return false;
+  }
+  io_uring_queue_exit(&ring);
+  return true;
+}
+
+IoUringAlignedFileReader::IoUringAlignedFileReader()
+    : generation(next_generation.fetch_add(1)) {
+  std::scoped_lock lk(global_config_mut);
+  this->sqpoll = global_sqpoll;
+  this->queue_depth = global_queue_depth;
+}
+
+IoUringAlignedFileReader::~IoUringAlignedFileReader() {
+  if (this->file_desc != -1) {
+    std::cerr << "close() not called" << std::endl;
+    close();
+  }
+}
+
+void IoUringAlignedFileReader::open(const std::string &fname) {
+  int flags = O_DIRECT | O_RDONLY | O_LARGEFILE;
+  this->file_desc = ::open(fname.c_str(), flags);
+  // error checks
+  assert(this->file_desc != -1);
+  LOG_KNOWHERE_DEBUG_ << "Opened file : " << fname;
+}
+
+void IoUringAlignedFileReader::close() {
+  {
+    std::scoped_lock lk(this->ctx_mut);
+    // rings hold a reference to the file while it is registered
+    this->generation.store(next_generation.fetch_add(1));
+    this->rings.clear();
+    this->sq_owner_fd = -1;
+  }
+  if (this->file_desc != -1) {
+    ::close(this->file_desc);
+    this->file_desc = -1;
+  }
+}
+
+void IoUringAlignedFileReader::register_buffers(
+    const std::vector<std::pair<void *, uint64_t>> &bufs) {
+  std::scoped_lock lk(this->ctx_mut);
+  if (!this->rings.empty()) {
+    LOG(WARNING) << "register_buffers() called after rings were created, "
+                    "existing rings keep their buffers";
+  }
+  this->fixed_bufs.clear();
+  for (auto &[buf, len] : bufs) {
+    this->fixed_bufs.push_back({buf, len});
+  }
+  std::sort(this->fixed_bufs.begin(), this->fixed_bufs.end(),
+            [](const struct iovec &a, const struct iovec &b) {
+              return a.iov_base < b.iov_base;
+            });
+}
+
+IoUringAlignedFileReader::Ring *IoUringAlignedFileReader::create_ring() {
+  auto                   ring = std::make_unique<Ring>();
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  if (this->sqpoll) {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = sq_thread_idle_ms;
+    if (this->sq_owner_fd != -1) {
+      params.flags |= IORING_SETUP_ATTACH_WQ;
+      params.wq_fd = this->sq_owner_fd;
+    }
+  }
+  int ret = io_uring_queue_init_params(this->queue_depth, &ring->ring, &params);
+  if (ret < 0 && this->sqpoll) {
+    // SQPOLL needs CAP_SYS_NICE before 5.11
+    LOG(WARNING) << "io_uring SQPOLL setup failed, errno: " << -ret << ", "
+                 << strerror(-ret) << ", falling back to plain submission";
+    this->sqpoll = false;
+    memset(&params, 0, sizeof(params));
+    ret = io_uring_queue_init_params(this->queue_depth, &ring->ring, &params);
+  }
+  if (ret < 0) {
+    throw_uring_error("io_uring_queue_init", -ret);
+  }
+  if (this->sqpoll && this->sq_owner_fd == -1) {
+    this->sq_owner_fd = ring->ring.ring_fd;
+  }
+
+  if (this->file_desc != -1) {
+    ret = io_uring_register_files(&ring->ring, &this->file_desc, 1);
+    ring->fixed_file = (ret == 0);
+  }
+  if (!this->fixed_bufs.empty()) {
+    ret = io_uring_register_buffers(&ring->ring, this->fixed_bufs.data(),
+                                    this->fixed_bufs.size());
+    if (ret < 0) {
+      // usually RLIMIT_MEMLOCK, reads still work without the fast path
+      LOG(WARNING) << "io_uring_register_buffers failed, errno: " << -ret
+                   << ", " << strerror(-ret);
+    }
+    ring->fixed_bufs = (ret == 0);
+  }
+  return ring.release();
+}
+
+IOContext IoUringAlignedFileReader::get_ctx() {
+  const uint64_t gen = this->generation.load();
+  auto          &cached = ring_cache[gen % ring_cache_size];
+  if (cached.generation == gen) {
+    return cached.ctx;
+  }
+
+  std::scoped_lock lk(this->ctx_mut);
+  auto            &ring = this->rings[std::this_thread::get_id()];
+  if (ring == nullptr) {
+    ring.reset(create_ring());
+  }
+  // the rings may have been replaced while we waited for the lock
+  cached.generation = this->generation.load();
+  cached.ctx = reinterpret_cast<IOContext>(ring.get());
+  return cached.ctx;
+}
+
+int IoUringAlignedFileReader::find_fixed_buf(const AlignedRead &req) const {
+  auto it = std::upper_bound(
+      this->fixed_bufs.begin(), this->fixed_bufs.end(), req.buf,
+      [](void *buf, const struct iovec &v) { return buf < v.iov_base; });
+  if (it == this->fixed_bufs.begin()) {
+    return -1;
+  }
+  --it;
+  auto begin = (char *) it->iov_base;
+  if ((char *) req.buf + req.len > begin + it->iov_len) {
+    return -1;
+  }
+  return it - this->fixed_bufs.begin();
+}
+
+void IoUringAlignedFileReader::submit(Ring *ring, const AlignedRead *reqs,
+                                      size_t n_ops) {
+  const int fd = ring->fixed_file ? 0 : this->file_desc;
+  size_t    num_queued = 0;
+  for (size_t i = 0; i < n_ops; i++) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring->ring);
+    if (sqe == nullptr) {
+      // the submission queue is full, hand what we have to the kernel
+      flush(ring, num_queued);
+      num_queued = 0;
+      if (ring->ring.flags & IORING_SETUP_SQPOLL) {
+        // entries are freed only once the submission thread picked them up
+        io_uring_sqring_wait(&ring->ring);
+      }
+      sqe = io_uring_get_sqe(&ring->ring);
+      if (sqe == nullptr) {
+        std::stringstream err;
+        err << "io_uring submission queue is full, queue depth: "
+            << this->queue_depth << ", requests: " << n_ops;
+        throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__,
+                                    __LINE__);
+      }
+    }
+    const int buf_index = ring->fixed_bufs ? find_fixed_buf(reqs[i]) : -1;
+    if (buf_index >= 0) {
+      io_uring_prep_read_fixed(sqe, fd, reqs[i].buf, reqs[i].len,
+                               reqs[i].offset, buf_index);
+    } else {
+      io_uring_prep_read(sqe, fd, reqs[i].buf, reqs[i].len, reqs[i].offset);
+    }
+    if (ring->fixed_file) {
+      sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    io_uring_sqe_set_data(sqe, reqs[i].buf);
+    num_queued++;
+  }
+  flush(ring, num_queued);
+}
+
+void IoUringAlignedFileReader::flush(Ring *ring, size_t n_ops) {
+  size_t num_submitted = 0, submit_retry = 0;
+  while (num_submitted < n_ops) {
+    int ret = io_uring_submit(&ring->ring);
+    if (ret < 0) {
+      if (-ret != EINTR && -ret != EAGAIN && -ret != EBUSY) {
+        throw_uring_error("io_uring_submit", -ret);
+      }
+      ret = 0;
+    }
+    num_submitted += ret;
+    ring->in_flight += ret;
+    if (num_submitted < n_ops) {
+      submit_retry++;
+      if (submit_retry <= n_retries) {
+        LOG(WARNING) << "io_uring_submit() failed; submit: " << num_submitted
+                     << ", expected: " << n_ops << ", retry: " << submit_retry;
+      } else {
+        std::stringstream err;
+        err << "io_uring_submit failed after retried " << n_retries
+            << " times";
+        throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__,
+                                    __LINE__);
+      }
+    }
+  }
+}
+
+size_t IoUringAlignedFileReader::reap(Ring *ring, size_t min_nr, size_t max_nr,
+                                      std::vector<void *> *done_bufs) {
+  // with min_nr == max_nr all completions are drained even after a failure,
+  // the buffers must not be written to once we return
+  int    first_err = 0;
+  size_t num_read = 0;
+  while (num_read < min_nr) {
+    struct io_uring_cqe *cqe = nullptr;
+    int                  ret = io_uring_wait_cqe(&ring->ring, &cqe);
+    if (ret < 0) {
+      if (-ret == EINTR) {
+        continue;
+      }
+      throw_uring_error("io_uring_wait_cqe", -ret);
+    }
+    // take whatever else is ready without another syscall
+    unsigned head, seen = 0;
+    io_uring_for_each_cqe(&ring->ring, head, cqe) {
+      if (cqe->res < 0 && first_err == 0) {
+        first_err = -cqe->res;
+      }
+      if (done_bufs != nullptr) {
+        done_bufs->push_back(io_uring_cqe_get_data(cqe));
+      }
+      if (++seen == max_nr - num_read) {
+        break;
+      }
+    }
+    io_uring_cq_advance(&ring->ring, seen);
+    num_read += seen;
+  }
+  ring->in_flight -= num_read;
+  if (first_err != 0) {
+    throw_uring_error("io_uring read", first_err);
+  }
+  return num_read;
+}
+
+void IoUringAlignedFileReader::read(std::vector<AlignedRead> &read_reqs,
+                                    IOContext &ctx, bool async) {
+  if (async == true) {
+    diskann::cout << "Async currently not supported in linux." << std::endl;
+  }
+  assert(this->file_desc != -1);
+  auto ring = reinterpret_cast<Ring *>(ctx);
+
+  // break-up requests into chunks of size queue_depth each
+  for (size_t begin = 0; begin < read_reqs.size(); begin += this->queue_depth) {
+    size_t n_ops =
+        std::min<size_t>(read_reqs.size() - begin, this->queue_depth);
+    submit(ring, read_reqs.data() + begin, n_ops);
+    reap(ring, n_ops, n_ops, nullptr);
+  }
+}
+
+void IoUringAlignedFileReader::submit_req(IOContext                &ctx,
+                                          std::vector<AlignedRead> &read_reqs) {
+  auto ring = reinterpret_cast<Ring *>(ctx);
+  if (ring->in_flight + read_reqs.size() > this->queue_depth) {
+    std::stringstream err;
+    err << "Async does not support number of read requests ("
+        << ring->in_flight + read_reqs.size()
+        << ") exceeds the queue depth (" << this->queue_depth << ")";
+    throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+  }
+  submit(ring, read_reqs.data(), read_reqs.size());
+}
+
+void IoUringAlignedFileReader::get_submitted_req(IOContext &ctx,
+                                                 size_t     n_ops) {
+  auto ring = reinterpret_cast<Ring *>(ctx);
+  if (n_ops > ring->in_flight) {
+    std::stringstream err;
+    err << "Async does not support getting number of read requests (" << n_ops
+        << ") exceeds number of submitted requests (" << ring->in_flight
+        << ")";
+    throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+  }
+  reap(ring, n_ops, n_ops, nullptr);
+}
+
+void IoUringAlignedFileReader::get_completed_req(
+    IOContext &ctx, size_t min_nr, size_t max_nr,
+    std::vector<void *> &done_bufs) {
+  auto ring = reinterpret_cast<Ring *>(ctx);
+  if (min_nr > ring->in_flight) {
+    std::stringstream err;
+    err << "Can not wait for " << min_nr << " reads, only " << ring->in_flight
+        << " are in flight";
+    throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+  }
+  reap(ring, min_nr, max_nr, &done_bufs);
+}
@@ -189,6 +189,8 @@ void LinuxAlignedFileReader::submit_req(io_context_t             &ctx,
   for (int64_t j = 0; j < n_ops; j++) {
     io_prep_pread(cb.data() + j, fd, read_reqs[j].buf, read_reqs[j].len,
                   read_reqs[j].offset);
+    // handed back in io_event::data by get_completed_req()
+    cb[j].data = read_reqs[j].buf;
   }
   for (uint64_t i = 0; i < n_ops; i++) {
     cbs[i] = cb.data() + i;
@@ -260,4 +262,34 @@ void LinuxAlignedFileReader::get_submitted_req(io_context_t &ctx, size_t n_ops)
       }
     }
   }
-}
\ No newline at end of file
+}
+
+void LinuxAlignedFileReader::get_completed_req(io_context_t &ctx,
+                                               size_t min_nr, size_t max_nr,
+                                               std::vector<void *> &done_bufs) {
+  int64_t                 ret;
+  std::vector<io_event_t> evts(max_nr);
+  while ((ret = io_getevents(ctx, min_nr, max_nr, evts.data(), nullptr)) < 0) {
+    if (-ret != EINTR) {
+      std::stringstream err;
+      err << "Unknown error occur in io_getevents, errno: " << -ret << ", "
+          << strerror(-ret);
+      throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__,
+                                  __LINE__);
+    }
+  }
+  int64_t first_err = 0;
+  for (int64_t i = 0; i < ret; i++) {
+    if ((int64_t) evts[i].res < 0 && first_err == 0) {
+      first_err = -(int64_t) evts[i].res;
+    }
+    done_bufs.push_back(evts[i].data);
+  }
+  if (first_err != 0) {
+    std::stringstream err;
+    err << "aio read failed, errno: " << first_err << ", "
+        << strerror(first_err);
+    throw diskann::ANNException(err.str(), -1, __FUNCSIG__, __FILE__,
+                                __LINE__);
+  }
+}
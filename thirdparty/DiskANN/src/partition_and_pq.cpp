@@ -2,9 +2,11 @@
 // Licensed under the MIT license.
 
 #include "diskann/math_utils.h"
+#include "common/kmeans.h"
 #include "knowhere/comp/thread_pool.h"
 #include <omp.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -103,24 +105,17 @@ void gen_random_slice(const std::string base_file,
  ************************************/
 
 template<typename T>
-void gen_random_slice(const std::string data_file, double p_val,
-                      float *&sampled_data, size_t &slice_size, size_t &ndims) {
-  size_t                          npts;
-  uint32_t                        npts32, ndims32;
+void gen_random_slice(const diskann::PreppedBaseReader<T> &base_reader,
+                      double p_val, float *&sampled_data, size_t &slice_size,
+                      size_t &ndims) {
+  size_t                          npts = base_reader.npts();
   std::vector<std::vector<float>> sampled_vectors;
+  ndims = base_reader.dim();
 
-  // amount to read in one shot
-  _u64 read_blk_size = 64 * 1024 * 1024;
-  // create cached reader + writer
-  cached_ifstream base_reader(data_file.c_str(), read_blk_size);
-
-  // metadata: npts, ndims
-  base_reader.read((char *) &npts32, sizeof(unsigned));
-  base_reader.read((char *) &ndims32, sizeof(unsigned));
-  npts = npts32;
-  ndims = ndims32;
-
-  std::unique_ptr<T[]> cur_vector_T = std::make_unique<T[]>(ndims);
+  size_t block_size = (std::min)(
+      npts, (size_t) diskann::PreppedBaseReader<T>::kBlockSize);
+  std::unique_ptr<T[]> block_data_T =
+      std::make_unique<T[]>(block_size * ndims);
   p_val = p_val < 1 ? p_val : 1;
 
   std::random_device rd;  // Will be used to obtain a seed for the random number
@@ -128,14 +123,15 @@ void gen_random_slice(const std::string data_file, double p_val,
   std::mt19937       generator((unsigned) x);
   std::uniform_real_distribution<float> distribution(0, 1);
 
-  for (size_t i = 0; i < npts; i++) {
-    base_reader.read((char *) cur_vector_T.get(), ndims * sizeof(T));
-    float rnd_val = distribution(generator);
-    if (rnd_val < p_val) {
-      std::vector<float> cur_vector_float;
-      for (size_t d = 0; d < ndims; d++)
-        cur_vector_float.push_back(cur_vector_T[d]);
-      sampled_vectors.push_back(cur_vector_float);
+  for (size_t start_id = 0; start_id < npts; start_id += block_size) {
+    size_t cur_blk_size = (std::min)(block_size, npts - start_id);
+    base_reader.read(start_id, cur_blk_size, block_data_T.get());
+    for (size_t p = 0; p < cur_blk_size; p++) {
+      float rnd_val = distribution(generator);
+      if (rnd_val < p_val) {
+        const T *cur_vector_T = block_data_T.get() + p * ndims;
+        sampled_vectors.emplace_back(cur_vector_T, cur_vector_T + ndims);
+      }
     }
   }
   slice_size = sampled_vectors.size();
@@ -147,6 +143,13 @@ void gen_random_slice(const std::string data_file, double p_val,
   }
 }
 
+template<typename T>
+void gen_random_slice(const std::string data_file, double p_val,
+                      float *&sampled_data, size_t &slice_size, size_t &ndims) {
+  gen_random_slice<T>(diskann::PreppedBaseReader<T>(data_file), p_val,
+                      sampled_data, slice_size, ndims);
+}
+
 // same as above, but samples from the matrix inputdata instead of a file of
 // npts*ndims to return sampled_data of size slice_size*ndims.
 template<typename T>
@@ -183,6 +186,27 @@ void gen_random_slice(const T *inputdata, size_t npts, size_t ndims,
   }
 }
 
+// k-means needs at least as many points as centers. With fewer points, every
+// point becomes a center and the remaining centers repeat them, as the random
+// pivot selection of k-means++ did, so no code ever maps to an unset pivot.
+static knowhere::Status train_pivots(
+    const std::shared_ptr<knowhere::ThreadPool> &pool, const float *data,
+    size_t num_points, size_t dim, size_t num_centers,
+    const knowhere::KMeansConfig &cfg, float *pivot_data) {
+  if (num_points == 0)
+    return knowhere::Status::invalid_args;
+  size_t num_trained = std::min(num_points, num_centers);
+  auto   status = knowhere::KMeansTrain(pool, data, num_points, dim,
+                                        num_trained, cfg, pivot_data);
+  if (status != knowhere::Status::success)
+    return status;
+  for (size_t j = num_trained; j < num_centers; j++) {
+    std::memcpy(pivot_data + j * dim, pivot_data + (j % num_trained) * dim,
+                dim * sizeof(float));
+  }
+  return knowhere::Status::success;
+}
+
 // given training data in train_data of dimensions num_train * dim, generate PQ
 // pivots using k-means algorithm to partition the co-ordinates into
 // num_pq_chunks (if it divides dimension, else rounded) chunks, and runs
@@ -309,6 +333,13 @@ int generate_pq_pivots(const float *passed_train_data, size_t num_train,
 
   full_pivot_data.reset(new float[num_centers * dim]);
 
+  knowhere::KMeansConfig kmeans_cfg;
+  kmeans_cfg.niter = max_k_means_reps;
+  kmeans_cfg.max_points_per_centroid = 0;
+  kmeans_cfg.tol = 1e-5;
+  kmeans_cfg.kmeans_plus_plus = true;
+  std::atomic<bool> kmeans_failed{false};
+
   auto thread_pool = knowhere::ThreadPool::GetGlobalThreadPool();
   std::vector<folly::Future<folly::Unit>> futures;
   futures.reserve(num_pq_chunks);
@@ -322,8 +353,6 @@ int generate_pq_pivots(const float *passed_train_data, size_t num_train,
           std::make_unique<float[]>(num_centers * chunk_size);
       std::unique_ptr<float[]> cur_data =
           std::make_unique<float[]>(num_train * chunk_size);
-      std::unique_ptr<uint32_t[]> closest_center =
-          std::make_unique<uint32_t[]>(num_train);
 
       LOG_KNOWHERE_DEBUG_ << "Processing chunk " << index
                           << " with dimensions [" << chunk_offsets[index]
@@ -335,12 +364,13 @@ int generate_pq_pivots(const float *passed_train_data, size_t num_train,
                     chunk_size * sizeof(float));
       }
 
-      kmeans::kmeanspp_selecting_pivots(cur_data.get(), num_train, chunk_size,
-                                        cur_pivot_data.get(), num_centers);
-
-      kmeans::run_lloyds(cur_data.get(), num_train, chunk_size,
-                         cur_pivot_data.get(), num_centers, max_k_means_reps,
-                         NULL, closest_center.get());
+      // the chunks already run in parallel, each one trains on its own thread
+      if (train_pivots(nullptr, cur_data.get(), num_train, chunk_size,
+                       num_centers, kmeans_cfg, cur_pivot_data.get()) !=
+          knowhere::Status::success) {
+        kmeans_failed = true;
+        return;
+      }
 
       for (uint64_t j = 0; j < num_centers; j++) {
         std::memcpy(full_pivot_data.get() + j * dim + chunk_offsets[index],
@@ -352,6 +382,11 @@ int generate_pq_pivots(const float *passed_train_data, size_t num_train,
   for (auto &future : futures) {
     future.wait();
   }
+  if (kmeans_failed) {
+    LOG(ERROR) << "k-means of the PQ pivots failed on " << num_train
+               << " training points for " << num_centers << " centers";
+    return -1;
+  }
 
   diskann::save_bin<float>(pq_pivots_path.c_str(), full_pivot_data.get(),
                            (size_t) num_centers, dim);
@@ -376,16 +411,12 @@ int generate_pq_pivots(const float *passed_train_data, size_t num_train,
 // If the numbber of centers is < 256, it stores as byte vector, else as 4-byte
 // vector in binary format.
 template<typename T>
-int generate_pq_data_from_pivots(const std::string data_file,
-                                 unsigned num_centers, unsigned num_pq_chunks,
-                                 std::string pq_pivots_path,
-                                 std::string pq_compressed_vectors_path) {
-  _u64            read_blk_size = 64 * 1024 * 1024;
-  cached_ifstream base_reader(data_file, read_blk_size);
-  _u32            npts32;
-  _u32            basedim32;
-  base_reader.read((char *) &npts32, sizeof(uint32_t));
-  base_reader.read((char *) &basedim32, sizeof(uint32_t));
+int generate_pq_data_from_pivots(
+    const diskann::PreppedBaseReader<T> &base_reader, unsigned num_centers,
+    unsigned num_pq_chunks, std::string pq_pivots_path,
+    std::string pq_compressed_vectors_path) {
+  _u32   npts32 = (_u32) base_reader.npts();
+  _u32   basedim32 = (_u32) base_reader.dim();
   size_t num_points = npts32;
   size_t dim = basedim32;
 
@@ -464,7 +495,10 @@ int generate_pq_data_from_pivots(const std::string data_file,
   compressed_file_writer.write((char *) &num_points, sizeof(uint32_t));
   compressed_file_writer.write((char *) &num_pq_chunks_u32, sizeof(uint32_t));
 
-  size_t block_size = num_points <= BLOCK_SIZE ? num_points : BLOCK_SIZE;
+  // blocks of the reader rather than BLOCK_SIZE, the encoding runs next to
+  // the graph build and should stay small
+  size_t block_size = (std::min)(
+      num_points, (size_t) diskann::PreppedBaseReader<T>::kBlockSize);
 
 #ifdef SAVE_INFLATED_PQ
   std::ofstream inflated_file_writer(inflated_pq_file, std::ios::binary);
@@ -495,8 +529,7 @@ int generate_pq_data_from_pivots(const std::string data_file,
     size_t end_id = (std::min)((block + 1) * block_size, num_points);
     size_t cur_blk_size = end_id - start_id;
 
-    base_reader.read((char *) (block_data_T.get()),
-                     sizeof(T) * (cur_blk_size * dim));
+    base_reader.read(start_id, cur_blk_size, block_data_T.get());
     diskann::convert_types<T, float>(block_data_T.get(), block_data_float.get(),
                                      cur_blk_size, dim);
 
@@ -604,6 +637,16 @@ int generate_pq_data_from_pivots(const std::string data_file,
   return 0;
 }
 
+template<typename T>
+int generate_pq_data_from_pivots(const std::string data_file,
+                                 unsigned num_centers, unsigned num_pq_chunks,
+                                 std::string pq_pivots_path,
+                                 std::string pq_compressed_vectors_path) {
+  return generate_pq_data_from_pivots<T>(
+      diskann::PreppedBaseReader<T>(data_file), num_centers, num_pq_chunks,
+      pq_pivots_path, pq_compressed_vectors_path);
+}
+
 int estimate_cluster_sizes(float *test_data_float, size_t num_test,
                            float *pivots, const size_t num_centers,
                            const size_t test_dim, const size_t k_base,
@@ -755,20 +798,12 @@ int shard_data_into_clusters(const std::string data_file, float *pivots,
 // useful for partitioning large dataset. we first generate only the IDS for
 // each shard, and retrieve the actual vectors on demand.
 template<typename T>
-int shard_data_into_clusters_only_ids(const std::string data_file,
-                                      float *pivots, const size_t num_centers,
-                                      const size_t dim, const size_t k_base,
-                                      std::string prefix_path) {
-  _u64 read_blk_size = 64 * 1024 * 1024;
-  //  _u64 write_blk_size = 64 * 1024 * 1024;
-  // create cached reader + writer
-  cached_ifstream base_reader(data_file, read_blk_size);
-  _u32            npts32;
-  _u32            basedim32;
-  base_reader.read((char *) &npts32, sizeof(uint32_t));
-  base_reader.read((char *) &basedim32, sizeof(uint32_t));
-  size_t num_points = npts32;
-  if (basedim32 != dim) {
+int shard_data_into_clusters_only_ids(
+    const diskann::PreppedBaseReader<T> &base_reader, float *pivots,
+    const size_t num_centers, const size_t dim, const size_t k_base,
+    std::string prefix_path) {
+  size_t num_points = base_reader.npts();
+  if (base_reader.dim() != dim) {
     LOG(ERROR) << "Error. dimensions dont match for train set and base set";
     return -1;
   }
@@ -804,8 +839,7 @@ int shard_data_into_clusters_only_ids(const std::string data_file,
     size_t end_id = (std::min)((block + 1) * block_size, num_points);
     size_t cur_blk_size = end_id - start_id;
 
-    base_reader.read((char *) block_data_T.get(),
-                     sizeof(T) * (cur_blk_size * dim));
+    base_reader.read(start_id, cur_blk_size, block_data_T.get());
     diskann::convert_types<T, float>(block_data_T.get(), block_data_float.get(),
                                      cur_blk_size, dim);
 
@@ -844,19 +878,22 @@ int shard_data_into_clusters_only_ids(const std::string data_file,
 }
 
 template<typename T>
-int retrieve_shard_data_from_ids(const std::string data_file,
-                                 std::string       idmap_filename,
-                                 std::string       data_filename) {
-  _u64 read_blk_size = 64 * 1024 * 1024;
-  //  _u64 write_blk_size = 64 * 1024 * 1024;
-  // create cached reader + writer
-  cached_ifstream base_reader(data_file, read_blk_size);
-  _u32            npts32;
-  _u32            basedim32;
-  base_reader.read((char *) &npts32, sizeof(uint32_t));
-  base_reader.read((char *) &basedim32, sizeof(uint32_t));
-  size_t num_points = npts32;
-  size_t dim = basedim32;
+int shard_data_into_clusters_only_ids(const std::string data_file,
+                                      float *pivots, const size_t num_centers,
+                                      const size_t dim, const size_t k_base,
+                                      std::string prefix_path) {
+  return shard_data_into_clusters_only_ids<T>(
+      diskann::PreppedBaseReader<T>(data_file), pivots, num_centers, dim,
+      k_base, prefix_path);
+}
+
+template<typename T>
+int retrieve_shard_data_from_ids(
+    const diskann::PreppedBaseReader<T> &base_reader,
+    std::string idmap_filename, std::string data_filename) {
+  size_t num_points = base_reader.npts();
+  size_t dim = base_reader.dim();
+  _u32   basedim32 = (_u32) dim;
 
   _u32 dummy_size = 0;
 
@@ -882,8 +919,7 @@ int retrieve_shard_data_from_ids(const std::string data_file,
     size_t end_id = (std::min)((block + 1) * block_size, num_points);
     size_t cur_blk_size = end_id - start_id;
 
-    base_reader.read((char *) block_data_T.get(),
-                     sizeof(T) * (cur_blk_size * dim));
+    base_reader.read(start_id, cur_blk_size, block_data_T.get());
 
     for (size_t p = 0; p < cur_blk_size; p++) {
       uint32_t original_point_map_id = (uint32_t) (start_id + p);
@@ -909,12 +945,38 @@ int retrieve_shard_data_from_ids(const std::string data_file,
   return 0;
 }
 
+template<typename T>
+int retrieve_shard_data_from_ids(const std::string data_file,
+                                 std::string       idmap_filename,
+                                 std::string       data_filename) {
+  return retrieve_shard_data_from_ids<T>(
+      diskann::PreppedBaseReader<T>(data_file), idmap_filename, data_filename);
+}
+
 // partitions a large base file into many shards using k-means hueristic
 // on a random sample generated using sampling_rate probability. After this, it
 // assignes each base point to the closest k_base nearest centers and creates
 // the shards.
 // The total number of points across all shards will be k_base * num_points.
 
+// k-means of the partitioning step. There are few pivots and many training
+// points, so one k-means runs on the whole knowhere thread pool.
+void train_partition_pivots(const float *train_data, size_t num_train,
+                            size_t dim, float *pivot_data, size_t num_parts,
+                            size_t max_k_means_reps) {
+  knowhere::KMeansConfig kmeans_cfg;
+  kmeans_cfg.niter = max_k_means_reps;
+  kmeans_cfg.max_points_per_centroid = 0;
+  kmeans_cfg.tol = 1e-5;
+  kmeans_cfg.kmeans_plus_plus = true;
+  if (train_pivots(knowhere::ThreadPool::GetGlobalThreadPool(),
+                   train_data, num_train, dim, num_parts, kmeans_cfg,
+                   pivot_data) != knowhere::Status::success) {
+    throw diskann::ANNException("k-means of the partitioning step failed", -1,
+                                __FUNCSIG__, __FILE__, __LINE__);
+  }
+}
+
 template<typename T>
 int partition(const std::string data_file, const float sampling_rate,
               size_t num_parts, size_t max_k_means_reps,
@@ -940,11 +1002,8 @@ int partition(const std::string data_file, const float sampling_rate,
 
   // Process Global k-means for kmeans_partitioning Step
   LOG_KNOWHERE_DEBUG_ << "Processing global k-means (kmeans_partitioning Step)";
-  kmeans::kmeanspp_selecting_pivots(train_data_float, num_train, train_dim,
-                                    pivot_data, num_parts);
-
-  kmeans::run_lloyds(train_data_float, num_train, train_dim, pivot_data,
-                     num_parts, max_k_means_reps, NULL, NULL);
+  train_partition_pivots(train_data_float, num_train, train_dim, pivot_data,
+                         num_parts, max_k_means_reps);
 
   LOG_KNOWHERE_DEBUG_ << "Saving global k-center pivots";
   diskann::save_bin<float>(output_file.c_str(), pivot_data, (size_t) num_parts,
@@ -961,7 +1020,7 @@ int partition(const std::string data_file, const float sampling_rate,
 }
 
 template<typename T>
-int partition_with_ram_budget(const std::string data_file,
+int partition_with_ram_budget(const diskann::PreppedBaseReader<T> &base_reader,
                               const double sampling_rate, double ram_budget,
                               size_t            graph_degree,
                               const std::string prefix_path, size_t k_base) {
@@ -973,13 +1032,13 @@ int partition_with_ram_budget(const std::string data_file,
   int  num_parts = 3;
   bool fit_in_ram = false;
 
-  gen_random_slice<T>(data_file, sampling_rate, train_data_float, num_train,
-                      train_dim);
+  gen_random_slice<T>(base_reader, sampling_rate, train_data_float,
+                      num_train, train_dim);
 
   size_t test_dim;
   size_t num_test;
   float *test_data_float;
-  gen_random_slice<T>(data_file, sampling_rate, test_data_float, num_test,
+  gen_random_slice<T>(base_reader, sampling_rate, test_data_float, num_test,
                       test_dim);
 
   float *pivot_data = nullptr;
@@ -1003,11 +1062,8 @@ int partition_with_ram_budget(const std::string data_file,
     // Process Global k-means for kmeans_partitioning Step
     LOG_KNOWHERE_INFO_
         << "Processing global k-means (kmeans_partitioning Step)";
-    kmeans::kmeanspp_selecting_pivots(train_data_float, num_train, train_dim,
-                                      pivot_data, num_parts);
-
-    kmeans::run_lloyds(train_data_float, num_train, train_dim, pivot_data,
-                       num_parts, max_k_means_reps, NULL, NULL);
+    train_partition_pivots(train_data_float, num_train, train_dim,
+                           pivot_data, num_parts, max_k_means_reps);
 
     // now pivots are ready. need to stream base points and assign them to
     // closest clusters.
@@ -1040,7 +1096,7 @@ int partition_with_ram_budget(const std::string data_file,
   diskann::save_bin<float>(output_file.c_str(), pivot_data, (size_t) num_parts,
                            train_dim);
 
-  shard_data_into_clusters_only_ids<T>(data_file, pivot_data, num_parts,
+  shard_data_into_clusters_only_ids<T>(base_reader, pivot_data, num_parts,
                                        train_dim, k_base, prefix_path);
   delete[] pivot_data;
   delete[] train_data_float;
@@ -1048,6 +1104,16 @@ int partition_with_ram_budget(const std::string data_file,
   return num_parts;
 }
 
+template<typename T>
+int partition_with_ram_budget(const std::string data_file,
+                              const double sampling_rate, double ram_budget,
+                              size_t            graph_degree,
+                              const std::string prefix_path, size_t k_base) {
+  return partition_with_ram_budget<T>(diskann::PreppedBaseReader<T>(data_file),
+                                      sampling_rate, ram_budget, graph_degree,
+                                      prefix_path, k_base);
+}
+
 // Instantations of supported templates
 
 template void DISKANN_DLLEXPORT
@@ -1119,3 +1185,49 @@ template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<uint8_t>(
 template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<float>(
     const std::string data_file, unsigned num_centers, unsigned num_pq_chunks,
     std::string pq_pivots_path, std::string pq_compressed_vectors_path);
+
+template void DISKANN_DLLEXPORT gen_random_slice<float>(
+    const diskann::PreppedBaseReader<float> &base_reader, double p_val,
+    float *&sampled_data, size_t &slice_size, size_t &ndims);
+template void DISKANN_DLLEXPORT gen_random_slice<uint8_t>(
+    const diskann::PreppedBaseReader<uint8_t> &base_reader, double p_val,
+    float *&sampled_data, size_t &slice_size, size_t &ndims);
+template void DISKANN_DLLEXPORT gen_random_slice<int8_t>(
+    const diskann::PreppedBaseReader<int8_t> &base_reader, double p_val,
+    float *&sampled_data, size_t &slice_size, size_t &ndims);
+
+template DISKANN_DLLEXPORT int partition_with_ram_budget<int8_t>(
+    const diskann::PreppedBaseReader<int8_t> &base_reader,
+    const double sampling_rate, double ram_budget, size_t graph_degree,
+    const std::string prefix_path, size_t k_base);
+template DISKANN_DLLEXPORT int partition_with_ram_budget<uint8_t>(
+    const diskann::PreppedBaseReader<uint8_t> &base_reader,
+    const double sampling_rate, double ram_budget, size_t graph_degree,
+    const std::string prefix_path, size_t k_base);
+template DISKANN_DLLEXPORT int partition_with_ram_budget<float>(
+    const diskann::PreppedBaseReader<float> &base_reader,
+    const double sampling_rate, double ram_budget, size_t graph_degree,
+    const std::string prefix_path, size_t k_base);
+
+template DISKANN_DLLEXPORT int retrieve_shard_data_from_ids<float>(
+    const diskann::PreppedBaseReader<float> &base_reader,
+    std::string idmap_filename, std::string data_filename);
+template DISKANN_DLLEXPORT int retrieve_shard_data_from_ids<uint8_t>(
+    const diskann::PreppedBaseReader<uint8_t> &base_reader,
+    std::string idmap_filename, std::string data_filename);
+template DISKANN_DLLEXPORT int retrieve_shard_data_from_ids<int8_t>(
+    const diskann::PreppedBaseReader<int8_t> &base_reader,
+    std::string idmap_filename, std::string data_filename);
+
+template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<int8_t>(
+    const diskann::PreppedBaseReader<int8_t> &base_reader, unsigned num_centers,
+    unsigned num_pq_chunks, std::string pq_pivots_path,
+    std::string pq_compressed_vectors_path);
+template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<uint8_t>(
+    const diskann::PreppedBaseReader<uint8_t> &base_reader, unsigned num_centers,
+    unsigned num_pq_chunks, std::string pq_pivots_path,
+    std::string pq_compressed_vectors_path);
+template DISKANN_DLLEXPORT int generate_pq_data_from_pivots<float>(
+    const diskann::PreppedBaseReader<float> &base_reader, unsigned num_centers,
+    unsigned num_pq_chunks, std::string pq_pivots_path,
+    std::string pq_compressed_vectors_path);
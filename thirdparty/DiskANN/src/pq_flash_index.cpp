@@ -13,6 +13,8 @@
 #include <cmath>
 #include <cstdint>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <optional>
 #include <random>
 #include <thread>
@@ -23,6 +25,8 @@
 #include "diskann/aux_utils.h"
 #include "diskann/timer.h"
 #include "diskann/utils.h"
+#include "common/bitset_util.h"
+#include "knowhere/comp/metrics.h"
 #include "knowhere/heap.h"
 
 #include "knowhere/utils.h"
@@ -68,7 +72,8 @@ namespace diskann {
   template<typename T>
   PQFlashIndex<T>::PQFlashIndex(std::shared_ptr<AlignedFileReader> fileReader,
                                 diskann::Metric                    m)
-      : reader(fileReader), metric(m) {
+      : reader(fileReader), metric(m),
+        node_cache(std::make_shared<NodeCache>()) {
     if (m == diskann::Metric::INNER_PRODUCT || m == diskann::Metric::COSINE) {
       if (!std::is_floating_point<T>::value) {
         LOG(WARNING) << "Cannot normalize integral data types."
@@ -88,6 +93,14 @@ namespace diskann {
 
   template<typename T>
   PQFlashIndex<T>::~PQFlashIndex() {
+    if (cache_refresher.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(cache_refresh_mutex);
+        cache_refresh_stop = true;
+      }
+      cache_refresh_cv.notify_one();
+      cache_refresher.join();
+    }
 #ifndef EXEC_ENV_OLS
     if (data != nullptr) {
       delete[] data;
@@ -118,6 +131,7 @@ namespace diskann {
   void PQFlashIndex<T>::setup_thread_data(_u64 nthreads) {
     LOG(INFO) << "Setting up thread-specific contexts for nthreads: "
               << nthreads;
+    std::vector<std::pair<void *, uint64_t>> sector_bufs;
     for (_s64 thread = 0; thread < (_s64) nthreads; thread++) {
       QueryScratch<T> scratch;
       _u64 coord_alloc_size = ROUND_UP(sizeof(T) * this->aligned_dim, 256);
@@ -149,7 +163,11 @@ namespace diskann {
       ThreadData<T> data;
       data.scratch = scratch;
       this->thread_data.push(data);
+      sector_bufs.emplace_back(scratch.sector_scratch,
+                               (_u64) MAX_N_SECTOR_READS * read_len_for_node);
     }
+    // every search reads its sectors into these, let the reader pin them once
+    reader->register_buffers(sector_bufs);
     load_flag = true;
   }
 
@@ -182,38 +200,51 @@ namespace diskann {
     LOG_KNOWHERE_DEBUG_ << "Loading the cache list(" << num_cached_nodes
                         << " points) into memory...";
 
-    auto ctx = this->reader->get_ctx();
-
     nhood_cache_buf = new unsigned[num_cached_nodes * (max_degree + 1)];
-    memset(nhood_cache_buf, 0, num_cached_nodes * (max_degree + 1));
+    memset(nhood_cache_buf, 0,
+           num_cached_nodes * (max_degree + 1) * sizeof(unsigned));
 
     _u64 coord_cache_buf_len = num_cached_nodes * aligned_dim;
     diskann::alloc_aligned((void **) &coord_cache_buf,
                            coord_cache_buf_len * sizeof(T), 8 * sizeof(T));
     memset(coord_cache_buf, 0, coord_cache_buf_len * sizeof(T));
+    node_cache_slots = num_cached_nodes;
+
+    std::vector<_u64> slots(num_cached_nodes);
+    std::iota(slots.begin(), slots.end(), 0);
+    auto cache = std::make_shared<NodeCache>();
+    load_nodes_to_cache(node_list, slots, *cache);
+    std::atomic_store(&node_cache,
+                      std::shared_ptr<const NodeCache>(std::move(cache)));
+    LOG_KNOWHERE_DEBUG_ << "done.";
+  }
+
+  template<typename T>
+  void PQFlashIndex<T>::load_nodes_to_cache(const std::vector<_u32> &ids,
+                                            const std::vector<_u64> &slots,
+                                            NodeCache               &cache) {
+    auto ctx = this->reader->get_ctx();
 
     size_t BLOCK_SIZE = 32;
-    size_t num_blocks = DIV_ROUND_UP(num_cached_nodes, BLOCK_SIZE);
+    size_t num_blocks = DIV_ROUND_UP(ids.size(), BLOCK_SIZE);
+    char  *block_buf = nullptr;
+    alloc_aligned((void **) &block_buf, BLOCK_SIZE * read_len_for_node,
+                  SECTOR_LEN);
 
     for (_u64 block = 0; block < num_blocks; block++) {
       _u64 start_idx = block * BLOCK_SIZE;
-      _u64 end_idx = (std::min)(num_cached_nodes, (block + 1) * BLOCK_SIZE);
-      std::vector<AlignedRead>             read_reqs;
-      std::vector<std::pair<_u32, char *>> nhoods;
+      _u64 end_idx = (std::min)(ids.size(), (block + 1) * BLOCK_SIZE);
+      std::vector<AlignedRead> read_reqs;
       for (_u64 node_idx = start_idx; node_idx < end_idx; node_idx++) {
         AlignedRead read;
-        char       *buf = nullptr;
-        alloc_aligned((void **) &buf, read_len_for_node, SECTOR_LEN);
-        nhoods.push_back(std::make_pair(node_list[node_idx], buf));
         read.len = read_len_for_node;
-        read.buf = buf;
-        read.offset = get_node_sector_offset(node_list[node_idx]);
+        read.buf = block_buf + (node_idx - start_idx) * read_len_for_node;
+        read.offset = get_node_sector_offset(ids[node_idx]);
         read_reqs.push_back(read);
       }
 
       reader->read(read_reqs, ctx);
 
-      _u64 node_idx = start_idx;
       for (_u32 i = 0; i < read_reqs.size(); i++) {
 #if defined(_WINDOWS) && \
     defined(USE_BING_INFRA)  // this block is to handle failed reads in
@@ -222,12 +253,13 @@ namespace diskann {
           continue;
         }
 #endif
-        auto &nhood = nhoods[i];
-        char *node_buf = get_offset_to_node(nhood.second, nhood.first);
+        const _u32 id = ids[start_idx + i];
+        const _u64 slot = slots[start_idx + i];
+        char *node_buf = get_offset_to_node((char *) read_reqs[i].buf, id);
         T    *node_coords = OFFSET_TO_NODE_COORDS(node_buf);
-        T    *cached_coords = coord_cache_buf + node_idx * aligned_dim;
+        T    *cached_coords = coord_cache_buf + slot * aligned_dim;
         memcpy(cached_coords, node_coords, disk_bytes_per_point);
-        coord_cache.insert(std::make_pair(nhood.first, cached_coords));
+        cache.coord.insert(std::make_pair(id, cached_coords));
 
         // insert node nhood into nhood_cache
         unsigned *node_nhood = OFFSET_TO_NODE_NHOOD(node_buf);
@@ -236,15 +268,13 @@ namespace diskann {
         unsigned                   *nbrs = node_nhood + 1;
         std::pair<_u32, unsigned *> cnhood;
         cnhood.first = nnbrs;
-        cnhood.second = nhood_cache_buf + node_idx * (max_degree + 1);
+        cnhood.second = nhood_cache_buf + slot * (max_degree + 1);
         memcpy(cnhood.second, nbrs, nnbrs * sizeof(unsigned));
-        nhood_cache.insert(std::make_pair(nhood.first, cnhood));
-        aligned_free(nhood.second);
-        node_idx++;
+        cache.nhood.insert(std::make_pair(id, cnhood));
       }
     }
+    aligned_free(block_buf);
     this->reader->put_ctx(ctx);
-    LOG_KNOWHERE_DEBUG_ << "done.";
   }
 
 #ifdef EXEC_ENV_OLS
@@ -851,30 +881,35 @@ namespace diskann {
     knowhere::ResultMaxHeap<float, int64_t> pq_max_heap(pq_topk);
     T *data_buf = query_scratch->coord_scratch;
     std::unordered_map<_u64, std::vector<_u64>> nodes_in_sectors_to_visit;
+    const auto cache = get_node_cache();
     std::vector<AlignedRead>                    frontier_read_reqs;
     frontier_read_reqs.reserve(beam_width);
     char *sector_scratch = query_scratch->sector_scratch;
     _u64 &sector_scratch_idx = query_scratch->sector_idx;
     knowhere::ResultMaxHeap<float, _u64> max_heap(k_search);
     Timer                                io_timer, query_timer;
+    double                               io_us = 0;
 
     // scan un-marked points and calculate pq dists
-    for (_u64 id = 0; id < num_points; ++id) {
-      if (!bitset_view.test(id)) {
-        pq_batch_ids.push_back(id);
-      }
-
-      if (pq_batch_ids.size() == pq_batch_size || id == num_points - 1) {
-        const size_t sz = pq_batch_ids.size();
-        aggregate_coords(pq_batch_ids.data(), sz, this->data, this->n_chunks,
-                         pq_coord_scratch);
-        pq_dist_lookup(pq_coord_scratch, sz, this->n_chunks, pq_dists,
-                       dist_scratch);
-        for (size_t i = 0; i < sz; ++i) {
-          pq_max_heap.Push(dist_scratch[i], pq_batch_ids[i]);
-        }
-        pq_batch_ids.clear();
+    auto flush_pq_batch = [&]() {
+      const size_t sz = pq_batch_ids.size();
+      aggregate_coords(pq_batch_ids.data(), sz, this->data, this->n_chunks,
+                       pq_coord_scratch);
+      pq_dist_lookup(pq_coord_scratch, sz, this->n_chunks, pq_dists,
+                     dist_scratch);
+      for (size_t i = 0; i < sz; ++i) {
+        pq_max_heap.Push(dist_scratch[i], pq_batch_ids[i]);
+      }
+      pq_batch_ids.clear();
+    };
+    knowhere::ForEachValidId(bitset_view, num_points, [&](size_t id) {
+      pq_batch_ids.push_back(id);
+      if (pq_batch_ids.size() == pq_batch_size) {
+        flush_pq_batch();
       }
+    });
+    if (!pq_batch_ids.empty()) {
+      flush_pq_batch();
     }
 
     // deduplicate sectors by ids
@@ -882,9 +917,10 @@ namespace diskann {
       const auto [dist, id] = opt.value();
 
       // check if in cache
-      if (coord_cache.find(id) != coord_cache.end()) {
+      auto coord_iter = cache->coord.find(id);
+      if (coord_iter != cache->coord.end()) {
         float dist =
-            dist_cmp_wrap(query, coord_cache.at(id), (size_t) aligned_dim, id);
+            dist_cmp_wrap(query, coord_iter->second, (size_t) aligned_dim, id);
         max_heap.Push(dist, id);
         continue;
       }
@@ -915,8 +951,10 @@ namespace diskann {
 #else
         reader->read(frontier_read_reqs, ctx);  // synchronous IO linux
 #endif
+        const double read_us = (double) io_timer.elapsed();
+        io_us += read_us;
         if (stats != nullptr) {
-          stats->io_us += (double) io_timer.elapsed();
+          stats->io_us += read_us;
         }
 
         T *node_fp_coords_copy = data_buf;
@@ -967,6 +1005,8 @@ namespace diskann {
         LOG(ERROR) << "Size is incorrect";
       }
     }
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::IO_WAIT,
+                                 io_us / 1000);
     if (stats != nullptr) {
       stats->total_us = (double) query_timer.elapsed();
     }
@@ -974,57 +1014,159 @@ namespace diskann {
   }
 
   template<typename T>
-  void PQFlashIndex<T>::cached_beam_search(
-      const T *query1, const _u64 k_search, const _u64 l_search, _s64 *indices,
-      float *distances, const _u64 beam_width, const bool use_reorder_data,
-      QueryStats *stats, const knowhere::feder::diskann::FederResultUniq &feder,
-      knowhere::BitsetView bitset_view, const float filter_ratio_in, const bool for_tuning) {
-    if (beam_width > MAX_N_SECTOR_READS)
-      throw ANNException("Beamwidth can not be higher than MAX_N_SECTOR_READS",
-                         -1, __FUNCSIG__, __FILE__, __LINE__);
+  uint64_t PQFlashIndex<T>::init_beam_search(ThreadData<T>   &data,
+                                             BeamSearchState &state,
+                                             const bool       for_tuning) {
+    auto         query_scratch = &(data.scratch);
+    const float *query_float = query_scratch->aligned_query_float;
 
-    ThreadData<T> data = this->thread_data.pop();
-    while (data.scratch.sector_scratch == nullptr) {
-      this->thread_data.wait_for_push_notify();
-      data = this->thread_data.pop();
+    // query <-> PQ chunk centers distances
+    float *pq_dists = query_scratch->aligned_pqtable_dist_scratch;
+    pq_table.populate_chunk_distances(query_float, pq_dists);
+
+    auto vec_hash = knowhere::hash_vec(query_float, data_dim);
+    _u32 best_medoid = 0;
+    // for tuning, do not use cache
+    if (for_tuning || !get_cached_entry_point(vec_hash, best_medoid)) {
+      float best_dist = (std::numeric_limits<float>::max)();
+      for (_u64 cur_m = 0; cur_m < num_medoids; cur_m++) {
+        float cur_expanded_dist =
+            dist_cmp_float_wrap(query_float, centroid_data + aligned_dim * cur_m,
+                           (size_t) aligned_dim, medoids[cur_m]);
+        if (cur_expanded_dist < best_dist) {
+          best_medoid = medoids[cur_m];
+          best_dist = cur_expanded_dist;
+        }
+      }
     }
-    auto query_norm_opt = init_thread_data(data, query1);
-    if (!query_norm_opt.has_value()) {
-      // return an empty answer when calcu a zero point
-      this->thread_data.push(data);
-      this->thread_data.push_notify_all();
-      return;
+
+    float *dist_scratch = query_scratch->aligned_dist_scratch;
+    _u8   *pq_coord_scratch = query_scratch->aligned_pq_coord_scratch;
+    aggregate_coords(&best_medoid, 1, this->data, this->n_chunks,
+                     pq_coord_scratch);
+    pq_dist_lookup(pq_coord_scratch, 1, this->n_chunks, pq_dists,
+                   dist_scratch);
+    state.retset[0] = Neighbor(best_medoid, dist_scratch[0], true);
+    state.cur_list_size = 1;
+    state.k = 0;
+    query_scratch->visited->insert(best_medoid);
+    return vec_hash;
+  }
+
+  template<typename T>
+  unsigned PQFlashIndex<T>::take_candidate(BeamSearchState     &state,
+                                           unsigned            &pos,
+                                           knowhere::BitsetView bitset_view) {
+    std::vector<Neighbor> &retset = state.retset;
+    const unsigned         id = retset[pos].id;
+    retset[pos].flag = false;
+    if (this->count_visited_nodes) {
+      reinterpret_cast<std::atomic<_u32> &>(this->node_visit_counter[id].second)
+          .fetch_add(1);
     }
-    float query_norm = query_norm_opt.value();
-    auto  ctx = this->reader->get_ctx();
+    if (!bitset_view.empty() && bitset_view.test(id)) {
+      std::memmove(&retset[pos], &retset[pos + 1],
+                   (state.cur_list_size - pos - 1) * sizeof(Neighbor));
+      state.cur_list_size--;
+    } else {
+      pos++;
+    }
+    return id;
+  }
 
-    if (!bitset_view.empty()) {
-      const auto filter_threshold =
-          filter_ratio_in < 0 ? calcFilterThreshold(k_search) : filter_ratio_in;
-      const auto bv_cnt = bitset_view.count();
-      if (bitset_view.size() == bv_cnt) {
-        for (_u64 i = 0; i < k_search; i++) {
-          indices[i] = -1;
-          if (distances != nullptr) {
-            distances[i] = -1;
-          }
-        }
-        return;
+  template<typename T>
+  unsigned PQFlashIndex<T>::expand_node(
+      ThreadData<T> &data, BeamSearchState &state, const unsigned id,
+      const T *coords, const _u64 nnbrs, const unsigned *nbrs,
+      const _u64 l_search, QueryStats *stats,
+      const knowhere::feder::diskann::FederResultUniq &feder,
+      knowhere::BitsetView                             bitset_view) {
+    auto        &scratch = data.scratch;
+    const T     *query = scratch.aligned_query_T;
+    const float *query_float = scratch.aligned_query_float;
+    if (bitset_view.empty() || !bitset_view.test(id)) {
+      float cur_expanded_dist;
+      if (!use_disk_index_pq) {
+        cur_expanded_dist =
+            dist_cmp_wrap(query, coords, (size_t) aligned_dim, id);
+      } else {
+        if (metric == diskann::Metric::INNER_PRODUCT ||
+            metric == diskann::Metric::COSINE)
+          cur_expanded_dist =
+              disk_pq_table.inner_product(query_float, (_u8 *) coords);
+        else
+          cur_expanded_dist =
+              disk_pq_table.l2_distance(query_float, (_u8 *) coords);
       }
+      state.full_retset.push_back(Neighbor(id, cur_expanded_dist, true));
 
-      if (bv_cnt >= bitset_view.size() * filter_threshold) {
-        brute_force_beam_search(data, query_norm, k_search, indices, distances,
-                                beam_width, ctx, stats, feder, bitset_view);
-        this->thread_data.push(data);
-        this->thread_data.push_notify_all();
-        this->reader->put_ctx(ctx);
-        return;
+      // add top candidate info into feder result
+      if (feder != nullptr) {
+        feder->visit_info_.AddTopCandidateInfo(id, cur_expanded_dist);
+        feder->id_set_.insert(id);
       }
     }
 
-    auto         query_scratch = &(data.scratch);
-    const T     *query = data.scratch.aligned_query_T;
-    const float *query_float = data.scratch.aligned_query_float;
+    // compute nbrs <-> query dists in PQ space, the query <-> PQ chunk
+    // centers distances were filled by init_beam_search()
+    Timer  cpu_timer;
+    float *dist_scratch = scratch.aligned_dist_scratch;
+    aggregate_coords(nbrs, nnbrs, this->data, this->n_chunks,
+                     scratch.aligned_pq_coord_scratch);
+    pq_dist_lookup(scratch.aligned_pq_coord_scratch, nnbrs, this->n_chunks,
+                   scratch.aligned_pqtable_dist_scratch, dist_scratch);
+
+    std::vector<Neighbor> &retset = state.retset;
+    unsigned              &cur_list_size = state.cur_list_size;
+    tsl::robin_set<_u64>  &visited = *(scratch.visited);
+    unsigned               best = cur_list_size;
+    for (_u64 m = 0; m < nnbrs; ++m) {
+      unsigned nbr_id = nbrs[m];
+
+      // add neighbor info into feder result
+      if (feder != nullptr) {
+        feder->visit_info_.AddTopCandidateNeighbor(id, nbr_id,
+                                                   dist_scratch[m]);
+        feder->id_set_.insert(nbr_id);
+      }
+
+      if (visited.find(nbr_id) != visited.end()) {
+        continue;
+      }
+      visited.insert(nbr_id);
+      float dist = dist_scratch[m];
+      if (cur_list_size > 0 && dist >= retset[cur_list_size - 1].distance &&
+          (cur_list_size == l_search)) {
+        if (state.keep_dropped)
+          state.dropped.emplace_back(nbr_id, dist, true);
+        continue;
+      }
+      Neighbor nn(nbr_id, dist, true);
+      // Return position in sorted list where nn inserted.
+      auto r = InsertIntoPool(retset.data(), cur_list_size, nn);
+      if (cur_list_size < l_search)
+        ++cur_list_size;
+      else if (state.keep_dropped && r < cur_list_size &&
+               retset[cur_list_size].flag)
+        // the last candidate was pushed out of the full list
+        state.dropped.push_back(retset[cur_list_size]);
+      best = std::min(best, r);
+    }
+
+    if (stats != nullptr) {
+      stats->n_cmps += (double) nnbrs;
+      stats->cpu_us += (double) cpu_timer.elapsed();
+    }
+    return best;
+  }
+
+  template<typename T>
+  void PQFlashIndex<T>::expand_candidates(
+      ThreadData<T> &data, IOContext &ctx, BeamSearchState &state,
+      const _u64 l_search, const _u64 beam_width, QueryStats *stats,
+      const knowhere::feder::diskann::FederResultUniq &feder,
+      knowhere::BitsetView                             bitset_view) {
+    auto query_scratch = &(data.scratch);
 
     // pointers to buffers for data
     T *data_buf = query_scratch->coord_scratch;
@@ -1033,7 +1175,7 @@ namespace diskann {
     char *sector_scratch = query_scratch->sector_scratch;
     _u64 &sector_scratch_idx = query_scratch->sector_idx;
 
-    Timer io_timer, query_timer;
+    Timer io_timer;
     // cleared every iteration
     std::vector<unsigned> frontier;
     frontier.reserve(2 * beam_width);
@@ -1044,61 +1186,13 @@ namespace diskann {
     std::vector<std::pair<unsigned, std::pair<unsigned, unsigned *>>>
         cached_nhoods;
     cached_nhoods.reserve(2 * beam_width);
+    const auto cache = get_node_cache();
+    _u64       cache_hits = 0, cache_misses = 0;
 
-    // query <-> PQ chunk centers distances
-    float *pq_dists = query_scratch->aligned_pqtable_dist_scratch;
-    pq_table.populate_chunk_distances(query_float, pq_dists);
-
-    // query <-> neighbor list
-    float *dist_scratch = query_scratch->aligned_dist_scratch;
-    _u8   *pq_coord_scratch = query_scratch->aligned_pq_coord_scratch;
-
-    // lambda to batch compute query<-> node distances in PQ space
-    auto compute_dists = [this, pq_coord_scratch, pq_dists](const unsigned *ids,
-                                                            const _u64 n_ids,
-                                                            float *dists_out) {
-      aggregate_coords(ids, n_ids, this->data, this->n_chunks,
-                       pq_coord_scratch);
-      pq_dist_lookup(pq_coord_scratch, n_ids, this->n_chunks, pq_dists,
-                     dists_out);
-    };
-    Timer                 cpu_timer;
-    std::vector<Neighbor> retset(l_search + 1);
-    tsl::robin_set<_u64> &visited = *(query_scratch->visited);
-
-    std::vector<Neighbor> full_retset;
-    full_retset.reserve(4096);
-    auto vec_hash = knowhere::hash_vec(query_float, data_dim);
-    _u32 best_medoid = 0;
-    // for tuning, do not use cache
-    if (for_tuning || !lru_cache.try_get(vec_hash, best_medoid)) {
-      float best_dist = (std::numeric_limits<float>::max)();
-      std::vector<SimpleNeighbor> medoid_dists;
-      for (_u64 cur_m = 0; cur_m < num_medoids; cur_m++) {
-        float cur_expanded_dist =
-            dist_cmp_float_wrap(query_float, centroid_data + aligned_dim * cur_m,
-                           (size_t) aligned_dim, medoids[cur_m]);
-        if (cur_expanded_dist < best_dist) {
-          best_medoid = medoids[cur_m];
-          best_dist = cur_expanded_dist;
-        }
-      }
-    }
-
-    compute_dists(&best_medoid, 1, dist_scratch);
-    retset[0].id = best_medoid;
-    retset[0].flag = true;
-    retset[0].distance = dist_scratch[0];
-    visited.insert(best_medoid);
-
-    unsigned cur_list_size = 1;
-
-    std::sort(retset.begin(), retset.begin() + cur_list_size);
-
-    unsigned cmps = 0;
-    unsigned hops = 0;
-    unsigned num_ios = 0;
-    unsigned k = 0;
+    std::vector<Neighbor> &retset = state.retset;
+    unsigned              &cur_list_size = state.cur_list_size;
+    unsigned              &k = state.k;
+    double                &io_us = state.io_us;
 
     while (k < cur_list_size) {
       auto nk = cur_list_size;
@@ -1115,28 +1209,21 @@ namespace diskann {
              num_seen < beam_width) {
         if (retset[marker].flag) {
           num_seen++;
-          auto iter = nhood_cache.find(retset[marker].id);
-          if (iter != nhood_cache.end()) {
-            cached_nhoods.push_back(
-                std::make_pair(retset[marker].id, iter->second));
+          const unsigned id = take_candidate(state, marker, bitset_view);
+          auto           iter = cache->nhood.find(id);
+          const bool     hit = iter != cache->nhood.end();
+          if (hit) {
+            cached_nhoods.push_back(std::make_pair(id, iter->second));
+            cache_hits++;
             if (stats != nullptr) {
               stats->n_cache_hits++;
             }
           } else {
-            frontier.push_back(retset[marker].id);
-          }
-          retset[marker].flag = false;
-          if (this->count_visited_nodes) {
-            reinterpret_cast<std::atomic<_u32> &>(
-                this->node_visit_counter[retset[marker].id].second)
-                .fetch_add(1);
+            frontier.push_back(id);
+            cache_misses++;
           }
-          if (!bitset_view.empty() && bitset_view.test(retset[marker].id)) {
-            std::memmove(&retset[marker], &retset[marker + 1],
-                         (cur_list_size - marker - 1) * sizeof(Neighbor));
-            cur_list_size--;
-          } else {
-            marker++;
+          if (node_access_sketch != nullptr) {
+            record_node_access(id, hit);
           }
         } else {
           marker++;
@@ -1161,7 +1248,6 @@ namespace diskann {
             stats->n_4k++;
             stats->n_ios++;
           }
-          num_ios++;
         }
         io_timer.reset();
 #ifdef USE_BING_INFRA
@@ -1169,83 +1255,23 @@ namespace diskann {
 #else
         reader->read(frontier_read_reqs, ctx);  // synchronous IO linux
 #endif
+        const double read_us = (double) io_timer.elapsed();
+        io_us += read_us;
         if (stats != nullptr) {
-          stats->io_us += (double) io_timer.elapsed();
+          stats->io_us += read_us;
         }
       }
 
       // process cached nhoods
       for (auto &cached_nhood : cached_nhoods) {
-        auto global_cache_iter = coord_cache.find(cached_nhood.first);
-        T   *node_fp_coords_copy = global_cache_iter->second;
-        if (bitset_view.empty() || !bitset_view.test(cached_nhood.first)) {
-          float cur_expanded_dist;
-          if (!use_disk_index_pq) {
-            cur_expanded_dist =
-                dist_cmp_wrap(query, node_fp_coords_copy, (size_t) aligned_dim,
-                         cached_nhood.first);
-          } else {
-            if (metric == diskann::Metric::INNER_PRODUCT ||
-                metric == diskann::Metric::COSINE)
-              cur_expanded_dist = disk_pq_table.inner_product(
-                  query_float, (_u8 *) node_fp_coords_copy);
-            else
-              cur_expanded_dist = disk_pq_table.l2_distance(
-                  query_float, (_u8 *) node_fp_coords_copy);
-          }
-          full_retset.push_back(
-              Neighbor((unsigned) cached_nhood.first, cur_expanded_dist, true));
-
-          // add top candidate info into feder result
-          if (feder != nullptr) {
-            feder->visit_info_.AddTopCandidateInfo(cached_nhood.first,
-                                                   cur_expanded_dist);
-            feder->id_set_.insert(cached_nhood.first);
-          }
-        }
-        _u64      nnbrs = cached_nhood.second.first;
-        unsigned *node_nbrs = cached_nhood.second.second;
-
-        // compute node_nbrs <-> query dists in PQ space
-        cpu_timer.reset();
-        compute_dists(node_nbrs, nnbrs, dist_scratch);
-        if (stats != nullptr) {
-          stats->n_cmps += (double) nnbrs;
-          stats->cpu_us += (double) cpu_timer.elapsed();
-        }
-
-        // process prefetched nhood
-        for (_u64 m = 0; m < nnbrs; ++m) {
-          unsigned id = node_nbrs[m];
-
-          // add neighbor info into feder result
-          if (feder != nullptr) {
-            feder->visit_info_.AddTopCandidateNeighbor(cached_nhood.first, id,
-                                                       dist_scratch[m]);
-            feder->id_set_.insert(id);
-          }
-
-          if (visited.find(id) != visited.end()) {
-            continue;
-          } else {
-            visited.insert(id);
-            cmps++;
-            float dist = dist_scratch[m];
-            if (cur_list_size > 0 &&
-                dist >= retset[cur_list_size - 1].distance &&
-                (cur_list_size == l_search))
-              continue;
-            Neighbor nn(id, dist, true);
-            // Return position in sorted list where nn inserted.
-            auto r = InsertIntoPool(retset.data(), cur_list_size, nn);
-            if (cur_list_size < l_search)
-              ++cur_list_size;
-            if (r < nk)
-              // nk logs the best position in the retset that was
-              // updated due to neighbors of n.
-              nk = r;
-          }
-        }
+        auto r = expand_node(data, state, cached_nhood.first,
+                             cache->coord.at(cached_nhood.first),
+                             cached_nhood.second.first,
+                             cached_nhood.second.second, l_search, stats,
+                             feder, bitset_view);
+        // nk logs the best position in the retset that was updated due to
+        // neighbors of n.
+        nk = std::min(nk, r);
       }
 #ifdef USE_BING_INFRA
       // process each frontier nhood - compute distances to unvisited nodes
@@ -1266,95 +1292,91 @@ namespace diskann {
         char *node_disk_buf =
             get_offset_to_node(frontier_nhood.second, frontier_nhood.first);
         unsigned *node_buf = OFFSET_TO_NODE_NHOOD(node_disk_buf);
-        _u64      nnbrs = (_u64) (*node_buf);
-        T        *node_fp_coords = OFFSET_TO_NODE_COORDS(node_disk_buf);
+        T        *node_fp_coords_copy = data_buf;
+        memcpy(node_fp_coords_copy, OFFSET_TO_NODE_COORDS(node_disk_buf),
+               disk_bytes_per_point);
+        auto r = expand_node(data, state, frontier_nhood.first,
+                             node_fp_coords_copy, (_u64) (*node_buf),
+                             node_buf + 1, l_search, stats, feder, bitset_view);
+        nk = std::min(nk, r);
+      }
 
-        T *node_fp_coords_copy = data_buf;
-        memcpy(node_fp_coords_copy, node_fp_coords, disk_bytes_per_point);
-        if (bitset_view.empty() || !bitset_view.test(frontier_nhood.first)) {
-          float cur_expanded_dist;
-          if (!use_disk_index_pq) {
-            cur_expanded_dist =
-                dist_cmp_wrap(query, node_fp_coords_copy, (size_t) aligned_dim,
-                         frontier_nhood.first);
-          } else {
-            if (metric == diskann::Metric::INNER_PRODUCT ||
-                metric == diskann::Metric::COSINE)
-              cur_expanded_dist = disk_pq_table.inner_product(
-                  query_float, (_u8 *) node_fp_coords_copy);
-            else
-              cur_expanded_dist = disk_pq_table.l2_distance(
-                  query_float, (_u8 *) node_fp_coords_copy);
-          }
-          full_retset.push_back(
-              Neighbor(frontier_nhood.first, cur_expanded_dist, true));
-
-          // add top candidate info into feder result
-          if (feder != nullptr) {
-            feder->visit_info_.AddTopCandidateInfo(frontier_nhood.first,
-                                                   cur_expanded_dist);
-            feder->id_set_.insert(frontier_nhood.first);
-          }
-        }
-        unsigned *node_nbrs = (node_buf + 1);
-        // compute node_nbrs <-> query dist in PQ space
-        cpu_timer.reset();
-        compute_dists(node_nbrs, nnbrs, dist_scratch);
-        if (stats != nullptr) {
-          stats->n_cmps += (double) nnbrs;
-          stats->cpu_us += (double) cpu_timer.elapsed();
-        }
+      // update best inserted position
+      if (nk <= k)
+        k = nk;  // k is the best position in retset updated in this round.
+      else
+        ++k;
+    }
+    count_node_cache_accesses(cache_hits, cache_misses);
+  }
 
-        cpu_timer.reset();
-        // process prefetch-ed nhood
-        for (_u64 m = 0; m < nnbrs; ++m) {
-          unsigned id = node_nbrs[m];
+  template<typename T>
+  void PQFlashIndex<T>::cached_beam_search(
+      const T *query1, const _u64 k_search, const _u64 l_search, _s64 *indices,
+      float *distances, const _u64 beam_width, const bool use_reorder_data,
+      QueryStats *stats, const knowhere::feder::diskann::FederResultUniq &feder,
+      knowhere::BitsetView bitset_view, const float filter_ratio_in, const bool for_tuning) {
+    if (beam_width > MAX_N_SECTOR_READS)
+      throw ANNException("Beamwidth can not be higher than MAX_N_SECTOR_READS",
+                         -1, __FUNCSIG__, __FILE__, __LINE__);
 
-          // add neighbor info into feder result
-          if (feder != nullptr) {
-            feder->visit_info_.AddTopCandidateNeighbor(frontier_nhood.first, id,
-                                                       dist_scratch[m]);
-            feder->id_set_.insert(frontier_nhood.first);
-          }
+    ThreadData<T> data = this->thread_data.pop();
+    while (data.scratch.sector_scratch == nullptr) {
+      this->thread_data.wait_for_push_notify();
+      data = this->thread_data.pop();
+    }
+    auto query_norm_opt = init_thread_data(data, query1);
+    if (!query_norm_opt.has_value()) {
+      // return an empty answer when calcu a zero point
+      this->thread_data.push(data);
+      this->thread_data.push_notify_all();
+      return;
+    }
+    float query_norm = query_norm_opt.value();
+    auto  ctx = this->reader->get_ctx();
 
-          if (visited.find(id) != visited.end()) {
-            continue;
-          } else {
-            visited.insert(id);
-            cmps++;
-            float dist = dist_scratch[m];
-            if (stats != nullptr) {
-              stats->n_cmps++;
-            }
-            if (cur_list_size > 0 &&
-                dist >= retset[cur_list_size - 1].distance &&
-                (cur_list_size == l_search))
-              continue;
-            Neighbor nn(id, dist, true);
-            auto     r = InsertIntoPool(
-                    retset.data(), cur_list_size,
-                    nn);  // Return position in sorted list where nn inserted.
-            if (cur_list_size < l_search)
-              ++cur_list_size;
-            if (r < nk)
-              nk = r;  // nk logs the best position in the retset that was
-                       // updated due to neighbors of n.
+    if (!bitset_view.empty()) {
+      const auto filter_threshold =
+          filter_ratio_in < 0 ? calcFilterThreshold(k_search) : filter_ratio_in;
+      // the beam search always filters while it walks, never after
+      const auto strategy = knowhere::ChooseFilterStrategy(
+          bitset_view, bitset_view.size(), 0.0f, filter_threshold);
+      if (strategy == knowhere::FilterStrategy::ALL_FILTERED) {
+        for (_u64 i = 0; i < k_search; i++) {
+          indices[i] = -1;
+          if (distances != nullptr) {
+            distances[i] = -1;
           }
         }
+        return;
+      }
 
-        if (stats != nullptr) {
-          stats->cpu_us += (double) cpu_timer.elapsed();
-        }
+      if (strategy == knowhere::FilterStrategy::BRUTE_FORCE) {
+        brute_force_beam_search(data, query_norm, k_search, indices, distances,
+                                beam_width, ctx, stats, feder, bitset_view);
+        this->thread_data.push(data);
+        this->thread_data.push_notify_all();
+        this->reader->put_ctx(ctx);
+        return;
       }
+    }
 
-      // update best inserted position
-      if (nk <= k)
-        k = nk;  // k is the best position in retset updated in this round.
-      else
-        ++k;
+    auto  query_scratch = &(data.scratch);
+    const T *query = data.scratch.aligned_query_T;
 
-      hops++;
-    }
+    // sector scratch
+    char *sector_scratch = query_scratch->sector_scratch;
+
+    Timer io_timer, query_timer;
+
+    BeamSearchState state;
+    state.retset.resize(l_search + 1);
+    state.full_retset.reserve(4096);
+    auto vec_hash = init_beam_search(data, state, for_tuning);
+    expand_candidates(data, ctx, state, l_search, beam_width, stats, feder,
+                      bitset_view);
+    std::vector<Neighbor> &full_retset = state.full_retset;
+    double                &io_us = state.io_us;
 
     // re-sort by distance
     std::sort(full_retset.begin(), full_retset.end(),
@@ -1394,8 +1416,10 @@ namespace diskann {
 #else
       reader->read(vec_read_reqs, ctx);     // synchronous IO linux
 #endif
+      const double read_us = (double) io_timer.elapsed();
+      io_us += read_us;
       if (stats != nullptr) {
-        stats->io_us += io_timer.elapsed();
+        stats->io_us += read_us;
       }
 
       for (size_t i = 0; i < full_retset.size(); ++i) {
@@ -1437,70 +1461,526 @@ namespace diskann {
       }
     }
     if (k_search > 0) {
-      lru_cache.put(vec_hash, indices[0]);
+      entry_cache.put(vec_hash, indices[0]);
     }
 
     this->thread_data.push(data);
     this->thread_data.push_notify_all();
     this->reader->put_ctx(ctx);
+    maybe_refresh_node_cache(1);
     // std::cout << num_ios << " " <<stats << std::endl;
 
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::IO_WAIT,
+                                 io_us / 1000);
     if (stats != nullptr) {
       stats->total_us = (double) query_timer.elapsed();
     }
   }
 
-  // range search returns results of all neighbors within distance of range.
-  // indices and distances need to be pre-allocated of size l_search and the
-  // return value is the number of matching hits.
+  template<typename T>
+  void PQFlashIndex<T>::pipelined_beam_search(
+      const T *queries, const _u64 nq, const _u64 query_stride,
+      const _u64 k_search, const _u64 l_search, _s64 *indices,
+      float *distances, const _u64 beam_width, const _u64 pipeline_width,
+      knowhere::BitsetView bitset_view, const float filter_ratio_in,
+      const bool for_tuning) {
+    if (beam_width == 0 || beam_width > MAX_N_SECTOR_READS)
+      throw ANNException("Beamwidth should be in [1, MAX_N_SECTOR_READS]", -1,
+                         __FUNCSIG__, __FILE__, __LINE__);
+    if (nq == 0) {
+      return;
+    }
+
+    auto fill_empty = [&](const _u64 q) {
+      for (_u64 i = 0; i < k_search; i++) {
+        indices[q * k_search + i] = -1;
+        if (distances != nullptr) {
+          distances[q * k_search + i] = -1;
+        }
+      }
+    };
+
+    if (!bitset_view.empty()) {
+      const auto filter_threshold =
+          filter_ratio_in < 0 ? calcFilterThreshold(k_search) : filter_ratio_in;
+      const auto strategy = knowhere::ChooseFilterStrategy(
+          bitset_view, bitset_view.size(), 0.0f, filter_threshold);
+      if (strategy == knowhere::FilterStrategy::ALL_FILTERED) {
+        for (_u64 q = 0; q < nq; q++) {
+          fill_empty(q);
+        }
+        return;
+      }
+      // brute force reads in big batches already, nothing to overlap
+      if (strategy == knowhere::FilterStrategy::BRUTE_FORCE) {
+        for (_u64 q = 0; q < nq; q++) {
+          cached_beam_search(
+              queries + q * query_stride, k_search, l_search,
+              indices + q * k_search,
+              distances == nullptr ? nullptr : distances + q * k_search,
+              beam_width, false, nullptr, nullptr, bitset_view,
+              filter_ratio_in, for_tuning);
+        }
+        return;
+      }
+    }
+
+    struct QueryState {
+      ThreadData<T>   data;
+      bool            active = false;
+      _u64            q = 0;
+      float           query_norm = 0;
+      uint64_t        vec_hash = 0;
+      // no unexpanded candidate in search.retset before search.k
+      BeamSearchState search;
+      // sector scratch slots not used by a read, and the node each used slot
+      // is reading
+      std::vector<unsigned> free_slots;
+      std::vector<unsigned> slot_node;
+      _u64                  n_in_flight = 0;
+    };
+
+    // the first scratch is waited for, the others are only taken if idle so
+    // that a pipelined search never starves the regular ones
+    std::vector<QueryState> states(1);
+    states[0].data = this->thread_data.pop();
+    while (states[0].data.scratch.sector_scratch == nullptr) {
+      this->thread_data.wait_for_push_notify();
+      states[0].data = this->thread_data.pop();
+    }
+    const _u64 max_states = std::min(std::max<_u64>(pipeline_width, 1), nq);
+    while (states.size() < max_states) {
+      ThreadData<T> data = this->thread_data.pop();
+      if (data.scratch.sector_scratch == nullptr) {
+        break;
+      }
+      states.emplace_back();
+      states.back().data = data;
+    }
+    for (auto &s : states) {
+      s.search.retset.resize(l_search + 1);
+      s.search.full_retset.reserve(4096);
+      s.slot_node.resize(beam_width);
+    }
+
+    auto       ctx = this->reader->get_ctx();
+    const _u64 max_in_flight = this->reader->max_in_flight();
+    _u64       total_in_flight = 0;
+    _u64       next_q = 0;
+    const auto cache = get_node_cache();
+    _u64       cache_hits = 0, cache_misses = 0;
+
+    // move s to the next query that needs a search, false if none is left
+    auto assign = [&](QueryState &s) {
+      while (next_q < nq) {
+        s.q = next_q++;
+        auto query_norm_opt =
+            init_thread_data(s.data, queries + s.q * query_stride);
+        if (!query_norm_opt.has_value()) {
+          fill_empty(s.q);
+          continue;
+        }
+        s.query_norm = query_norm_opt.value();
+        s.search.full_retset.clear();
+        s.vec_hash = init_beam_search(s.data, s.search, for_tuning);
+        s.free_slots.clear();
+        for (unsigned slot = beam_width; slot > 0; slot--) {
+          s.free_slots.push_back(slot - 1);
+        }
+        s.n_in_flight = 0;
+        return true;
+      }
+      return false;
+    };
+
+    // whether s has a candidate left to expand, leaves s.search.k on it
+    auto has_candidate = [](QueryState &s) {
+      auto &search = s.search;
+      while (search.k < search.cur_list_size &&
+             !search.retset[search.k].flag) {
+        search.k++;
+      }
+      return search.k < search.cur_list_size;
+    };
+
+    // full distance of node id and PQ distances of its neighbors
+    auto expand = [&](QueryState &s, const unsigned id, const T *coords,
+                      const _u64 nnbrs, const unsigned *nbrs) {
+      auto r = expand_node(s.data, s.search, id, coords, nnbrs, nbrs, l_search,
+                           nullptr, nullptr, bitset_view);
+      s.search.k = std::min(s.search.k, r);
+    };
+
+    // take the best candidates of s while it has free slots and the context
+    // has room, cached nodes are expanded right away
+    auto issue = [&](QueryState &s, std::vector<AlignedRead> &reqs) {
+      while (!s.free_slots.empty() &&
+             total_in_flight + reqs.size() < max_in_flight &&
+             has_candidate(s)) {
+        const unsigned id = take_candidate(s.search, s.search.k, bitset_view);
+        auto           iter = cache->nhood.find(id);
+        const bool     hit = iter != cache->nhood.end();
+        if (node_access_sketch != nullptr) {
+          record_node_access(id, hit);
+        }
+        if (hit) {
+          cache_hits++;
+          expand(s, id, cache->coord.at(id), iter->second.first,
+                 iter->second.second);
+          continue;
+        }
+        cache_misses++;
+        const unsigned slot = s.free_slots.back();
+        s.free_slots.pop_back();
+        s.slot_node[slot] = id;
+        reqs.emplace_back(
+            get_node_sector_offset((size_t) id), read_len_for_node,
+            s.data.scratch.sector_scratch + slot * read_len_for_node);
+        s.n_in_flight++;
+      }
+    };
+
+    auto complete = [&](void *buf) {
+      for (auto &s : states) {
+        char *sector_scratch = s.data.scratch.sector_scratch;
+        if ((char *) buf < sector_scratch ||
+            (char *) buf >= sector_scratch + beam_width * read_len_for_node) {
+          continue;
+        }
+        const unsigned slot =
+            ((char *) buf - sector_scratch) / read_len_for_node;
+        const unsigned id = s.slot_node[slot];
+        s.free_slots.push_back(slot);
+        s.n_in_flight--;
+
+        char     *node_disk_buf = get_offset_to_node((char *) buf, id);
+        unsigned *node_buf = OFFSET_TO_NODE_NHOOD(node_disk_buf);
+        T        *node_fp_coords_copy = s.data.scratch.coord_scratch;
+        memcpy(node_fp_coords_copy, OFFSET_TO_NODE_COORDS(node_disk_buf),
+               disk_bytes_per_point);
+        expand(s, id, node_fp_coords_copy, (_u64) (*node_buf), node_buf + 1);
+        return;
+      }
+      throw ANNException("Completed read does not belong to any query", -1,
+                         __FUNCSIG__, __FILE__, __LINE__);
+    };
+
+    auto finish = [&](QueryState &s) {
+      std::vector<Neighbor> &full_retset = s.search.full_retset;
+      std::sort(full_retset.begin(), full_retset.end(),
+                [](const Neighbor &left, const Neighbor &right) {
+                  return left.distance < right.distance;
+                });
+      _s64  *res_ids = indices + s.q * k_search;
+      float *res_dists =
+          distances == nullptr ? nullptr : distances + s.q * k_search;
+      for (_u64 i = 0; i < k_search; i++) {
+        if (i >= full_retset.size()) {
+          res_ids[i] = -1;
+          if (res_dists != nullptr) {
+            res_dists[i] = -1;
+          }
+          continue;
+        }
+        res_ids[i] = full_retset[i].id;
+        if (res_dists != nullptr) {
+          res_dists[i] = full_retset[i].distance;
+          if (metric == diskann::Metric::INNER_PRODUCT) {
+            res_dists[i] = 1.0 - res_dists[i] / 2.0;
+            if (max_base_norm != 0)
+              res_dists[i] *= (max_base_norm * s.query_norm);
+          } else if (metric == diskann::Metric::COSINE) {
+            res_dists[i] = -res_dists[i];
+          }
+        }
+      }
+      if (k_search > 0 && res_ids[0] >= 0) {
+        entry_cache.put(s.vec_hash, res_ids[0]);
+      }
+    };
+
+    // reap at least min_nr reads, total_in_flight stays exact even if one of
+    // them failed
+    std::vector<void *> done_bufs;
+    done_bufs.reserve(max_in_flight);
+    double io_us = 0;
+    auto reap = [&](const size_t min_nr) {
+      done_bufs.clear();
+      Timer io_timer;
+      try {
+        this->reader->get_completed_req(ctx, min_nr, total_in_flight,
+                                        done_bufs);
+      } catch (...) {
+        total_in_flight -= done_bufs.size();
+        throw;
+      }
+      io_us += (double) io_timer.elapsed();
+      total_in_flight -= done_bufs.size();
+    };
+
+    auto release = [&]() {
+      for (auto &s : states) {
+        this->thread_data.push(s.data);
+      }
+      this->thread_data.push_notify_all();
+      this->reader->put_ctx(ctx);
+    };
+
+    try {
+      for (auto &s : states) {
+        s.active = assign(s);
+      }
+      std::vector<AlignedRead> reqs;
+      reqs.reserve(max_in_flight);
+      while (true) {
+        reqs.clear();
+        bool any_active = false;
+        for (auto &s : states) {
+          while (s.active) {
+            issue(s, reqs);
+            if (s.n_in_flight > 0 || has_candidate(s)) {
+              break;
+            }
+            finish(s);
+            s.active = assign(s);
+          }
+          any_active |= s.active;
+        }
+        if (!reqs.empty()) {
+          this->reader->submit_req(ctx, reqs);
+          total_in_flight += reqs.size();
+        }
+        if (!any_active) {
+          break;
+        }
+        // an active query without reads in flight always has a free slot, so
+        // it only issued nothing if the context is full
+        assert(total_in_flight > 0);
+        reap(1);
+        for (auto buf : done_bufs) {
+          complete(buf);
+        }
+      }
+    } catch (...) {
+      // the kernel may still write into the scratches, wait before handing
+      // them back
+      while (total_in_flight > 0) {
+        try {
+          reap(total_in_flight);
+        } catch (const std::exception &e) {
+          LOG(ERROR) << "failed to drain reads: " << e.what();
+          if (done_bufs.empty()) {
+            break;
+          }
+        }
+      }
+      release();
+      throw;
+    }
+    release();
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::IO_WAIT, io_us / 1000);
+    count_node_cache_accesses(cache_hits, cache_misses);
+    maybe_refresh_node_cache(nq);
+  }
+
   template<typename T>
   _u32 PQFlashIndex<T>::range_search(
       const T *query1, const double range, const _u64 min_l_search,
-      const _u64 max_l_search, std::vector<_s64> &indices,
-      std::vector<float> &distances, const _u64 beam_width,
-      const float l_k_ratio, knowhere::BitsetView bitset_view,
-      QueryStats *stats) {
+      const _u64 max_l_search, const RangeSearchCallback &emit,
+      const _u64 beam_width, const float l_k_ratio,
+      knowhere::BitsetView bitset_view, QueryStats *stats) {
+    if (beam_width > MAX_N_SECTOR_READS)
+      throw ANNException("Beamwidth can not be higher than MAX_N_SECTOR_READS",
+                         -1, __FUNCSIG__, __FILE__, __LINE__);
+
+    ThreadData<T> data = this->thread_data.pop();
+    while (data.scratch.sector_scratch == nullptr) {
+      this->thread_data.wait_for_push_notify();
+      data = this->thread_data.pop();
+    }
+    auto query_norm_opt = init_thread_data(data, query1);
+    if (!query_norm_opt.has_value()) {
+      // return an empty answer when calcu a zero point
+      this->thread_data.push(data);
+      this->thread_data.push_notify_all();
+      return 0;
+    }
+    const float query_norm = query_norm_opt.value();
+    auto        ctx = this->reader->get_ctx();
+    auto        release = [&]() {
+      this->thread_data.push(data);
+      this->thread_data.push_notify_all();
+      this->reader->put_ctx(ctx);
+    };
+
+    const bool is_ip = metric == diskann::Metric::INNER_PRODUCT ||
+                       metric == diskann::Metric::COSINE;
+    auto in_range = [is_ip, range](const float dist) {
+      return is_ip ? dist > (float) range : dist < (float) range;
+    };
+    // hits go out in batches, straight from the stack
+    constexpr _u64 kEmitBatch = 256;
+    _s64           emit_ids[kEmitBatch];
+    float          emit_dists[kEmitBatch];
+    _u64           n_emit = 0;
+    auto           flush = [&]() {
+      if (n_emit > 0) {
+        emit(emit_ids, emit_dists, n_emit);
+        n_emit = 0;
+      }
+    };
+
     _u32 res_count = 0;
+    _u64 l_search = min_l_search;  // starting size of the candidate list
+    if (!bitset_view.empty()) {
+      const auto strategy = knowhere::ChooseFilterStrategy(
+          bitset_view, bitset_view.size(), 0.0f,
+          calcFilterThreshold(min_l_search));
+      if (strategy == knowhere::FilterStrategy::ALL_FILTERED) {
+        release();
+        return 0;
+      }
 
-    bool stop_flag = false;
-
-    _u32 l_search = min_l_search;  // starting size of the candidate list
-    while (!stop_flag) {
-      indices.resize(l_search);
-      distances.resize(l_search);
-      for (auto &x : distances)
-        x = std::numeric_limits<float>::max();
-      this->cached_beam_search(query1, l_search, l_k_ratio * l_search,
-                               indices.data(), distances.data(), beam_width,
-                               false, stats, nullptr, bitset_view);
-      for (_u32 i = 0; i < l_search; i++) {
-        if (indices[i] == -1) {
-          res_count = i;
-          break;
-        }
-        bool in_range = (metric == diskann::Metric::INNER_PRODUCT ||
-                         metric == diskann::Metric::COSINE)
-                                ? distances[i] > (float) range
-                                : distances[i] < (float) range;
-        if (!in_range) {
-          res_count = i;
-          break;
+      if (strategy == knowhere::FilterStrategy::BRUTE_FORCE) {
+        // the scan has no candidate list to resume, only its top-k grows
+        std::vector<_s64>  indices;
+        std::vector<float> distances;
+        while (true) {
+          indices.resize(l_search);
+          distances.resize(l_search);
+          brute_force_beam_search(data, query_norm, l_search, indices.data(),
+                                  distances.data(), beam_width, ctx, stats,
+                                  nullptr, bitset_view);
+          res_count = 0;
+          while (res_count < l_search && indices[res_count] != -1 &&
+                 in_range(distances[res_count]))
+            res_count++;
+          if (res_count < (_u32) (l_search / 2.0) ||
+              l_search * 2 > max_l_search)
+            break;
+          l_search *= 2;
         }
-        if (i == l_search - 1) {
-          res_count = l_search;
+        release();
+        for (_u32 i = 0; i < res_count; i++) {
+          emit_ids[n_emit] = indices[i];
+          emit_dists[n_emit] = distances[i];
+          if (++n_emit == kEmitBatch)
+            flush();
         }
+        flush();
+        return res_count;
       }
-      if (res_count < (_u32) (l_search / 2.0))
-        stop_flag = true;
-      l_search = l_search * 2;
-      if (l_search > max_l_search)
-        stop_flag = true;
     }
-    indices.resize(res_count);
-    distances.resize(res_count);
+
+    Timer query_timer;
+    auto  list_size = [l_k_ratio](const _u64 l) {
+      return std::max<_u64>((_u64) (l_k_ratio * l), 1);
+    };
+    // full precision distance to the distance that is returned
+    auto to_result = [this, query_norm](const float dist) {
+      if (metric == diskann::Metric::INNER_PRODUCT) {
+        // convert l2 distance to ip distance, then rescale to revert back to
+        // original norms
+        const float ip = 1.0 - dist / 2.0;
+        return max_base_norm != 0 ? ip * (max_base_norm * query_norm) : ip;
+      } else if (metric == diskann::Metric::COSINE) {
+        return -dist;
+      }
+      return dist;
+    };
+
+    BeamSearchState state;
+    state.keep_dropped = true;
+    state.retset.resize(list_size(l_search) + 1);
+    state.full_retset.reserve(4096);
+    auto vec_hash = init_beam_search(data, state, false);
+    while (true) {
+      expand_candidates(data, ctx, state, list_size(l_search), beam_width,
+                        stats, nullptr, bitset_view);
+
+      auto &full_retset = state.full_retset;
+      std::sort(full_retset.begin(), full_retset.end());
+      const _u64 n_top = std::min<_u64>(l_search, full_retset.size());
+      res_count = 0;
+      while (res_count < n_top &&
+             in_range(to_result(full_retset[res_count].distance)))
+        res_count++;
+      // a longer list can only find more hits through the candidates that
+      // did not fit into this one
+      if (res_count < (_u32) (l_search / 2.0) ||
+          l_search * 2 > max_l_search || state.dropped.empty())
+        break;
+      l_search *= 2;
+
+      // the longer list takes the best of its own and the dropped candidates
+      // and continues from the best one that was not expanded yet
+      const _u64 new_size = list_size(l_search);
+      auto      &retset = state.retset;
+      auto      &dropped = state.dropped;
+      dropped.insert(dropped.end(), retset.begin(),
+                     retset.begin() + state.cur_list_size);
+      const _u64 kept = std::min<_u64>(new_size, dropped.size());
+      std::partial_sort(dropped.begin(), dropped.begin() + kept,
+                        dropped.end());
+      retset.resize(new_size + 1);
+      std::copy(dropped.begin(), dropped.begin() + kept, retset.begin());
+      dropped.erase(std::remove_if(dropped.begin() + kept, dropped.end(),
+                                   [](const Neighbor &n) { return !n.flag; }),
+                    dropped.end());
+      dropped.erase(dropped.begin(), dropped.begin() + kept);
+      state.cur_list_size = kept;
+      state.k = 0;
+      while (state.k < state.cur_list_size && !retset[state.k].flag)
+        state.k++;
+    }
+
+    // every expanded node in range is a hit, also past the best l_search
+    const auto &full_retset = state.full_retset;
+    if (!full_retset.empty()) {
+      entry_cache.put(vec_hash, full_retset[0].id);
+    }
+    release();
+    maybe_refresh_node_cache(1);
+
+    res_count = 0;
+    for (const auto &nbr : full_retset) {
+      const float dist = to_result(nbr.distance);
+      if (!in_range(dist))
+        break;
+      emit_ids[n_emit] = nbr.id;
+      emit_dists[n_emit] = dist;
+      res_count++;
+      if (++n_emit == kEmitBatch)
+        flush();
+    }
+    flush();
+
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::IO_WAIT,
+                                 state.io_us / 1000);
+    if (stats != nullptr) {
+      stats->total_us = (double) query_timer.elapsed();
+    }
     return res_count;
   }
 
+  template<typename T>
+  _u32 PQFlashIndex<T>::range_search(
+      const T *query1, const double range, const _u64 min_l_search,
+      const _u64 max_l_search, std::vector<_s64> &indices,
+      std::vector<float> &distances, const _u64 beam_width,
+      const float l_k_ratio, knowhere::BitsetView bitset_view,
+      QueryStats *stats) {
+    indices.clear();
+    distances.clear();
+    return range_search(
+        query1, range, min_l_search, max_l_search,
+        [&](const _s64 *ids, const float *dists, const _u64 n) {
+          indices.insert(indices.end(), ids, ids + n);
+          distances.insert(distances.end(), dists, dists + n);
+        },
+        beam_width, l_k_ratio, bitset_view, stats);
+  }
+
   template<typename T>
   inline void PQFlashIndex<T>::copy_vec_base_data(T *des, const int64_t des_idx,
                                                   void *src) {
@@ -1521,10 +2001,12 @@ namespace diskann {
   PQFlashIndex<T>::get_sectors_layout_and_write_data_from_cache(
       const int64_t *ids, int64_t n, T *output_data) {
     std::unordered_map<_u64, std::vector<_u64>> sectors_to_visit;
+    const auto                                  cache = get_node_cache();
     for (int64_t i = 0; i < n; ++i) {
       _u64 id = ids[i];
-      if (coord_cache.find(id) != coord_cache.end()) {
-        copy_vec_base_data(output_data, i, coord_cache.at(id));
+      auto coord_iter = cache->coord.find(id);
+      if (coord_iter != cache->coord.end()) {
+        copy_vec_base_data(output_data, i, coord_iter->second);
       } else {
         const _u64 sector_offset = get_node_sector_offset(id);
         sectors_to_visit[sector_offset].push_back(i);
@@ -1635,6 +2117,212 @@ namespace diskann {
     return metric;
   }
 
+  template<typename T>
+  void PQFlashIndex<T>::set_entry_cache_size(size_t size) {
+    entry_cache.resize(size);
+  }
+
+  template<typename T>
+  _u64 PQFlashIndex<T>::get_entry_cache_hits() const noexcept {
+    return entry_cache.hits();
+  }
+
+  template<typename T>
+  _u64 PQFlashIndex<T>::get_entry_cache_misses() const noexcept {
+    return entry_cache.misses();
+  }
+
+  template<typename T>
+  bool PQFlashIndex<T>::get_cached_entry_point(const _u64 vec_hash,
+                                              _u32      &medoid) const {
+    if (entry_cache.capacity() == 0) {
+      return false;
+    }
+    const bool hit = entry_cache.try_get(vec_hash, medoid);
+    knowhere::CountEntryCacheLookup(knowhere::EntryCacheIndex::DISKANN, hit);
+    return hit;
+  }
+
+  template<typename T>
+  void PQFlashIndex<T>::enable_adaptive_cache(_u64 refresh_queries) {
+    if (refresh_queries == 0) {
+      return;
+    }
+    if (node_cache_slots == 0) {
+      LOG_KNOWHERE_WARNING_
+          << "The node cache is empty, it can not adapt to the traffic.";
+      return;
+    }
+    cache_refresh_queries = refresh_queries;
+    // a few counters per node that competes for the cache
+    node_access_sketch =
+        std::make_unique<knowhere::FrequencySketch>(2 * node_cache_slots);
+    recent_misses_size = 2 * node_cache_slots;
+    recent_misses.reset(new std::atomic<_u32>[recent_misses_size]);
+    for (_u64 i = 0; i < recent_misses_size; i++) {
+      recent_misses[i].store(std::numeric_limits<_u32>::max(),
+                             std::memory_order_relaxed);
+    }
+    cache_refresher = std::thread([this]() {
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(cache_refresh_mutex);
+          cache_refresh_cv.wait(lock, [this]() {
+            return cache_refresh_pending || cache_refresh_stop;
+          });
+          if (cache_refresh_stop) {
+            return;
+          }
+          cache_refresh_pending = false;
+        }
+        try {
+          refresh_node_cache();
+        } catch (const std::exception &e) {
+          LOG_KNOWHERE_WARNING_ << "Failed to refresh the node cache: "
+                                << e.what();
+        }
+      }
+    });
+    LOG_KNOWHERE_INFO_ << "Adaptive node cache of " << node_cache_slots
+                       << " nodes, refreshed every " << refresh_queries
+                       << " queries.";
+  }
+
+  template<typename T>
+  _u64 PQFlashIndex<T>::get_node_cache_hits() const noexcept {
+    return node_cache_hits.load(std::memory_order_relaxed);
+  }
+
+  template<typename T>
+  _u64 PQFlashIndex<T>::get_node_cache_misses() const noexcept {
+    return node_cache_misses.load(std::memory_order_relaxed);
+  }
+
+  template<typename T>
+  _u64 PQFlashIndex<T>::get_node_cache_refreshes() const noexcept {
+    return node_cache_refreshes.load(std::memory_order_relaxed);
+  }
+
+  template<typename T>
+  void PQFlashIndex<T>::count_node_cache_accesses(const _u64 hits,
+                                                  const _u64 misses) {
+    node_cache_hits.fetch_add(hits, std::memory_order_relaxed);
+    node_cache_misses.fetch_add(misses, std::memory_order_relaxed);
+    knowhere::CountNodeCacheAccesses(hits, misses);
+  }
+
+  template<typename T>
+  void PQFlashIndex<T>::maybe_refresh_node_cache(const _u64 nq) {
+    if (cache_refresh_queries == 0 ||
+        queries_since_refresh.fetch_add(nq, std::memory_order_relaxed) + nq <
+            cache_refresh_queries) {
+      return;
+    }
+    queries_since_refresh.store(0, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(cache_refresh_mutex);
+      cache_refresh_pending = true;
+    }
+    cache_refresh_cv.notify_one();
+  }
+
+  template<typename T>
+  void PQFlashIndex<T>::refresh_node_cache() {
+    const auto cur = get_node_cache();
+
+    // candidates: the cached nodes and the nodes that missed recently, ties
+    // go to the cached ones so that equally hot nodes do not churn
+    struct Candidate {
+      _u32 count;
+      bool cached;
+      _u32 id;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(cur->coord.size() + recent_misses_size);
+    tsl::robin_set<_u32> seen;
+    for (const auto &it : cur->coord) {
+      candidates.push_back({node_access_sketch->estimate(it.first), true,
+                            it.first});
+      seen.insert(it.first);
+    }
+    for (_u64 i = 0; i < recent_misses_size; i++) {
+      const _u32 id = recent_misses[i].load(std::memory_order_relaxed);
+      if (id < num_points && seen.insert(id).second) {
+        candidates.push_back({node_access_sketch->estimate(id), false, id});
+      }
+    }
+    node_access_sketch->halve();
+    if (candidates.size() > node_cache_slots) {
+      std::nth_element(candidates.begin(),
+                       candidates.begin() + node_cache_slots, candidates.end(),
+                       [](const Candidate &a, const Candidate &b) {
+                         return a.count != b.count ? a.count > b.count
+                                                   : a.cached > b.cached;
+                       });
+      candidates.resize(node_cache_slots);
+    }
+
+    // cached nodes that stay keep their slot, the others free it for the new
+    // nodes
+    std::vector<bool> slot_used(node_cache_slots, false);
+    tsl::robin_set<_u32> keep;
+    std::vector<_u32>    incoming;
+    for (const auto &c : candidates) {
+      if (c.cached) {
+        keep.insert(c.id);
+        slot_used[(cur->coord.at(c.id) - coord_cache_buf) / aligned_dim] =
+            true;
+      } else {
+        incoming.push_back(c.id);
+      }
+    }
+    if (incoming.empty()) {
+      return;
+    }
+    std::vector<_u64> free_slots;
+    for (_u64 slot = 0; slot < node_cache_slots; slot++) {
+      if (!slot_used[slot]) {
+        free_slots.push_back(slot);
+      }
+    }
+    incoming.resize(std::min(incoming.size(), free_slots.size()));
+    free_slots.resize(incoming.size());
+
+    // Searches read the slots of the cache they started with. Publish the
+    // cache without the evicted nodes, wait for the searches on the old one
+    // to finish, and only then overwrite the freed slots.
+    auto wait_for_readers = [](const std::shared_ptr<const NodeCache> &c) {
+      // no new reference can appear once c is not the published cache
+      while (c.use_count() > 1) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+    };
+    auto kept = std::make_shared<NodeCache>();
+    kept->nhood.reserve(node_cache_slots);
+    kept->coord.reserve(node_cache_slots);
+    for (const auto &it : cur->nhood) {
+      if (keep.find(it.first) != keep.end()) {
+        kept->nhood.insert(it);
+        kept->coord.insert(
+            std::make_pair(it.first, cur->coord.at(it.first)));
+      }
+    }
+    auto next = std::make_shared<NodeCache>(*kept);
+    std::shared_ptr<const NodeCache> published = std::move(kept);
+    std::atomic_store(&node_cache, published);
+    wait_for_readers(cur);
+
+    load_nodes_to_cache(incoming, free_slots, *next);
+    std::atomic_store(&node_cache, std::shared_ptr<const NodeCache>(next));
+    wait_for_readers(published);
+
+    node_cache_refreshes.fetch_add(1, std::memory_order_relaxed);
+    knowhere::CountNodeCacheRefresh();
+    LOG_KNOWHERE_DEBUG_ << "Refreshed the node cache, " << incoming.size()
+                        << " of " << node_cache_slots << " nodes replaced.";
+  }
+
 #ifdef EXEC_ENV_OLS
   template<typename T>
   char *PQFlashIndex<T>::getHeaderBytes() {
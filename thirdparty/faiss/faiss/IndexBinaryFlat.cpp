@@ -27,7 +27,8 @@ IndexBinaryFlat::IndexBinaryFlat(idx_t d, MetricType metric)
         : IndexBinary(d, metric) {}
 
 void IndexBinaryFlat::add(idx_t n, const uint8_t* x) {
-    xb.insert(xb.end(), x, x + n * code_size);
+    xb.resize((ntotal + n) * code_size);
+    memcpy(xb.data() + ntotal * code_size, x, n * code_size);
     ntotal += n;
 }
 
@@ -75,6 +76,8 @@ void IndexBinaryFlat::search(
 }
 
 size_t IndexBinaryFlat::remove_ids(const IDSelector& sel) {
+    // the codes are moved in place, they can not stay borrowed
+    xb.detach();
     idx_t j = 0;
     for (idx_t i = 0; i < ntotal; i++) {
         if (sel.is_member(i)) {
@@ -27,6 +27,8 @@
 #include <faiss/utils/jaccard-inl.h>
 #include <faiss/utils/utils.h>
 #include <cinttypes>
+
+#include "knowhere/comp/metrics.h"
 namespace faiss {
 
 void IndexBinaryIVF::search_thread_safe(
@@ -46,7 +48,10 @@ void IndexBinaryIVF::search_thread_safe(
 
     double t0 = getmillisecs();
     quantizer->search(n, x, nprobe, coarse_dis.get(), idx.get());
-    indexIVF_stats.quantization_time += getmillisecs() - t0;
+    double t1 = getmillisecs();
+    indexIVF_stats.quantization_time += t1 - t0;
+    knowhere::ObserveSearchPhase(
+            knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
 
     t0 = getmillisecs();
     invlists->prefetch_lists(idx.get(), n * nprobe);
@@ -63,7 +68,9 @@ void IndexBinaryIVF::search_thread_safe(
             nullptr,
             nprobe,
             bitset);
-    indexIVF_stats.search_time += getmillisecs() - t0;
+    double t2 = getmillisecs();
+    indexIVF_stats.search_time += t2 - t0;
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::LIST_SCAN, t2 - t0);
 }
 
 void IndexBinaryIVF::search_and_reconstruct_thread_safe(
@@ -737,13 +744,18 @@ void IndexBinaryIVF::range_search_thread_safe(
 
     double t0 = getmillisecs();
     quantizer->search(n, x, nprobe, coarse_dis.get(), idx.get());
-    indexIVF_stats.quantization_time += getmillisecs() - t0;
+    double t1 = getmillisecs();
+    indexIVF_stats.quantization_time += t1 - t0;
+    knowhere::ObserveSearchPhase(
+            knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
 
     t0 = getmillisecs();
     invlists->prefetch_lists(idx.get(), n * nprobe);
     range_search_preassigned_thread_safe(
             n, x, radius, idx.get(), coarse_dis.get(), res, nprobe, bitset);
-    indexIVF_stats.search_time += getmillisecs() - t0;
+    double t2 = getmillisecs();
+    indexIVF_stats.search_time += t2 - t0;
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::LIST_SCAN, t2 - t0);
 }
 
 void IndexBinaryIVF::range_search_preassigned_thread_safe(
@@ -34,6 +34,8 @@ size_t IndexFlatCodes::sa_code_size() const {
 }
 
 size_t IndexFlatCodes::remove_ids(const IDSelector& sel) {
+    // the codes are moved in place, they can not stay borrowed
+    codes.detach();
     idx_t j = 0;
     for (idx_t i = 0; i < ntotal; i++) {
         if (sel.is_member(i)) {
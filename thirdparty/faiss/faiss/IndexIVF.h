@@ -16,6 +16,7 @@
 
 #include <faiss/Clustering.h>
 #include <faiss/Index.h>
+#include <faiss/impl/maybe_owned_vector.h>
 #include <faiss/impl/platform_macros.h>
 #include <faiss/invlists/DirectMap.h>
 #include <faiss/invlists/InvertedLists.h>
@@ -118,8 +119,11 @@ struct IndexIVF : Index, Level1Quantizer {
      *
      * prefix_sum: the start offset of invlists in arranged_codes:
      *   {0, n0, n0+n1, n0+n1+n2, ...}
+     *
+     * write_index_nm stores arranged_codes as they are ("IwFa"), so that
+     * read_index_nm can map or borrow them instead of rebuilding them.
      */
-    std::vector<uint8_t> arranged_codes;
+    MaybeOwnedVector<uint8_t> arranged_codes;
     std::vector<size_t> prefix_sum;
 
     /** Parallel mode determines how queries are parallelized with OpenMP
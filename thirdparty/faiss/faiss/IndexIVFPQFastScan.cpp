@@ -27,6 +27,8 @@
 #include <faiss/impl/simd_result_handlers.h>
 #include <faiss/utils/quantize_lut.h>
 
+#include "knowhere/comp/metrics.h"
+
 namespace faiss {
 
 using namespace simd_result_handlers;
@@ -385,11 +387,11 @@ void IndexIVFPQFastScan::compute_LUT(
         const idx_t* coarse_ids,
         const float* coarse_dis,
         AlignedTable<float>& dis_tables,
-        AlignedTable<float>& biases) const {
+        AlignedTable<float>& biases,
+        size_t nprobe) const {
     const IndexIVFPQFastScan& ivfpq = *this;
     size_t dim12 = pq.ksub * pq.M;
     size_t d = pq.d;
-    size_t nprobe = ivfpq.nprobe;
 
     if (ivfpq.by_residual) {
         if (ivfpq.metric_type == METRIC_L2) {
@@ -475,13 +477,21 @@ void IndexIVFPQFastScan::compute_LUT_uint8(
         const float* coarse_dis,
         AlignedTable<uint8_t>& dis_tables,
         AlignedTable<uint16_t>& biases,
-        float* normalizers) const {
+        float* normalizers,
+        size_t nprobe) const {
     const IndexIVFPQFastScan& ivfpq = *this;
     AlignedTable<float> dis_tables_float;
     AlignedTable<float> biases_float;
 
     uint64_t t0 = get_cy();
-    compute_LUT(n, x, coarse_ids, coarse_dis, dis_tables_float, biases_float);
+    compute_LUT(
+            n,
+            x,
+            coarse_ids,
+            coarse_dis,
+            dis_tables_float,
+            biases_float,
+            nprobe);
     IVFFastScan_stats.t_compute_distance_tables += get_cy() - t0;
 
     bool lut_is_3d = ivfpq.by_residual && ivfpq.metric_type == METRIC_L2;
@@ -668,6 +678,133 @@ void IndexIVFPQFastScan::search(
     }
 }
 
+void IndexIVFPQFastScan::search_thread_safe(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const size_t nprobe,
+        const size_t max_codes,
+        const BitsetView bitset) const {
+    FAISS_THROW_IF_NOT(k > 0);
+    const size_t final_nprobe = std::min(nlist, nprobe);
+
+    if (metric_type == METRIC_L2) {
+        search_implem_thread_safe<CMax<uint16_t, int64_t>>(
+                n, x, k, distances, labels, final_nprobe, bitset);
+    } else {
+        search_implem_thread_safe<CMin<uint16_t, int64_t>>(
+                n, x, k, distances, labels, final_nprobe, bitset);
+    }
+}
+
+template <class C>
+void IndexIVFPQFastScan::search_implem_thread_safe(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        size_t nprobe,
+        const BitsetView bitset) const {
+    memset(distances, -1, sizeof(float) * k * n);
+    memset(labels, -1, sizeof(idx_t) * k * n);
+    if (n == 0 || nprobe == 0) {
+        return;
+    }
+
+    using HeapHC = HeapHandler<C, true>;
+    using ReservoirHC = ReservoirHandler<C, true>;
+    using SingleResultHC = SingleResultHandler<C, true>;
+
+    std::unique_ptr<idx_t[]> coarse_ids(new idx_t[n * nprobe]);
+    std::unique_ptr<float[]> coarse_dis(new float[n * nprobe]);
+    double t0 = getmillisecs();
+    quantizer->search(n, x, nprobe, coarse_dis.get(), coarse_ids.get());
+    double t1 = getmillisecs();
+    knowhere::ObserveSearchPhase(
+            knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
+
+    size_t dim12 = pq.ksub * M2;
+    AlignedTable<uint8_t> dis_tables;
+    AlignedTable<uint16_t> biases;
+    std::unique_ptr<float[]> normalizers(new float[2 * n]);
+
+    compute_LUT_uint8(
+            n,
+            x,
+            coarse_ids.get(),
+            coarse_dis.get(),
+            dis_tables,
+            biases,
+            normalizers.get(),
+            nprobe);
+
+    bool single_LUT = !(by_residual && metric_type == METRIC_L2);
+
+    AlignedTable<uint16_t> tmp_distances(k);
+    for (idx_t i = 0; i < n; i++) {
+        const uint8_t* LUT = nullptr;
+        int qmap1[1] = {0};
+        std::unique_ptr<SIMDResultHandler<C, true>> handler;
+
+        // same choice as search_dispatch_implem for implem 10 / 11
+        if (k == 1) {
+            handler.reset(new SingleResultHC(1, 0));
+        } else if (k <= 20) {
+            handler.reset(new HeapHC(
+                    1, tmp_distances.get(), labels + i * k, k, 0));
+        } else {
+            handler.reset(new ReservoirHC(1, 0, k, 2 * k));
+        }
+
+        handler->q_map = qmap1;
+        handler->bitset = bitset;
+
+        if (single_LUT) {
+            LUT = dis_tables.get() + i * dim12;
+        }
+        for (idx_t j = 0; j < nprobe; j++) {
+            size_t ij = i * nprobe + j;
+            if (!single_LUT) {
+                LUT = dis_tables.get() + ij * dim12;
+            }
+            if (biases.get()) {
+                handler->dbias = biases.get() + ij;
+            }
+
+            idx_t list_no = coarse_ids[ij];
+            if (list_no < 0)
+                continue;
+            size_t ls = invlists->list_size(list_no);
+            if (ls == 0)
+                continue;
+
+            InvertedLists::ScopedCodes codes(invlists, list_no);
+            InvertedLists::ScopedIds ids(invlists, list_no);
+
+            handler->ntotal = ls;
+            handler->id_map = ids.get();
+
+#define DISPATCH(classHC)                                              \
+    if (dynamic_cast<classHC*>(handler.get())) {                       \
+        auto* res = static_cast<classHC*>(handler.get());              \
+        pq4_accumulate_loop(                                           \
+                1, roundup(ls, bbs), bbs, M2, codes.get(), LUT, *res); \
+    }
+            DISPATCH(HeapHC)
+            else DISPATCH(ReservoirHC) else DISPATCH(SingleResultHC)
+#undef DISPATCH
+        }
+
+        handler->to_flat_arrays(
+                distances + i * k, labels + i * k, normalizers.get() + i * 2);
+    }
+    knowhere::ObserveSearchPhase(
+            knowhere::SearchPhase::LIST_SCAN, getmillisecs() - t1);
+}
+
 template <class C>
 void IndexIVFPQFastScan::search_implem_1(
         idx_t n,
@@ -686,7 +823,14 @@ void IndexIVFPQFastScan::search_implem_1(
     AlignedTable<float> dis_tables;
     AlignedTable<float> biases;
 
-    compute_LUT(n, x, coarse_ids.get(), coarse_dis.get(), dis_tables, biases);
+    compute_LUT(
+            n,
+            x,
+            coarse_ids.get(),
+            coarse_dis.get(),
+            dis_tables,
+            biases,
+            nprobe);
 
     bool single_LUT = !(by_residual && metric_type == METRIC_L2);
 
@@ -764,7 +908,8 @@ void IndexIVFPQFastScan::search_implem_2(
             coarse_dis.get(),
             dis_tables,
             biases,
-            normalizers.get());
+            normalizers.get(),
+            nprobe);
 
     bool single_LUT = !(by_residual && metric_type == METRIC_L2);
 
@@ -872,7 +1017,8 @@ void IndexIVFPQFastScan::search_implem_10(
             coarse_dis.get(),
             dis_tables,
             biases,
-            normalizers.get());
+            normalizers.get(),
+            nprobe);
 
     TIC;
 
@@ -990,7 +1136,8 @@ void IndexIVFPQFastScan::search_implem_12(
             coarse_dis.get(),
             dis_tables,
             biases,
-            normalizers.get());
+            normalizers.get(),
+            nprobe);
 
     TIC;
 
@@ -96,7 +96,21 @@ struct IndexIVFPQFastScan : IndexIVF {
             idx_t* labels,
             const BitsetView bitset = nullptr) const override;
 
-    // prepare look-up tables
+    /** search with nprobe given per call instead of the nprobe field, so
+     * concurrent callers can use different nprobes. The ids set in bitset
+     * are skipped by the result handlers. max_codes is ignored, it is
+     * there to match IndexIVF::search_thread_safe. */
+    void search_thread_safe(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const size_t nprobe,
+            const size_t max_codes,
+            const BitsetView bitset = nullptr) const;
+
+    // prepare look-up tables, nprobe tables per query when the LUT is 3D
 
     void compute_LUT(
             size_t n,
@@ -104,7 +118,8 @@ struct IndexIVFPQFastScan : IndexIVF {
             const idx_t* coarse_ids,
             const float* coarse_dis,
             AlignedTable<float>& dis_tables,
-            AlignedTable<float>& biases) const;
+            AlignedTable<float>& biases,
+            size_t nprobe) const;
 
     void compute_LUT_uint8(
             size_t n,
@@ -113,7 +128,8 @@ struct IndexIVFPQFastScan : IndexIVF {
             const float* coarse_dis,
             AlignedTable<uint8_t>& dis_tables,
             AlignedTable<uint16_t>& biases,
-            float* normalizers) const;
+            float* normalizers,
+            size_t nprobe) const;
 
     // internal search funcs
 
@@ -154,6 +170,17 @@ struct IndexIVFPQFastScan : IndexIVF {
             size_t* ndis_out,
             size_t* nlist_out) const;
 
+    // implem 10/11 with an explicit nprobe and bitset, no global stats
+    template <class C>
+    void search_implem_thread_safe(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            size_t nprobe,
+            const BitsetView bitset) const;
+
     template <class C>
     void search_implem_12(
             idx_t n,
@@ -20,6 +20,8 @@
 #include <faiss/impl/FaissAssert.h>
 #include <omp.h>
 #include <cinttypes>
+
+#include "knowhere/comp/metrics.h"
 namespace faiss {
 
 namespace {
@@ -80,6 +82,9 @@ void IndexIVF::search_thread_safe(
         double t2 = getmillisecs();
         ivf_stats->quantization_time += t1 - t0;
         ivf_stats->search_time += t2 - t0;
+        knowhere::ObserveSearchPhase(
+                knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
+        knowhere::ObserveSearchPhase(knowhere::SearchPhase::LIST_SCAN, t2 - t1);
     };
 
     if ((parallel_mode & ~PARALLEL_MODE_NO_HEAP_INIT) == 0) {
@@ -168,6 +173,9 @@ void IndexIVF::search_without_codes_thread_safe(
         double t2 = getmillisecs();
         ivf_stats->quantization_time += t1 - t0;
         ivf_stats->search_time += t2 - t0;
+        knowhere::ObserveSearchPhase(
+                knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
+        knowhere::ObserveSearchPhase(knowhere::SearchPhase::LIST_SCAN, t2 - t1);
     };
 
     if ((parallel_mode & ~PARALLEL_MODE_NO_HEAP_INIT) == 0) {
@@ -519,7 +527,10 @@ void IndexIVF::range_search_thread_safe(
 
     double t0 = getmillisecs();
     quantizer->search(nx, x, final_nprobe, coarse_dis.get(), keys.get());
-    indexIVF_stats.quantization_time += getmillisecs() - t0;
+    double t1 = getmillisecs();
+    indexIVF_stats.quantization_time += t1 - t0;
+    knowhere::ObserveSearchPhase(
+            knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
 
     t0 = getmillisecs();
     invlists->prefetch_lists(keys.get(), nx * final_nprobe);
@@ -538,7 +549,9 @@ void IndexIVF::range_search_thread_safe(
             &indexIVF_stats,
             bitset);
 
-    indexIVF_stats.search_time += getmillisecs() - t0;
+    double t2 = getmillisecs();
+    indexIVF_stats.search_time += t2 - t0;
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::LIST_SCAN, t2 - t0);
 }
 
 void IndexIVF::range_search_without_codes_thread_safe(
@@ -555,7 +568,10 @@ void IndexIVF::range_search_without_codes_thread_safe(
 
     double t0 = getmillisecs();
     quantizer->search(nx, x, final_nprobe, coarse_dis.get(), keys.get());
-    indexIVF_stats.quantization_time += getmillisecs() - t0;
+    double t1 = getmillisecs();
+    indexIVF_stats.quantization_time += t1 - t0;
+    knowhere::ObserveSearchPhase(
+            knowhere::SearchPhase::COARSE_QUANTIZATION, t1 - t0);
 
     t0 = getmillisecs();
     invlists->prefetch_lists(keys.get(), nx * final_nprobe);
@@ -574,7 +590,9 @@ void IndexIVF::range_search_without_codes_thread_safe(
             &indexIVF_stats,
             bitset);
 
-    indexIVF_stats.search_time += getmillisecs() - t0;
+    double t2 = getmillisecs();
+    indexIVF_stats.search_time += t2 - t0;
+    knowhere::ObserveSearchPhase(knowhere::SearchPhase::LIST_SCAN, t2 - t0);
 }
 
 void IndexIVF::range_search_preassigned_without_codes(
@@ -93,6 +93,12 @@ Index* Cloner::clone_Index(const Index* index) {
                         ivf->invlists)) {
             res->invlists = new ArrayInvertedLists(*ails);
             res->own_invlists = true;
+        } else if (
+                auto* mils = dynamic_cast<const MaybeOwnedArrayInvertedLists*>(
+                        ivf->invlists)) {
+            // the views are shared, not copied
+            res->invlists = new MaybeOwnedArrayInvertedLists(*mils);
+            res->own_invlists = true;
         } else {
             FAISS_THROW_MSG(
                     "clone not supported for this type of inverted lists");
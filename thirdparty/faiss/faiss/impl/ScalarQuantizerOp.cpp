@@ -6,6 +6,7 @@
  */
 
 #include <cstdio>
+#include <cstring>
 #include <algorithm>
 
 #ifdef __SSE__
@@ -126,6 +127,25 @@ float decode_fp16(uint16_t h) {
 
 #endif
 
+// bf16 is the upper half of a float32, rounded to nearest even. NaNs keep
+// a mantissa bit so they do not turn into infinities.
+uint16_t encode_bf16(float x) {
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    if ((u & 0x7fffffffu) > 0x7f800000u) {
+        return (u >> 16) | 0x0040u;
+    }
+    u += 0x7fffu + ((u >> 16) & 1u);
+    return u >> 16;
+}
+
+float decode_bf16(uint16_t x) {
+    uint32_t u = (uint32_t)x << 16;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
 /*******************************************************************
  * Quantizer range training
  */
@@ -183,6 +183,33 @@ static void read_ArrayInvertedLists_sizes(
     }
 }
 
+// read n elements into vec. With IO_FLAG_ZERO_COPY and a reader that can
+// lend its memory, vec becomes a view of it, unless the elements are not
+// aligned there: they are then copied out of the borrowed bytes.
+template <typename T>
+static void read_vector_zero_copy(
+        IOReader* f,
+        int io_flags,
+        MaybeOwnedVector<T>& vec,
+        size_t n,
+        size_t align = alignof(T)) {
+    std::shared_ptr<const void> owner;
+    const void* p = nullptr;
+    if (io_flags & IO_FLAG_ZERO_COPY) {
+        p = f->borrow(n * sizeof(T), &owner);
+    }
+    if (p == nullptr) {
+        vec.resize(n);
+        READANDCHECK(vec.data(), n);
+    } else if (reinterpret_cast<uintptr_t>(p) % align == 0) {
+        vec = MaybeOwnedVector<T>::borrow(
+                static_cast<const T*>(p), n, std::move(owner));
+    } else {
+        vec.resize(n);
+        memcpy(vec.data(), p, n * sizeof(T));
+    }
+}
+
 InvertedLists* read_InvertedLists(IOReader* f, int io_flags) {
     uint32_t h;
     READ1(h);
@@ -243,6 +270,23 @@ InvertedLists* read_InvertedLists(IOReader* f, int io_flags) {
             }
         }
         return lca;
+    } else if (
+            h == fourcc("ilar") && (io_flags & IO_FLAG_ZERO_COPY) &&
+            !(io_flags & IO_FLAG_SKIP_IVF_DATA)) {
+        size_t nlist, code_size;
+        READ1(nlist);
+        READ1(code_size);
+        std::vector<size_t> sizes(nlist);
+        read_ArrayInvertedLists_sizes(f, sizes);
+        auto mils = new MaybeOwnedArrayInvertedLists(nlist, code_size);
+        for (size_t i = 0; i < nlist; i++) {
+            if (sizes[i] > 0) {
+                read_vector_zero_copy(
+                        f, io_flags, mils->codes[i], sizes[i] * code_size);
+                read_vector_zero_copy(f, io_flags, mils->ids[i], sizes[i]);
+            }
+        }
+        return mils;
     } else if (h == fourcc("ilar") && !(io_flags & IO_FLAG_SKIP_IVF_DATA)) {
         auto ails = new ArrayInvertedLists(0, 0);
         READ1(ails->nlist);
@@ -609,7 +653,15 @@ Index* read_index(IOReader* f, int io_flags) {
         }
         read_index_header(idxf, f);
         idxf->code_size = idxf->d * sizeof(float);
-        READXBVECTOR(idxf->codes);
+        {
+            // READXBVECTOR, the stored size counts floats
+            size_t size;
+            READ1(size);
+            FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));
+            // the codes are read as floats, a misaligned view is copied
+            read_vector_zero_copy(
+                    f, io_flags, idxf->codes, size * 4, alignof(float));
+        }
         FAISS_THROW_IF_NOT(
                 idxf->codes.size() == idxf->ntotal * idxf->code_size);
         // leak!
@@ -954,6 +1006,41 @@ Index* read_index(const char* fname, int io_flags) {
     return idx;
 }
 
+// IndexIVF::arranged_codes as written by write_index_nm, mapped from the file
+// with IO_FLAG_MMAP. They are copied if the floats are not aligned.
+static void read_arranged_codes(IndexIVF* ivf, IOReader* f, int io_flags) {
+    size_t size;
+    READ1(size);
+    FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));
+    FileIOReader* reader = dynamic_cast<FileIOReader*>(f);
+    if ((io_flags & IO_FLAG_MMAP) == IO_FLAG_MMAP && reader != nullptr) {
+        FILE* fdesc = reader->f;
+        size_t o = ftell(fdesc);
+        struct stat buf;
+        int ret = fstat(fileno(fdesc), &buf);
+        FAISS_THROW_IF_NOT_FMT(ret == 0, "fstat failed: %s", strerror(errno));
+        size_t totsize = buf.st_size;
+        FAISS_THROW_IF_NOT(o + size <= totsize);
+        if (o % sizeof(float) == 0 && size > 0) {
+            void* ptr = mmap(
+                    nullptr, totsize, PROT_READ, MAP_SHARED, fileno(fdesc), 0);
+            FAISS_THROW_IF_NOT_FMT(
+                    ptr != MAP_FAILED, "could not mmap: %s", strerror(errno));
+            std::shared_ptr<const void> owner(
+                    ptr, [totsize](const void* p) {
+                        munmap(const_cast<void*>(p), totsize);
+                    });
+            ivf->arranged_codes = MaybeOwnedVector<uint8_t>::borrow(
+                    static_cast<const uint8_t*>(ptr) + o, size, owner);
+            fseek(fdesc, o + size, SEEK_SET);
+            return;
+        }
+        io_flags = 0;
+    }
+    read_vector_zero_copy(
+            f, io_flags, ivf->arranged_codes, size, alignof(float));
+}
+
 // read offset-only index
 Index *read_index_nm(IOReader *f, int io_flags) {
     Index * idx = nullptr;
@@ -965,6 +1052,22 @@ Index *read_index_nm(IOReader *f, int io_flags) {
         ivfl->code_size = ivfl->d * sizeof(float);
         read_InvertedLists_nm (ivfl, f, io_flags);
         idx = ivfl;
+    } else if (h == fourcc("IwFa")) {
+        IndexIVFFlat* ivfl = new IndexIVFFlat();
+        read_arranged_codes(ivfl, f, io_flags);
+        read_ivf_header(ivfl, f);
+        ivfl->code_size = ivfl->d * sizeof(float);
+        FAISS_THROW_IF_NOT(
+                ivfl->arranged_codes.size() == ivfl->ntotal * ivfl->code_size);
+        // the ids are read in any case, only the vectors can be mapped
+        read_InvertedLists_nm(ivfl, f, io_flags & ~IO_FLAG_MMAP);
+        ivfl->prefix_sum.resize(ivfl->nlist);
+        size_t offset = 0;
+        for (size_t i = 0; i < ivfl->nlist; i++) {
+            ivfl->prefix_sum[i] = offset;
+            offset += ivfl->invlists->list_size(i);
+        }
+        idx = ivfl;
     } else if(h == fourcc("IwSq")) {
         IndexIVFScalarQuantizer * ivsc = new IndexIVFScalarQuantizer();
         read_ivf_header(ivsc, f);
@@ -1092,7 +1195,12 @@ IndexBinary* read_index_binary(IOReader* f, int io_flags) {
     if (h == fourcc("IBxF")) {
         IndexBinaryFlat* idxf = new IndexBinaryFlat();
         read_index_binary_header(idxf, f);
-        READVECTOR(idxf->xb);
+        {
+            size_t size;
+            READ1(size);
+            FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));
+            read_vector_zero_copy(f, io_flags, idxf->xb, size);
+        }
         FAISS_THROW_IF_NOT(idxf->xb.size() == idxf->ntotal * idxf->code_size);
         // leak!
         idx = idxf;
@@ -208,51 +208,61 @@ static void write_ScalarQuantizer(const ScalarQuantizer* ivsc, IOWriter* f) {
     WRITEVECTOR(ivsc->trained);
 }
 
-void write_InvertedLists(const InvertedLists* ils, IOWriter* f) {
-    if (ils == nullptr) {
-        uint32_t h = fourcc("il00");
-        WRITE1(h);
-    } else if (
-            const auto& ails = dynamic_cast<const ArrayInvertedLists*>(ils)) {
-        uint32_t h = fourcc("ilar");
-        WRITE1(h);
-        WRITE1(ails->nlist);
-        WRITE1(ails->code_size);
-        // here we store either as a full or a sparse data buffer
-        size_t n_non0 = 0;
+// ArrayInvertedLists and MaybeOwnedArrayInvertedLists share the "ilar" format
+template <class ArrayLists>
+static void write_ArrayInvertedLists(const ArrayLists* ails, IOWriter* f) {
+    uint32_t h = fourcc("ilar");
+    WRITE1(h);
+    WRITE1(ails->nlist);
+    WRITE1(ails->code_size);
+    // here we store either as a full or a sparse data buffer
+    size_t n_non0 = 0;
+    for (size_t i = 0; i < ails->nlist; i++) {
+        if (ails->ids[i].size() > 0)
+            n_non0++;
+    }
+    if (n_non0 > ails->nlist / 2) {
+        uint32_t list_type = fourcc("full");
+        WRITE1(list_type);
+        std::vector<size_t> sizes;
         for (size_t i = 0; i < ails->nlist; i++) {
-            if (ails->ids[i].size() > 0)
-                n_non0++;
-        }
-        if (n_non0 > ails->nlist / 2) {
-            uint32_t list_type = fourcc("full");
-            WRITE1(list_type);
-            std::vector<size_t> sizes;
-            for (size_t i = 0; i < ails->nlist; i++) {
-                sizes.push_back(ails->ids[i].size());
-            }
-            WRITEVECTOR(sizes);
-        } else {
-            int list_type = fourcc("sprs"); // sparse
-            WRITE1(list_type);
-            std::vector<size_t> sizes;
-            for (size_t i = 0; i < ails->nlist; i++) {
-                size_t n = ails->ids[i].size();
-                if (n > 0) {
-                    sizes.push_back(i);
-                    sizes.push_back(n);
-                }
-            }
-            WRITEVECTOR(sizes);
+            sizes.push_back(ails->ids[i].size());
         }
-        // make a single contiguous data buffer (useful for mmapping)
+        WRITEVECTOR(sizes);
+    } else {
+        int list_type = fourcc("sprs"); // sparse
+        WRITE1(list_type);
+        std::vector<size_t> sizes;
         for (size_t i = 0; i < ails->nlist; i++) {
             size_t n = ails->ids[i].size();
             if (n > 0) {
-                WRITEANDCHECK(ails->codes[i].data(), n * ails->code_size);
-                WRITEANDCHECK(ails->ids[i].data(), n);
+                sizes.push_back(i);
+                sizes.push_back(n);
             }
         }
+        WRITEVECTOR(sizes);
+    }
+    // make a single contiguous data buffer (useful for mmapping)
+    for (size_t i = 0; i < ails->nlist; i++) {
+        size_t n = ails->ids[i].size();
+        if (n > 0) {
+            WRITEANDCHECK(ails->codes[i].data(), n * ails->code_size);
+            WRITEANDCHECK(ails->ids[i].data(), n);
+        }
+    }
+}
+
+void write_InvertedLists(const InvertedLists* ils, IOWriter* f) {
+    if (ils == nullptr) {
+        uint32_t h = fourcc("il00");
+        WRITE1(h);
+    } else if (
+            const auto& ails = dynamic_cast<const ArrayInvertedLists*>(ils)) {
+        write_ArrayInvertedLists(ails, f);
+    } else if (
+            const auto& mils =
+                    dynamic_cast<const MaybeOwnedArrayInvertedLists*>(ils)) {
+        write_ArrayInvertedLists(mils, f);
     } else if (const auto & lca =
                        dynamic_cast<const ConcurrentArrayInvertedLists *>(ils)) {
         uint32_t h = fourcc("ilca");
@@ -754,8 +764,16 @@ void write_index(const Index* idx, const char* fname) {
 void write_index_nm(const Index *idx, IOWriter *f) {
     if(const IndexIVFFlat * ivfl =
               dynamic_cast<const IndexIVFFlat *> (idx)) {
-        uint32_t h = fourcc("IwFl");
-        WRITE1(h);
+        if (!ivfl->arranged_codes.empty()) {
+            // the vectors are stored once in list order, and first so that
+            // they are aligned in the buffer for read_index_nm to borrow them
+            uint32_t h = fourcc("IwFa");
+            WRITE1(h);
+            WRITEVECTOR(ivfl->arranged_codes);
+        } else {
+            uint32_t h = fourcc("IwFl");
+            WRITE1(h);
+        }
         write_ivf_header(ivfl, f);
         write_InvertedLists_nm(ivfl->invlists, f);
     } else if(const IndexIVFScalarQuantizer * ivsc =
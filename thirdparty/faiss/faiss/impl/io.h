@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdio>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -34,6 +35,14 @@ struct IOReader {
     // return a file number that can be memory-mapped
     virtual int fileno();
 
+    // For IO_FLAG_ZERO_COPY: a reader that holds its content in memory
+    // returns a pointer to the next nbytes, skips them and sets *owner to a
+    // handle that keeps them alive. The default returns nullptr without
+    // reading anything, the caller then copies with operator().
+    virtual const void* borrow(
+            size_t nbytes,
+            std::shared_ptr<const void>* owner);
+
     virtual ~IOReader() {}
 };
 
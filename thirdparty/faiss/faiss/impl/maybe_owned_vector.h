@@ -0,0 +1,125 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace faiss {
+
+/** A std::vector<T> that can instead be a view of memory owned by someone
+ * else, typically the buffer an index was read from with IO_FLAG_ZERO_COPY.
+ * The view holds owner, which keeps that memory alive.
+ *
+ * The accessors never copy or reallocate, whether const or not, so readers
+ * can share a view. The borrowed memory must not be written: code that
+ * modifies the elements in place calls detach() first, which copies a view
+ * into an owned vector. resize() detaches too. */
+template <typename T>
+struct MaybeOwnedVector {
+    MaybeOwnedVector() = default;
+
+    static MaybeOwnedVector borrow(
+            const T* data,
+            size_t n,
+            std::shared_ptr<const void> owner) {
+        MaybeOwnedVector v;
+        v.view = const_cast<T*>(data);
+        v.view_size = n;
+        v.owner = std::move(owner);
+        return v;
+    }
+
+    bool is_view() const {
+        return view != nullptr;
+    }
+
+    T* data() {
+        return view != nullptr ? view : owned.data();
+    }
+
+    const T* data() const {
+        return view != nullptr ? view : owned.data();
+    }
+
+    size_t size() const {
+        return view != nullptr ? view_size : owned.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    T& operator[](size_t i) {
+        return data()[i];
+    }
+
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+
+    T* begin() {
+        return data();
+    }
+
+    T* end() {
+        return data() + size();
+    }
+
+    const T* begin() const {
+        return data();
+    }
+
+    const T* end() const {
+        return data() + size();
+    }
+
+    void resize(size_t n) {
+        if (view != nullptr) {
+            owned.assign(view, view + std::min(n, view_size));
+            view = nullptr;
+            view_size = 0;
+            owner.reset();
+        }
+        owned.resize(n);
+    }
+
+    /// copy a view into an owned vector, before writing to the elements
+    void detach() {
+        if (view != nullptr) {
+            resize(view_size);
+        }
+    }
+
+    void clear() {
+        view = nullptr;
+        view_size = 0;
+        owner.reset();
+        owned.clear();
+    }
+
+   private:
+    std::vector<T> owned;
+    T* view = nullptr;
+    size_t view_size = 0;
+    std::shared_ptr<const void> owner;
+};
+
+} // namespace faiss
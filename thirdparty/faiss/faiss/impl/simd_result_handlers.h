@@ -17,6 +17,8 @@
 #include <faiss/impl/platform_macros.h>
 #include <faiss/utils/AlignedTable.h>
 #include <faiss/utils/partitioning.h>
+#include <knowhere/bitsetview.h>
+using knowhere::BitsetView;
 
 /** This file contains callbacks for kernels that compute distances.
  *
@@ -108,9 +110,14 @@ struct SIMDResultHandler {
     const TI* id_map;      // map offset in invlist to vector id
     const int* q_map;      // map q to global query
     const uint16_t* dbias; // table of biases to add to each query
+    BitsetView bitset;     // ids set in the bitset are never collected
 
     explicit SIMDResultHandler(size_t ntotal)
-            : ntotal(ntotal), id_map(nullptr), q_map(nullptr), dbias(nullptr) {}
+            : ntotal(ntotal),
+              id_map(nullptr),
+              q_map(nullptr),
+              dbias(nullptr),
+              bitset(nullptr) {}
 
     void set_block_origin(size_t i0, size_t j0) {
         this->i0 = i0;
@@ -169,6 +176,16 @@ struct SIMDResultHandler {
             int nbit = (ntotal - idx);
             lt_mask &= (uint32_t(1) << nbit) - 1;
         }
+        if (!bitset.empty()) {
+            uint32_t candidates = lt_mask;
+            while (candidates) {
+                int j = __builtin_ctz(candidates);
+                candidates &= candidates - 1;
+                if (bitset.test(adjust_id(b, j))) {
+                    lt_mask &= ~(uint32_t(1) << j);
+                }
+            }
+        }
         return lt_mask;
     }
 
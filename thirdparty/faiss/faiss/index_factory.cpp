@@ -139,8 +139,9 @@ std::map<std::string, QuantizerType> sq_types = {
         {"SQ4", QuantizerType::QT_4bit},
         {"SQ6", QuantizerType::QT_6bit},
         {"SQfp16", QuantizerType::QT_fp16},
+        {"SQbf16", QuantizerType::QT_bf16},
 };
-const std::string sq_pattern = "(SQ4|SQ8|SQ6|SQfp16)";
+const std::string sq_pattern = "(SQ4|SQ8|SQ6|SQfp16|SQbf16)";
 
 std::map<std::string, AdditiveQuantizer::Search_type_t> aq_search_type = {
         {"_Nfloat", AdditiveQuantizer::ST_norm_float},
@@ -57,6 +57,10 @@ const int IO_FLAG_SKIP_IVF_DATA = 8;
 // try to memmap data (useful to load an ArrayInvertedLists as an
 // OnDiskInvertedLists)
 const int IO_FLAG_MMAP = IO_FLAG_SKIP_IVF_DATA | 0x646f0000;
+// let flat codes and inverted lists point into the memory of the reader
+// instead of copying it, if the reader supports IOReader::borrow. The data
+// is copied when the index modifies it.
+const int IO_FLAG_ZERO_COPY = 16;
 
 Index* read_index(const char* fname, int io_flags = 0);
 Index* read_index(FILE* f, int io_flags = 0);
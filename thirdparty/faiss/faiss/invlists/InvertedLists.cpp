@@ -874,6 +874,67 @@ void ReadOnlyInvertedLists::resize(size_t, size_t) {
     FAISS_THROW_MSG("not implemented");
 }
 
+/*****************************************
+ * MaybeOwnedArrayInvertedLists implementation
+ ******************************************/
+
+MaybeOwnedArrayInvertedLists::MaybeOwnedArrayInvertedLists(
+        size_t nlist,
+        size_t code_size)
+        : InvertedLists(nlist, code_size), codes(nlist), ids(nlist) {}
+
+size_t MaybeOwnedArrayInvertedLists::list_size(size_t list_no) const {
+    assert(list_no < nlist);
+    return ids[list_no].size();
+}
+
+const uint8_t* MaybeOwnedArrayInvertedLists::get_codes(size_t list_no) const {
+    assert(list_no < nlist);
+    return codes[list_no].data();
+}
+
+const InvertedLists::idx_t* MaybeOwnedArrayInvertedLists::get_ids(
+        size_t list_no) const {
+    assert(list_no < nlist);
+    return ids[list_no].data();
+}
+
+size_t MaybeOwnedArrayInvertedLists::add_entries(
+        size_t list_no,
+        size_t n_entry,
+        const idx_t* ids_in,
+        const uint8_t* code,
+        const float* code_norm) {
+    if (n_entry == 0)
+        return 0;
+    assert(list_no < nlist);
+    size_t o = ids[list_no].size();
+    ids[list_no].resize(o + n_entry);
+    memcpy(&ids[list_no][o], ids_in, sizeof(ids_in[0]) * n_entry);
+    codes[list_no].resize((o + n_entry) * code_size);
+    memcpy(&codes[list_no][o * code_size], code, code_size * n_entry);
+    return o;
+}
+
+void MaybeOwnedArrayInvertedLists::update_entries(
+        size_t list_no,
+        size_t offset,
+        size_t n_entry,
+        const idx_t* ids_in,
+        const uint8_t* codes_in) {
+    assert(list_no < nlist);
+    assert(n_entry + offset <= ids[list_no].size());
+    ids[list_no].detach();
+    codes[list_no].detach();
+    memcpy(&ids[list_no][offset], ids_in, sizeof(ids_in[0]) * n_entry);
+    memcpy(&codes[list_no][offset * code_size], codes_in, code_size * n_entry);
+}
+
+void MaybeOwnedArrayInvertedLists::resize(size_t list_no, size_t new_size) {
+    ids[list_no].resize(new_size);
+    codes[list_no].resize(new_size * code_size);
+}
+
 /*****************************************
  * HStackInvertedLists implementation
  ******************************************/
@@ -21,6 +21,7 @@
 #include <set>
 #include <deque>
 #include <faiss/Index.h>
+#include <faiss/impl/maybe_owned_vector.h>
 
 namespace faiss {
 
@@ -509,6 +510,37 @@ struct ReadOnlyInvertedLists : InvertedLists {
     void resize(size_t list_no, size_t new_size) override;
 };
 
+/** ArrayInvertedLists whose lists can be views: read with IO_FLAG_ZERO_COPY,
+ * the codes and ids of every list point into the buffer the index was read
+ * from, which they keep alive. A list is copied the first time it is
+ * modified (see MaybeOwnedVector::detach). */
+struct MaybeOwnedArrayInvertedLists : InvertedLists {
+    std::vector<MaybeOwnedVector<uint8_t>> codes; ///< size nlist
+    std::vector<MaybeOwnedVector<idx_t>> ids;     ///< size nlist
+
+    MaybeOwnedArrayInvertedLists(size_t nlist, size_t code_size);
+
+    size_t list_size(size_t list_no) const override;
+    const uint8_t* get_codes(size_t list_no) const override;
+    const idx_t* get_ids(size_t list_no) const override;
+
+    size_t add_entries(
+            size_t list_no,
+            size_t n_entry,
+            const idx_t* ids,
+            const uint8_t* code,
+            const float* code_norm = nullptr) override;
+
+    void update_entries(
+            size_t list_no,
+            size_t offset,
+            size_t n_entry,
+            const idx_t* ids,
+            const uint8_t* code) override;
+
+    void resize(size_t list_no, size_t new_size) override;
+};
+
 /// Horizontal stack of inverted lists
 struct HStackInvertedLists : ReadOnlyInvertedLists {
     std::vector<const InvertedLists*> ils;
@@ -6,9 +6,11 @@
 #include <cstdio>
 #include <stdexcept>
 
-#include "common/lru_cache.h"
+#include "common/bitset_util.h"
+#include "common/concurrent_cache.h"
 #include "io/fileIO.h"
 #include "knowhere/bitsetview.h"
+#include "knowhere/comp/metrics.h"
 #include "knowhere/utils.h"
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-variable"
@@ -19,9 +21,12 @@
 #include <fcntl.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <atomic>
 #include <list>
+#include <numeric>
 #include <random>
+#include <tuple>
 #include <unordered_set>
 
 #include "hnswlib.h"
@@ -41,6 +46,15 @@ typedef unsigned int tableint;
 typedef unsigned int linklistsizeint;
 constexpr float kHnswSearchKnnBFThreshold = 0.93f;
 constexpr float kHnswSearchRangeBFThreshold = 0.97f;
+// below this share of filtered ids the graph is walked ignoring the bitset and the filtered ids are dropped after
+constexpr float kHnswSearchPostFilterThreshold = 0.02f;
+
+// how reorderGraph() renumbers the internal ids
+enum class GraphReorder {
+    NONE = 0,
+    BFS = 1,
+    RCM = 2,
+};
 
 enum Metric {
     L2 = 0,
@@ -79,15 +93,23 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             metric_type_ = Metric::HAMMING;
         } else if (auto x = dynamic_cast<JaccardSpace*>(s)) {
             metric_type_ = Metric::JACCARD;
+        } else if (auto x = dynamic_cast<L2SQSpace*>(s)) {
+            metric_type_ = Metric::L2;
+        } else if (auto x = dynamic_cast<InnerProductSQSpace*>(s)) {
+            metric_type_ = Metric::INNER_PRODUCT;
+        } else if (auto x = dynamic_cast<CosineSQSpace*>(s)) {
+            metric_type_ = Metric::COSINE;
         } else {
             metric_type_ = Metric::UNKNOWN;
         }
+        sq_space_ = dynamic_cast<SQSpace*>(s);
 
         max_elements_ = max_elements;
 
         num_deleted_ = 0;
         data_size_ = s->get_data_size();
         fstdistfunc_ = s->get_dist_func();
+        fstdistfunc_query_ = s->get_query_dist_func();
         dist_func_param_ = s->get_dist_func_param();
         M_ = M;
         maxM_ = M_;
@@ -146,12 +168,17 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 free(data_norm_l2_);
             }
         }
+        if (raw_data_owned_) {
+            free(raw_data_);
+        }
 
-        for (tableint i = 0; i < cur_element_count; i++) {
-            if (element_levels_[i] > 0)
-                free(linkLists_[i]);
+        if (linkLists_ != nullptr) {
+            for (tableint i = 0; i < cur_element_count; i++) {
+                if (element_levels_[i] > 0)
+                    free(linkLists_[i]);
+            }
+            free(linkLists_);
         }
-        free(linkLists_);
         delete visited_list_pool_;
 
         delete space_;
@@ -191,15 +218,38 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     char* data_level0_memory_;
     float* data_norm_l2_;  // vector's l2 norm
-    char** linkLists_;
+    char** linkLists_ = nullptr;
     std::vector<int> element_levels_;
+    // set instead of linkLists_ and element_levels_ when the upper levels stay in the mapped CSR section of the
+    // file: id has upper_offsets_[id + 1] - upper_offsets_[id] upper levels, its level l list is list
+    // upper_offsets_[id] + l - 1 of upper_links_
+    const uint64_t* upper_offsets_ = nullptr;
+    const char* upper_links_ = nullptr;
 
     size_t data_size_;
 
     size_t label_offset_;
     DISTFUNC<dist_t> fstdistfunc_;
+    DISTFUNC<dist_t> fstdistfunc_query_;
     void* dist_func_param_;
 
+    // set when the level 0 memory holds codes instead of the vectors, points into space_
+    SQSpace* sq_space_ = nullptr;
+    // raw vectors of a quantized index by internal id, the final candidates of a search are reranked against them.
+    // Allocated by enableRawData(), borrowed through setRawData() or loaded by loadRawData(), null when there is
+    // nothing to rerank with.
+    float* raw_data_ = nullptr;
+    bool raw_data_owned_ = false;
+    // the raw vectors read or mapped by loadRawData(), raw_data_ borrows them
+    knowhere::BinaryPtr raw_file_;
+    bool raw_file_mapped_ = false;
+    // the loaded binary was saved with raw vectors, which are stored apart from it
+    bool raw_data_expected_ = false;
+    // largest L2 norm of the quantization error of a vector, relative to the vector norm for COSINE. Measured
+    // against raw_data_ by codeErrorBound() on first use, negative while it has to be measured again.
+    mutable std::atomic<float> code_error_bound_{-1.0f};
+    mutable std::mutex code_error_mutex_;
+
     std::default_random_engine level_generator_;
     std::default_random_engine update_probability_generator_;
 
@@ -207,13 +257,26 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     char* map_;
     size_t map_size_;
 
-    mutable knowhere::lru_cache<uint64_t, tableint> lru_cache;
+    // filled by reorderGraph(), internal_to_external_[id] is the label stored at internal id and
+    // external_to_internal_ is its inverse. Both stay empty as long as internal ids are the labels.
+    std::vector<tableint> internal_to_external_;
+    std::vector<tableint> external_to_internal_;
 
     inline char*
     getDataByInternalId(tableint internal_id) const {
         return (data_level0_memory_ + internal_id * size_data_per_element_ + offsetData_);
     }
 
+    inline labeltype
+    getExternalLabel(tableint internal_id) const {
+        return internal_to_external_.empty() ? internal_id : internal_to_external_[internal_id];
+    }
+
+    inline tableint
+    getInternalId(labeltype label) const {
+        return external_to_internal_.empty() ? label : external_to_internal_[label];
+    }
+
     int
     getRandomLevel(double reverse_size) {
         std::uniform_real_distribution<double> distribution(0.0, 1.0);
@@ -232,16 +295,122 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     inline dist_t
     calcDistance(const void* vec, const tableint id) const {
-        dist_t dist = fstdistfunc_(vec, getDataByInternalId(id), dist_func_param_);
+        dist_t dist = fstdistfunc_query_(vec, getDataByInternalId(id), dist_func_param_);
+        if (metric_type_ == Metric::COSINE) {
+            dist /= data_norm_l2_[id];
+        }
+        return dist;
+    }
+
+    // exact distance of a float query to the raw vector kept for reranking
+    inline dist_t
+    calcRawDistance(const void* vec, const tableint id) const {
+        const size_t dim = *(size_t*)dist_func_param_;
+        const float* raw = raw_data_ + id * dim;
+        if (metric_type_ == Metric::L2) {
+            return faiss::fvec_L2sqr((const float*)vec, raw, dim);
+        }
+        dist_t dist = -faiss::fvec_inner_product((const float*)vec, raw, dim);
         if (metric_type_ == Metric::COSINE) {
             dist /= data_norm_l2_[id];
         }
         return dist;
     }
 
+    // drops all cached entry points, 0 disables the cache. Call it before the index is shared with searchers
+    void
+    setEntryCacheSize(size_t size) {
+        entry_cache_.resize(size);
+    }
+
+    // searches that started from a cached entry point, and those that looked one up and found none
+    uint64_t
+    getEntryCacheHits() const {
+        return entry_cache_.hits();
+    }
+
+    uint64_t
+    getEntryCacheMisses() const {
+        return entry_cache_.misses();
+    }
+
+    // the entry point cached for a query, a lookup of an enabled cache is also counted in the prometheus metrics
+    bool
+    getCachedEntryPoint(uint64_t vec_hash, tableint& entry) const {
+        if (entry_cache_.capacity() == 0) {
+            return false;
+        }
+        const bool hit = entry_cache_.try_get(vec_hash, entry);
+        knowhere::CountEntryCacheLookup(knowhere::EntryCacheIndex::HNSW, hit);
+        return hit;
+    }
+
+    // bytes of one input vector, more than data_size_ when the vectors are stored as codes
+    inline size_t
+    getVectorSize() const {
+        return sq_space_ != nullptr ? *(size_t*)dist_func_param_ * sizeof(float) : data_size_;
+    }
+
+    // stores the vector, or its code, at internal id
+    inline void
+    setData(tableint internal_id, const void* data_point) {
+        if (sq_space_ != nullptr) {
+            sq_space_->encode((const float*)data_point, getDataByInternalId(internal_id));
+        } else {
+            memcpy(getDataByInternalId(internal_id), data_point, data_size_);
+        }
+        if (raw_data_ != nullptr) {
+            if (!raw_data_owned_) {
+                throw std::runtime_error("Can not add points to an index with borrowed raw vectors");
+            }
+            memcpy(raw_data_ + internal_id * *(size_t*)dist_func_param_, data_point, getVectorSize());
+            code_error_bound_.store(-1.0f, std::memory_order_relaxed);
+        }
+    }
+
+    float
+    codeErrorBound() const {
+        float bound = code_error_bound_.load(std::memory_order_acquire);
+        if (bound >= 0.0f) {
+            return bound;
+        }
+        std::lock_guard<std::mutex> lock(code_error_mutex_);
+        bound = code_error_bound_.load(std::memory_order_acquire);
+        if (bound >= 0.0f) {
+            return bound;
+        }
+        const size_t dim = *(size_t*)dist_func_param_;
+        float max_error = 0.0f;
+        for (size_t i = 0; i < cur_element_count; i++) {
+            float error = std::sqrt(sq_space_->codeError(raw_data_ + i * dim, getDataByInternalId(i)));
+            if (metric_type_ == Metric::COSINE && data_norm_l2_[i] > 0.0f) {
+                error /= data_norm_l2_[i];
+            }
+            max_error = std::max(max_error, error);
+        }
+        code_error_bound_.store(max_error, std::memory_order_release);
+        return max_error;
+    }
+
+    // A code distance below the returned radius is all an exact distance below radius guarantees: the code is at most
+    // codeErrorBound() from its vector, which moves an L2 distance by at most that much and an inner product by at
+    // most that times the query norm.
+    float
+    codeRadius(const void* query_data, float radius) const {
+        const float error = codeErrorBound();
+        if (metric_type_ == Metric::L2) {
+            const float r = std::sqrt(std::max(radius, 0.0f)) + error;
+            return r * r;
+        }
+        const size_t dim = *(size_t*)dist_func_param_;
+        return radius + std::sqrt(faiss::fvec_norm_L2sqr((const float*)query_data, dim)) * error;
+    }
+
+    // lock_free is for searches of a graph that nobody writes meanwhile, see addPointsBatched
+    template <bool lock_free = false>
     std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst>
     searchBaseLayer(tableint ep_id, tableint cur_c, int layer) {
-        auto& visited = visited_list_pool_->getFreeVisitedList();
+        auto visited = visited_list_pool_->getFreeVisitedList();
 
         std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst>
             top_candidates;
@@ -253,7 +422,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         top_candidates.emplace(dist, ep_id);
         lowerBound = dist;
         candidateSet.emplace(-dist, ep_id);
-        visited[ep_id] = true;
+        visited.set(ep_id);
 
         while (!candidateSet.empty()) {
             std::pair<dist_t, tableint> curr_el_pair = candidateSet.top();
@@ -264,7 +433,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
             tableint curNodeNum = curr_el_pair.second;
 
-            std::unique_lock<std::mutex> lock(link_list_locks_[curNodeNum]);
+            std::unique_lock<std::mutex> lock;
+            if constexpr (!lock_free) {
+                lock = std::unique_lock<std::mutex>(link_list_locks_[curNodeNum]);
+            }
 
             int* data;  // = (int *)(linkList0_ + curNodeNum * size_links_per_element0_);
             if (layer == 0) {
@@ -283,10 +455,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             for (size_t j = 0; j < size; j++) {
                 tableint candidate_id = *(datal + j);
                 // if (candidate_id == 0) continue;
-                if (visited[candidate_id]) {
+                if (visited.get(candidate_id)) {
                     continue;
                 }
-                visited[candidate_id] = true;
+                visited.set(candidate_id);
 
                 dist_t dist1 = calcDistance(cur_c, candidate_id);
                 if (top_candidates.size() < ef_construction_ || lowerBound > dist1) {
@@ -319,17 +491,17 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         if (feder_result != nullptr) {
             feder_result->visit_info_.AddLevelVisitRecord(0);
         }
-        auto& visited = visited_list_pool_->getFreeVisitedList();
+        auto visited = visited_list_pool_->getFreeVisitedList();
         NeighborSet retset(ef);
 
-        if (!has_deletions || !bitset.test((int64_t)ep_id)) {
+        if (!has_deletions || !bitset.test((int64_t)getExternalLabel(ep_id))) {
             dist_t dist = calcDistance(data_point, ep_id);
             retset.insert(Neighbor(ep_id, dist, Neighbor::kValid));
         } else {
             retset.insert(Neighbor(ep_id, std::numeric_limits<dist_t>::max(), Neighbor::kInvalid));
         }
 
-        visited[ep_id] = true;
+        visited.set(ep_id);
         while (retset.has_next()) {
             auto [u, d, s] = retset.pop();
             tableint* list = (tableint*)get_linklist0(u);
@@ -346,23 +518,23 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 }
 #endif
                 tableint v = list[i];
-                if (visited[v]) {
+                if (visited.get(v)) {
                     if (feder_result != nullptr) {
-                        feder_result->visit_info_.AddVisitRecord(0, u, v, -1.0);
-                        feder_result->id_set_.insert(u);
-                        feder_result->id_set_.insert(v);
+                        feder_result->visit_info_.AddVisitRecord(0, getExternalLabel(u), getExternalLabel(v), -1.0);
+                        feder_result->id_set_.insert(getExternalLabel(u));
+                        feder_result->id_set_.insert(getExternalLabel(v));
                     }
                     continue;
                 }
-                visited[v] = true;
+                visited.set(v);
                 dist_t dist = calcDistance(data_point, v);
                 if (feder_result != nullptr) {
-                    feder_result->visit_info_.AddVisitRecord(0, u, v, dist);
-                    feder_result->id_set_.insert(u);
-                    feder_result->id_set_.insert(v);
+                    feder_result->visit_info_.AddVisitRecord(0, getExternalLabel(u), getExternalLabel(v), dist);
+                    feder_result->id_set_.insert(getExternalLabel(u));
+                    feder_result->id_set_.insert(getExternalLabel(v));
                 }
                 int status = Neighbor::kValid;
-                if (has_deletions && bitset.test((int64_t)v)) {
+                if (has_deletions && bitset.test((int64_t)getExternalLabel(v))) {
                     status = Neighbor::kInvalid;
                 }
 
@@ -428,7 +600,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     getNeighboursWithinRadius(std::vector<std::pair<dist_t, tableint>>& top_candidates, const void* data_point,
                               float radius, const knowhere::BitsetView bitset) const {
         std::vector<std::pair<dist_t, labeltype>> result;
-        auto& visited = visited_list_pool_->getFreeVisitedList();
+        auto visited = visited_list_pool_->getFreeVisitedList();
 
         std::queue<std::pair<dist_t, tableint>> radius_queue;
         while (!top_candidates.empty()) {
@@ -436,9 +608,9 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             top_candidates.pop_back();
             if (cand.first < radius) {
                 radius_queue.push(cand);
-                result.emplace_back(cand.first, cand.second);
+                result.emplace_back(cand.first, getExternalLabel(cand.second));
             }
-            visited[cand.second] = true;
+            visited.set(cand.second);
         }
 
         while (!radius_queue.empty()) {
@@ -456,13 +628,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 #endif
             for (size_t j = 1; j <= size; j++) {
                 int candidate_id = *(data + j);
-                if (!visited[candidate_id]) {
-                    visited[candidate_id] = true;
-                    if (bitset.empty() || !bitset.test((int64_t)candidate_id)) {
+                if (!visited.get(candidate_id)) {
+                    visited.set(candidate_id);
+                    if (bitset.empty() || !bitset.test((int64_t)getExternalLabel(candidate_id))) {
                         dist_t dist = calcDistance(data_point, candidate_id);
                         if (dist < radius) {
                             radius_queue.push({dist, candidate_id});
-                            result.emplace_back(dist, candidate_id);
+                            result.emplace_back(dist, getExternalLabel(candidate_id));
                         }
                     }
                 }
@@ -484,9 +656,21 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     linklistsizeint*
     get_linklist(tableint internal_id, int level) const {
+        if (upper_offsets_ != nullptr) {
+            return (linklistsizeint*)(upper_links_ +
+                                      (upper_offsets_[internal_id] + level - 1) * size_links_per_element_);
+        }
         return (linklistsizeint*)(linkLists_[internal_id] + (level - 1) * size_links_per_element_);
     };
 
+    int
+    getElementLevel(tableint internal_id) const {
+        if (upper_offsets_ != nullptr) {
+            return upper_offsets_[internal_id + 1] - upper_offsets_[internal_id];
+        }
+        return element_levels_[internal_id];
+    }
+
     linklistsizeint*
     get_linklist_at_level(tableint internal_id, int level) const {
         return level == 0 ? get_linklist0(internal_id) : get_linklist(internal_id, level);
@@ -633,6 +817,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             data_norm_l2_ = data_norm_l2_new;
         }
 
+        if (raw_data_owned_) {
+            float* raw_data_new = (float*)realloc(raw_data_, new_max_elements * getVectorSize());
+            if (raw_data_new == nullptr)
+                throw std::runtime_error("Not enough memory: resizeIndex failed to allocate raw data");
+            raw_data_ = raw_data_new;
+        }
+
         // Reallocate all other layers
         char** linkLists_new = (char**)realloc(linkLists_, sizeof(void*) * new_max_elements);
         if (linkLists_new == nullptr)
@@ -651,7 +842,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         map_ = static_cast<char*>(mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, input.descriptor(), 0));
 
         size_t dim;
-        readBinaryPOD(input, metric_type_);
+        const bool csr = readLayout(input);
         readBinaryPOD(input, data_size_);
         readBinaryPOD(input, dim);
         if (metric_type_ == Metric::L2) {
@@ -668,6 +859,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             throw std::runtime_error("Invalid metric type " + std::to_string(metric_type_));
         }
         fstdistfunc_ = space_->get_dist_func();
+        fstdistfunc_query_ = space_->get_query_dist_func();
         dist_func_param_ = space_->get_dist_func_param();
 
         readBinaryPOD(input, offsetLevel0_);
@@ -717,38 +909,35 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         size_links_per_element_ = maxM_ * sizeof(tableint) + sizeof(linklistsizeint);
 
         size_links_level0_ = maxM0_ * sizeof(tableint) + sizeof(linklistsizeint);
-        std::vector<std::mutex>(max_elements).swap(link_list_locks_);
-
         visited_list_pool_ = new VisitedListPool(max_elements);
-
-        linkLists_ = (char**)malloc(sizeof(void*) * max_elements);  // NOLINT
-        if (linkLists_ == nullptr) {
-            throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklists");
-        }
-        element_levels_ = std::vector<int>(max_elements);
         revSize_ = 1.0 / mult_;
         ef_ = 10;
-        for (size_t i = 0; i < cur_element_count; i++) {
-            unsigned int linkListSize;
-            readBinaryPOD(input, linkListSize);
-            if (linkListSize == 0) {
-                element_levels_[i] = 0;
-                linkLists_[i] = nullptr;
-            } else {
-                element_levels_[i] = linkListSize / size_links_per_element_;
-                linkLists_[i] = (char*)malloc(linkListSize);
-                if (linkLists_[i] == nullptr) {
-                    throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklist");
-                }
-                input.read(linkLists_[i], linkListSize);
-            }
+
+        if (csr && mmap_enabled_) {
+            // search only: the upper levels are used in place and neither link lists nor locks are allocated
+            input.advance(csrPadding(input.offset()));
+            upper_offsets_ = reinterpret_cast<const uint64_t*>(map_ + input.offset());
+            input.advance((cur_element_count + 1) * sizeof(uint64_t));
+            upper_links_ = map_ + input.offset();
+            input.advance(upper_offsets_[cur_element_count] * size_links_per_element_);
+        } else {
+            std::vector<std::mutex>(max_elements).swap(link_list_locks_);
+            readUpperLevels(input, csr, input.offset(), max_elements);
+        }
+
+        while ((size_t)input.offset() < map_size_) {
+            readTrailingSection(input);
         }
 
         input.close();
+        if (!mmap_enabled_) {
+            munmap(map_, map_size_);
+        }
     }
 
     void
     saveIndex(knowhere::MemoryIOWriter& output) {
+        writeBinaryPOD(output, kMappableMagic);
         // write l2/ip calculator
         writeBinaryPOD(output, metric_type_);
         writeBinaryPOD(output, data_size_);
@@ -775,11 +964,35 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             output.write(data_norm_l2_, cur_element_count * sizeof(float));
         }
 
+        // the upper levels as one CSR section, 8 byte aligned in the binary so that a mapping can use it in place
+        char padding[sizeof(uint64_t)] = {};
+        if (size_t size = csrPadding(output.rp)) {
+            output.write(padding, size);
+        }
+        std::vector<uint64_t> upper_offsets(cur_element_count + 1, 0);
         for (size_t i = 0; i < cur_element_count; i++) {
-            unsigned int linkListSize = element_levels_[i] > 0 ? size_links_per_element_ * element_levels_[i] : 0;
-            writeBinaryPOD(output, linkListSize);
-            if (linkListSize)
-                output.write(linkLists_[i], linkListSize);
+            upper_offsets[i + 1] = upper_offsets[i] + getElementLevel(i);
+        }
+        output.write(upper_offsets.data(), upper_offsets.size() * sizeof(uint64_t));
+        for (size_t i = 0; i < cur_element_count; i++) {
+            if (int level = getElementLevel(i)) {
+                output.write((char*)get_linklist(i, 1), size_links_per_element_ * level);
+            }
+        }
+
+        // optional trailing sections, indexes without them keep internal id == label and store plain vectors
+        if (!internal_to_external_.empty()) {
+            writeBinaryPOD(output, kReorderedMagic);
+            output.write(internal_to_external_.data(), cur_element_count * sizeof(tableint));
+        }
+        if (sq_space_ != nullptr) {
+            writeBinaryPOD(output, kQuantizedMagic);
+            writeBinaryPOD(output, (int32_t)sq_space_->qtype());
+            writeBinaryPOD(output, sq_space_->param().vmin);
+            writeBinaryPOD(output, sq_space_->param().scale);
+        }
+        if (raw_data_ != nullptr) {
+            writeBinaryPOD(output, kRawDataMagic);
         }
         // output.close();
     }
@@ -788,7 +1001,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     loadIndex(knowhere::MemoryIOReader& input, size_t max_elements_i = 0) {
         // linxj: init with metrictype
         size_t dim;
-        readBinaryPOD(input, metric_type_);
+        const bool csr = readLayout(input);
         readBinaryPOD(input, data_size_);
         readBinaryPOD(input, dim);
         if (metric_type_ == Metric::L2) {
@@ -805,6 +1018,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             throw std::runtime_error("Invalid metric type " + std::to_string(metric_type_));
         }
         fstdistfunc_ = space_->get_dist_func();
+        fstdistfunc_query_ = space_->get_query_dist_func();
         dist_func_param_ = space_->get_dist_func_param();
 
         readBinaryPOD(input, offsetLevel0_);
@@ -848,25 +1062,12 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
         visited_list_pool_ = new VisitedListPool(max_elements);
 
-        linkLists_ = (char**)malloc(sizeof(void*) * max_elements);
-        if (linkLists_ == nullptr)
-            throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklists");
-        element_levels_ = std::vector<int>(max_elements);
         revSize_ = 1.0 / mult_;
         ef_ = 10;
-        for (size_t i = 0; i < cur_element_count; i++) {
-            unsigned int linkListSize;
-            readBinaryPOD(input, linkListSize);
-            if (linkListSize == 0) {
-                element_levels_[i] = 0;
-                linkLists_[i] = nullptr;
-            } else {
-                element_levels_[i] = linkListSize / size_links_per_element_;
-                linkLists_[i] = (char*)malloc(linkListSize);
-                if (linkLists_[i] == nullptr)
-                    throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklist");
-                input.read(linkLists_[i], linkListSize);
-            }
+        readUpperLevels(input, csr, input.rp, max_elements);
+
+        while (input.rp < input.total) {
+            readTrailingSection(input);
         }
     }
 
@@ -888,7 +1089,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     void
     updatePoint(const void* dataPoint, tableint internalId, float updateNeighborProbability) {
         // update the feature vector associated with existing point with new vector
-        memcpy(getDataByInternalId(internalId), dataPoint, data_size_);
+        setData(internalId, dataPoint);
 
         int maxLevelCopy = maxlevel_;
         tableint entryPointCopy = enterpoint_node_;
@@ -1039,6 +1240,9 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     tableint
     addPoint(const void* data_point, labeltype label, int level) {
+        if (!internal_to_external_.empty()) {
+            throw std::runtime_error("Can not add points to a reordered index");
+        }
         tableint cur_c = label;
         {
             std::unique_lock<std::mutex> templock_curr(cur_element_count_guard_);
@@ -1061,7 +1265,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         tableint enterpoint_copy = enterpoint_node_;
 
         memset(data_level0_memory_ + cur_c * size_data_per_element_ + offsetLevel0_, 0, size_data_per_element_);
-        memcpy(getDataByInternalId(cur_c), data_point, data_size_);
+        setData(cur_c, data_point);
 
         if (metric_type_ == Metric::COSINE) {
             data_norm_l2_[cur_c] =
@@ -1127,15 +1331,202 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         return cur_c;
     };
 
+    // Inserts the n points of data, labelled 0 to n - 1, into an empty index. The points go in rounds that double
+    // with the graph up to batch_size points. The points of a round search the graph left by the earlier rounds,
+    // which nobody writes meanwhile, so the searches take no lock. The links back to them are then grouped by the
+    // node they go to and every node merges its own share, again without a lock. Levels are drawn up front, so the
+    // graph does not depend on the number of threads. The points of one round never link to each other directly,
+    // which costs some recall when batch_size is large against n.
+    void
+    addPointsBatched(const void* data, size_t n, size_t batch_size) {
+        if (!internal_to_external_.empty()) {
+            throw std::runtime_error("Can not add points to a reordered index");
+        }
+        if (cur_element_count != 0) {
+            throw std::runtime_error("Batched insertion needs an empty index");
+        }
+        if (n > max_elements_) {
+            throw std::runtime_error("The number of elements exceeds the specified limit");
+        }
+        if (raw_data_ != nullptr && !raw_data_owned_) {
+            throw std::runtime_error("Can not add points to an index with borrowed raw vectors");
+        }
+        if (n == 0) {
+            return;
+        }
+        batch_size = std::max(batch_size, (size_t)1);
+
+        for (size_t i = 0; i < n; i++) {
+            int curlevel = getRandomLevel(mult_);
+            element_levels_[i] = curlevel;
+            if (curlevel) {
+                linkLists_[i] = (char*)malloc(size_links_per_element_ * curlevel + 1);
+                if (linkLists_[i] == nullptr) {
+                    for (size_t j = 0; j < i; j++) {
+                        if (element_levels_[j] > 0)
+                            free(linkLists_[j]);
+                    }
+                    throw std::runtime_error("Not enough memory: addPointsBatched failed to allocate linklist");
+                }
+                memset(linkLists_[i], 0, size_links_per_element_ * curlevel + 1);
+            }
+        }
+
+        const size_t vector_size = getVectorSize();
+#pragma omp parallel for
+        for (int64_t i = 0; i < (int64_t)n; i++) {
+            const char* data_point = (const char*)data + vector_size * i;
+            memset(data_level0_memory_ + i * size_data_per_element_ + offsetLevel0_, 0, size_data_per_element_);
+            setData(i, data_point);
+            if (metric_type_ == Metric::COSINE) {
+                data_norm_l2_[i] =
+                    std::sqrt(faiss::fvec_norm_L2sqr((const float*)data_point, *(size_t*)(dist_func_param_)));
+            }
+        }
+
+        enterpoint_node_ = 0;
+        maxlevel_ = element_levels_[0];
+        cur_element_count = 1;
+
+        for (size_t begin = 1; begin < n;) {
+            const size_t end = std::min(n, begin + std::min(begin, batch_size));
+            const tableint enterpoint = enterpoint_node_;
+            const int maxlevel = maxlevel_;
+
+#pragma omp parallel for schedule(dynamic, 16)
+            for (int64_t i = begin; i < (int64_t)end; i++) {
+                linkToFrozenGraph(i, enterpoint, maxlevel);
+            }
+            addBackLinks(begin, end);
+
+            for (size_t i = begin; i < end; i++) {
+                if (element_levels_[i] > maxlevel_) {
+                    enterpoint_node_ = i;
+                    maxlevel_ = element_levels_[i];
+                }
+            }
+            cur_element_count = end;
+            begin = end;
+        }
+    }
+
+    // fills the link lists of cur_c from a graph nobody writes, and only cur_c's own lists
+    void
+    linkToFrozenGraph(tableint cur_c, tableint enterpoint, int maxlevel) {
+        const int curlevel = element_levels_[cur_c];
+        tableint currObj = enterpoint;
+        dist_t curdist = calcDistance(cur_c, currObj);
+        for (int level = maxlevel; level > curlevel; level--) {
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                linklistsizeint* ll = get_linklist(currObj, level);
+                int size = getListCount(ll);
+                tableint* datal = (tableint*)(ll + 1);
+                for (int i = 0; i < size; i++) {
+                    dist_t d = calcDistance(cur_c, datal[i]);
+                    if (d < curdist) {
+                        curdist = d;
+                        currObj = datal[i];
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        for (int level = std::min(curlevel, maxlevel); level >= 0; level--) {
+            auto top_candidates = searchBaseLayer<true>(currObj, cur_c, level);
+            std::vector<tableint> selected(getNeighborsByHeuristic2(top_candidates, M_));
+            linklistsizeint* ll_cur = get_linklist_at_level(cur_c, level);
+            setListCount(ll_cur, selected.size());
+            std::copy(selected.begin(), selected.end(), (tableint*)(ll_cur + 1));
+            currObj = selected.front();
+        }
+    }
+
+    // Links the nodes found by linkToFrozenGraph back to the new nodes [begin, end). The links are spread over
+    // buckets by target in chunks of the new nodes, then every bucket sorts its links by (target, level) and merges
+    // each target alone, pruning with the heuristic when the list overflows.
+    void
+    addBackLinks(size_t begin, size_t end) {
+        using BackLink = std::tuple<tableint, int, tableint>;  // target, level, source
+        constexpr size_t kBuckets = 256;
+        const size_t n_chunks = std::min(end - begin, (size_t)64);
+        std::vector<std::vector<std::vector<BackLink>>> chunks(n_chunks, std::vector<std::vector<BackLink>>(kBuckets));
+
+#pragma omp parallel for
+        for (int64_t c = 0; c < (int64_t)n_chunks; c++) {
+            auto& buckets = chunks[c];
+            const size_t chunk_begin = begin + (end - begin) * c / n_chunks;
+            const size_t chunk_end = begin + (end - begin) * (c + 1) / n_chunks;
+            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                for (int level = 0; level <= element_levels_[i]; level++) {
+                    linklistsizeint* ll = get_linklist_at_level(i, level);
+                    size_t size = getListCount(ll);
+                    tableint* datal = (tableint*)(ll + 1);
+                    for (size_t j = 0; j < size; j++) {
+                        buckets[datal[j] % kBuckets].emplace_back(datal[j], level, i);
+                    }
+                }
+            }
+        }
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int64_t b = 0; b < (int64_t)kBuckets; b++) {
+            std::vector<BackLink> links;
+            for (auto& buckets : chunks) {
+                links.insert(links.end(), buckets[b].begin(), buckets[b].end());
+            }
+            std::sort(links.begin(), links.end());
+            for (size_t first = 0, last = 0; first < links.size(); first = last) {
+                while (last < links.size() && std::get<0>(links[last]) == std::get<0>(links[first]) &&
+                       std::get<1>(links[last]) == std::get<1>(links[first])) {
+                    last++;
+                }
+                mergeBackLinks(links.data() + first, links.data() + last);
+            }
+        }
+    }
+
+    template <typename BackLink>
+    void
+    mergeBackLinks(const BackLink* first, const BackLink* last) {
+        const tableint target = std::get<0>(*first);
+        const int level = std::get<1>(*first);
+        const size_t Mcurmax = level ? maxM_ : maxM0_;
+        linklistsizeint* ll = get_linklist_at_level(target, level);
+        size_t size = getListCount(ll);
+        tableint* datal = (tableint*)(ll + 1);
+
+        if (size + (last - first) <= Mcurmax) {
+            for (auto it = first; it != last; ++it) {
+                datal[size++] = std::get<2>(*it);
+            }
+            setListCount(ll, size);
+            return;
+        }
+
+        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst>
+            candidates;
+        for (size_t j = 0; j < size; j++) {
+            candidates.emplace(calcDistance(datal[j], target), datal[j]);
+        }
+        for (auto it = first; it != last; ++it) {
+            candidates.emplace(calcDistance(std::get<2>(*it), target), std::get<2>(*it));
+        }
+        std::vector<tableint> selected(getNeighborsByHeuristic2(candidates, Mcurmax));
+        setListCount(ll, selected.size());
+        std::copy(selected.begin(), selected.end(), datal);
+    }
+
     std::vector<std::pair<dist_t, labeltype>>
     searchKnnBF(void* query_data, size_t k, const knowhere::BitsetView bitset) const {
         knowhere::ResultMaxHeap<dist_t, labeltype> max_heap(k);
-        for (labeltype id = 0; id < cur_element_count; ++id) {
-            if (!bitset.test(id)) {
-                dist_t dist = calcDistance(query_data, id);
-                max_heap.Push(dist, id);
-            }
-        }
+        knowhere::ForEachValidId(bitset, cur_element_count, [&](labeltype label) {
+            const tableint id = getInternalId(label);
+            dist_t dist = raw_data_ != nullptr ? calcRawDistance(query_data, id) : calcDistance(query_data, id);
+            max_heap.Push(dist, label);
+        });
         const size_t len = std::min(max_heap.Size(), k);
         std::vector<std::pair<dist_t, labeltype>> result(len);
         for (int64_t i = len - 1; i >= 0; --i) {
@@ -1156,16 +1547,16 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             knowhere::NormalizeVec((float*)query_data, *((size_t*)dist_func_param_));
         }
 
-        // do bruteforce search when delete rate high
-        if (!bitset.empty()) {
-            const auto bs_cnt = bitset.count();
-            if (bs_cnt == cur_element_count)
-                return {};
-            if (bs_cnt >= (cur_element_count * kHnswSearchKnnBFThreshold)) {
-                return searchKnnBF(query_data, k, bitset);
-            }
+        const auto strategy = knowhere::ChooseFilterStrategy(bitset, cur_element_count, kHnswSearchPostFilterThreshold,
+                                                             kHnswSearchKnnBFThreshold);
+        if (strategy == knowhere::FilterStrategy::ALL_FILTERED) {
+            return {};
+        }
+        if (strategy == knowhere::FilterStrategy::BRUTE_FORCE) {
+            return searchKnnBF(query_data, k, bitset);
         }
 
+        const auto walk_start = std::chrono::steady_clock::now();
         tableint currObj = enterpoint_node_;
         uint64_t vec_hash;
         if (metric_type_ == Metric::HAMMING || metric_type_ == Metric::JACCARD) {
@@ -1174,7 +1565,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             vec_hash = knowhere::hash_vec((const float*)query_data, *(size_t*)dist_func_param_);
         }
         // for tuning, do not use cache
-        if (param->for_tuning || !lru_cache.try_get(vec_hash, currObj)) {
+        if (param->for_tuning || !getCachedEntryPoint(vec_hash, currObj)) {
             dist_t curdist = calcDistance(query_data, enterpoint_node_);
 
             for (int level = maxlevel_; level > 0; level--) {
@@ -1202,9 +1593,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                             throw std::runtime_error("cand error");
                         dist_t d = calcDistance(query_data, cand);
                         if (feder_result != nullptr) {
-                            feder_result->visit_info_.AddVisitRecord(level, currObj, cand, d);
-                            feder_result->id_set_.insert(currObj);
-                            feder_result->id_set_.insert(cand);
+                            feder_result->visit_info_.AddVisitRecord(level, getExternalLabel(currObj),
+                                                                     getExternalLabel(cand), d);
+                            feder_result->id_set_.insert(getExternalLabel(currObj));
+                            feder_result->id_set_.insert(getExternalLabel(cand));
                         }
 
                         if (d < curdist) {
@@ -1217,20 +1609,37 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             }
         }
         std::vector<std::pair<dist_t, tableint>> top_candidates;
-        size_t ef = param ? param->ef_ : this->ef_;
-        if (!bitset.empty()) {
-            top_candidates = searchBaseLayerST<true, true>(currObj, query_data, std::max(ef, k), bitset, feder_result);
+        size_t ef = std::max(param ? param->ef_ : this->ef_, k);
+        if (strategy == knowhere::FilterStrategy::PRE_FILTER) {
+            top_candidates = searchBaseLayerST<true, true>(currObj, query_data, ef, bitset, feder_result);
+        } else if (strategy == knowhere::FilterStrategy::POST_FILTER) {
+            // widen ef by the filtered share so that about ef candidates are left once the filtered ones are dropped
+            const size_t post_ef = ef + (ef * bitset.count() + cur_element_count - 1) / cur_element_count;
+            top_candidates = searchBaseLayerST<false, true>(currObj, query_data, post_ef, bitset, feder_result);
+            dropFiltered(top_candidates, bitset);
+            if (top_candidates.size() < k) {
+                top_candidates = searchBaseLayerST<true, true>(currObj, query_data, ef, bitset, feder_result);
+            }
         } else {
-            top_candidates = searchBaseLayerST<false, true>(currObj, query_data, std::max(ef, k), bitset, feder_result);
+            top_candidates = searchBaseLayerST<false, true>(currObj, query_data, ef, bitset, feder_result);
+        }
+        knowhere::ObserveSearchPhase(knowhere::SearchPhase::GRAPH_HOPS,
+                                     knowhere::ScopedPhaseTimer::ElapsedMs(walk_start));
+        if (raw_data_ != nullptr) {
+            // the graph was walked on codes, order all ef candidates by their exact distances
+            for (auto& candidate : top_candidates) {
+                candidate.first = calcRawDistance(query_data, candidate.second);
+            }
+            std::sort(top_candidates.begin(), top_candidates.end(), CompareByFirst());
         }
         std::vector<std::pair<dist_t, labeltype>> result;
         size_t len = std::min(k, top_candidates.size());
         result.reserve(len);
         for (int i = 0; i < len; ++i) {
-            result.emplace_back(top_candidates[i].first, (labeltype)top_candidates[i].second);
+            result.emplace_back(top_candidates[i].first, getExternalLabel(top_candidates[i].second));
         }
         if (len > 0) {
-            lru_cache.put(vec_hash, result[0].second);
+            entry_cache_.put(vec_hash, top_candidates[0].second);
         }
         return result;
     };
@@ -1238,17 +1647,26 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     std::vector<std::pair<dist_t, labeltype>>
     searchRangeBF(void* query_data, float radius, const knowhere::BitsetView bitset) const {
         std::vector<std::pair<dist_t, labeltype>> result;
-        for (labeltype id = 0; id < cur_element_count; ++id) {
-            if (!bitset.test(id)) {
-                dist_t dist = calcDistance(query_data, id);
-                if (dist < radius) {
-                    result.emplace_back(dist, id);
-                }
+        knowhere::ForEachValidId(bitset, cur_element_count, [&](labeltype label) {
+            const tableint id = getInternalId(label);
+            dist_t dist = raw_data_ != nullptr ? calcRawDistance(query_data, id) : calcDistance(query_data, id);
+            if (dist < radius) {
+                result.emplace_back(dist, label);
             }
-        }
+        });
         return result;
     }
 
+    // removes the candidates the bitset filters out, keeping the order of the others
+    void
+    dropFiltered(std::vector<std::pair<dist_t, tableint>>& candidates, const knowhere::BitsetView bitset) const {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [&](const std::pair<dist_t, tableint>& candidate) {
+                                            return bitset.test((int64_t)getExternalLabel(candidate.second));
+                                        }),
+                         candidates.end());
+    }
+
     std::vector<std::pair<dist_t, labeltype>>
     searchRange(void* query_data, float radius, const knowhere::BitsetView bitset, const SearchParam* param = nullptr,
                 const knowhere::feder::hnsw::FederResultUniq& feder_result = nullptr) const {
@@ -1261,16 +1679,16 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             knowhere::NormalizeVec((float*)query_data, *((size_t*)dist_func_param_));
         }
 
-        // do bruteforce range search when delete rate high
-        if (!bitset.empty()) {
-            const auto bs_cnt = bitset.count();
-            if (bs_cnt == cur_element_count)
-                return {};
-            if (bs_cnt >= (cur_element_count * kHnswSearchRangeBFThreshold)) {
-                return searchRangeBF(query_data, radius, bitset);
-            }
+        const auto strategy = knowhere::ChooseFilterStrategy(bitset, cur_element_count, kHnswSearchPostFilterThreshold,
+                                                             kHnswSearchRangeBFThreshold);
+        if (strategy == knowhere::FilterStrategy::ALL_FILTERED) {
+            return {};
+        }
+        if (strategy == knowhere::FilterStrategy::BRUTE_FORCE) {
+            return searchRangeBF(query_data, radius, bitset);
         }
 
+        const auto walk_start = std::chrono::steady_clock::now();
         tableint currObj = enterpoint_node_;
         uint64_t vec_hash;
         if (metric_type_ == Metric::HAMMING || metric_type_ == Metric::JACCARD) {
@@ -1279,7 +1697,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             vec_hash = knowhere::hash_vec((const float*)query_data, *(size_t*)dist_func_param_);
         }
         // for tuning, do not use cache
-        if (param->for_tuning || !lru_cache.try_get(vec_hash, currObj)) {
+        if (param->for_tuning || !getCachedEntryPoint(vec_hash, currObj)) {
             dist_t curdist = calcDistance(query_data, enterpoint_node_);
 
             for (int level = maxlevel_; level > 0; level--) {
@@ -1303,9 +1721,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                             throw std::runtime_error("cand error");
                         dist_t d = calcDistance(query_data, cand);
                         if (feder_result != nullptr) {
-                            feder_result->visit_info_.AddVisitRecord(level, currObj, cand, d);
-                            feder_result->id_set_.insert(currObj);
-                            feder_result->id_set_.insert(cand);
+                            feder_result->visit_info_.AddVisitRecord(level, getExternalLabel(currObj),
+                                                                     getExternalLabel(cand), d);
+                            feder_result->id_set_.insert(getExternalLabel(currObj));
+                            feder_result->id_set_.insert(getExternalLabel(cand));
                         }
                         if (d < curdist) {
                             curdist = d;
@@ -1319,7 +1738,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
         std::vector<std::pair<dist_t, tableint>> top_candidates;
         size_t ef = param ? param->ef_ : this->ef_;
-        if (!bitset.empty()) {
+        if (strategy == knowhere::FilterStrategy::PRE_FILTER) {
             top_candidates = searchBaseLayerST<true, true>(currObj, query_data, ef, bitset, feder_result);
         } else {
             top_candidates = searchBaseLayerST<false, true>(currObj, query_data, ef, bitset, feder_result);
@@ -1328,10 +1747,100 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         if (top_candidates.size() == 0) {
             return {};
         } else {
-            lru_cache.put(vec_hash, top_candidates[0].second);
+            entry_cache_.put(vec_hash, top_candidates[0].second);
         }
 
-        return getNeighboursWithinRadius(top_candidates, query_data, radius, bitset);
+        // a post filtered search also expands the radius through the filtered ids and drops them at the end. With
+        // raw vectors the codes are expanded through a radius wide enough for the quantization error and only the
+        // exact distances decide
+        const bool post_filter = strategy == knowhere::FilterStrategy::POST_FILTER;
+        const float expand_radius = raw_data_ != nullptr ? codeRadius(query_data, radius) : radius;
+        auto result =
+            getNeighboursWithinRadius(top_candidates, query_data, expand_radius, post_filter ? nullptr : bitset);
+        knowhere::ObserveSearchPhase(knowhere::SearchPhase::GRAPH_HOPS,
+                                     knowhere::ScopedPhaseTimer::ElapsedMs(walk_start));
+        if (post_filter) {
+            result.erase(std::remove_if(result.begin(), result.end(),
+                                        [&](const std::pair<dist_t, labeltype>& r) { return bitset.test(r.second); }),
+                         result.end());
+        }
+        if (raw_data_ != nullptr) {
+            // the widened radius was applied to the code distances, the exact ones have to be within radius
+            size_t n = 0;
+            for (size_t i = 0; i < result.size(); i++) {
+                dist_t dist = calcRawDistance(query_data, getInternalId(result[i].second));
+                if (dist < radius) {
+                    result[n++] = {dist, result[i].second};
+                }
+            }
+            result.resize(n);
+        }
+        return result;
+    }
+
+    // Renumbers the internal ids so that nodes that are close in the level 0 graph are also close in memory, a search
+    // then touches far fewer cache lines and pages per hop. BFS lists the nodes breadth first from the entry point,
+    // RCM (reverse Cuthill-McKee) goes breadth first from the lowest degree node, visits the neighbours of a node by
+    // increasing degree and reverses the order. Results keep reporting labels through internal_to_external_.
+    // Elements are moved in place, must not run concurrently with searches or inserts.
+    void
+    reorderGraph(GraphReorder method) {
+        if (method == GraphReorder::NONE || cur_element_count == 0) {
+            return;
+        }
+        if (mmap_enabled_) {
+            throw std::runtime_error("Can not reorder a mmapped index");
+        }
+        const size_t n = cur_element_count;
+        std::vector<tableint> order = getReorderedIds(method);
+        std::vector<tableint> perm(n);
+        for (size_t i = 0; i < n; i++) {
+            perm[order[i]] = i;
+        }
+
+        permuteInPlace(data_level0_memory_, size_data_per_element_, order);
+        for (size_t i = 0; i < n; i++) {
+            relinkList(get_linklist0(i), perm);
+        }
+
+        if (metric_type_ == Metric::COSINE) {
+            permuteInPlace((char*)data_norm_l2_, sizeof(float), order);
+        }
+
+        if (raw_data_owned_) {
+            permuteInPlace((char*)raw_data_, getVectorSize(), order);
+        } else if (raw_data_ != nullptr) {
+            const size_t vec_size = getVectorSize();
+            char* new_raw = (char*)malloc(max_elements_ * vec_size);  // NOLINT
+            if (new_raw == nullptr) {
+                throw std::runtime_error("Not enough memory: reorderGraph failed to allocate raw data");
+            }
+            for (size_t i = 0; i < n; i++) {
+                memcpy(new_raw + i * vec_size, (char*)raw_data_ + order[i] * vec_size, vec_size);
+            }
+            // borrowed raw vectors are left alone and replaced by the reordered copy
+            raw_data_ = (float*)new_raw;
+            raw_data_owned_ = true;
+            raw_file_.reset();
+        }
+
+        permuteInPlace((char*)linkLists_, sizeof(char*), order);
+        permuteInPlace((char*)element_levels_.data(), sizeof(int), order);
+        for (size_t i = 0; i < n; i++) {
+            for (int level = 1; level <= element_levels_[i]; level++) {
+                relinkList(get_linklist(i, level), perm);
+            }
+        }
+        enterpoint_node_ = perm[enterpoint_node_];
+
+        std::vector<tableint> labels(n);
+        for (size_t i = 0; i < n; i++) {
+            labels[i] = getExternalLabel(order[i]);
+        }
+        internal_to_external_ = std::move(labels);
+        buildExternalToInternal();
+        // cached entry points are internal ids of the old order
+        entry_cache_.resize(entry_cache_.capacity());
     }
 
     void
@@ -1367,15 +1876,274 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         std::cout << "integrity ok, checked " << connections_checked << " connections\n";
     }
 
+    static constexpr uint32_t kReorderedMagic = 0x52444f48;  // "HODR"
+    static constexpr uint32_t kQuantizedMagic = 0x51534f48;  // "HOSQ"
+    static constexpr uint32_t kRawDataMagic = 0x57524f48;    // "HORW"
+    // leads the binaries whose upper levels are a CSR section, older binaries start with the metric type and
+    // store every node's upper levels behind their size instead
+    static constexpr uint64_t kMappableMagic = 0x3152534357534e48;  // "HNSWCSR1"
+
+    static size_t
+    csrPadding(size_t offset) {
+        return (sizeof(uint64_t) - offset % sizeof(uint64_t)) % sizeof(uint64_t);
+    }
+
+    // reads the metric type, returns whether the upper levels are a CSR section
+    template <typename R>
+    bool
+    readLayout(R& input) {
+        uint64_t head;
+        readBinaryPOD(input, head);
+        if (head != kMappableMagic) {
+            metric_type_ = head;
+            return false;
+        }
+        readBinaryPOD(input, metric_type_);
+        return true;
+    }
+
+    // fills linkLists_ and element_levels_ from either layout, offset is the position of input in the binary
+    template <typename R>
+    void
+    readUpperLevels(R& input, bool csr, size_t offset, size_t max_elements) {
+        linkLists_ = (char**)calloc(max_elements, sizeof(void*));  // NOLINT
+        if (linkLists_ == nullptr) {
+            throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklists");
+        }
+        element_levels_ = std::vector<int>(max_elements);
+
+        std::vector<uint64_t> upper_offsets;
+        if (csr) {
+            char padding[sizeof(uint64_t)];
+            if (size_t size = csrPadding(offset)) {
+                input.read(padding, size);
+            }
+            upper_offsets.resize(cur_element_count + 1);
+            input.read((char*)upper_offsets.data(), upper_offsets.size() * sizeof(uint64_t));
+        }
+        for (size_t i = 0; i < cur_element_count; i++) {
+            unsigned int linkListSize;
+            if (csr) {
+                linkListSize = (upper_offsets[i + 1] - upper_offsets[i]) * size_links_per_element_;
+            } else {
+                readBinaryPOD(input, linkListSize);
+            }
+            element_levels_[i] = linkListSize / size_links_per_element_;
+            if (linkListSize != 0) {
+                linkLists_[i] = (char*)malloc(linkListSize);
+                if (linkLists_[i] == nullptr) {
+                    throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklist");
+                }
+                input.read(linkLists_[i], linkListSize);
+            }
+        }
+    }
+
+    template <typename R>
+    void
+    readTrailingSection(R& input) {
+        uint32_t magic;
+        readBinaryPOD(input, magic);
+        if (magic == kReorderedMagic) {
+            internal_to_external_.resize(cur_element_count);
+            input.read((char*)internal_to_external_.data(), cur_element_count * sizeof(tableint));
+            buildExternalToInternal();
+        } else if (magic == kQuantizedMagic) {
+            int32_t qtype;
+            float vmin, scale;
+            readBinaryPOD(input, qtype);
+            readBinaryPOD(input, vmin);
+            readBinaryPOD(input, scale);
+            setQuantizer((QuantType)qtype, vmin, scale);
+        } else if (magic == kRawDataMagic) {
+            raw_data_expected_ = true;
+        } else {
+            throw std::runtime_error("Invalid trailing section in hnsw index");
+        }
+    }
+
+    // swaps the plain space created from the header for the quantized space the level 0 codes were written with
+    void
+    setQuantizer(QuantType qtype, float vmin, float scale) {
+        const size_t dim = *(size_t*)dist_func_param_;
+        SQSpace* space = nullptr;
+        if (metric_type_ == Metric::L2) {
+            space = new L2SQSpace(dim, qtype);
+        } else if (metric_type_ == Metric::INNER_PRODUCT) {
+            space = new InnerProductSQSpace(dim, qtype);
+        } else if (metric_type_ == Metric::COSINE) {
+            space = new CosineSQSpace(dim, qtype);
+        } else {
+            throw std::runtime_error("Invalid metric type for a quantized index " + std::to_string(metric_type_));
+        }
+        space->setRange(vmin, scale);
+        if (space->get_data_size() != data_size_) {
+            delete space;
+            throw std::runtime_error("Quantized data size mismatch in hnsw index");
+        }
+        delete space_;
+        space_ = space;
+        sq_space_ = space;
+        fstdistfunc_ = space_->get_dist_func();
+        fstdistfunc_query_ = space_->get_query_dist_func();
+        dist_func_param_ = space_->get_dist_func_param();
+    }
+
+    // keeps a copy of every added vector to rerank with, call before adding points
+    void
+    enableRawData() {
+        raw_data_ = (float*)malloc(max_elements_ * getVectorSize());  // NOLINT
+        if (raw_data_ == nullptr) {
+            throw std::runtime_error("Not enough memory: enableRawData failed to allocate raw data");
+        }
+        raw_data_owned_ = true;
+    }
+
+    void
+    saveRawData(knowhere::MemoryIOWriter& output) {
+        output.write(raw_data_, cur_element_count * getVectorSize());
+    }
+
+    // whether the binary was saved with raw vectors, they have to be loaded with setRawData() or loadRawData()
+    bool
+    expectsRawData() const {
+        return raw_data_expected_;
+    }
+
+    // reads the raw vectors from the file saveRawData() was written to, or maps it when mmap is set
+    void
+    loadRawData(const std::string& location, bool mmap) {
+        auto raw_file = knowhere::LoadBinaryFile(location, cur_element_count * getVectorSize(), mmap);
+        setRawData((const float*)raw_file->data.get(), cur_element_count);
+        raw_file_ = raw_file;
+        raw_file_mapped_ = mmap;
+    }
+
+    // borrows the n raw vectors written by saveRawData(), data must outlive the index or the next reorderGraph()
+    void
+    setRawData(const float* data, size_t n) {
+        if (n != cur_element_count) {
+            throw std::runtime_error("Raw data of " + std::to_string(n) + " vectors for an index of " +
+                                     std::to_string(cur_element_count));
+        }
+        if (raw_data_owned_) {
+            free(raw_data_);
+        }
+        raw_data_ = const_cast<float*>(data);
+        raw_data_owned_ = false;
+        raw_file_.reset();
+        code_error_bound_.store(-1.0f, std::memory_order_relaxed);
+    }
+
+    // moves element order[i] of the elem_size byte elements at base to position i, cycle by cycle through one element
+    // of scratch space
+    static void
+    permuteInPlace(char* base, size_t elem_size, const std::vector<tableint>& order) {
+        std::vector<bool> moved(order.size(), false);
+        std::vector<char> first(elem_size);
+        for (size_t start = 0; start < order.size(); start++) {
+            if (moved[start] || order[start] == start) {
+                continue;
+            }
+            memcpy(first.data(), base + start * elem_size, elem_size);
+            size_t i = start;
+            for (; order[i] != start; i = order[i]) {
+                memcpy(base + i * elem_size, base + order[i] * elem_size, elem_size);
+                moved[i] = true;
+            }
+            memcpy(base + i * elem_size, first.data(), elem_size);
+            moved[i] = true;
+        }
+    }
+
+    void
+    relinkList(linklistsizeint* ll, const std::vector<tableint>& perm) {
+        int size = getListCount(ll);
+        tableint* data = (tableint*)(ll + 1);
+        for (int j = 0; j < size; j++) {
+            data[j] = perm[data[j]];
+        }
+    }
+
+    void
+    buildExternalToInternal() {
+        external_to_internal_.assign(internal_to_external_.size(), 0);
+        for (size_t i = 0; i < internal_to_external_.size(); i++) {
+            external_to_internal_[internal_to_external_[i]] = i;
+        }
+    }
+
+    // new position -> old internal id
+    std::vector<tableint>
+    getReorderedIds(GraphReorder method) const {
+        const size_t n = cur_element_count;
+        auto degree = [&](tableint id) { return getListCount(get_linklist0(id)); };
+
+        std::vector<tableint> order;
+        order.reserve(n);
+        std::vector<bool> visited(n, false);
+        std::vector<tableint> neighbors;
+        auto bfs = [&](tableint start) {
+            size_t head = order.size();
+            order.push_back(start);
+            visited[start] = true;
+            while (head < order.size()) {
+                auto list = get_linklist0(order[head++]);
+                tableint* data = (tableint*)(list + 1);
+                neighbors.assign(data, data + getListCount(list));
+                if (method == GraphReorder::RCM) {
+                    std::stable_sort(neighbors.begin(), neighbors.end(),
+                                     [&](tableint a, tableint b) { return degree(a) < degree(b); });
+                }
+                for (auto v : neighbors) {
+                    if (!visited[v]) {
+                        visited[v] = true;
+                        order.push_back(v);
+                    }
+                }
+            }
+        };
+
+        // the level 0 graph is directed, nodes no one links to are picked up as new starts
+        std::vector<tableint> starts(n);
+        std::iota(starts.begin(), starts.end(), 0);
+        if (method == GraphReorder::RCM) {
+            std::stable_sort(starts.begin(), starts.end(), [&](tableint a, tableint b) { return degree(a) < degree(b); });
+        } else {
+            bfs(enterpoint_node_);
+        }
+        for (auto start : starts) {
+            if (!visited[start]) {
+                bfs(start);
+            }
+        }
+        if (method == GraphReorder::RCM) {
+            std::reverse(order.begin(), order.end());
+        }
+        return order;
+    }
+
     int64_t
     cal_size() {
         int64_t ret = 0;
         ret += sizeof(*this);
         ret += sizeof(*space_);
         ret += visited_list_pool_->size();
+        ret += entry_cache_.size() - sizeof(entry_cache_);
         ret += link_list_locks_.size() * sizeof(std::mutex);
         ret += element_levels_.size() * sizeof(int);
+        ret += (internal_to_external_.size() + external_to_internal_.size()) * sizeof(tableint);
         ret += max_elements_ * size_data_per_element_;
+        if (raw_data_owned_) {
+            ret += max_elements_ * getVectorSize();
+        } else if (raw_file_ != nullptr && !raw_file_mapped_) {
+            ret += raw_file_->size;
+        }
+        if (upper_offsets_ != nullptr) {
+            ret += (cur_element_count + 1) * sizeof(uint64_t);
+            ret += upper_offsets_[cur_element_count] * size_links_per_element_;
+            return ret;
+        }
         ret += max_elements_ * sizeof(void*);
         for (auto i = 0; i < max_elements_; ++i) {
             if (element_levels_[i] > 0) {
@@ -1384,6 +2152,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         }
         return ret;
     }
+
+ private:
+    // query hash -> best entry point found last time, sized by `entry_cache_size` in the index config
+    mutable knowhere::concurrent_cache<uint64_t, tableint> entry_cache_;
 };
 
 }  // namespace hnswlib
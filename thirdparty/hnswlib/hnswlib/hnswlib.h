@@ -183,6 +183,12 @@ class SpaceInterface {
     virtual DISTFUNC<MTYPE>
     get_dist_func() = 0;
 
+    // distance from a query to a stored vector, differs from get_dist_func() when the stored vectors are encoded
+    virtual DISTFUNC<MTYPE>
+    get_query_dist_func() {
+        return get_dist_func();
+    }
+
     virtual void*
     get_dist_func_param() = 0;
 
@@ -242,4 +248,5 @@ AlgorithmInterface<dist_t>::searchKnnCloserFirst(void* query_data, size_t k,
 #include "space_cosine.h"
 #include "space_hamming.h"
 #include "space_jaccard.h"
+#include "space_sq.h"
 #pragma GCC diagnostic pop
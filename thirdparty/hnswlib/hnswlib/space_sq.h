@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "faiss/impl/ScalarQuantizerOp.h"
+#include "hnswlib.h"
+#include "simd/hook.h"
+
+namespace hnswlib {
+
+// how the vectors of a quantized space are stored
+enum class QuantType {
+    NONE = 0,
+    SQ8 = 1,   // one byte per dimension, one uniform range for all dimensions
+    FP16 = 2,  // IEEE half float per dimension
+};
+
+// param of the quantized distance functions, dim must stay the first member because hnswlib reads the dimension
+// through dist_func_param_
+struct SQParam {
+    size_t dim;
+    float vmin = 0.0f;
+    float scale = 1.0f;  // (vmax - vmin) / 255
+};
+
+static float
+SQ8L2Sqr(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    auto param = (const SQParam*)param_ptr;
+    return param->scale * param->scale *
+           (float)faiss::u8vec_L2sqr((const uint8_t*)pVect1, (const uint8_t*)pVect2, param->dim);
+}
+
+// sum((vmin + scale * a) * (vmin + scale * b)), the byte sums are stored behind the codes
+static float
+SQ8InnerProductDistance(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    auto param = (const SQParam*)param_ptr;
+    int32_t sum1, sum2;
+    memcpy(&sum1, (const uint8_t*)pVect1 + param->dim, sizeof(int32_t));
+    memcpy(&sum2, (const uint8_t*)pVect2 + param->dim, sizeof(int32_t));
+    float ip = faiss::u8vec_inner_product((const uint8_t*)pVect1, (const uint8_t*)pVect2, param->dim);
+    return -1.0f * (param->dim * param->vmin * param->vmin + param->vmin * param->scale * (sum1 + sum2) +
+                    param->scale * param->scale * ip);
+}
+
+static float
+SQ8L2SqrQuery(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    auto param = (const SQParam*)param_ptr;
+    return faiss::fvec_L2sqr_sq8((const float*)pVect1, (const uint8_t*)pVect2, param->dim, param->vmin,
+                                 param->scale);
+}
+
+static float
+SQ8InnerProductDistanceQuery(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    auto param = (const SQParam*)param_ptr;
+    return -1.0f * faiss::fvec_inner_product_sq8((const float*)pVect1, (const uint8_t*)pVect2, param->dim,
+                                                 param->vmin, param->scale);
+}
+
+static float
+FP16L2Sqr(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    return faiss::fp16vec_L2sqr((const uint16_t*)pVect1, (const uint16_t*)pVect2, *((size_t*)param_ptr));
+}
+
+static float
+FP16InnerProductDistance(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    return -1.0f * faiss::fp16vec_inner_product((const uint16_t*)pVect1, (const uint16_t*)pVect2,
+                                                *((size_t*)param_ptr));
+}
+
+static float
+FP16L2SqrQuery(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    return faiss::fvec_L2sqr_fp16((const float*)pVect1, (const uint16_t*)pVect2, *((size_t*)param_ptr));
+}
+
+static float
+FP16InnerProductDistanceQuery(const void* pVect1, const void* pVect2, const void* param_ptr) {
+    return -1.0f * faiss::fvec_inner_product_fp16((const float*)pVect1, (const uint16_t*)pVect2,
+                                                  *((size_t*)param_ptr));
+}
+
+// A space whose vectors are stored as codes. The graph is built comparing codes to codes (get_dist_func), queries
+// stay float and are compared to the codes directly (get_query_dist_func), so a query is never quantized. SQ8 codes
+// of the inner product spaces carry the int32 sum of their bytes behind the bytes, which keeps the code to code
+// inner product in integers.
+class SQSpace : public SpaceInterface<float> {
+ public:
+    SQSpace(size_t dim, QuantType qtype, bool is_ip) : qtype_(qtype), is_ip_(is_ip) {
+        param_.dim = dim;
+        if (qtype == QuantType::SQ8) {
+            data_size_ = dim + (is_ip ? sizeof(int32_t) : 0);
+            fstdistfunc_ = is_ip ? SQ8InnerProductDistance : SQ8L2Sqr;
+            fstdistfunc_query_ = is_ip ? SQ8InnerProductDistanceQuery : SQ8L2SqrQuery;
+        } else if (qtype == QuantType::FP16) {
+            data_size_ = dim * sizeof(uint16_t);
+            fstdistfunc_ = is_ip ? FP16InnerProductDistance : FP16L2Sqr;
+            fstdistfunc_query_ = is_ip ? FP16InnerProductDistanceQuery : FP16L2SqrQuery;
+        } else {
+            throw std::runtime_error("Invalid quant type " + std::to_string((int)qtype));
+        }
+    }
+
+    // SQ8 takes the range of all values of all dimensions, FP16 needs no training
+    void
+    train(const float* x, size_t n) {
+        if (qtype_ != QuantType::SQ8) {
+            return;
+        }
+        float vmin = std::numeric_limits<float>::max();
+        float vmax = std::numeric_limits<float>::lowest();
+        for (size_t i = 0; i < n * param_.dim; i++) {
+            vmin = std::min(vmin, x[i]);
+            vmax = std::max(vmax, x[i]);
+        }
+        if (n == 0) {
+            vmin = vmax = 0.0f;
+        }
+        setRange(vmin, vmax > vmin ? (vmax - vmin) / 255.0f : 1.0f);
+    }
+
+    void
+    setRange(float vmin, float scale) {
+        param_.vmin = vmin;
+        param_.scale = scale;
+    }
+
+    void
+    encode(const float* x, void* code) const {
+        if (qtype_ == QuantType::SQ8) {
+            auto c = (uint8_t*)code;
+            int32_t sum = 0;
+            for (size_t i = 0; i < param_.dim; i++) {
+                float v = std::round((x[i] - param_.vmin) / param_.scale);
+                c[i] = (uint8_t)std::min(255.0f, std::max(0.0f, v));
+                sum += c[i];
+            }
+            if (is_ip_) {
+                memcpy(c + param_.dim, &sum, sizeof(int32_t));
+            }
+        } else {
+            auto c = (uint16_t*)code;
+            for (size_t i = 0; i < param_.dim; i++) {
+                c[i] = faiss::encode_fp16(x[i]);
+            }
+        }
+    }
+
+    void
+    decode(const void* code, float* x) const {
+        if (qtype_ == QuantType::SQ8) {
+            auto c = (const uint8_t*)code;
+            for (size_t i = 0; i < param_.dim; i++) {
+                x[i] = param_.vmin + param_.scale * c[i];
+            }
+        } else {
+            auto c = (const uint16_t*)code;
+            for (size_t i = 0; i < param_.dim; i++) {
+                x[i] = faiss::decode_fp16(c[i]);
+            }
+        }
+    }
+
+    // squared L2 distance between a vector and its code, i.e. how far quantization moved the vector
+    float
+    codeError(const float* x, const void* code) const {
+        return qtype_ == QuantType::SQ8 ? SQ8L2SqrQuery(x, code, &param_) : FP16L2SqrQuery(x, code, &param_);
+    }
+
+    QuantType
+    qtype() const {
+        return qtype_;
+    }
+
+    const SQParam&
+    param() const {
+        return param_;
+    }
+
+    size_t
+    get_data_size() {
+        return data_size_;
+    }
+
+    DISTFUNC<float>
+    get_dist_func() {
+        return fstdistfunc_;
+    }
+
+    DISTFUNC<float>
+    get_query_dist_func() {
+        return fstdistfunc_query_;
+    }
+
+    void*
+    get_dist_func_param() {
+        return &param_;
+    }
+
+ private:
+    DISTFUNC<float> fstdistfunc_;
+    DISTFUNC<float> fstdistfunc_query_;
+    size_t data_size_;
+    SQParam param_;
+    QuantType qtype_;
+    bool is_ip_;
+};
+
+class L2SQSpace : public SQSpace {
+ public:
+    L2SQSpace(size_t dim, QuantType qtype) : SQSpace(dim, qtype, false) {
+    }
+};
+
+class InnerProductSQSpace : public SQSpace {
+ public:
+    InnerProductSQSpace(size_t dim, QuantType qtype) : SQSpace(dim, qtype, true) {
+    }
+};
+
+// like CosineSpace the codes are of the raw vectors, hnswlib divides by the stored norms
+class CosineSQSpace : public SQSpace {
+ public:
+    CosineSQSpace(size_t dim, QuantType qtype) : SQSpace(dim, qtype, true) {
+    }
+};
+
+}  // namespace hnswlib
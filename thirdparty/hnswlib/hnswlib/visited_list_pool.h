@@ -1,45 +1,180 @@
 #pragma once
 
 #include <algorithm>
-#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <thread>
-#include <unordered_map>
-#include <vector>
 
 namespace hnswlib {
 
+///////////////////////////////////////////////////////////
+//
+// Epoch-stamped visited table
+//
+// Instead of clearing numelements entries for every query, each list keeps
+// a current tag and an element counts as visited iff its mark equals the
+// tag. Starting a new query only bumps the tag; the mark array is cleared
+// once every 65535 queries when the tag wraps around.
+//
+/////////////////////////////////////////////////////////
+
+class VisitedList {
+ public:
+    using vl_type = uint16_t;
+
+    explicit VisitedList(size_t numelements) : numelements_(numelements), mass_(new vl_type[numelements]()) {
+    }
+
+    void
+    reset() {
+        ++cur_v_;
+        if (cur_v_ == 0) {
+            std::memset(mass_.get(), 0, sizeof(vl_type) * numelements_);
+            cur_v_ = 1;
+        }
+    }
+
+    inline bool
+    get(size_t id) const {
+        return mass_[id] == cur_v_;
+    }
+
+    inline void
+    set(size_t id) {
+        mass_[id] = cur_v_;
+    }
+
+    size_t
+    capacity() const {
+        return numelements_;
+    }
+
+ private:
+    size_t numelements_;
+    vl_type cur_v_{0};
+    std::unique_ptr<vl_type[]> mass_;
+};
+
 ///////////////////////////////////////////////////////////
 //
 // Class for multi-threaded pool-management of VisitedLists
 //
+// Free lists are parked in a fixed number of atomic slots, so taking and
+// returning a list is a handful of exchanges with no mutex and no hashing.
+// Lists are created lazily, one per concurrently running search; when all
+// slots are busy on return the surplus list is simply freed.
+//
 /////////////////////////////////////////////////////////
 
 class VisitedListPool {
-    int numelements;
-    std::unordered_map<std::thread::id, std::vector<bool>> map;
-    std::mutex mtx;
-
  public:
-    VisitedListPool(int numelements1) {
-        numelements = numelements1;
+    class Handle {
+     public:
+        Handle(VisitedListPool* pool, VisitedList* list) : pool_(pool), list_(list) {
+        }
+        Handle(Handle&& other) noexcept : pool_(other.pool_), list_(other.list_) {
+            other.list_ = nullptr;
+        }
+        Handle(const Handle&) = delete;
+        Handle&
+        operator=(const Handle&) = delete;
+        Handle&
+        operator=(Handle&&) = delete;
+
+        ~Handle() {
+            if (list_ != nullptr) {
+                pool_->releaseVisitedList(list_);
+            }
+        }
+
+        inline bool
+        get(size_t id) const {
+            return list_->get(id);
+        }
+
+        inline void
+        set(size_t id) {
+            list_->set(id);
+        }
+
+     private:
+        VisitedListPool* pool_;
+        VisitedList* list_;
+    };
+
+    explicit VisitedListPool(size_t numelements, size_t num_slots = 0)
+        : numelements_(numelements),
+          num_slots_(num_slots != 0 ? num_slots : std::max(2 * std::thread::hardware_concurrency(), 16u)),
+          slots_(new std::atomic<VisitedList*>[num_slots_]) {
+        for (size_t i = 0; i < num_slots_; ++i) {
+            slots_[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~VisitedListPool() {
+        for (size_t i = 0; i < num_slots_; ++i) {
+            delete slots_[i].load(std::memory_order_relaxed);
+        }
     }
 
-    std::vector<bool>&
+    VisitedListPool(const VisitedListPool&) = delete;
+    VisitedListPool&
+    operator=(const VisitedListPool&) = delete;
+
+    Handle
     getFreeVisitedList() {
-        std::unique_lock lk(mtx);
-        auto& res = map[std::this_thread::get_id()];
-        lk.unlock();
-        if (res.size() != numelements) {
-            res.assign(numelements, false);
-        } else {
-            std::fill(res.begin(), res.end(), false);
-        }
-        return res;
-    };
+        const size_t start = slotHint();
+        for (size_t i = 0; i < num_slots_; ++i) {
+            auto& slot = slots_[(start + i) % num_slots_];
+            if (slot.load(std::memory_order_relaxed) == nullptr) {
+                continue;
+            }
+            if (VisitedList* list = slot.exchange(nullptr, std::memory_order_acquire)) {
+                list->reset();
+                return Handle(this, list);
+            }
+        }
+        auto list = new VisitedList(numelements_);
+        num_lists_.fetch_add(1, std::memory_order_relaxed);
+        list->reset();
+        return Handle(this, list);
+    }
 
     int64_t
-    size() {
-        return numelements * (sizeof(std::thread::id) + numelements / 8) + sizeof(*this);
+    size() const {
+        return sizeof(*this) + num_slots_ * sizeof(std::atomic<VisitedList*>) +
+               num_lists_.load(std::memory_order_relaxed) *
+                   (sizeof(VisitedList) + numelements_ * sizeof(VisitedList::vl_type));
     }
+
+ private:
+    void
+    releaseVisitedList(VisitedList* list) {
+        const size_t start = slotHint();
+        for (size_t i = 0; i < num_slots_; ++i) {
+            VisitedList* expected = nullptr;
+            if (slots_[(start + i) % num_slots_].compare_exchange_strong(expected, list, std::memory_order_release,
+                                                                         std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        num_lists_.fetch_sub(1, std::memory_order_relaxed);
+        delete list;
+    }
+
+    // Threads start probing at different slots so they rarely contend on the same cache line.
+    static size_t
+    slotHint() {
+        static thread_local const size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        return hint;
+    }
+
+    size_t numelements_;
+    size_t num_slots_;
+    std::unique_ptr<std::atomic<VisitedList*>[]> slots_;
+    std::atomic<int64_t> num_lists_{0};
 };
 }  // namespace hnswlib